@@ -0,0 +1,153 @@
+/**
+  ******************************************************************************
+  * @file    button.c
+  * @brief   User button (the BLUE button of the STM32F0-Discovery, PA0,
+  *          high when pressed) on EXTI0, debounced by a timer.
+  *
+  *          The first edge masks EXTI0 and posts EVT_BUTTON_EDGE; the main
+  *          loop calls BTN_Edge, that starts a timer of BTN_DEBOUNCE_MS.
+  *          When it expires the level is read and EXTI0 unmasked: the
+  *          bounces cost one interrupt, and nothing is polled.
+  *
+  *          A press is posted as EVT_BUTTON when it is over:
+  *          - BTN_SHORT when the button is released before BTN_LONG_MS;
+  *          - BTN_LONG as soon as it has been held for BTN_LONG_MS, so the
+  *            user sees when to release it. The release is then ignored.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "button.h"
+#include "event.h"
+#include "timer.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static TMR_TypeDef BtnDebounce;			// Runs while EXTI0 is masked
+static TMR_TypeDef BtnLong;					// Runs while the button is held, before BTN_LONG
+static uint8_t     BtnLevel = 0;		// Debounced level of PA0, 1 == pressed
+
+/* Private function prototypes -----------------------------------------------*/
+static void BTN_Debounced(void);
+static void BTN_LongPress(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Configures PA0 as input and EXTI0 on both edges.
+  *         EVT_Init and TMR_Init must have been called.
+  * @param  None
+  * @retval None
+  */
+void BTN_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStructure;
+  EXTI_InitTypeDef EXTI_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_GPIOA, ENABLE);
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
+
+  /* PA0: input, floating (the board has the pull-down) */
+  GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0;
+  GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
+  GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+  GPIO_Init(GPIOA, &GPIO_InitStructure);
+  BtnLevel = GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_0);
+
+  /* EXTI0 on PA0, both edges */
+  SYSCFG_EXTILineConfig(EXTI_PortSourceGPIOA, EXTI_PinSource0);
+  EXTI_InitStructure.EXTI_Line = EXTI_Line0;
+  EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+  EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising_Falling;
+  EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+  EXTI_Init(&EXTI_InitStructure);
+
+  NVIC_InitStructure.NVIC_IRQChannel = EXTI0_1_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+}
+
+/**
+  * @brief  EVT_BUTTON_EDGE: starts the debounce. To be called from the main
+  *         loop.
+  * @param  None
+  * @retval None
+  */
+void BTN_Edge(void)
+{
+  TMR_Start(&BtnDebounce, BTN_DEBOUNCE_MS, 0, BTN_Debounced);
+}
+
+/**
+  * @brief  Debounced state of the button.
+  * @param  None
+  * @retval 1 if it is pressed, 0 otherwise
+  */
+uint8_t BTN_Pressed(void)
+{
+  return BtnLevel;
+}
+
+/**
+  * @brief  PA0 changed: masks EXTI0 until the level is stable and tells the
+  *         main loop. Called from EXTI0_1_IRQHandler.
+  * @param  None
+  * @retval None
+  */
+void BTN_EXTI_IRQHandler(void)
+{
+  if (EXTI_GetITStatus(EXTI_Line0) == RESET)
+    return;
+  EXTI_ClearITPendingBit(EXTI_Line0);
+  EXTI->IMR &= ~EXTI_Line0;
+  EVT_PostOnce(EVT_BUTTON_EDGE);
+}
+
+/**
+  * @brief  BtnDebounce expired: reads PA0 and unmasks EXTI0, then handles
+  *         the press or the release.
+  * @param  None
+  * @retval None
+  */
+static void BTN_Debounced(void)
+{
+  uint8_t Level = GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_0);
+
+  EXTI_ClearITPendingBit(EXTI_Line0);
+  EXTI->IMR |= EXTI_Line0;
+
+  // An edge between the read and the unmask has no interrupt: debounce again
+  if (GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_0) != Level)
+  {
+    EXTI->IMR &= ~EXTI_Line0;
+    BTN_Edge();
+    return;
+  }
+
+  if (Level == BtnLevel)
+    return;		// a glitch shorter than the debounce
+  BtnLevel = Level;
+
+  if (Level)
+    TMR_Start(&BtnLong, BTN_LONG_MS, 0, BTN_LongPress);
+  else if (TMR_Active(&BtnLong))
+  {
+    TMR_Stop(&BtnLong);
+    EVT_Post(EVT_BUTTON, BTN_SHORT);
+  }
+}
+
+/**
+  * @brief  BtnLong expired: the button is still held.
+  * @param  None
+  * @retval None
+  */
+static void BTN_LongPress(void)
+{
+  EVT_Post(EVT_BUTTON, BTN_LONG);
+}
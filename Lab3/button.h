@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    button.h
+  * @brief   Header for button.c: user button on PA0 (EXTI0), debounced by a
+  *          timer, short and long presses.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BUTTON_H
+#define __BUTTON_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+#define BTN_DEBOUNCE_MS		20		// ms without edges before the level is read
+#define BTN_LONG_MS				3000	// ms held down for a long press
+
+// Data of EVT_BUTTON
+#define BTN_SHORT					1			// Released before BTN_LONG_MS
+#define BTN_LONG					2			// Held for BTN_LONG_MS, posted before the release
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void    BTN_Init(void);
+void    BTN_Edge(void);
+uint8_t BTN_Pressed(void);
+void    BTN_EXTI_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BUTTON_H */
@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file    event.c
+  * @brief   Queue of the events posted by the interrupts to the main loop.
+  *
+  *          The interrupts only tell what happened (a tick, new bytes from
+  *          the STM WiFi module, a character on COM1, the button) and the
+  *          main loop does the work when it takes the event, instead of
+  *          looking at every buffer and flag on every turn.
+  *
+  *          There is one consumer, the main loop, that owns EvtHead, and
+  *          several producers, the interrupts, that can preempt each other.
+  *          The Cortex-M0 has no LDREX/STREX: a post masks the interrupts
+  *          for the few instructions that reserve and fill a slot, then
+  *          EvtTail is moved with a single byte store. The main loop reads
+  *          without masking: it sees a slot only when it is complete.
+  *
+  *          Events that only mean "something to look at" (EVT_TICK, EVT_RX)
+  *          are posted with EVT_PostOnce: at most one of each type waits in
+  *          the queue, so a main loop busy for a while finds one
+  *          event instead of a full queue.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "event.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define EVT_QUEUE_MASK		(EVT_QUEUE_SIZE - 1)
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static EVT_TypeDef EvtQueue[EVT_QUEUE_SIZE];
+static __IO uint8_t  EvtHead = 0;			// Oldest event, written only by EVT_Get
+static __IO uint8_t  EvtTail = 0;			// First free slot, written only with the interrupts masked
+static __IO uint32_t EvtWaiting = 0;		// Types posted with EVT_PostOnce and not taken yet
+static __IO uint16_t EvtLost = 0;			// Events dropped because the queue was full
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Empties the queue.
+  * @param  None
+  * @retval None
+  */
+void EVT_Init(void)
+{
+  uint32_t Mask = __get_PRIMASK();
+
+  __disable_irq();
+  EvtHead = 0;
+  EvtTail = 0;
+  EvtWaiting = 0;
+  EvtLost = 0;
+  __set_PRIMASK(Mask);
+}
+
+/**
+  * @brief  Posts an event. Can be called from any interrupt and from the
+  *         main loop.
+  * @param  Type: EVT_xxx
+  * @param  Data: depends on the type
+  * @retval PASS, or FAIL if the queue is full (the event is lost)
+  */
+uint8_t EVT_Post(uint8_t Type, uint16_t Data)
+{
+  uint32_t Mask = __get_PRIMASK();
+  uint8_t  Tail;
+
+  __disable_irq();
+  Tail = EvtTail;
+  if (((Tail + 1) & EVT_QUEUE_MASK) == EvtHead)
+  {
+    EvtLost++;
+    __set_PRIMASK(Mask);
+    return FAIL;
+  }
+  EvtQueue[Tail].Type = Type;
+  EvtQueue[Tail].Data = Data;
+  EvtTail = (Tail + 1) & EVT_QUEUE_MASK;
+  __set_PRIMASK(Mask);
+
+  return PASS;
+}
+
+/**
+  * @brief  Posts an event without data, unless one of the same type is
+  *         already waiting.
+  * @param  Type: EVT_xxx
+  * @retval PASS if posted or already waiting, FAIL if the queue is full
+  */
+uint8_t EVT_PostOnce(uint8_t Type)
+{
+  uint32_t Mask = __get_PRIMASK();
+  uint32_t Bit = (uint32_t)1 << Type;
+  uint8_t  Status = PASS;
+
+  __disable_irq();
+  if ((EvtWaiting & Bit) == 0)
+  {
+    Status = EVT_Post(Type, 0);
+    if (Status == PASS)
+      EvtWaiting |= Bit;
+  }
+  __set_PRIMASK(Mask);
+
+  return Status;
+}
+
+/**
+  * @brief  Takes the oldest event. Only the main loop can call it.
+  * @param  pEvent: where to copy the event
+  * @retval Its type, EVT_NONE if the queue is empty
+  */
+uint8_t EVT_Get(EVT_TypeDef *pEvent)
+{
+  uint8_t Head = EvtHead;
+  uint32_t Mask;
+
+  if (Head == EvtTail)
+    return EVT_NONE;
+
+  *pEvent = EvtQueue[Head];
+
+  // From now on the same type can be posted again: cleared before the slot
+  // is freed, so a post in between is never skipped (at worst it is twice)
+  if (EvtWaiting & ((uint32_t)1 << pEvent->Type))
+  {
+    Mask = __get_PRIMASK();
+    __disable_irq();
+    EvtWaiting &= ~((uint32_t)1 << pEvent->Type);
+    __set_PRIMASK(Mask);
+  }
+  EvtHead = (Head + 1) & EVT_QUEUE_MASK;
+
+  return pEvent->Type;
+}
+
+/**
+  * @brief  Tests if an event is waiting. To test it before sleeping, call
+  *         it with the interrupts masked: a WFI still wakes up on the
+  *         interrupt that is pending.
+  * @param  None
+  * @retval 1 if EVT_Get would return an event, 0 otherwise
+  */
+uint8_t EVT_Pending(void)
+{
+  return EvtHead != EvtTail;
+}
+
+/**
+  * @brief  Events lost because the queue was full.
+  * @param  None
+  * @retval Number of events
+  */
+uint16_t EVT_Overruns(void)
+{
+  return EvtLost;
+}
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    event.h
+  * @brief   Header for event.c: queue of the events posted by the interrupts
+  *          to the main loop.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __EVENT_H
+#define __EVENT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t  Type;		// EVT_xxx
+  uint16_t Data;		// Depends on the type
+} EVT_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define EVT_QUEUE_SIZE		16		// Events waiting, must be a power of 2
+
+// Event types, at most 32
+#define EVT_NONE					0			// Returned by EVT_Get when the queue is empty
+#define EVT_TICK					1			// SysTick, 1 ms (posted once)
+#define EVT_RX						2			// New bytes from the STM WiFi module (posted once)
+#define EVT_COM1_RX				3			// Character from COM1, Data = the character
+#define EVT_BUTTON				4			// User button pressed, Data = BTN_SHORT or BTN_LONG
+#define EVT_BUTTON_EDGE		5			// PA0 changed, debounced by BTN_Edge (posted once)
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void     EVT_Init(void);
+uint8_t  EVT_Post(uint8_t Type, uint16_t Data);
+uint8_t  EVT_PostOnce(uint8_t Type);
+uint8_t  EVT_Get(EVT_TypeDef *pEvent);
+uint8_t  EVT_Pending(void);
+uint16_t EVT_Overruns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENT_H */
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    idle.c
+  * @brief   Low-power wait of the main loop when no event is waiting.
+  *
+  *          The main loop takes the events posted by the interrupts (see
+  *          event.c); when the queue is empty it calls IDLE_Wait, that
+  *          sleeps until the next interrupt, as SleepMode_Measure of Lab1
+  *          does:
+  *
+  *          - IDLE_RUN: never sleeps, the main loop spins on EVT_Get.
+  *          - IDLE_SLEEP: Sleep mode (WFI). The clocks, the DMA and the
+  *            peripherals keep running, SysTick wakes the core every ms.
+  *
+  *          The queue is tested with the interrupts masked and the WFI is
+  *          done before unmasking them: an event posted in between leaves
+  *          its interrupt pending and the WFI returns at once.
+  *
+  *          Stop mode is not used. USART2 of the STM32F051 has no wake-up
+  *          from Stop, only an EXTI falling edge on PA3 (its RX) could wake
+  *          the MCU, on the start bit. Then the core runs on the HSI while
+  *          USART2 has the baud rate of the PLL clock: the first bytes are
+  *          lost until SystemInit has locked the PLL again, two or three
+  *          at 115200. The retries of the AT engine cover a lost reply, not
+  *          what the module sends on its own: a web command, a +WIND
+  *          message or a frame of the peer would lose its head, and
+  *          nothing sends them again. In Stop the SysTick, TIM3 and the
+  *          DMA stop too: no timeout, no LED pattern.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "idle.h"
+#include "event.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static uint8_t IdlePolicy = IDLE_RUN;
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Sets the idle policy, at boot or later to change it.
+  * @param  Policy: IDLE_RUN or IDLE_SLEEP
+  * @retval None
+  */
+void IDLE_Init(uint8_t Policy)
+{
+  IdlePolicy = Policy;
+}
+
+/**
+  * @brief  Current idle policy.
+  * @param  None
+  * @retval IDLE_RUN or IDLE_SLEEP
+  */
+uint8_t IDLE_GetPolicy(void)
+{
+  return IdlePolicy;
+}
+
+/**
+  * @brief  Sleeps until the next interrupt if no event is waiting. To be
+  *         called by the main loop when EVT_Get returns EVT_NONE.
+  * @param  None
+  * @retval Mode entered: IDLE_RUN (an event was waiting or the policy is
+  *         IDLE_RUN) or IDLE_SLEEP
+  */
+uint8_t IDLE_Wait(void)
+{
+  uint32_t Mask = __get_PRIMASK();
+  uint8_t  Mode = IdlePolicy;
+
+  if (Mode == IDLE_RUN)
+    return IDLE_RUN;
+
+  __disable_irq();
+  if (EVT_Pending())
+    Mode = IDLE_RUN;
+  else
+    __WFI();
+  __set_PRIMASK(Mask);
+
+  return Mode;
+}
@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file    idle.h
+  * @brief   Header for idle.c: low-power wait of the main loop when no event
+  *          is waiting.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IDLE_H
+#define __IDLE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+// Idle policies, also the mode returned by IDLE_Wait. Only Run and Sleep: in Stop
+// mode the bytes the module sends on its own are lost on wake-up (see idle.c)
+#define IDLE_RUN					0			// Never sleeps: the main loop spins on EVT_Get
+#define IDLE_SLEEP				1			// Sleep mode (WFI) until the next interrupt
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void    IDLE_Init(uint8_t Policy);
+uint8_t IDLE_GetPolicy(void);
+uint8_t IDLE_Wait(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IDLE_H */
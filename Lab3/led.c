@@ -0,0 +1,194 @@
+/**
+  ******************************************************************************
+  * @file    led.c
+  * @brief   Blinking patterns of the LEDs on PC6, PC8 and PC9 produced by
+  *          TIM3 and DMA, without the CPU.
+  *
+  *          The pins are the TIM3 channels 1, 3 and 4 in PWM mode 1. TIM3
+  *          counts ms and overflows every LED_STEP_MS: at every update
+  *          DMA1 Channel3 writes the next line of LedSteps in CCR1..CCR4 in
+  *          one burst (TIM3->DMAR), going around the table in circular mode.
+  *          A CCR of LED_STEP_MS keeps the output on for the whole step,
+  *          0 keeps it off, so a pattern is a bit per step.
+  *
+  *          Once LED_Set has written the table nothing else runs: the
+  *          patterns go on while the core sleeps (Sleep mode only, TIM3 and
+  *          the DMA are stopped in Stop mode). All the LEDs share the steps,
+  *          so they flash in phase.
+  *
+  *          The output data register of the pins is kept equal to the state
+  *          of the LEDs (1 == pattern not OFF), so GPIO_ReadOutputDataBit
+  *          still tells if a LED is lit. The pins are in alternate function
+  *          mode: a write in the register (the io: command) does not reach
+  *          them, it is only the intent, on or off, applied by LED_Update.
+  *          The io: PWM operations (duty, pattern) come in by LED_SetPin.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "led.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define LED_CHANNELS			4			// CCR1..CCR4, written by every burst
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static uint16_t LedSteps[LED_STEPS][LED_CHANNELS];	// Read by DMA1 Channel3
+static uint16_t LedPattern[LED_CHANNELS];
+static const uint16_t LedPins[LED_CHANNELS] = { GPIO_Pin_6, 0, GPIO_Pin_8, GPIO_Pin_9 };	// 0 == no LED on the channel
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Configures PC6, PC8, PC9, TIM3 and DMA1 Channel3. All the LEDs
+  *         are off.
+  * @param  None
+  * @retval None
+  */
+void LED_Init(void)
+{
+  GPIO_InitTypeDef        GPIO_InitStructure;
+  TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+  TIM_OCInitTypeDef       TIM_OCInitStructure;
+  DMA_InitTypeDef         DMA_InitStructure;
+  uint8_t Step, Led;
+
+  for (Step = 0; Step < LED_STEPS; Step++)
+    for (Led = 0; Led < LED_CHANNELS; Led++)
+      LedSteps[Step][Led] = 0;
+  for (Led = 0; Led < LED_CHANNELS; Led++)
+    LedPattern[Led] = LED_PATTERN_OFF;
+
+  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_GPIOC | RCC_AHBPeriph_DMA1, ENABLE);
+  RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+
+  /* PC6, PC8 and PC9: TIM3_CH1, TIM3_CH3, TIM3_CH4 (AF0), push-pull */
+  GPIO_ResetBits(GPIOC, GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9);
+  GPIO_PinAFConfig(GPIOC, GPIO_PinSource6, GPIO_AF_0);
+  GPIO_PinAFConfig(GPIOC, GPIO_PinSource8, GPIO_AF_0);
+  GPIO_PinAFConfig(GPIOC, GPIO_PinSource9, GPIO_AF_0);
+  GPIO_InitStructure.GPIO_Pin = GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9;
+  GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF;
+  GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
+  GPIO_InitStructure.GPIO_Speed = GPIO_Speed_2MHz;
+  GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+  GPIO_Init(GPIOC, &GPIO_InitStructure);
+
+  /* TIM3: 1 kHz count, update every LED_STEP_MS */
+  TIM_TimeBaseStructure.TIM_Prescaler = (SystemCoreClock / 1000) - 1;
+  TIM_TimeBaseStructure.TIM_Period = LED_STEP_MS - 1;
+  TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+  TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+  TIM_TimeBaseInit(TIM3, &TIM_TimeBaseStructure);
+
+  /* PWM mode 1, active high: on while the counter is below CCRx */
+  TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
+  TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
+  TIM_OCInitStructure.TIM_Pulse = 0;
+  TIM_OCInitStructure.TIM_OCPolarity = TIM_OCPolarity_High;
+  TIM_OC1Init(TIM3, &TIM_OCInitStructure);
+  TIM_OC3Init(TIM3, &TIM_OCInitStructure);
+  TIM_OC4Init(TIM3, &TIM_OCInitStructure);
+  TIM_OC1PreloadConfig(TIM3, TIM_OCPreload_Enable);
+  TIM_OC3PreloadConfig(TIM3, TIM_OCPreload_Enable);
+  TIM_OC4PreloadConfig(TIM3, TIM_OCPreload_Enable);
+  TIM_ARRPreloadConfig(TIM3, ENABLE);
+
+  /* DMA1 Channel3 (TIM3_UP): LedSteps -> TIM3->DMAR, half word, circular */
+  DMA_DeInit(DMA1_Channel3);
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&TIM3->DMAR;
+  DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)LedSteps;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+  DMA_InitStructure.DMA_BufferSize = LED_STEPS * LED_CHANNELS;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+  DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+  DMA_Init(DMA1_Channel3, &DMA_InitStructure);
+  DMA_Cmd(DMA1_Channel3, ENABLE);
+
+  /* Every update writes CCR1..CCR4 in one burst */
+  TIM_DMAConfig(TIM3, TIM_DMABase_CCR1, TIM_DMABurstLength_4Transfers);
+  TIM_DMACmd(TIM3, TIM_DMA_Update, ENABLE);
+  TIM_Cmd(TIM3, ENABLE);
+}
+
+/**
+  * @brief  Sets the pattern of a LED, from the next step on.
+  * @param  Led: LED_RED, LED_BLUE or LED_GREEN
+  * @param  Pattern: LED_PATTERN_xxx, bit n == on during step n
+  * @retval None
+  */
+void LED_Set(uint8_t Led, uint16_t Pattern)
+{
+  uint8_t Step;
+
+  if ((Led >= LED_CHANNELS) || (LedPins[Led] == 0))
+    return;
+
+  LedPattern[Led] = Pattern;
+  for (Step = 0; Step < LED_STEPS; Step++)
+    LedSteps[Step][Led] = (Pattern & (1 << Step)) ? LED_STEP_MS : 0;
+
+  if (Pattern != LED_PATTERN_OFF)
+    GPIOC->BSRR = LedPins[Led];
+  else
+    GPIOC->BRR = LedPins[Led];
+}
+
+/**
+  * @brief  Sets the pattern of the LED on a pin of GPIOC, WIFI_IoPattern of
+  *         the io: command.
+  * @param  Pin: GPIO_Pin_6, GPIO_Pin_8 or GPIO_Pin_9, the others are ignored
+  * @param  Pattern: bit n == on during step n
+  * @retval None
+  */
+void LED_SetPin(uint16_t Pin, uint16_t Pattern)
+{
+  uint8_t Led;
+
+  for (Led = 0; Led < LED_CHANNELS; Led++)
+  {
+    if ((LedPins[Led] != 0) && (LedPins[Led] == Pin))
+      LED_Set(Led, Pattern);
+  }
+}
+
+/**
+  * @brief  Pattern of a LED.
+  * @param  Led: LED_RED, LED_BLUE or LED_GREEN
+  * @retval LED_PATTERN_xxx
+  */
+uint16_t LED_Get(uint8_t Led)
+{
+  if (Led >= LED_CHANNELS)
+    return LED_PATTERN_OFF;
+  return LedPattern[Led];
+}
+
+/**
+  * @brief  Applies the writes in GPIOC->ODR: a LED whose bit has been set is
+  *         turned on, one whose bit has been reset is turned off, the others
+  *         keep their pattern.
+  * @param  None
+  * @retval None
+  */
+void LED_Update(void)
+{
+  uint16_t Odr = GPIOC->ODR;
+  uint8_t  Led;
+
+  for (Led = 0; Led < LED_CHANNELS; Led++)
+  {
+    if ((LedPins[Led] == 0) || (((Odr & LedPins[Led]) != 0) == (LedPattern[Led] != LED_PATTERN_OFF)))
+      continue;
+    LED_Set(Led, (Odr & LedPins[Led]) ? LED_PATTERN_ON : LED_PATTERN_OFF);
+  }
+}
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    led.h
+  * @brief   Header for led.c: blinking patterns of the LEDs on PC6, PC8 and
+  *          PC9 produced by TIM3 and DMA, without the CPU.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LED_H
+#define __LED_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+// LEDs: the value is the TIM3 channel - 1
+#define LED_RED						0			// PC6, TIM3_CH1
+#define LED_BLUE					2			// PC8, TIM3_CH3
+#define LED_GREEN					3			// PC9, TIM3_CH4
+
+#define LED_STEPS					16		// Steps of a pattern, one bit each
+#define LED_STEP_MS				32		// ms of a step: a pattern lasts 512 ms
+
+// Patterns: bit n == the LED is on during step n
+#define LED_PATTERN_OFF				0x0000
+#define LED_PATTERN_ON				0xFFFF
+#define LED_PATTERN_FLASH			0x00FF	// 256 ms on, 256 ms off
+#define LED_PATTERN_FAST			0x3333	// 4 flashes per pattern
+#define LED_PATTERN_DOUBLE		0x0033	// two short flashes, then off
+
+/* Exported macro ------------------------------------------------------------*/
+#define LED_PATTERN_DUTY(n)		((uint16_t)((1UL << (n)) - 1))	// on for n steps of 16
+
+/* Exported functions ------------------------------------------------------- */
+void     LED_Init(void);
+void     LED_Set(uint8_t Led, uint16_t Pattern);
+void     LED_SetPin(uint16_t Pin, uint16_t Pattern);
+uint16_t LED_Get(uint8_t Led);
+void     LED_Update(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LED_H */
@@ -29,6 +29,10 @@
 	*          |/|   |__________|
 	*
 	* For do the connection just press and release the blue button on the STM32F0-Discovery.
+	*		Hold it for 3 seconds (BTN_LONG_MS) to restore the factory settings of the STM WiFi module
+	*		before the connection: both the Leds flash fast when it can be released.
+	* The configuration saved on the module and the state of the Leds are kept in the flash (see persist.c):
+	*		after a reset there is no need to press the button again, the module joins the network by itself.
 	* When the Led D5 is ON (Led D5 is on the STM WiFi module), the WiFi connection is active.
 	*		For do this it is necessary some seconds, during the set up and connection the Blue Led
 	*		on the STM32F0-Discovery is flashing.
@@ -59,11 +63,11 @@
 	*
 	* RouterName ______________________________________
 	*                                                  |
-	* 	uint8_t TxBuffer_RouterName[] = "at+s.ssidtxt=NETGEAR-3G\n\r";
+	* 	const WIFI_AtCommand_TypeDef AtCmd_RouterName = WIFI_AT_COMMAND("at+s.ssidtxt=NETGEAR-3G\n\r", &AtReply_Setting);
 	*
 	* RouterPassword _______________________________________________
 	*                                                               |
-	*		uint8_t TxBuffer_RouterPW[] = "at+s.scfg=wifi_wpa_psk_text,XYZ\n\r";
+	*		const WIFI_AtCommand_TypeDef AtCmd_RouterPW = WIFI_AT_COMMAND("at+s.scfg=wifi_wpa_psk_text,XYZ\n\r", &AtReply_Setting);
 	*
 	***
 
@@ -75,10 +79,11 @@
 	* 	BLed_ON 		// Turn ON  the Blue Led
 	* 	GLed_OFF 		// Turn OFF the Green Led
 	* 	HLed_ON 		// Turn ON  the Green Led
+	* 	BLed_FLASH	// Blue Led flashing
+	* 	GLed_FLASH	// Green Led flashing
 	*
-	* The variables below are used in stm32f0xx_it.c for flashing leds
-	* 	LBflash=0;	// Led Blue  0==FlashOFF 1==FlashON
-	* 	LGflash=0;	// Led Green 0==FlashOFF 1==FlashON
+	* The LEDs are driven by TIM3 and DMA (see led.c): LED_Set gives any LED a pattern
+	*		(LED_PATTERN_FLASH, LED_PATTERN_DOUBLE, ...) that goes on without the CPU
 	*
 	* For remember the status of the leds use the variables below
 	* 	LedG=0; 		// Led Greem 0==OFF 1==ON
@@ -91,10 +96,50 @@
 					USART_WordLength 					= USART_WordLength_8b;
 					USART_StopBits 						= USART_StopBits_1;
 					USART_Parity 							= USART_Parity_No;
-					USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+					USART_HardwareFlowControl = USART_HardwareFlowControl_None;	// no RTS/CTS on USART2: CTS would be PA0
 					USART_Mode 								= USART_Mode_Rx | USART_Mode_Tx;
 
-	*** NOTE: the string RxBuffer contain the string received from USART2
+	*** USART2 transmission is done by DMA1 Channel4 from a queue of buffers, see wifi_uart.c
+
+	*** NOTE: the RxBuffer (in wifi_uart.c) is a ring buffer that contains the string received from USART2,
+	***       it is scanned incrementally with WIFI_MatchPoll (see RxStringHandler) and cleared with Clr_RxBuffer
+
+	*** The configuration of the STM WiFi module (ConfigureWiFi) is sent by the non blocking AT engine
+	***       (see wifi_at.c), advanced by WIFI_AtProcess in the main loop, with a timeout on every answer
+
+	*** The LED commands (lgon lgoff lbon lboff) are applied by RxStringHandler as soon as they are scanned,
+	***       the led.html page is uploaded later, once for a burst of commands (see Refresh_LedPage)
+	***       With LedPageDynamic the page is led.shtml, uploaded once: a LED change sends only the status
+	***       string (at+s.inputssi, 46 bytes) instead of fsd + fsc + fsa + the whole page (281 bytes)
+	***       led.shtml and the files it uses are in the table of web_assets.c, streamed from flash in
+	***       chunks of 256 bytes, each one paced by its OK (see wifi_asset.c). web_assets.c is written
+	***       by tools/web_assets.py from the files in web/, compressed with gzip when it is shorter
+
+	*** Any writable pin is set by the io: command (see wifi_io.c), several pins in one command:
+	***       e.g. io:c8=1,c9=0,c+40 - the status string shows the number and the result of the last one
+	***       The LEDs are TIM3 outputs: =, + and - turn them on or off, io:c9%25 (duty) and
+	***       io:c8*00FF (pattern of 16 steps) set their PWM through led.c
+
+	*** With FrameChannel the commands can also arrive as binary frames on a socket of the module
+	***       (COBS, CRC-32, sequence numbers and acks, see wifi_frame.c): the payload is the command
+
+	*** The interrupts do not share flags with the main loop: they post events (tick, bytes from the
+	***       module, COM1 character, button edge) in the queue of event.c, the main loop takes them
+	***       The button is on EXTI0, debounced by a timer: short and long presses, see button.c
+
+	*** Counters and latency histograms (AT round trip, page upload, reconnects, overruns, main loop time)
+	***       are kept in RAM by metrics.c and uploaded as metrics.json when they change (see Load_MetricsPage):
+	***       open 192.168.0.5/metrics.json
+
+	*** A failure of the module (+WIND:42, 43, 44 or 34) is recovered from the cheapest step:
+	***       a reconnect (at+s.roam), then a Soft Reset with the saved settings, then ConfigureWiFi,
+	***       with an exponential backoff and at most 3 resets a minute (see recover.c and Cmd_Fail)
+
+	*** Nothing waits with Delay(): the waits are software timers (see timer.c) or the Delay of the answer
+	***       expected by the AT engine, so the main loop keeps running during them
+
+	*** When no event is waiting the main loop sleeps (see idle.c and IdlePolicy): Sleep mode until the
+	***       next interrupt. Not Stop mode: USART2 cannot wake up from it without losing bytes
 
   ******************************************************************************
   * @file    USART/HyperTerminal_Interrupt/main.c
@@ -126,6 +171,23 @@
 #include "main.h"
 #include "eeprom.h"
 #include "Definizioni.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+#include "wifi_strings.h"
+#include "wifi_cmd.h"
+#include "wifi_at.h"
+#include "wifi_page.h"
+#include "wifi_io.h"
+#include "wifi_frame.h"
+#include "event.h"
+#include "metrics.h"
+#include "timer.h"
+#include "led.h"
+#include "idle.h"
+#include "button.h"
+#include "persist.h"
+#include "recover.h"
+#include "wifi_asset.h"
 #include <string.h>
 
 /** @addtogroup STM32F0xx_StdPeriph_Examples
@@ -136,38 +198,71 @@
   * @{
   */
 
-typedef enum {FAILED = 0, PASSED = !FAILED} TestStatus;
-
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 // Define the commands for the Red, Blue Led OFF and ON
-#define BLed_OFF	GPIO_ResetBits(GPIOC, GPIO_Pin_8) // Blue LED OFF
-#define BLed_ON		GPIO_SetBits(GPIOC, GPIO_Pin_8) 	// Blue LED ON
+#define BLed_OFF	LED_Set(LED_BLUE, LED_PATTERN_OFF) 		// Blue LED OFF
+#define BLed_ON		LED_Set(LED_BLUE, LED_PATTERN_ON) 		// Blue LED ON
+#define BLed_FLASH	LED_Set(LED_BLUE, LED_PATTERN_FLASH) 	// Blue LED flashing
 // Define the commands for the Green Led OFF and ON
-#define GLed_OFF	GPIO_ResetBits(GPIOC, GPIO_Pin_9)	// Green LED OFF
-#define GLed_ON		GPIO_SetBits(GPIOC, GPIO_Pin_9) 	// Green LED ON
+#define GLed_OFF	LED_Set(LED_GREEN, LED_PATTERN_OFF)		// Green LED OFF
+#define GLed_ON		LED_Set(LED_GREEN, LED_PATTERN_ON) 		// Green LED ON
+#define GLed_FLASH	LED_Set(LED_GREEN, LED_PATTERN_FLASH)	// Green LED flashing
 // Define the commands for the Red Led OFF and ON
-#define RLed_OFF	GPIO_ResetBits(GPIOC, GPIO_Pin_6)	// Red LED OFF
-#define RLed_ON		GPIO_SetBits(GPIOC, GPIO_Pin_6) 	// Red LED ON
-
-#define TXBUFFERSIZE   (countof(TxBuffer_AT) - 1)
-
-// Commands available ******************************************************************
-#define RxLBOFF  "lboff"	// Led Blue OFF
-#define RxLBON   "lbon"		// Led Blue ON
-#define RxLGOFF  "lgoff"	// Led Green OFF
-#define RxLGON   "lgon"		// Led Green ON
-#define RxClrBuf "X"			// Clear RxBuffer
-#define RxReset  "reset"	// Reset the STM WiFi module, it reload the WiFi configuration
-													//		received from STM32F0-Discovery.
-													//		During the reset the Blue Led is flashing.
-#define SCAN			"scan" // scan command MV
-#define GET_IP		"get_ip"	// obtain ip command MV
-#define POST_IP		"post_ip"		// obtain IP address and print it on HTERM
-
-// Received strings used for test the status of STM WiFi
-#define WiFi_IP		":WiFi Up:"  	// This means that STM WiFi is connected to WiFi Network
-#define WiFi_OK		"OK"					// This is the answer at the AT command
+#define RLed_OFF	LED_Set(LED_RED, LED_PATTERN_OFF)			// Red LED OFF
+#define RLed_ON		LED_Set(LED_RED, LED_PATTERN_ON) 			// Red LED ON
+
+// Commands available and strings received: see wifi_strings.h
+
+// AT engine timeouts
+#define AtTimeout				2000		// ms to wait for the OK of an AT command
+#define AtRetries				2				// times an AT command is sent again before failing
+#define WiFiUpTimeout		30000		// ms to wait for :WiFi Up: after the Soft Reset
+#define ResumeUpTimeout	15000		// ms to wait at boot for the :WiFi Up: of a module already provisioned
+#define LedSaveDly			2000		// ms without LED commands before the LED state goes in the EEPROM
+#define QueryTimeout		10000		// ms to wait for the OK of scan, get_ip and post_ip
+
+#define ClrBufDly				1000		// ms between the two clears of the X command
+#define ResetRestoreDly	2000		// ms after ResetSTMWiFIModule_retainsLEDs configured the module
+
+// Longest sequence of AT commands queued at once (ConfigureWiFi): at&f, the 6 settings and the tag,
+//		at&w and the Soft Reset. The pages follow from ConfigureWiFi_Up, on a queue emptied
+#define ConfigureWiFiCmds	(1 + 7 + 1 + 1)
+WIFI_AT_FITS(ConfigureWiFi_Fits, ConfigureWiFiCmds);
+
+#define IpMaxLength	19					// longest value accepted as IP address in the at+s.sts answer
+
+// led.html refresh
+#define PageRefreshDly	100			// ms without LED commands before led.html is uploaded
+#define PageRetryDly		5000		// ms before uploading again after a failure
+
+// metrics.json refresh
+#define MetricsRefreshDly	10000	// ms between two uploads of metrics.json, at least
+
+// 1 == the LED status is shown by led.shtml, uploaded once by ConfigureWiFi: the module puts the
+//		string set with at+s.inputssi in place of its SSI tag, so a LED change sends only that string.
+// 0 == a LED change deletes and uploads again the whole led.html
+#define LedPageDynamic	1
+
+// 1 == ConfigureWiFi opens a TCP socket towards FrameHost: the commands can arrive as binary
+//		frames too (see wifi_frame.c and tools/wifi_frame.py). The socket is the first one, id 00
+#define FrameChannel	0
+#define FrameHost			"192.168.1.10"
+#define FramePort			"32000"
+
+// What the main loop does when no event is waiting, see idle.c:
+//		IDLE_RUN   == spins on EVT_Get
+//		IDLE_SLEEP == Sleep mode until the next interrupt (SysTick at most 1 ms later)
+#define IdlePolicy		IDLE_SLEEP
+
+// Strings searched in the RxBuffer, the value is the bit in the mask returned
+// by WIFI_MatchPoll() and the index in RxCommands[]
+#define RX_ID(Id, String)	Id,
+enum
+{
+	WIFI_RX_STRINGS(RX_ID)
+	RX_NBR_OF_STRINGS
+};
 
 /* Private macro -------------------------------------------------------------*/
 #define countof(a)   (sizeof(a) / sizeof(*(a)))
@@ -175,106 +270,274 @@ typedef enum {FAILED = 0, PASSED = !FAILED} TestStatus;
 /* Private variables ---------------------------------------------------------*/
 
 // Parsing variables MV
-char *tmp2;			// tmp variable for token parsing
-char *tmp3;			// tmp variable for token parsing
-char tmp_page[250];	// used for sending new html page
-char test[20] = "ip_ipaddr";			//string to find in each token
+uint16_t tmp_offs;	// tmp variable for parsing the answer in the RxBuffer
+uint8_t  IpAddress[IpMaxLength];	// IP address, copied from the at+s.sts answer: the IP page
+uint16_t IpLength = 0;						//	is sent later, the RxBuffer has been overwritten meanwhile
+const uint8_t IpKey[] = "ip_ipaddr";		// string to find in the answer
+uint32_t IpFrom = 0;		// stream position of the at+s.sts sent by get_ip
+uint8_t  IpWanted = 0;	// 1 == the IP is read when the OK of at+s.sts is scanned
 uint8_t ip_flag = 0;	//used within the LoadAppropiate_page function to enter the right if(...) condition
 // MV end
 
-
-uint8_t TxBuffer_AT[] = "at\n\r";
-uint8_t TxBuffer_FAIL1[] = "+WIND:42:RX_MGMT:";
-uint8_t TxBuffer_FAIL2[] = "+WIND:43:RX_DATA:";
-uint8_t TxBuffer_FAIL3[] = "+WIND:44:RX_UNK:";
-uint8_t TxBuffer_FAIL4[] = "+WIND:34:WiFi Unhandled Event:";
-uint8_t TxBuffer_FAIL5[] = "ERROR:";
-
-uint8_t TxBuffer_SCAN[] = "at+s.scan\n\r";			// SCAN command MV
-uint8_t TxBuffer_GET_IP[] = "at+s.sts\n\r";			// GET IP command MV
-uint8_t TxBuffer_POST_IP[] = "at+s.sts=ip_ipaddr\n\r";	// POST IP command MV
-uint8_t TxBuffer_RouterName[] = "at+s.ssidtxt=Robert\n\r"; 										// BBMHem
-uint8_t TxBuffer_RouterPW[] = "at+s.scfg=wifi_wpa_psk_text,maremmamaiala\n\r";	// enrico321
-uint8_t TxBuffer_RouterPotectionMode[] = "at+s.scfg=wifi_priv_mode,2\n\r";			// 2
-uint8_t TxBuffer_RouterRadioInSTAMode[] = "at+s.scfg=wifi_mode,1\n\r"; 					// 1
-uint8_t TxBuffer_RouterDHCPclient[] = "at+s.scfg=ip_use_dhcp,1\n\r";
-uint8_t TxBuffer_RouterSaveSettings[] = "at&w\n\r";
-uint8_t TxBuffer_RouterSoftReset[] = "at+cfun=1\r\n";
+// Tag of the configuration, saved on the module by at&w with the settings: user_desc = lab3-<ConfigHash
+//		in hex>. ResumeWiFi reads it back with at+s.gcfg, the module holds the configuration only if
+//		it matches (at&f, another firmware or a lost at&w give another user_desc)
+uint8_t  ConfigTag[] = "at+s.scfg=user_desc,lab3-0000\n\r";
+#define ConfigTagValue	20		// offset of lab3-XXXX in ConfigTag
+#define ConfigTagLength	9			// length of lab3-XXXX
+const uint8_t ConfigTagKey[] = "user_desc";		// string to find in the answer of at+s.gcfg
+uint32_t ConfigTagFrom = 0;		// stream position of the at+s.gcfg sent by ResumeWiFi_Up
+uint8_t  ConfigTagWanted = 0;	// 1 == the tag is read when the OK of at+s.gcfg is scanned
+uint8_t  ConfigTagMatch = 0;	// 1 == the module answered the tag of ConfigHash
+uint8_t  ResumeStatus = WIFI_AT_OK;	// :WiFi Up: of ResumeWiFi, or its timeout
+
+
+// All the strings sent and searched are const: they stay in flash, they are not copied in RAM
+// Answers expected by the AT engine, the failure string is ERROR: (RX_FAIL5)
+const WIFI_AtReply_TypeDef AtReply_OK =
+	{ WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), AtTimeout, DlyBeforeClrRxBuffer, AtRetries, 0 };
+const WIFI_AtReply_TypeDef AtReply_Setting =	// independent settings: sent back to back, OKs in order
+	{ WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), AtTimeout, DlyBeforeClrRxBuffer, AtRetries, WIFI_AT_PIPELINE };
+const WIFI_AtReply_TypeDef AtReply_WiFiUp =
+	{ WIFI_MATCH_BIT(RX_WIFI_UP), 0, WiFiUpTimeout, 1000, 0, 0 };
+const WIFI_AtReply_TypeDef AtReply_Resume =	// nothing sent: the module boots on its own
+	{ WIFI_MATCH_BIT(RX_WIFI_UP), 0, ResumeUpTimeout, 1000, 0, 0 };
+const WIFI_AtReply_TypeDef AtReply_Sent =	// no answer: done once sent (fsa header, the page follows)
+	{ 0, 0, AtTimeout, 0, 0, 0 };
+const WIFI_AtReply_TypeDef AtReply_Delete =	// fsd: OK, or ERROR: if there is no page, both are fine
+	{ 0, 0, AtTimeout, 1000, 0, 0 };
+const WIFI_AtReply_TypeDef AtReply_Page =	// page data: cannot be sent again without fsc and fsa
+	{ WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), AtTimeout, 1000, 0, 0 };
+const WIFI_AtReply_TypeDef AtReply_SSI =	// status string: no need to wait, the page is not rebuilt
+	{ WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), AtTimeout, 0, 0, 0 };
+const WIFI_AtReply_TypeDef AtReply_Socket =	// socket read and write: the frames are sent again if lost
+	{ WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), AtTimeout, 0, 0, 0 };
+const WIFI_AtReply_TypeDef AtReply_Query =	// scan, get_ip, post_ip: long answer, not sent again
+	{ WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), QueryTimeout, DlyBeforeClrRxBuffer, 0, 0 };
+
+// AT commands: string, length and expected answer
+const WIFI_AtCommand_TypeDef AtCmd_SCAN = WIFI_AT_COMMAND("at+s.scan\n\r", &AtReply_Query);				// SCAN command MV
+const WIFI_AtCommand_TypeDef AtCmd_GET_IP = WIFI_AT_COMMAND("at+s.sts\n\r", &AtReply_Query);				// GET IP command MV
+const WIFI_AtCommand_TypeDef AtCmd_POST_IP = WIFI_AT_COMMAND("at+s.sts=ip_ipaddr\n\r", &AtReply_Query);	// POST IP command MV
+const WIFI_AtCommand_TypeDef AtCmd_RouterName = WIFI_AT_COMMAND("at+s.ssidtxt=Robert\n\r", &AtReply_Setting); 										// BBMHem
+const WIFI_AtCommand_TypeDef AtCmd_RouterPW = WIFI_AT_COMMAND("at+s.scfg=wifi_wpa_psk_text,maremmamaiala\n\r", &AtReply_Setting);	// enrico321
+const WIFI_AtCommand_TypeDef AtCmd_RouterPotectionMode = WIFI_AT_COMMAND("at+s.scfg=wifi_priv_mode,2\n\r", &AtReply_Setting);		// 2
+const WIFI_AtCommand_TypeDef AtCmd_RouterRadioInSTAMode = WIFI_AT_COMMAND("at+s.scfg=wifi_mode,1\n\r", &AtReply_Setting); 			// 1
+const WIFI_AtCommand_TypeDef AtCmd_RouterDHCPclient = WIFI_AT_COMMAND("at+s.scfg=ip_use_dhcp,1\n\r", &AtReply_Setting);
+// No RTS/CTS: the CTS of USART2 is PA0, also the BLUE button (EXTI0), and the STM32F051 has no other
+//		pin for it. Once the module drove it the long press (FactoryReprovision) would be lost. The
+//		chunks of wifi_asset.c are paced by the OKs only
+const WIFI_AtCommand_TypeDef AtCmd_RouterFlowControl = WIFI_AT_COMMAND("at+s.scfg=console1_hwfc,0\n\r", &AtReply_Setting);
+const WIFI_AtCommand_TypeDef AtCmd_RouterSaveSettings = WIFI_AT_COMMAND("at&w\n\r", &AtReply_OK);
+const WIFI_AtCommand_TypeDef AtCmd_FactoryDefaults = WIFI_AT_COMMAND("at&f\n\r", &AtReply_OK);
+const WIFI_AtCommand_TypeDef AtCmd_RouterSoftReset = WIFI_AT_COMMAND("at+cfun=1\r\n", &AtReply_WiFiUp);
+const WIFI_AtCommand_TypeDef AtCmd_ConfigQuery = WIFI_AT_COMMAND("at+s.gcfg=user_desc\n\r", &AtReply_OK);	// the tag, see ConfigTag
+const WIFI_AtCommand_TypeDef AtCmd_FrameSocket = WIFI_AT_COMMAND("at+s.sockon=" FrameHost "," FramePort ",t\n\r", &AtReply_OK);
+const WIFI_AtCommand_TypeDef AtCmd_FrameSocketClose = WIFI_AT_COMMAND("at+s.sockc=00\n\r", &AtReply_Delete);	// ERROR: if already closed
+const WIFI_AtCommand_TypeDef AtCmd_Reconnect = WIFI_AT_COMMAND("at+s.roam\n\r", &AtReply_OK);	// join the network again, see Recover_Run
 
 // HTML Pages
-uint8_t TxBuffer_Delete_led_page[] = "at+s.fsd=/led.html\n\r"; // Delete led.html page
-uint8_t TxBuffer_Prepare_led_page[] = "at+s.fsc=/led.html,210\n\r";	//192
-uint8_t TxBuffer_Prepare_led_page_upload[] = "at+s.fsa=/led.html,210\n\r"; //192
+const WIFI_AtCommand_TypeDef AtCmd_Delete_led_page = WIFI_AT_COMMAND("at+s.fsd=/led.html\n\r", &AtReply_Delete); // Delete led.html page
+const WIFI_AtCommand_TypeDef AtCmd_Delete_metrics = WIFI_AT_COMMAND("at+s.fsd=/metrics.json\n\r", &AtReply_Delete);
+// led.html is written from the templates LedPage and IpPage
+// Dynamic page: led.shtml and its files are in web_assets.c, LedStatusSSI replaces
+// <!--#input_ssi--> when the page is requested.
+// The headers are sent without the final 0, the data that follow them is counted exactly
+// The module reads exactly LedStatusLength chars after the header: a wrong length is a build error
+#define LedStatusLength		28
+#define Text(x)						Text_(x)		// the value of a macro as a string literal
+#define Text_(x)					#x
+const WIFI_AtCommand_TypeDef AtCmd_InputSSI = WIFI_AT_DATA("at+s.inputssi=" Text(LedStatusLength) "\n\r", &AtReply_Sent);
+uint8_t LedStatusSSI[] = "OFF / OFF<br>io 00 ok C=0000";		// Green / Blue, last io: command, always LedStatusLength chars
+typedef char LedStatusSSI_Fits[(countof(LedStatusSSI) - 1 == LedStatusLength) ? 1 : -1];
+
+// Pins written by the io: command: the LEDs, not the USART and the button. They are TIM3
+//		outputs: =, + and - only turn them on or off (LED_Update), % and * set their pattern
+const WIFI_IoPort_TypeDef IoPorts[] =
+{
+	{ 'c', GPIOC, GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9, GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9, LED_SetPin }
+};
+uint32_t IoPos = 0;					// stream position after "io:"
+uint8_t  IoOpen = 0;				// 1 == io: received, it is executed at the end of the line
+uint8_t  IoCount = 0;				// io: commands received, shown in the status string
+uint8_t  IoResult = WIFI_IO_OK;	// result of the last one
+
+uint32_t SockDataPos = 0;		// stream position after +WIND:55:Pending Data:
+uint8_t  SockDataOpen = 0;	// 1 == the length is read at the end of the line
+uint16_t SockPending = 0;		// bytes announced on the socket and not read yet
+uint8_t  FrameCmd[24];			// at+s.sockr being sent
+uint16_t FrameCmdTicket = 0;	// WIFI_TxSubmit ticket of FrameCmd
+
+// led.html template: the HTML shared by all the LED states is stored once, the state of
+// every LED is a field (PageValue). Add a LED with one more label and one more field.
+enum
+{
+	PAGE_LEDG = 0,
+	PAGE_LEDB,
+	PAGE_IP				// IP address, in IpAddress
+};
+const WIFI_PageItem_TypeDef LedPageItems[] =
+{
+	WIFI_PAGE_TEXT("<html><head><meta content='\22'text/html; charset=ISO-8859-1\0x22 http-equiv=\0x22content-type\0x22>"
+								 "<title>Andrea_Floridia-Leds.html</title></head><body> <br>Green_Led is "),
+	WIFI_PAGE_FIELD(PAGE_LEDG),
+	WIFI_PAGE_TEXT(" <br>Blue_Led is "),
+	WIFI_PAGE_FIELD(PAGE_LEDB),
+	WIFI_PAGE_TEXT("<br></body></html>\r\n")
+};
+const char *PageValue(uint8_t Field, uint16_t *pLength);
+const WIFI_Page_TypeDef LedPage = { "/led.html", LedPageItems, countof(LedPageItems), PageValue };
 // MV begin
-uint8_t HTML_IP_1[] = "<html><head><title>Andrea_Floridia-Leds.html</title></head><body> <br>IP: ";		// HTML page in case of IP address
-uint8_t HTML_IP_2[] = "<br></body></html>\r\n";				// HTML page in case of IP address
-uint8_t TxBuffer_led_pageLVoffLBoff[] = "<html><head><meta content='\22'text/html; charset=ISO-8859-1\0x22 http-equiv=\0x22content-type\0x22><title>Andrea_Floridia-Leds.html</title></head><body> <br>Green_Led is OFF <br>Blue_Led is OFF<br></body></html>\r\n";
-uint8_t TxBuffer_led_pageLVonLBoff[] = "<html><head><meta content='\22'text/html; charset=ISO-8859-1\0x22 http-equiv=\0x22content-type\0x22><title>Andrea_Floridia-Leds.html</title></head><body> <br>Green_Led is ON  <br>Blue_Led is OFF<br></body></html>\r\n";
-uint8_t TxBuffer_led_pageLVonLBon[] = "<html><head><meta content='\22'text/html; charset=ISO-8859-1\0x22 http-equiv=\0x22content-type\0x22><title>Andrea_Floridia-Leds.html</title></head><body> <br>Green_Led is ON  <br>Blue_Led is ON <br></body></html>\r\n";
-uint8_t TxBuffer_led_pageLVoffLBon[] = "<html><head><meta content='\22'text/html; charset=ISO-8859-1\0x22 http-equiv=\0x22content-type\0x22><title>Andrea_Floridia-Leds.html</title></head><body> <br>Green_Led is OFF <br>Blue_Led is ON <br></body></html>\r\n";
+// HTML page in case of IP address
+const WIFI_PageItem_TypeDef IpPageItems[] =
+{
+	WIFI_PAGE_TEXT("<html><head><title>Andrea_Floridia-Leds.html</title></head><body> <br>IP: "),
+	WIFI_PAGE_FIELD(PAGE_IP),
+	WIFI_PAGE_TEXT("<br></body></html>\r\n")
+};
+const WIFI_Page_TypeDef IpPage = { "/led.html", IpPageItems, countof(IpPageItems), PageValue };
 // MV end
 
+// Command registry: what to do when a string is received from the STM WiFi module
+//		The matcher gives the index of every string found, so the handler is taken from
+//		the table without comparing strings, whatever the number of commands
+void Cmd_Fail(void);
+void Cmd_ClrBuf(void);
+void Cmd_Reset(void);
+void Cmd_LgOn(uint32_t Pos);
+void Cmd_LgOff(uint32_t Pos);
+void Cmd_LbOn(uint32_t Pos);
+void Cmd_LbOff(uint32_t Pos);
+void Cmd_Io(uint32_t Pos);
+void Cmd_IoEnd(uint32_t Pos);
+void Cmd_SockData(uint32_t Pos);
+void Cmd_SockDataEnd(uint32_t Pos);
+void Cmd_Scan(void);
+void Cmd_GetIp(void);
+void Cmd_PostIp(void);
+void Cmd_OkScan(uint32_t Pos);
+void Cmd_Query_Done(uint8_t Status);
+void Cmd_GetIp_Done(uint8_t Status);
+void Cmd_QueryEnd(void);
+
+// In the order of the RX_xxx values (WIFI_RX_STRINGS). TestRxCommand executes the lowest one first.
+//		OnScan is called by RxStringHandler as soon as the string is scanned, Execute by TestRxCommand:
+//		it must consume the RxBuffer. WIFI_CMD_WEB: a command of the web interface, the only ones
+//		accepted from a frame (Frame_Received). See wifi_cmd.c
+const WIFI_Cmd_TypeDef RxCommands[RX_NBR_OF_STRINGS] =
+{
+	WIFI_CMD(TxBuffer_FAIL1, 0, Cmd_Fail),
+	WIFI_CMD(TxBuffer_FAIL2, 0, Cmd_Fail),
+	WIFI_CMD(TxBuffer_FAIL3, 0, Cmd_Fail),
+	WIFI_CMD(TxBuffer_FAIL4, 0, Cmd_Fail),
+	WIFI_CMD(TxBuffer_FAIL5, 0, 0),		// the answer of an AT command, see AtReply_OK
+	WIFI_CMD(RxClrBuf, 0, Cmd_ClrBuf),
+	WIFI_CMD_WEB(RxReset, 0, Cmd_Reset),
+	WIFI_CMD_WEB(RxLGON, Cmd_LgOn, 0),
+	WIFI_CMD_WEB(RxLGOFF, Cmd_LgOff, 0),
+	WIFI_CMD_WEB(RxLBON, Cmd_LbOn, 0),
+	WIFI_CMD_WEB(RxLBOFF, Cmd_LbOff, 0),
+	WIFI_CMD(RxIo, Cmd_Io, 0),
+	WIFI_CMD(RxFrame, 0, 0),		// handled by RxStringHandler
+	WIFI_CMD(RxSockData, Cmd_SockData, 0),
+	WIFI_CMD_WEB(SCAN, 0, Cmd_Scan),
+	WIFI_CMD_WEB(GET_IP, 0, Cmd_GetIp),
+	WIFI_CMD_WEB(POST_IP, 0, Cmd_PostIp),
+	WIFI_CMD(WiFi_OK, Cmd_OkScan, 0),		// answers, for the AT engine (and the IP of get_ip)
+	WIFI_CMD(WiFi_IP, 0, 0)
+};
+
+uint8_t ConfigResult = FAIL;	// PASS or FAIL, result of the last ConfigureWiFi
+uint32_t ConfigStart = 0;		// LocalTime when ConfigureWiFi started
+uint32_t ConfigUpTime = 0;	// ms from ConfigureWiFi to :WiFi Up:, for measuring the reprovisioning time
+
+uint8_t  PageDirty = 0;	// 1 == led.html does not show LedG and LedB yet
+uint32_t PageDue = 0;		// LocalTime when led.html is uploaded
+uint32_t PageStart = 0;		// LocalTime when the upload of led.html started
+
+TMR_TypeDef ClrBufTimer;			// second clear of the X command
+TMR_TypeDef QueryTimer;				// clear of the RxBuffer at the end of get_ip
+TMR_TypeDef ResetTimer;				// end of ResetSTMWiFIModule_retainsLEDs
+TMR_TypeDef LedSaveTimer;			// LED state written in the EEPROM after a burst of commands
+TMR_TypeDef RecoverTimer;			// backoff before the next recovery, see recover.c
+uint8_t RecoverNext = RCV_RECONNECT;	// tier run by Recover_Run
+uint8_t RecoverTier = RCV_NONE;	// tier running on the AT engine, RCV_NONE == none
+uint8_t ResetRetainLeds = 0;	// 1 == ConfigureWiFi was started by ResetSTMWiFIModule_retainsLEDs or ResumeWiFi
+uint8_t ConfigFactory = 0;		// 1 == ConfigureWiFi restores the factory settings first
+uint16_t ConfigHash = 0;			// hash of the settings sent by ConfigureWiFi, see Config_Hash
+uint8_t ResetLedG = 0;				// LedG and LedB restored by ResetSTMWiFIModule_Restore
+uint8_t ResetLedB = 0;
+
+uint32_t MetricsRendered = 0;		// Metrics.Version when the upload of metrics.json started
+uint32_t MetricsUploaded = 0;		// Metrics.Version on the module
+uint32_t MetricsDue = 0;				// LocalTime when metrics.json can be uploaded again
+uint32_t LoopStart = 0;					// MET_Cycles at the start of the main loop turn
 
 
 // Initialize the Leds status to OFF
 uint8_t LedG=0; 		// Led Greem 0==OFF 1==ON
 uint8_t LedB=0; 		// Led Blue  0==OFF 1==ON
 // Initialize the Leds flashing to OFF
-uint8_t LBflash=0;	// Led Blue  0==FlashOFF 1==FlashON
-uint8_t LGflash=0;	// Led Green 0==FlashOFF 1==FlashON
-
 
-uint8_t RxBuffer[RXBUFFERSIZE];
-// uint8_t NbrOfDataToTransfer = TXBUFFERSIZE;
-uint16_t NbrOfDataToRead = RXBUFFERSIZE;
-__IO uint8_t TxCount = 0;
-__IO uint16_t RxCount = 0;
-
-uint16_t LungBuff=0;
-uint16_t Cont=0;
-size_t   LungStringa=0;
 uint16_t Val = 0;
 
 /* Virtual address defined by the user: 0xFFFF value is prohibited */
+//		PST_CONFIG_HASH, PST_PROVISIONED and PST_LEDS, see persist.c
 uint16_t VirtAddVarTab[NB_OF_VAR] = {0x5555, 0x6666, 0x7777};
-uint16_t VarDataTab[NB_OF_VAR] = {0, 0, 0};
-uint16_t VarValue = 0;
-uint16_t NumPressBott=0x30;
 
 
-static __IO uint32_t TimingDelay;
+__IO uint32_t LocalTime = 0;	// ms since reset, incremented by SysTick
 USART_InitTypeDef USART_InitStructure;
-// extern uint8_t NbrOfDataToTransfer;
-extern uint16_t NbrOfDataToRead;
-extern __IO uint8_t TxCount;
-extern __IO uint16_t RxCount;
-uint8_t Tasto=0;
-uint8_t MemTasto=0;
 uint16_t RxChar=0;
-uint16_t RxChar_USART2=0;
-uint16_t TLampeggio=0;
 
 
 /* Private function prototypes -----------------------------------------------*/
 void NVIC_Config(void);
-void PA0_InFloating(void);
-void PC6PC8andPC9output(void);
-void Delay(__IO uint32_t nTime);
-void TimingDelay_Decrement(void);
+void LocalTime_Increment(void);
 void STM_EVAL_COM_2_Init(USART_InitTypeDef* USART_InitStruct);
 
-uint8_t BuffOneCH(uint8_t* pBuffer1, uint8_t* pBuffer2, uint16_t BufferLength);
-uint8_t Search_B2inB1(uint8_t* pBuffer1, uint8_t* pBuffer2, uint16_t Buffer1Length, uint16_t Buffer2Length);
-static void Fill_Buffer(uint8_t *pBuffer, uint16_t BufferLength);
-// uint8_t SearchBuffer2inBuffer1(uint8_t* pBuffer1, uint8_t* pBuffer2, uint16_t Buffer1Length, uint16_t Buffer2Length);
-
-uint8_t ConfigureWiFi(void);	// it return PASS or FAIL
+uint8_t ConfigureWiFi(void);	// it queue the configuration and return PASS
+void ConfigureWiFi_Start(void);
+void ConfigureWiFi_Upload(void);
+void FactoryReprovision(void);
+uint8_t ResumeWiFi(void);
+void ResumeWiFi_Up(uint8_t Status);
+void ResumeWiFi_Checked(uint8_t Status);
+uint16_t Wait_Only(const void *pArg);
+uint16_t Config_Hash(void);
+void Config_Tag(uint16_t Hash);
+uint8_t Config_TagFound(void);
+void Save_LedState(void);
+void ConfigureWiFi_Check(uint8_t Status);
+void ConfigureWiFi_Assets(uint8_t Status);
+void ConfigureWiFi_Saved(uint8_t Status);
+void ConfigureWiFi_Up(uint8_t Status);
+void ConfigureWiFi_Done(uint8_t Status);
 void TestRxCommand(void);
+void RxStringHandler(uint8_t Id, uint32_t Pos);
+void Refresh_LedPage(uint32_t Dly);
 void LoadAppropite_LedPage(void);
+void LoadAppropite_LedPage_Done(uint8_t Status);
+void LoadAppropite_LedPage_Loaded(uint8_t Status);
+void Load_MetricsPage(void);
+void Load_MetricsPage_Check(uint8_t Status);
+void Load_MetricsPage_Done(uint8_t Status);
+void Set_LedStatusSSI(void);
 void Clr_RxBuffer(void);
+uint16_t Frame_Prefix(uint8_t *pDst, uint16_t Length);
+uint16_t Frame_SendRead(const void *pArg);
+void Frame_Received(const uint8_t *pData, uint16_t Length);
+uint16_t Put_Decimal(uint8_t *pDst, uint16_t Value);
 
 void ResetSTMWiFIModule(void);
+void ResetSTMWiFIModule_Up(uint8_t Status);
 void ResetSTMWiFIModule_retainsLEDs(void);
+void ResetSTMWiFIModule_Restore(void);
+void ResetSTMWiFIModule_keepsSettings(void);
+void Recover_Schedule(void);
+void Recover_Run(void);
+void Recover_Check(uint8_t Status);
+void Recover_Done(uint8_t Status);
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -288,6 +551,8 @@ void ResetSTMWiFIModule_retainsLEDs(void);
   */
 int main(void)
 {
+	EVT_TypeDef Event;
+
   /*!< At this stage the microcontroller clock setting is already configured,
   this is done through SystemInit() function which is called from startup
   file (startup_stm32f0xx.s) before to branch to application main.
@@ -295,16 +560,12 @@ int main(void)
   system_stm32f0xx.c file
   */
 
-   /* Unlock the Flash Program Erase controller
-  FLASH_Unlock();
-  EEPROM Init
-  EE_Init();
-	*/
-	// Configure I/O for reading the BLUE button on STM32F0-Discovery
-	PA0_InFloating();
+	// Unlock the Flash Program Erase controller, EEPROM Init: provisioning and LED state, see persist.c
+	PST_Init();
 
-	// Configure I/O for LEDs that are present on STM32F0-Discovery + PC6 for RED led
-	PC6PC8andPC9output();
+	// Configure I/O for LEDs that are present on STM32F0-Discovery + PC6 for RED led,
+	//		driven by TIM3 (see led.c)
+	LED_Init();
 
 	/* Setup SysTick Timer for 1 msec interrupts. ***************************************************
 	     ------------------------------------------
@@ -332,8 +593,13 @@ int main(void)
 	       - Reload Value is the parameter to be passed for SysTick_Config() function
 	       - Reload Value should not exceed 0xFFFFFF
 	*/
+	EVT_Init();		// the interrupts post their events from now on, see event.c
+	TMR_Init(LocalTime);	// the timers advance with the ticks, see timer.c
 	SysTick_Config(SystemCoreClock / 1000); // 1mS
 
+	// BLUE button on STM32F0-Discovery: EXTI0, debounced by a timer, see button.c
+	BTN_Init();
+
 
   /* NVIC configuration */
   NVIC_Config();
@@ -360,59 +626,126 @@ int main(void)
 	// Conf. USART2 as is COM2
   STM_EVAL_COM_2_Init(&USART_InitStructure);
 
+	// USART2 TX is done by DMA1 Channel4, RX by DMA1 Channel5 in circular mode, see wifi_uart.c
+	WIFI_TxInit();
+
   /* Enable the EVAL_COM1 Receive interrupt: this interrupt is generated when the
   EVAL_COM1 receive data register is not empty */
   USART_ITConfig(EVAL_COM1, USART_IT_RXNE, ENABLE);
 
-  /* Enable the EVAL_COM2 Receive interrupt: this interrupt is generated when the
-  EVAL_COM2 receive data register is not empty */
-  USART_ITConfig(USART2, USART_IT_RXNE, ENABLE);
+	// Sleep when no event is waiting, see IdlePolicy
+	IDLE_Init(IdlePolicy);
 
+  /* Start the EVAL_COM2 reception: the received bytes go in the RxBuffer ring by DMA,
+  the idle line interrupt is generated at the end of every message */
+  WIFI_RxInit();
 
-	Tasto=GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_0);
-	MemTasto = Tasto;
 
 	// Clear RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);
+	Clr_RxBuffer();
 
-	// Initialize the LED variable
-  LedG=0; 		// Led Greem 0==OFF
-  LedB=0; 		// Led Blue  0==OFF
-	// Initialize the Leds flashing to OFF
-	LBflash=0; 	// Led Blue  0==FlashOFF
-	LGflash=0;	// Led Green 0==FlashOFF
+	// The automaton used by TestRxCommand to find all the commands in one pass is in flash
+	// (wifi_match_table.c): a table generated from other strings is a build error, stop here
+	if (WIFI_CmdInit(RxCommands, RX_NBR_OF_STRINGS) == FAIL)
+		{
+		RLed_ON;
+		while (1)
+			{}
+		}
+	// AT commands are sent by the AT engine, the answers are found by the automaton
+	WIFI_AtInit();
+	WIFI_AtSetMonitor(MET_AtMonitor);		// round trip of the AT commands, see metrics.c
+	WIFI_MatchSetHandler(RxStringHandler);
+	// Pins that the io: command can write
+	WIFI_IoInit(IoPorts, countof(IoPorts));
+	// Binary frames on the socket, see FrameChannel
+	WIFI_FrameInit(Frame_Prefix, &AtReply_Socket, Frame_Received);
+	// Files of the web interface, in chunks: at+s.fsa has no answer, every chunk waits for its OK
+	WIFI_AssetInit(&AtReply_Page);
+	// Recoveries after a failure of the module: from a reconnect up to ConfigureWiFi, see Cmd_Fail
+	RCV_Init();
+
+	// Initialize the LED variable: the state before the reset, saved in the EEPROM
+  LedG = (PST_Get(PST_LEDS) & 0x01) ? 1 : 0;
+  LedB = (PST_Get(PST_LEDS) & 0x02) ? 1 : 0;
+	if (LedG) GLed_ON;
+	if (LedB) BLed_ON;
+
+	// The module already holds this configuration (saved by at&w): no need to send it again,
+	//		wait for it to join the network. Otherwise press the BLUE button
+	ConfigHash = Config_Hash();
+	if ((PST_Get(PST_PROVISIONED) == PST_SAVED) && (PST_Get(PST_CONFIG_HASH) == ConfigHash))
+		ResumeWiFi();
 
 
   /* Infinite loop */
   while (1)
   {
-		// Check the BLUE button ***********************************************************
-		Tasto=GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_0);
-		if (MemTasto != Tasto)
+		// Wait for an event posted by the interrupts, see event.c **************************
+		LoopStart = MET_Cycles();
+		switch (EVT_Get(&Event))
 			{
-			MemTasto = Tasto;
-			if (Tasto==0)
-				{
+			case EVT_NONE:		// nothing happened: sleep until the next interrupt
+				if (IDLE_Wait() == IDLE_SLEEP)
+					MET_Sample(&Metrics.Sleep, (MET_Cycles() - LoopStart) / (SystemCoreClock / 1000000));
+				continue;
+
+			case EVT_BUTTON_EDGE:	// PA0 changed: read when it is stable, see button.c
+				BTN_Edge();
+				break;
+
+			case EVT_BUTTON:	// the BLUE button was pressed
+				if (Event.Data == BTN_LONG)
+					{
+					FactoryReprovision();	// Factory settings, then the configuration
+					break;
+					}
 				GLed_OFF;		// Set Led Green to OFF
-				BLed_OFF;		// Set Led Blue to OFF
+				BLed_FLASH;	// Set Led Blue flashing
 				LedG=0; 		// Status of Led Greem is 0==OFF
 				LedB=0; 		// Status of Led Blue is 0==OFF
-				LGflash=0;	// Set Led Green 0==FlashOFF
-				LBflash=1; 	// Set Led Blue 1==FlashON
 
-				if (ConfigureWiFi() == PASS)	// Send AT command for configure the STM WiFi Module *******
-					{
-					LBflash=0; 	// Set Led Blue 0==FlashOFF
-					BLed_OFF;		// Set Led Blue to OFF
-					}
-				else
-					LGflash=1; 	// Set Led Green 0==FlashOFF
-				}
+				ConfigureWiFi();	// Queue the AT commands for configure the STM WiFi Module, see ConfigureWiFi_Done
+				break;
+
+			case EVT_COM1_RX:	// character from COM1
+				RxChar = Event.Data;
+				break;
+
+			default:					// EVT_TICK: timeouts, EVT_RX: new bytes, both handled below
+				break;
 			}
 
+		// Expire the timers *********************************************************************
+		TMR_Process(LocalTime);
+
+		// Send the queued AT commands and check their answers *****************************
+		WIFI_AtProcess(LocalTime);
+
+		// Binary frames: acks and frames sent again, then read the socket data announced
+		WIFI_FrameProcess(LocalTime);
+		if (SockPending && (WIFI_AtBusy() == 0))
+			WIFI_AtSubmitFunc(Frame_SendRead, 0, &AtReply_Socket, 0);	// the queue is empty, it cannot be refused
+
 		// Test if there are commands from the STM WiFi module *****************************
-		TestRxCommand();
+		//		not while it is being configured: the AT engine owns the answers
+		if (WIFI_AtBusy() == 0)
+			TestRxCommand();
+
+		// Upload led.html when the LED commands are over **********************************
+		if (PageDirty && (WIFI_AtBusy() == 0) && ((int32_t)(LocalTime - PageDue) >= 0))
+			{
+			PageDirty = 0;
+			LoadAppropite_LedPage();
+			}
+
+		// Upload metrics.json when the values have changed, once the module is configured *
+		if ((Metrics.Version != MetricsUploaded) && (ConfigResult == PASS) && (WIFI_AtBusy() == 0) &&
+				((int32_t)(LocalTime - MetricsDue) >= 0))
+			Load_MetricsPage();
 
+		// Time to handle the event
+		MET_Sample(&Metrics.Loop, (MET_Cycles() - LoopStart) / (SystemCoreClock / 1000000));
   }
 
 }
@@ -425,808 +758,1012 @@ int main(void)
 //
 void TestRxCommand(void)
 {
-	// Test if received fromSTM WiFI: +WIND:42:RX_MGMT: - Unhandled Event: - From network means FAIL
-	// if is so I reset the STM WiFI module
-	if (Search_B2inB1(RxBuffer, TxBuffer_FAIL1, RXBUFFERSIZE, (countof(TxBuffer_FAIL1) - 1)) != FAIL)
-		{
-		GLed_OFF;
-		BLed_OFF;
-		LBflash=1; // Led Blue   1==FlashON
-		LGflash=1; // Led Green  1==FlashON
-		ResetSTMWiFIModule_retainsLEDs();
-		}
-	// *******************************************************************************************
+	// Every string of RxCommands[] present in the RxBuffer: only the bytes received
+	// since the previous call are scanned, the strings found before are remembered.
+	// Each command consumes the RxBuffer, so at most one is executed per call:
+	// what is received in the meantime is tested at the next call. With no command
+	// to execute what has been scanned is dropped, so the RxBuffer does not fill up
+	WIFI_CmdDispatch();
+}
 
-	// Test if received fromSTM WiFI: +WIND:43:RX_DATA: - Unhandled Event: - From network means FAIL
-	// if is so I reset the STM WiFI module
-	if (Search_B2inB1(RxBuffer, TxBuffer_FAIL2, RXBUFFERSIZE, (countof(TxBuffer_FAIL2) - 1)) != FAIL)
-		{
-		GLed_OFF;
-		BLed_OFF;
-		LBflash=1; // Led Blue   1==FlashON
-		LGflash=1; // Led Green  1==FlashON
-		ResetSTMWiFIModule_retainsLEDs();
-		}
-	// *******************************************************************************************
 
-	// Test if received fromSTM WiFI: +WIND:44:RX_UNK: - Unhandled Event: - From network means FAIL
-	// if is so I reset the STM WiFI module
-	if (Search_B2inB1(RxBuffer, TxBuffer_FAIL3, RXBUFFERSIZE, (countof(TxBuffer_FAIL3) - 1)) != FAIL)
-		{
-		GLed_OFF;
-		BLed_OFF;
-		LBflash=1; // Led Blue   1==FlashON
-		LGflash=1; // Led Green  1==FlashON
-		ResetSTMWiFIModule_retainsLEDs();
-		}
-	// *******************************************************************************************
+//
+// Received from STM WiFi: +WIND:42:RX_MGMT: +WIND:43:RX_DATA: +WIND:44:RX_UNK: +WIND:34:WiFi
+//		Unhandled Event: - From network means FAIL, if is so I recover the STM WiFI module:
+//		a reconnect first, then a Soft Reset, then the whole configuration (see recover.c)
+//		ERROR: is not a failure of the module: it answers one AT command, the AT engine takes it
+//
+void Cmd_Fail(void)
+{
+	Clr_RxBuffer(); // Clear the RxBuffer
 
-	// Test if received fromSTM WiFI: +WIND:34:WiFi - Unhandled Event: - From network means FAIL
-	// if is so I reset the STM WiFI module
-	if (Search_B2inB1(RxBuffer, TxBuffer_FAIL4, RXBUFFERSIZE, (countof(TxBuffer_FAIL4) - 1)) != FAIL)
-		{
-		GLed_OFF;
-		BLed_OFF;
-		LBflash=1; // Led Blue   1==FlashON
-		LGflash=1; // Led Green  1==FlashON
-		ResetSTMWiFIModule_retainsLEDs();
-		}
-	// *******************************************************************************************
+	// The failures reported while a recovery waits or runs are part of the same one
+	if ((RecoverTier != RCV_NONE) || TMR_Active(&RecoverTimer))
+		return;
 
-	// Test if received fromSTM WiFI: ERROR: - From network means FAIL
-	// if is so I reset the STM WiFI module
-	if (Search_B2inB1(RxBuffer, TxBuffer_FAIL5, RXBUFFERSIZE, (countof(TxBuffer_FAIL5) - 1)) != FAIL)
-		{
-		GLed_OFF;
-		BLed_OFF;
-		LBflash=1; // Led Blue   1==FlashON
-		LGflash=1; // Led Green  1==FlashON
-		ResetSTMWiFIModule_retainsLEDs();
-		}
-	// *******************************************************************************************
+	BLed_FLASH; // Led Blue flashing
+	GLed_FLASH; // Led Green flashing
+	Recover_Schedule();
+}
 
 
-	// Test command: X - Clear RxBuffer **********************************************************
-	if (BuffOneCH(RxBuffer, RxClrBuf, RXBUFFERSIZE) != FAIL)
-		{
-		Clr_RxBuffer(); // Clear the RxBuffer
-		Delay(1000); 		// Dly 1sec
-		Clr_RxBuffer(); // Clear the RxBuffer
-		}
-	// *******************************************************************************************
+//
+// Command: X - Clear RxBuffer
+//
+void Cmd_ClrBuf(void)
+{
+	Clr_RxBuffer(); // Clear the RxBuffer
+	TMR_Start(&ClrBufTimer, ClrBufDly, 0, Clr_RxBuffer);	// and again in 1sec
+}
 
 
-	// *******************************************************************************************
-	// Test command: reset - reset the STM WiFi module,
-	//							 STM WiFi reload the WiFi configuration received from STM32F0-Discovery
-	if (Search_B2inB1(RxBuffer, RxReset, RXBUFFERSIZE, (countof(RxReset) - 1)) != FAIL)
-		{
-		GLed_OFF;
-		LedG=0;
-		BLed_OFF;
-		LedB=0;
-		LBflash=1; // Led Blue  1==FlashON
-		ConfigureWiFi();
-		// ResetSTMWiFIModule();
-		}
-	// *******************************************************************************************
+//
+// Command: reset - reset the STM WiFi module,
+//							 STM WiFi reload the WiFi configuration received from STM32F0-Discovery
+//
+void Cmd_Reset(void)
+{
+	GLed_OFF;
+	LedG=0;
+	BLed_FLASH; // Led Blue flashing
+	LedB=0;
+	ConfigureWiFi();
+	// ResetSTMWiFIModule();
+}
+
+
+//
+// Commands: lgon lgoff lbon lboff - applied as soon as they are received,
+//		the led.html refresh is only scheduled: a burst of commands is uploaded once
+//
+void Cmd_LgOn(uint32_t Pos)
+{
+	GLed_ON;
+	LedG=1;
+	Refresh_LedPage(PageRefreshDly);
+}
+
+void Cmd_LgOff(uint32_t Pos)
+{
+	GLed_OFF;
+	LedG=0;
+	Refresh_LedPage(PageRefreshDly);
+}
+
+void Cmd_LbOn(uint32_t Pos)
+{
+	BLed_ON;
+	LedB=1;
+	Refresh_LedPage(PageRefreshDly);
+}
 
+void Cmd_LbOff(uint32_t Pos)
+{
+	BLed_OFF;
+	LedB=0;
+	Refresh_LedPage(PageRefreshDly);
+}
+
+
+//
+// Command: io: - remote I/O, the operations are executed when the line is over (Cmd_IoEnd)
+//
+void Cmd_Io(uint32_t Pos)
+{
+	IoPos = Pos + 1;
+	IoOpen = 1;
+}
+
+//
+// End of the line of an io: command: all its operations are applied at once,
+//		then the page is refreshed once and shows the result
+//
+void Cmd_IoEnd(uint32_t Pos)
+{
+	IoOpen = 0;
+	IoResult = WIFI_IoExecute(IoPos, (uint16_t)(Pos - IoPos));
+	IoCount++;
+	// the LEDs may have been changed: apply the pins written to TIM3
+	LED_Update();
+	LedG = GPIO_ReadOutputDataBit(GPIOC, GPIO_Pin_9);
+	LedB = GPIO_ReadOutputDataBit(GPIOC, GPIO_Pin_8);
+	Refresh_LedPage(PageRefreshDly);
+}
+
+
+//
+// +WIND:55:Pending Data:<id>:<length> - data received on the socket, read at the end of the line
+//
+void Cmd_SockData(uint32_t Pos)
+{
+	SockDataPos = Pos + 1;
+	SockDataOpen = 1;
+}
+
+void Cmd_SockDataEnd(uint32_t Pos)
+{
+	uint32_t ReadCount = WIFI_RxReadCount();
+	uint16_t Offset, End, Length = 0;
+
+	SockDataOpen = 0;
+	if ((int32_t)(SockDataPos - ReadCount) < 0)
+		return;		// already consumed
+	End = (uint16_t)(Pos - ReadCount);
+	// skip <id>: then read the length
+	for (Offset = (uint16_t)(SockDataPos - ReadCount); (Offset < End) && (WIFI_RxPeek(Offset) != ':'); Offset++)
+		;
+	for (Offset++; (Offset < End) && (WIFI_RxPeek(Offset) >= '0') && (WIFI_RxPeek(Offset) <= '9'); Offset++)
+		Length = Length * 10 + (WIFI_RxPeek(Offset) - '0');
+	SockPending += Length;		// read by the main loop
+}
+
+
+//
+// Command: scan MV
+//		The OK is waited by the AT engine, the RxBuffer is cleared DlyBeforeClrRxBuffer after it
+//
+void Cmd_Scan(void)
+{
+	RLed_ON;
+	if (WIFI_AtSubmitCmd(&AtCmd_SCAN, Cmd_Query_Done) != PASS)
+		Cmd_Query_Done(WIFI_AT_ERROR);
+}
 
-	// ***************** Test lgon lgoff *********************************************************
-	//
-	// Test command: lgon - Green LED ON
-	if (Search_B2inB1(RxBuffer, RxLGON, RXBUFFERSIZE, (countof(RxLGON) - 1)) != FAIL)
+
+//
+// Command: get_ip MV - obtain the IP address and show it in led.html
+//
+void Cmd_GetIp(void)
+{
+	// The IP is read by Cmd_OkScan, when the OK of this at+s.sts is scanned
+	IpFrom = WIFI_RxReadCount() + WIFI_RxAvailable();
+	IpWanted = 1;
+	IpLength = 0;
+	RLed_ON;
+	if (WIFI_AtSubmitCmd(&AtCmd_GET_IP, Cmd_GetIp_Done) != PASS)
+		Cmd_GetIp_Done(WIFI_AT_ERROR);
+}
+
+//
+// OK scanned: for get_ip and for the at+s.gcfg of ResumeWiFi the answer is still in the RxBuffer,
+//		before the OK
+//
+void Cmd_OkScan(uint32_t Pos)
+{
+	if (ConfigTagWanted && ((int32_t)(Pos - ConfigTagFrom) >= 0))
 		{
-		GLed_ON;
-		LedG=1;
-		Clr_RxBuffer(); // Clear the RxBuffer
-		LoadAppropite_LedPage();
-		Delay(1000); 		// Dly 1sec
-		Clr_RxBuffer(); // Clear the RxBuffer
+		ConfigTagWanted = 0;
+		ConfigTagMatch = Config_TagFound();
 		}
-	// Test command: lgoff - Green LED OFF
-	if (Search_B2inB1(RxBuffer, RxLGOFF, RXBUFFERSIZE, (countof(RxLGOFF) - 1)) != FAIL)
+	if ((IpWanted == 0) || ((int32_t)(Pos - IpFrom) < 0))
+		return;
+	IpWanted = 0;
+	//Find the ip address: "ip_ipaddr = x.x.x.x" is somewhere in the answer, copy it in IpAddress
+	tmp_offs = WIFI_RxFind(IpKey, sizeof(IpKey) - 1, 0);		// find "ip_ipaddr"
+	if (tmp_offs != WIFI_RX_NOT_FOUND)
+		tmp_offs = WIFI_RxFind((const uint8_t *)"=", 1, tmp_offs);	// advance to the value
+	if (tmp_offs != WIFI_RX_NOT_FOUND)
 		{
-		GLed_OFF;
-		LedG=0;
-		Clr_RxBuffer(); // Clear the RxBuffer
-		LoadAppropite_LedPage();
-		Delay(1000); 		// Dly 1sec
-		Clr_RxBuffer(); // Clear the RxBuffer
+		for (tmp_offs++; tmp_offs < WIFI_RxAvailable(); tmp_offs++)
+			{
+			Val = WIFI_RxPeek(tmp_offs);
+			if (Val == '#' || Val == '/' || Val == '\r' || Val == '\n' || IpLength == IpMaxLength)
+				break;		// end of the value
+			IpAddress[IpLength++] = Val;
+			}
 		}
-	// *******************************************************************************************
+}
+
+
+//
+// Command: post_ip MV - print the IP address on HTERM
+//
+void Cmd_PostIp(void)
+{
+	RLed_ON;
+	if (WIFI_AtSubmitCmd(&AtCmd_POST_IP, Cmd_Query_Done) != PASS)
+		Cmd_Query_Done(WIFI_AT_ERROR);
+}
 
 
-	// ***************** Test lbon lboff *********************************************************
-	//
-	// Test command: lbon - Blue LED ON
-	if (Search_B2inB1(RxBuffer, RxLBON, RXBUFFERSIZE, (countof(RxLBON) - 1)) != FAIL)
+//
+// End of scan and post_ip: called by the AT engine DlyBeforeClrRxBuffer after the OK,
+//		the answer has been consumed
+//
+void Cmd_Query_Done(uint8_t Status)
+{
+	Cmd_QueryEnd();
+}
+
+//
+// End of get_ip: upload the IP page, its pieces go straight from flash and from IpAddress
+//		to USART2. The red LED goes off when it is on the module (see LoadAppropite_LedPage_Loaded)
+//
+void Cmd_GetIp_Done(uint8_t Status)
+{
+	IpWanted = 0;
+	if (Status != WIFI_AT_OK)
 		{
-		BLed_ON;
-		LedB=1;
-		Clr_RxBuffer(); // Clear the RxBuffer
-		LoadAppropite_LedPage();
-		Delay(1000); 		// Dly 1sec
-		Clr_RxBuffer(); // Clear the RxBuffer
+		Cmd_QueryEnd();
+		return;
 		}
-	// Test command: lboff - Blue LED OFF
-	if (Search_B2inB1(RxBuffer, RxLBOFF, RXBUFFERSIZE, (countof(RxLBOFF) - 1)) != FAIL)
+	ip_flag = 1;
+	LoadAppropite_LedPage();
+}
+
+void Cmd_QueryEnd(void)
+{
+	RLed_OFF;
+	Clr_RxBuffer(); // Clear the RxBuffer
+}
+
+
+//
+// Called by WIFI_MatchPoll for every string of RxCommands[] received, in the order of arrival
+//		The answers go to the AT engine, then the OnScan function of the string is called
+//
+void RxStringHandler(uint8_t Id, uint32_t Pos)
+{
+	// Binary frames: the strings inside them are data, not answers or commands
+	if (Id == RX_FRAME)
 		{
-		BLed_OFF;
-		LedB=0;
-		Clr_RxBuffer(); // Clear the RxBuffer
-		LoadAppropite_LedPage();
-		Delay(1000); 		// Dly 1sec
-		Clr_RxBuffer(); // Clear the RxBuffer
+		if (FrameChannel)
+			WIFI_FrameDelimiter(Pos);
+		return;
 		}
-
-		// scan procedure MV
-	if (Search_B2inB1(RxBuffer, SCAN, RXBUFFERSIZE, (countof(SCAN) - 1)) != FAIL)
+	if (WIFI_FrameOpen(Pos))
 		{
-				LungBuff=(countof(TxBuffer_SCAN) - 1);
-				for (Cont=0; Cont<=LungBuff; Cont++)
-				{
-				USART_SendData(USART2, TxBuffer_SCAN[Cont]);
-				// The software must wait the end of transmission
-				while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-					{}
-				}
-			// Test the OK answer ******************************************************************
-			RLed_ON;
-				while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-					{
-					Delay(1000);
-					}
-				RLed_OFF;
-				Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-				Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-				RxCount=0; // ********************************************************************************
+		if (Id < RX_NBR_OF_STRINGS)
+			WIFI_MatchDiscard(WIFI_MATCH_BIT(Id));
+		return;
 		}
-		// scan procedure end
 
-		// get ip procedure MV
-		if (Search_B2inB1(RxBuffer, GET_IP, RXBUFFERSIZE, (countof(GET_IP) - 1)) != FAIL)
-			{
-					tmp_page[0] = 0;					// init the variable
-					LungBuff=(countof(TxBuffer_GET_IP) - 1);
-					for (Cont=0; Cont<=LungBuff; Cont++)
-					{
-					USART_SendData(USART2, TxBuffer_GET_IP[Cont]);
-					// The software must wait the end of transmission
-					while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-						{}
-					}
-				// Test the OK answer ******************************************************************
-				RLed_ON;
-					while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-						{
-						Delay(1000);
-						}
-					//Extract the ip address
-					tmp2 = strtok(RxBuffer, "=");
-
-					while (tmp2 != NULL) {
-						if(strstr(tmp2, test) != NULL){		// check whether it contains "ip_ipaddr"
-							tmp2 = strtok(NULL, "=");		// advance next token
-							tmp3 = strtok(tmp2, "#");		// split again
-							break;
-						}
-						tmp2 = strtok(NULL, "=");
-					}
-					tmp3 = strtok(tmp3, "/\n");		// remove \n at the end
-					//Upload new html page
-					// build the final html page
-					strcat(tmp_page, HTML_IP_1);
-					strcat(tmp_page, tmp3);
-					strcat(tmp_page, HTML_IP_2);
-					//Upload
-					ip_flag = 1;
-					LoadAppropite_LedPage();
-					ip_flag = 0;
-					// reset the tmp variables
-					tmp3 = NULL;
-					tmp2 = NULL;
-					tmp_page[0] = 0;
-					RLed_OFF;
-					Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-					Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-					RxCount=0; // ********************************************************************************
-			}
-			// get ip procedure end
+	WIFI_AtMatchHandler(Id, Pos);
 
-			// post ip procedure begin
-			if (Search_B2inB1(RxBuffer, POST_IP, RXBUFFERSIZE, (countof(POST_IP) - 1)) != FAIL)
-			{
-					tmp_page[0] = 0;
-					LungBuff=(countof(TxBuffer_POST_IP) - 1);
-					for (Cont=0; Cont<=LungBuff; Cont++)
-					{
-					USART_SendData(USART2, TxBuffer_POST_IP[Cont]);
-					// The software must wait the end of transmission
-					while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-						{}
-					}
-				// Test the OK answer ******************************************************************
-				RLed_ON;
-					while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-						{
-						Delay(1000);
-						}
-
-					RLed_OFF;
-					Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-					Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-					RxCount=0; // ********************************************************************************
-			}
-		// post ip procedure end
+	if (Id <= RX_FAIL4)
+		MET_Count(&Metrics.Wind[Id - RX_FAIL1]);
 
-	// *******************************************************************************************
+	if (WIFI_CmdScan(Id, Pos))
+		return;		// the OnScan function of the string
+	if ((Id == WIFI_MATCH_EOL) && IoOpen)
+		Cmd_IoEnd(Pos);
+	else if ((Id == WIFI_MATCH_EOL) && SockDataOpen)
+		Cmd_SockDataEnd(Pos);
+}
+
+
+//
+// Schedule the upload of the led.html page Dly ms from now, see the main loop
+//		Every call restarts the wait, so the page is uploaded once the commands stop
+//
+void Refresh_LedPage(uint32_t Dly)
+{
+	PageDirty = 1;
+	PageDue = LocalTime + Dly;
+	TMR_Start(&LedSaveTimer, LedSaveDly, 0, Save_LedState);
+}
+
+//
+// LED state in the EEPROM, restored at boot: written once after a burst of commands,
+//		and only if it changed (see PST_Set). A write that failed is tried again by the next one
+//
+void Save_LedState(void)
+{
+	PST_Set(PST_LEDS, (LedG ? 0x01 : 0) | (LedB ? 0x02 : 0));
+}
+
+
+
+//
+// Binary frames, see wifi_frame.c
+//		Frame_Prefix writes the socket write command of a frame: at+s.sockw=00,<length>
+//
+uint16_t Frame_Prefix(uint8_t *pDst, uint16_t Length)
+{
+	memcpy(pDst, "at+s.sockw=00,", 14);
+	Length = 14 + Put_Decimal(&pDst[14], Length);
+	pDst[Length++] = '\n';
+	pDst[Length++] = '\r';
+	return Length;
+}
+
+//
+// Read the bytes announced on the socket: the frames among them are found by the matcher
+//
+uint16_t Frame_SendRead(const void *pArg)
+{
+	uint16_t Length;
+	uint16_t Ticket;
+
+	// The previous command may still be in the TX queue: the AT engine calls again later
+	if (WIFI_TxDone(FrameCmdTicket) == FAIL)
+		return WIFI_TX_FAIL;
+	memcpy(FrameCmd, "at+s.sockr=00,", 14);
+	Length = 14 + Put_Decimal(&FrameCmd[14], SockPending);
+	FrameCmd[Length++] = '\n';
+	FrameCmd[Length++] = '\r';
+	Ticket = WIFI_TxSubmit(FrameCmd, Length, 0);
+	if (Ticket != WIFI_TX_FAIL)
+	{
+		FrameCmdTicket = Ticket;
+		SockPending = 0;
+	}
+	return Ticket;
+}
+
+//
+// Payload of a data frame: one of the commands of RxCommands[], the whole payload.
+//		It is looked up with the automaton of the text commands, then executed as if received
+//		as text. Only the web commands (WIFI_CMD_WEB) are accepted: the messages of the module
+//		(failures, :WiFi Up:, OK) would fake its state, io: needs the RxBuffer
+//
+void Frame_Received(const uint8_t *pData, uint16_t Length)
+{
+	uint8_t Id = WIFI_CmdLookup(pData, Length);
+
+	if (Id != WIFI_CMD_NONE)
+		WIFI_CmdPost(Id);		// OnScan now, Execute by TestRxCommand, FAIL if not a web command
+}
+
+//
+// Write Value in decimal, return the number of digits
+//
+uint16_t Put_Decimal(uint8_t *pDst, uint16_t Value)
+{
+	uint8_t  Digits[5];
+	uint16_t Count = 0, Size = 0;
+
+	do
+		{
+		Digits[Count++] = '0' + (Value % 10);
+		Value /= 10;
+		} while (Value != 0);
+	while (Count != 0)
+		pDst[Size++] = Digits[--Count];
+	return Size;
 }
 
 
 
 //
 // Reset the STM WiFi Module
+//		Soft Reset, then the AT engine waits for :WiFi Up: and the page is uploaded again
 //
 void ResetSTMWiFIModule(void)
 {
+	MET_Count(&Metrics.Resets);
+
 	// Send Router Soft Reset *********************************
-	LungBuff=(countof(TxBuffer_RouterSoftReset) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
-		{
-		USART_SendData(USART2, TxBuffer_RouterSoftReset[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
-		}
-	Delay(1000); 		// Dly 1sec
+	WIFI_AtAbort();
 	Clr_RxBuffer(); // Clear the RxBuffer
+	WIFI_AtBegin();
+	WIFI_AtSubmitCmd(&AtCmd_RouterSoftReset, ResetSTMWiFIModule_Up);
+	if (WIFI_AtEnd() != PASS)
+		ResetSTMWiFIModule_Up(WIFI_AT_ERROR);
 
 	// Start LEDs flashing
-	LBflash=0;
-	BLed_OFF;
-	LGflash=1; // Green Led flasshing
-	LBflash=1; // Blue Led flasshing
-	// test the WiFi Connection -> :WiFi Up:
-	//                                |
-	while ( Search_B2inB1(RxBuffer, WiFi_IP, RXBUFFERSIZE, (countof(WiFi_IP) - 1)) == FAIL )
-		{
-		Delay(1000);
-		}
-	// Stop LEDs flashing
-	LBflash=0;
+	GLed_FLASH; // Green Led flasshing
+	BLed_FLASH; // Blue Led flasshing
+}
+
+void ResetSTMWiFIModule_Up(uint8_t Status)
+{
+	// :WiFi Up: received (or not in WiFiUpTimeout): stop LEDs flashing
 	BLed_OFF;
-	LGflash=0;
 	GLed_OFF;
 
 	Clr_RxBuffer(); // Clear the RxBuffer
 	LoadAppropite_LedPage();
-	Delay(1000); 		// Dly 1sec
-	Clr_RxBuffer(); // Clear the RxBuffer
-
-	LBflash=0; // Led Blue  0==FlashOFF
-	BLed_OFF;
 }
 
 
 //
 // Reset the STM WiFi Module but retains the status of the LEDs
+//		ConfigureWiFi runs on the AT engine, ConfigureWiFi_Done starts ResetTimer and
+//		ResetSTMWiFIModule_Restore puts the LEDs back ResetRestoreDly later
 //
 void ResetSTMWiFIModule_retainsLEDs(void)
 {
-	uint8_t LedG_Mem = LedG; 	// Memorize the status of Green Led
-	uint8_t LedB_Mem = LedB; 	// Memorize the status of Blue Led
+	ResetLedG = LedG; 	// Memorize the status of Green Led
+	ResetLedB = LedB; 	// Memorize the status of Blue Led
 
+	MET_Count(&Metrics.Resets);
 	ConfigureWiFi();
+	ResetRetainLeds = 1;
+}
 
-	Delay(2000); 		// Dly 2sec
+void ResetSTMWiFIModule_Restore(void)
+{
 	Clr_RxBuffer(); // Clear the RxBuffer
-	LBflash=0; 			// Led Blue  0==FlashOFF
 	BLed_OFF;
-	LedG = LedG_Mem; 	// Restore the status of Green Led
-	LedB = LedB_Mem; 	// Restore the status of Blue Led
+	LedG = ResetLedG; 	// Restore the status of Green Led
+	LedB = ResetLedB; 	// Restore the status of Blue Led
 	LoadAppropite_LedPage();
-	Delay(1000); 		// Dly 1sec
-	Clr_RxBuffer(); // Clear the RxBuffer
-
-	LGflash=1;			// Green LED flashing - ATTENTION: In the final application, this line, should be REMOVED.
 
+	GLed_FLASH;			// Green LED flashing - ATTENTION: In the final application, this line, should be REMOVED.
 }
 
-
-
 //
-// Clear RxBuffer
+// Reset the STM WiFi Module with the settings it saved (at&w), retains the status of the LEDs
+//		Soft Reset, then the socket and the pages as in ConfigureWiFi: they do not survive the reset
 //
-void Clr_RxBuffer(void)
+void ResetSTMWiFIModule_keepsSettings(void)
 {
-		Fill_Buffer(RxBuffer, RXBUFFERSIZE);
-		RxCount=0;
+	MET_Count(&Metrics.Resets);
+	ConfigureWiFi_Start();
+	ResetLedG = LedG; 	// Memorize the status of Green Led
+	ResetLedB = LedB; 	// Memorize the status of Blue Led
+	ResetRetainLeds = 1;
+	GLed_FLASH; // Green Led flasshing
+	BLed_FLASH; // Blue Led flasshing
+
+	WIFI_AtBegin();
+	WIFI_AtSubmitCmd(&AtCmd_RouterSoftReset, ConfigureWiFi_Up);		// ConfigureWiFi_Up uploads the socket and the pages
+	if (WIFI_AtEnd() != PASS)
+		ConfigureWiFi_Done(WIFI_AT_ERROR);
 }
 
 
 //
-// Configure the WiFi module
+// Recovery after Cmd_Fail: recover.c chooses the tier and the wait before it (exponential backoff,
+//		at most RCV_RESETS resets a minute). A tier that fails schedules the next one
 //
-uint8_t ConfigureWiFi(void)
+void Recover_Schedule(void)
 {
+	uint32_t Delay;
 
-	// Send Router Name **************************************************************************
-	LungBuff=(countof(TxBuffer_RouterName) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
-		{
-		USART_SendData(USART2, TxBuffer_RouterName[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
-		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-		{
-		Delay(1000);
-		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
+	RecoverNext = RCV_Fail(LocalTime, &Delay);
+	if (Delay == 0)
+		Recover_Run();
+	else
+		TMR_Start(&RecoverTimer, Delay, 0, Recover_Run);
+}
 
+void Recover_Run(void)
+{
+	MET_Count(&Metrics.Recover[RecoverNext]);
 
-	// Send Router Password **********************************************************************
-	LungBuff=(countof(TxBuffer_RouterPW) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
-		{
-		USART_SendData(USART2, TxBuffer_RouterPW[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
-		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
+	switch (RecoverNext)
 		{
-		Delay(1000);
+		case RCV_RECONNECT:
+			// One command, the settings and the pages stay on the module
+			WIFI_AtAbort();
+			Clr_RxBuffer(); // Clear the RxBuffer
+			WIFI_AtSetMonitor(MET_AtMonitor);
+			WIFI_AtBegin();
+			if (FrameChannel)
+				{
+				WIFI_AtSubmitCmd(&AtCmd_Reconnect, Recover_Check);
+				WIFI_AtSubmitCmd(&AtCmd_FrameSocketClose, Recover_Check);
+				WIFI_AtSubmitCmd(&AtCmd_FrameSocket, Recover_Done);
+				}
+			else
+				WIFI_AtSubmitCmd(&AtCmd_Reconnect, Recover_Done);
+			RecoverTier = RecoverNext;
+			if (WIFI_AtEnd() != PASS)
+				Recover_Done(WIFI_AT_ERROR);
+			return;
+
+		case RCV_SOFT_RESET:
+			ResetSTMWiFIModule_keepsSettings();		// ConfigureWiFi_Done calls Recover_Done
+			break;
+
+		default:
+			ResetSTMWiFIModule_retainsLEDs();			// ConfigureWiFi_Done calls Recover_Done
+			break;
 		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
-
+	// After ConfigureWiFi_Start, that forgets the recovery in progress
+	RecoverTier = RecoverNext;
+}
 
-	// Send Router Potection Mode ****************************************************************
-	LungBuff=(countof(TxBuffer_RouterPotectionMode) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
-		{
-		USART_SendData(USART2, TxBuffer_RouterPotectionMode[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
-		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-		{
-		Delay(1000);
-		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
+void Recover_Check(uint8_t Status)
+{
+	if (Status != WIFI_AT_OK)
+		Recover_Done(Status);
+}
 
+void Recover_Done(uint8_t Status)
+{
+	uint8_t Tier = RecoverTier;
 
-	// Send Router Radio in STA Mode *************************************************************
-	LungBuff=(countof(TxBuffer_RouterRadioInSTAMode) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
+	RecoverTier = RCV_NONE;
+	if (Status != WIFI_AT_OK)
 		{
-		USART_SendData(USART2, TxBuffer_RouterRadioInSTAMode[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
+		Recover_Schedule();		// the next tier
+		return;
 		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
+	RCV_Done(LocalTime);
+
+	if (Tier == RCV_RECONNECT)
 		{
-		Delay(1000);
+		// Nothing was reset: the LEDs show their state again, and an upload dropped by the abort is done again
+		if (LedG)
+			GLed_ON;
+		else
+			GLed_OFF;
+		if (LedB)
+			BLed_ON;
+		else
+			BLed_OFF;
+		Refresh_LedPage(PageRefreshDly);
 		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
+}
 
 
-	// Send Router DHCP Client *******************************************************************
-	LungBuff=(countof(TxBuffer_RouterDHCPclient) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
-		{
-		USART_SendData(USART2, TxBuffer_RouterDHCPclient[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
-		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-		{
-		Delay(1000);
-		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
 
+//
+// Clear RxBuffer: consume everything received up to now
+//
+void Clr_RxBuffer(void)
+{
+		WIFI_MatchPoll();			// every string received is reported to RxStringHandler
+		WIFI_MatchConsume();
+}
 
-	// Send Router Save Settings *****************************************************************
-	LungBuff=(countof(TxBuffer_RouterSaveSettings) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
-		{
-		USART_SendData(USART2, TxBuffer_RouterSaveSettings[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
-		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-		{
-		Delay(1000);
-		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
 
+//
+// Configure the WiFi module
+//		The AT commands are queued on the AT engine (wifi_at.c) and sent by WIFI_AtProcess
+//		from the main loop: ConfigureWiFi returns at once and the main loop keeps running.
+//		Every answer has a timeout, a module that does not answer fails the configuration
+//		(see ConfigureWiFi_Done) instead of hanging the firmware.
+//
+uint8_t ConfigureWiFi(void)
+{
+	ConfigureWiFi_Start();
+	WIFI_AtBegin();
 
-	// Send Router Soft Reset ********************************************************************
-	// Start LEDs flashing
-	LBflash=0;
-	BLed_OFF;
-	LGflash=1; // Green Led flasshing
-	LBflash=1; // Blue Led flasshing
-	// Send Router Soft Reset *****************************************
-	LungBuff=(countof(TxBuffer_RouterSoftReset) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
+	// Long press of the button: back to the factory settings, then the configuration below
+	if (ConfigFactory)
 		{
-		USART_SendData(USART2, TxBuffer_RouterSoftReset[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
+		ConfigFactory = 0;
+		PST_Set(PST_PROVISIONED, PST_NONE);		// the module forgets the saved configuration
+		WIFI_AtSubmitCmd(&AtCmd_FactoryDefaults, ConfigureWiFi_Check);
 		}
-	Delay(1000);
-	/* Clear the RxBuffer */
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);
-	RxCount=0;
-
-	// test the WiFi Connection -> :WiFi Up:  *************************
-	//                                |
-	while ( Search_B2inB1(RxBuffer, WiFi_IP, RXBUFFERSIZE, (countof(WiFi_IP) - 1)) == FAIL )
+
+	// Send Router Name, Password, Potection Mode, Radio in STA Mode, DHCP Client ****************
+	//		they are independent: sent back to back, the OKs are matched in order. They are
+	//		not saved before at&w, so a failure here leaves the saved configuration unchanged
+	WIFI_AtSubmitCmd(&AtCmd_RouterName, ConfigureWiFi_Check);
+	WIFI_AtSubmitCmd(&AtCmd_RouterPW, ConfigureWiFi_Check);
+	WIFI_AtSubmitCmd(&AtCmd_RouterPotectionMode, ConfigureWiFi_Check);
+	WIFI_AtSubmitCmd(&AtCmd_RouterRadioInSTAMode, ConfigureWiFi_Check);
+	WIFI_AtSubmitCmd(&AtCmd_RouterDHCPclient, ConfigureWiFi_Check);
+	WIFI_AtSubmitCmd(&AtCmd_RouterFlowControl, ConfigureWiFi_Check);
+	ConfigHash = Config_Hash();
+	Config_Tag(ConfigHash);
+	WIFI_AtSubmit(ConfigTag, sizeof(ConfigTag), &AtReply_Setting, ConfigureWiFi_Check);
+
+	// Send Router Save Settings, then Soft Reset and wait for :WiFi Up: *************************
+	//		at most ConfigureWiFiCmds commands: the pages are queued by ConfigureWiFi_Up
+	WIFI_AtSubmitCmd(&AtCmd_RouterSaveSettings, ConfigureWiFi_Saved);
+	WIFI_AtSubmitCmd(&AtCmd_RouterSoftReset, ConfigureWiFi_Up);
+
+	if (WIFI_AtEnd() != PASS)
 		{
-		Delay(1000);
+		ConfigureWiFi_Done(WIFI_AT_ERROR);
+		return FAIL;
 		}
-	LGflash=0; // Green Led NON flasshing
-	GLed_OFF;
-
-	Delay(1000);
-	/* Clear the RxBuffer */
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);
-	RxCount=0; // ********************************************************************************
+	return PASS;
+}
 
+//
+// Start of ConfigureWiFi and ResumeWiFi: a new configuration replaces the one in progress
+//
+void ConfigureWiFi_Start(void)
+{
+	WIFI_AtAbort();
+	Clr_RxBuffer(); // Clear the RxBuffer
+	ConfigResult = FAIL;
+	ConfigStart = LocalTime;
+	ResetRetainLeds = 0;			// a new configuration is not the one of a reset
+	TMR_Stop(&ResetTimer);
+	RecoverTier = RCV_NONE;		// nor a recovery
+	TMR_Stop(&RecoverTimer);
+	MET_Count(&Metrics.Configs);
+	WIFI_AtSetMonitor(MET_AtMonitor);		// the abort may have dropped the upload of metrics.json
+}
 
-	// LED.HTML page to load on STM WiFi *********************************************************
+//
+// End of ConfigureWiFi and ResumeWiFi, called by ConfigureWiFi_Up once the module is up: the
+//		socket and the pages are not kept by the module across a reset, they are always sent
+//
+void ConfigureWiFi_Upload(void)
+{
+	WIFI_AtBegin();
+	if (FrameChannel)
+		WIFI_AtSubmitCmd(&AtCmd_FrameSocket, ConfigureWiFi_Check);	// socket of the binary frames
 
-	// Prepare the HTML page named LED.HTML ******************************************************
-	LungBuff=(countof(TxBuffer_Prepare_led_page) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
+	if (LedPageDynamic)
 		{
-		USART_SendData(USART2, TxBuffer_Prepare_led_page[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
+		// LED.SHTML page and its files to load on STM WiFi, then its status string (ConfigureWiFi_Assets):
+		//		the page is never loaded again
+		WIFI_AssetUpload(WebAssets, WebAssetCount, ConfigureWiFi_Assets);	// refused: WIFI_AtEnd fails
 		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
+	else
 		{
-		Delay(1000);
+		// LED.HTML page to load on STM WiFi: prepare, upload header, page *************************
+		WIFI_AtSubmitFunc(WIFI_PageSendCreate, &LedPage, &AtReply_OK, ConfigureWiFi_Check);
+		WIFI_AtSubmitFunc(WIFI_PageSendAppend, &LedPage, &AtReply_Sent, ConfigureWiFi_Check);
+		WIFI_AtSubmitFunc(WIFI_PageSendBody, &LedPage, &AtReply_OK, ConfigureWiFi_Done);
 		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
+
+	if (WIFI_AtEnd() != PASS)
+		ConfigureWiFi_Done(WIFI_AT_ERROR);
+}
 
 
-	// Prepare to UpLoad the LED.HTML page *******************************************************
-	LungBuff=(countof(TxBuffer_Prepare_led_page_upload) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
+//
+// Boot with the configuration already saved on the module (see persist.c): the settings, at&w
+//		and the Soft Reset are skipped, the module joins the network on its own after the power
+//		up and sends :WiFi Up:. The LEDs flash meanwhile, then show their state again
+//		(as ResetSTMWiFIModule_retainsLEDs). The EEPROM only tells what was saved: the module is
+//		asked for its tag first (ResumeWiFi_Up), then the pages follow as in ConfigureWiFi
+//
+uint8_t ResumeWiFi(void)
+{
+	ConfigureWiFi_Start();
+	ConfigHash = PST_Get(PST_CONFIG_HASH);
+	Config_Tag(ConfigHash);
+	ResetLedG = LedG;
+	ResetLedB = LedB;
+	ResetRetainLeds = 1;
+	GLed_FLASH; // Green Led flasshing
+	BLed_FLASH; // Blue Led flasshing
+
+	// Then ConfigureWiFi_Up uploads the socket and the pages
+	if (WIFI_AtSubmitFunc(Wait_Only, 0, &AtReply_Resume, ResumeWiFi_Up) != PASS)
 		{
-		USART_SendData(USART2, TxBuffer_Prepare_led_page_upload[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
+		ConfigureWiFi_Done(WIFI_AT_ERROR);
+		return FAIL;
 		}
-	// *******************************************************************************************
+	return PASS;
+}
 
+void ResumeWiFi_Up(uint8_t Status)
+{
+	// :WiFi Up: or not, the module must hold the configuration: its tag is read by Cmd_OkScan
+	ResumeStatus = Status;
+	ConfigTagFrom = WIFI_RxReadCount() + WIFI_RxAvailable();
+	ConfigTagWanted = 1;
+	ConfigTagMatch = 0;
+	if (WIFI_AtSubmitCmd(&AtCmd_ConfigQuery, ResumeWiFi_Checked) != PASS)
+		ResumeWiFi_Checked(WIFI_AT_ERROR);
+}
 
-	// UpLoad the LED.HTML page ******************************************************************
-	LungBuff=(countof(TxBuffer_led_pageLVoffLBoff) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
+void ResumeWiFi_Checked(uint8_t Status)
+{
+	ConfigTagWanted = 0;
+	if ((Status != WIFI_AT_OK) || (ConfigTagMatch == 0))
 		{
-		USART_SendData(USART2, TxBuffer_led_pageLVoffLBoff[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
+		// Not this configuration, or no answer: the EEPROM is out of date, the whole configuration
+		//		is sent
+		PST_Set(PST_PROVISIONED, PST_NONE);
+		ConfigureWiFi();
+		ResetRetainLeds = 1;		// the LEDs show their state again at the end
+		return;
 		}
-	// Test the OK answer ******************************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
+	if (ResumeStatus == WIFI_AT_OK)
 		{
-		Delay(1000);
+		ConfigureWiFi_Up(ResumeStatus);
+		return;
 		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // ********************************************************************************
-
-	/* Clear the RxBuffer */
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);
-	RxCount=0;
+	// No :WiFi Up: in ResumeUpTimeout: only the STM32 was reset and the module was already up,
+	//		or it did not join yet. A Soft Reset (without at&w) makes it join again
+	WIFI_AtBegin();
+	WIFI_AtSubmitCmd(&AtCmd_RouterSoftReset, ConfigureWiFi_Up);
+	if (WIFI_AtEnd() != PASS)
+		ConfigureWiFi_Done(WIFI_AT_ERROR);
+}
 
-	LGflash=0; // Green Led flasshing OFF
-	LBflash=0; // Blue Led flasshing OFF
-	BLed_OFF;
-	GLed_OFF;
+//
+// Sends nothing: the command of the AT engine only waits for its answer (WIFI_AtSendFunc)
+//
+uint16_t Wait_Only(const void *pArg)
+{
+	return WIFI_TxSubmit(0, 0, 0);
+}
 
-	return PASS;
+//
+// Hash of the settings that ConfigureWiFi saves on the module with at&w: when they change in
+//		this file, the module is configured again
+//
+uint16_t Config_Hash(void)
+{
+	const WIFI_AtCommand_TypeDef *Settings[] =
+		{ &AtCmd_RouterName, &AtCmd_RouterPW, &AtCmd_RouterPotectionMode, &AtCmd_RouterRadioInSTAMode, &AtCmd_RouterDHCPclient,
+			&AtCmd_RouterFlowControl };
+	uint32_t Hash = 0;
+	uint8_t  i;
+
+	for (i = 0; i < countof(Settings); i++)
+		Hash = ((Hash << 5) | (Hash >> 27)) ^ WIFI_FrameCrc(Settings[i]->pCmd, Settings[i]->Length);
+	return (uint16_t)(Hash ^ (Hash >> 16));
 }
 
-// *******************************************************************************************
 //
-// Load the appropriate led.html page on STM WiFi in according to the value of
-//		LedG and LedB
+// Writes lab3-<Hash in hex> in ConfigTag: the value of user_desc for this configuration
 //
-void LoadAppropite_LedPage(void)
+void Config_Tag(uint16_t Hash)
 {
+	static const char Hex[] = "0123456789ABCDEF";
+	uint8_t *pHex = &ConfigTag[ConfigTagValue + ConfigTagLength - 4];
+
+	pHex[0] = Hex[(Hash >> 12) & 0x0F];
+	pHex[1] = Hex[(Hash >> 8) & 0x0F];
+	pHex[2] = Hex[(Hash >> 4) & 0x0F];
+	pHex[3] = Hex[Hash & 0x0F];
+}
 
-	// Delete the led.html page ********************************************
-	LungBuff=(countof(TxBuffer_Delete_led_page) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
+//
+// Answer of at+s.gcfg=user_desc, still in the RxBuffer: "#  user_desc = lab3-XXXX\r\n" with
+//		the value of ConfigTag?
+//
+uint8_t Config_TagFound(void)
+{
+	uint32_t From = ConfigTagFrom - WIFI_RxReadCount();
+	uint16_t Offs;
+	uint8_t  i;
+
+	if ((int32_t)From < 0)
+		From = 0;		// the start of the answer has been consumed
+	Offs = WIFI_RxFind(ConfigTagKey, sizeof(ConfigTagKey) - 1, (uint16_t)From);
+	if (Offs != WIFI_RX_NOT_FOUND)
+		Offs = WIFI_RxFind((const uint8_t *)"=", 1, Offs);
+	if (Offs == WIFI_RX_NOT_FOUND)
+		return 0;
+	for (Offs++; (Offs < WIFI_RxAvailable()) && (WIFI_RxPeek(Offs) == ' '); Offs++)
+		{}
+	for (i = 0; i < ConfigTagLength; i++, Offs++)
 		{
-		USART_SendData(USART2, TxBuffer_Delete_led_page[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
+		if ((Offs >= WIFI_RxAvailable()) || (WIFI_RxPeek(Offs) != ConfigTag[ConfigTagValue + i]))
+			return 0;
 		}
-	Delay(1000); // Dly 1sec
-	/* Clear the RxBuffer */
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);
-	RxCount=0;
-	// *********************************************************************
+	return (Offs < WIFI_RxAvailable()) && ((WIFI_RxPeek(Offs) == '\r') || (WIFI_RxPeek(Offs) == '\n'));
+}
 
 
-	// Prepare a blank led.html page ***************************************
-	LungBuff=(countof(TxBuffer_Prepare_led_page) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
-		{
-		USART_SendData(USART2, TxBuffer_Prepare_led_page[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
-		}
-	// Test the OK answer **************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
-		{
-		Delay(1000);
-		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // **********************************************************
+//
+// Long press of the button: restore the factory settings of the STM WiFi module (at&f), then
+//		configure it as ConfigureWiFi does. Both the LEDs flash fast until ConfigureWiFi_Saved
+//
+void FactoryReprovision(void)
+{
+	ConfigFactory = 1;
+	ConfigureWiFi();
+	LedG=0;
+	LedB=0;
+	LED_Set(LED_GREEN, LED_PATTERN_FAST);
+	LED_Set(LED_BLUE, LED_PATTERN_FAST);
+}
 
 
+//
+// ConfigureWiFi steps: called by the AT engine with the result of the command
+//
+void ConfigureWiFi_Check(uint8_t Status)
+{
+	if (Status != WIFI_AT_OK)
+		ConfigureWiFi_Done(Status);
+}
 
-	// Prepare to upload the led.html page *********************************
-	LungBuff=(countof(TxBuffer_Prepare_led_page_upload) - 1);
-	for (Cont=0; Cont<=LungBuff; Cont++)
+void ConfigureWiFi_Assets(uint8_t Status)
+{
+	if (Status != WIFI_AT_OK)
 		{
-		USART_SendData(USART2, TxBuffer_Prepare_led_page_upload[Cont]);
-		// The software must wait the end of transmission
-		while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-			{}
+		ConfigureWiFi_Done(Status);
+		return;
 		}
-	// *********************************************************************
-
-
-	// *********************************************************************
-	// load the appropiate web page in case of GET_IP Command
-	if (ip_flag) {
-
-		LungBuff=(countof(tmp_page) - 1);
-		for (Cont=0; Cont<=LungBuff; Cont++)
-			{
-			USART_SendData(USART2, tmp_page[Cont]);
-			// The software must wait the end of transmission
-			while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-				{}
-			}
+	Set_LedStatusSSI();
+	WIFI_AtBegin();
+	WIFI_AtSubmitCmd(&AtCmd_InputSSI, ConfigureWiFi_Check);
+	WIFI_AtSubmit(LedStatusSSI, countof(LedStatusSSI) - 1, &AtReply_OK, ConfigureWiFi_Done);
+	if (WIFI_AtEnd() != PASS)
+		ConfigureWiFi_Done(WIFI_AT_ERROR);
+}
 
-	}
-	// Test the value of LedG and LedB for upload the appropriate led.html page
-	if (LedG==1 & LedB==0)
+void ConfigureWiFi_Saved(uint8_t Status)
+{
+	if (Status != WIFI_AT_OK)
 		{
-		LungBuff=(countof(TxBuffer_led_pageLVonLBoff) - 1);
-		for (Cont=0; Cont<=LungBuff; Cont++)
-			{
-			USART_SendData(USART2, TxBuffer_led_pageLVonLBoff[Cont]);
-			// The software must wait the end of transmission
-			while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-				{}
-			}
+		ConfigureWiFi_Done(Status);
+		return;
 		}
-	if (LedG==1 & LedB==1)
+	// Settings saved on the module: the next boot can skip them (ResumeWiFi). Only once the hash is
+	//		in the EEPROM: otherwise the next boot configures the module again
+	if (PST_Set(PST_CONFIG_HASH, ConfigHash) == PASS)
+		PST_Set(PST_PROVISIONED, PST_SAVED);
+	else
+		PST_Set(PST_PROVISIONED, PST_NONE);
+	// The Soft Reset follows: start LEDs flashing
+	GLed_FLASH; // Green Led flasshing
+	BLed_FLASH; // Blue Led flasshing
+}
+
+
+void ConfigureWiFi_Up(uint8_t Status)
+{
+	if (Status != WIFI_AT_OK)
 		{
-		LungBuff=(countof(TxBuffer_led_pageLVonLBon) - 1);
-		for (Cont=0; Cont<=LungBuff; Cont++)
-			{
-			USART_SendData(USART2, TxBuffer_led_pageLVonLBon[Cont]);
-			// The software must wait the end of transmission
-			while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-				{}
-			}
+		ConfigureWiFi_Done(Status);
+		return;
 		}
-	if (LedG==0 & LedB==1)
+	// :WiFi Up: received
+	ConfigUpTime = LocalTime - ConfigStart;
+	MET_Record(&Metrics.Connect, ConfigUpTime);
+	GLed_OFF;		// Green Led NON flasshing
+	ConfigureWiFi_Upload();
+}
+
+void ConfigureWiFi_Done(uint8_t Status)
+{
+	if (Status == WIFI_AT_OK)
 		{
-		LungBuff=(countof(TxBuffer_led_pageLVoffLBon) - 1);
-		for (Cont=0; Cont<=LungBuff; Cont++)
-			{
-			USART_SendData(USART2, TxBuffer_led_pageLVoffLBon[Cont]);
-			// The software must wait the end of transmission
-			while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-				{}
-			}
+		ConfigResult = PASS;
+		BLed_OFF;		// Blue Led flasshing OFF
+		GLed_OFF;		// Green Led flasshing OFF
 		}
-	if (LedG==0 & LedB==0)
+	else
 		{
-		LungBuff=(countof(TxBuffer_led_pageLVoffLBoff) - 1);
-		for (Cont=0; Cont<=LungBuff; Cont++)
-			{
-			USART_SendData(USART2, TxBuffer_led_pageLVoffLBoff[Cont]);
-			// The software must wait the end of transmission
-			while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
-				{}
-			}
+		// The module did not answer, or answered ERROR: both LEDs flashing
+		ConfigResult = FAIL;
+		GLed_FLASH; // Green Led flasshing
+		BLed_FLASH; // Blue Led flasshing
 		}
-	// Test the OK answer **************************************************
-	RLed_ON;
-	while ( Search_B2inB1(RxBuffer, WiFi_OK, RXBUFFERSIZE, (countof(WiFi_OK) - 1)) == FAIL )
+
+	// ResetSTMWiFIModule_retainsLEDs goes on later, whatever the result
+	if (ResetRetainLeds)
 		{
-		Delay(1000);
+		ResetRetainLeds = 0;
+		TMR_Start(&ResetTimer, ResetRestoreDly, 0, ResetSTMWiFIModule_Restore);
 		}
-	RLed_OFF;
-	Delay(DlyBeforeClrRxBuffer); 					// Dly before clear the RxBuffer
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);	// Clear the RxBuffer
-	RxCount=0; // **********************************************************
 
-
-	Delay(1000); // Dly 1sec
-	/* Clear the RxBuffer */
-	Fill_Buffer(RxBuffer, RXBUFFERSIZE);
-	RxCount=0;
+	// Started by Recover_Run: on a failure the next tier follows
+	if (RecoverTier != RCV_NONE)
+		Recover_Done(Status);
 }
-// *******************************************************************************************
-
-
 
-/**
-  * @brief  Fills buffer.
-  * @param  pBuffer: pointer on the Buffer to fill
-  * @param  BufferLength: size of the buffer to fill
-  * @retval None
-  */
-static void Fill_Buffer(uint8_t *pBuffer, uint16_t BufferLength)
+// *******************************************************************************************
+//
+// Load the appropriate led.html page on STM WiFi in according to the value of
+//		LedG and LedB
+//		The AT commands are queued on the AT engine: LoadAppropite_LedPage_Loaded is called at the end
+//
+void LoadAppropite_LedPage(void)
 {
-  uint16_t index = 0;
+	const WIFI_Page_TypeDef *pPage;
 
-  /* Put in global buffer same values */
-  for (index = 0; index < BufferLength; index++ )
-  {
-    pBuffer[index] = 0x00;
-  }
+	PageStart = LocalTime;
+
+	// Dynamic page: only the status string is sent, led.shtml is always there
+	//		(the IP page of GET_IP still goes in led.html)
+	//		The commands are queued all or none: a full queue fails the upload, tried again later
+	WIFI_AtBegin();
+	if (LedPageDynamic && (ip_flag == 0))
+		{
+		Set_LedStatusSSI();
+		WIFI_AtSubmitCmd(&AtCmd_InputSSI, LoadAppropite_LedPage_Done);
+		WIFI_AtSubmit(LedStatusSSI, countof(LedStatusSSI) - 1, &AtReply_SSI, LoadAppropite_LedPage_Loaded);
+		}
+	else
+		{
+		// Delete the led.html page *****************************************************
+		WIFI_AtSubmitCmd(&AtCmd_Delete_led_page, LoadAppropite_LedPage_Done);
+
+		// load the appropiate web page in case of GET_IP Command, otherwise prepare a blank
+		//		led.html page, prepare to upload it, upload it from the template
+		pPage = ip_flag ? &IpPage : &LedPage;
+		WIFI_AtSubmitFunc(WIFI_PageSendCreate, pPage, &AtReply_OK, LoadAppropite_LedPage_Done);
+		WIFI_AtSubmitFunc(WIFI_PageSendAppend, pPage, &AtReply_Sent, LoadAppropite_LedPage_Done);
+		WIFI_AtSubmitFunc(WIFI_PageSendBody, pPage, &AtReply_Page, LoadAppropite_LedPage_Loaded);
+		}
+	if (WIFI_AtEnd() != PASS)
+		LoadAppropite_LedPage_Loaded(WIFI_AT_ERROR);
 }
 
 
-/*
-//
-// Search pBguffer2 in pBuffer1
 //
-// pBuffer1 is RxBuffer
-// pBuffer2 is string to search in pBuffer1
-// Buffer1Length is the length of pBuffer1
-// Bugger2Length is the length of pBuffer2
+// Value of the fields of the led.html templates
 //
-uint8_t SearchBuffer2inBuffer1(uint8_t* pBuffer1, uint8_t* pBuffer2, uint16_t Buffer1Length, uint16_t Buffer2Length)
+const char *PageValue(uint8_t Field, uint16_t *pLength)
 {
-uint16_t ValComp=0;
-
-  while (Buffer1Length--)
-  {
-    if (*pBuffer1 == *pBuffer2)
-    {
-      ValComp++;
-			pBuffer1++;
-      pBuffer2++;
-			if (ValComp == Buffer2Length)
-				return PASS;
-    }
-		else
+	switch (Field)
 		{
-			pBuffer1++;
-			if (ValComp > 0 )
-				return FAIL;
+		case PAGE_LEDG:
+			*pLength = 3;
+			return LedG ? "ON " : "OFF";
+		case PAGE_LEDB:
+			*pLength = 3;
+			return LedB ? "ON " : "OFF";
+		case PAGE_IP:
+			*pLength = IpLength;
+			return (const char *)IpAddress;
+		default:
+			*pLength = 0;
+			return 0;
 		}
-  }
-  return FAIL;
 }
 
-*/
 
+//
+// Write in LedStatusSSI the status of the LEDs: "ON  / OFF" etc.
+//		and the acknowledge of the last io: command: number, result (ok or eN) and port C
+//		The length does not change (LedStatusLength), AtCmd_InputSSI is constant
+//
+void Set_LedStatusSSI(void)
+{
+	static const char Hex[] = "0123456789ABCDEF";
+	uint16_t Pins = GPIO_ReadOutputData(GPIOC) & IoPorts[0].Pins;
+
+	memcpy(&LedStatusSSI[0], LedG ? "ON " : "OFF", 3);
+	memcpy(&LedStatusSSI[6], LedB ? "ON " : "OFF", 3);
+	LedStatusSSI[16] = Hex[IoCount >> 4];
+	LedStatusSSI[17] = Hex[IoCount & 0x0F];
+	LedStatusSSI[19] = (IoResult == WIFI_IO_OK) ? 'o' : 'e';
+	LedStatusSSI[20] = (IoResult == WIFI_IO_OK) ? 'k' : Hex[IoResult];
+	LedStatusSSI[24] = Hex[(Pins >> 12) & 0x0F];
+	LedStatusSSI[25] = Hex[(Pins >> 8) & 0x0F];
+	LedStatusSSI[26] = Hex[(Pins >> 4) & 0x0F];
+	LedStatusSSI[27] = Hex[Pins & 0x0F];
+}
 
 
-uint8_t Search_B2inB1(uint8_t* pBuffer1, uint8_t* pBuffer2, uint16_t Buffer1Length, uint16_t Buffer2Length)
+//
+// LoadAppropite_LedPage steps: a failed upload is tried again later
+//
+void LoadAppropite_LedPage_Done(uint8_t Status)
 {
-uint16_t ValComp = 0;
-uint8_t* Mem_pBuffer2 = pBuffer2;
-
-  while (Buffer1Length--)
-  {
-    if (*pBuffer1 == *pBuffer2)
-    {
-      ValComp++;
-			pBuffer1++;
-      pBuffer2++;
-			if (ValComp == Buffer2Length)
-				return PASS;
-    }
-		else
+	if (Status != WIFI_AT_OK)
+		LoadAppropite_LedPage_Loaded(Status);
+}
+void LoadAppropite_LedPage_Loaded(uint8_t Status)
+{
+	if (ip_flag)
 		{
-			ValComp=0;
-			pBuffer2=Mem_pBuffer2;
-			pBuffer1++;
+		// End of get_ip: the IP page is on the module (or it failed), clear the RxBuffer later
+		ip_flag = 0;
+		TMR_Start(&QueryTimer, DlyBeforeClrRxBuffer, 0, Cmd_QueryEnd);
 		}
-  }
-  return FAIL;
+	if (Status != WIFI_AT_OK)
+		{
+		Refresh_LedPage(PageRetryDly);
+		return;
+		}
+	MET_Record(&Metrics.Upload, LocalTime - PageStart);
 }
 
 
-
-
-
-
-
-/**
-  * @brief  Search, character -> Buffer2, in the Buffer1
-  * @param  pBuffer1, pBuffer2: buffers to be compared.
-  * @param  BufferLength: buffer's length
-  * @retval PASSED: pBuffer1 contain pBuffer2
-  *         FAILED: pBuffer1 differs from pBuffer2
-	*
-	* ATTENTION Buffer2 must contain only one character
-	*
-  */
-uint8_t BuffOneCH(uint8_t* pBuffer1, uint8_t* pBuffer2, uint16_t BufferLength)
+//
+// Upload metrics.json (see metrics.c): delete it, then create it and upload it from the MET_Page template
+//		The commands of this upload are not recorded, otherwise every upload would change
+//		the values and call for the next one
+//
+void Load_MetricsPage(void)
 {
-  while (BufferLength--)
-  {
-    if (*pBuffer1 == *pBuffer2)
-    {
-      return PASS;
-    }
-    pBuffer1++;
-    // pBuffer2++;
-  }
-
-  return FAIL;
+	MetricsDue = LocalTime + MetricsRefreshDly;
+	MetricsRendered = Metrics.Version;
+
+	WIFI_AtSetMonitor(0);
+	WIFI_AtBegin();
+	WIFI_AtSubmitCmd(&AtCmd_Delete_metrics, Load_MetricsPage_Check);
+	WIFI_AtSubmitFunc(WIFI_PageSendCreate, &MET_Page, &AtReply_OK, Load_MetricsPage_Check);
+	WIFI_AtSubmitFunc(WIFI_PageSendAppend, &MET_Page, &AtReply_Sent, Load_MetricsPage_Check);
+	WIFI_AtSubmitFunc(WIFI_PageSendBody, &MET_Page, &AtReply_Page, Load_MetricsPage_Done);
+	if (WIFI_AtEnd() != PASS)
+		Load_MetricsPage_Done(WIFI_AT_ERROR);
 }
+void Load_MetricsPage_Check(uint8_t Status)
+{
+	if (Status != WIFI_AT_OK)
+		Load_MetricsPage_Done(Status);
+}
+void Load_MetricsPage_Done(uint8_t Status)
+{
+	WIFI_AtSetMonitor(MET_AtMonitor);
+	if (Status == WIFI_AT_OK)
+		MetricsUploaded = MetricsRendered;		// tried again after MetricsRefreshDly otherwise
+}
+// *******************************************************************************************
 
 
 /**
@@ -1269,45 +1806,6 @@ void STM_EVAL_COM_2_Init(USART_InitTypeDef* USART_InitStruct)
 
 
 
-/**
-  * @brief  PA0 InPut + Floating (BLUE Key on STM32F0-Discovery)
-  * @param  None
-  * @retval None
-  */
-void PA0_InFloating(void)
-{
-	GPIO_InitTypeDef        GPIO_InitStructure;
-	/* GPIOC Periph clock enable */
-	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_GPIOA, ENABLE);
-
-	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0;
-	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
-	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
-	GPIO_Init(GPIOA, &GPIO_InitStructure);
-}
-
-
-
-/**
-  * @brief  Inizialize PC8 and PC9 in OutPut PushPull (LEDs) + PC6 for RED led
-  * @param  None
-  * @retval None
-  */
-void PC6PC8andPC9output(void)
-{
-	GPIO_InitTypeDef        GPIO_InitStructure;
-	/* GPIOC Periph clock enable */
-	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_GPIOC, ENABLE);
-
-	/* Configure PC8 and PC9 in output pushpull mode */
-	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9;
-	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_OUT;
-	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
-	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
-	GPIO_Init(GPIOC, &GPIO_InitStructure);
-}
-
 /**
   * @brief  Configures the nested vectored interrupt controller.
   * @param  None
@@ -1334,28 +1832,13 @@ void NVIC_Config(void)
 
 
 /****************************************************************************************************
-  * @brief  Inserts a delay time.
-  * @param  nTime: specifies the delay time length, in milliseconds.
-  * @retval None
-  */
-void Delay(__IO uint32_t nTime)
-{
-  TimingDelay = nTime;
-
-  while(TimingDelay != 0);
-}
-
-/**
-  * @brief  Decrements the TimingDelay variable.
+  * @brief  Counts the ms in LocalTime. The waits are timers, see timer.c
   * @param  None
   * @retval None
   */
-void TimingDelay_Decrement(void)
+void LocalTime_Increment(void)
 {
-  if (TimingDelay != 0x00)
-  {
-    TimingDelay--;
-  }
+  LocalTime++;
 }
 
 #ifdef  USE_FULL_ASSERT
@@ -0,0 +1,246 @@
+/**
+  ******************************************************************************
+  * @file    metrics.c
+  * @brief   Counters and latency histograms kept in RAM, sent as a JSON
+  *          file that the main loop uploads on the STM WiFi module.
+  *
+  *          A histogram has one bucket per power of 2 (the number of
+  *          significant bits of the value, counted with shifts since the
+  *          Cortex-M0 has no CLZ) and keeps the largest value: 12 counters
+  *          and the Max cover from 1 ms to seconds without any division.
+  *
+  *          Version changes with every value recorded, so the file is
+  *          uploaded again only when there is something new. The main loop
+  *          and Sleep times are recorded with MET_Sample, which does not
+  *          change Version: they change at every turn and would upload the
+  *          file forever; their histograms go out with the next real change.
+  *
+  *          metrics.json is the template MET_Page (wifi_page.c): the keys are
+  *          constant text in flash and every value is a number field of fixed
+  *          width, written when it is sent. The length of the file does not
+  *          depend on the values and the file is never built in RAM.
+  *
+  *          The RX and event overruns and the frames dropped are read from
+  *          their modules when the file is sent.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "metrics.h"
+#include "wifi_at.h"
+#include "wifi_uart.h"
+#include "wifi_frame.h"
+#include "event.h"
+#include "idle.h"
+#include "wifi_page.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define MET_WIND_COUNT		(sizeof(Metrics.Wind) / sizeof(Metrics.Wind[0]))
+#define MET_RECOVER_COUNT	(sizeof(Metrics.Recover) / sizeof(Metrics.Recover[0]))
+#define MET_HISTOGRAMS		5										// Histograms in Metrics, see MetHistograms
+#define MET_HIST_FIELDS		(MET_BUCKETS + 1)		// Fields of a histogram: the buckets, then the Max
+
+// Number fields of MET_Page: the histograms first, in the order of MetHistograms
+enum
+{
+  MET_FIELD_HIST_END = MET_HISTOGRAMS * MET_HIST_FIELDS,
+  MET_FIELD_UP = MET_FIELD_HIST_END,
+  MET_FIELD_AT_ERR,
+  MET_FIELD_AT_TMO,
+  MET_FIELD_IDLE,
+  MET_FIELD_CONFIGS,
+  MET_FIELD_RESETS,
+  MET_FIELD_WIND,
+  MET_FIELD_RECOVER = MET_FIELD_WIND + MET_WIND_COUNT,
+  MET_FIELD_RX_LOST = MET_FIELD_RECOVER + MET_RECOVER_COUNT,
+  MET_FIELD_EVT_LOST,
+  MET_FIELD_FRAME_ERR
+};
+
+/* Private macro -------------------------------------------------------------*/
+#define MET_U16(f)				WIFI_PAGE_NUMBER((f), 5)
+#define MET_U32(f)				WIFI_PAGE_NUMBER((f), 10)
+
+// {"n":[c0,...,c11],"max":m} of the histogram h of MetHistograms
+#define MET_HISTOGRAM(name, h)																\
+  WIFI_PAGE_TEXT(name "{\"n\":["),													\
+  MET_U16((h) * MET_HIST_FIELDS + 0), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 1), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 2), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 3), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 4), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 5), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 6), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 7), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 8), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 9), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 10), WIFI_PAGE_TEXT(","),	\
+  MET_U16((h) * MET_HIST_FIELDS + 11),												\
+  WIFI_PAGE_TEXT("],\"max\":"),															\
+  MET_U32((h) * MET_HIST_FIELDS + MET_BUCKETS),							\
+  WIFI_PAGE_TEXT("}")
+
+/* Private variables ---------------------------------------------------------*/
+MET_TypeDef Metrics;
+
+extern __IO uint32_t LocalTime;
+
+static MET_Histogram_TypeDef *const MetHistograms[MET_HISTOGRAMS] =
+{
+  &Metrics.AtRtt, &Metrics.Upload, &Metrics.Connect, &Metrics.Loop, &Metrics.Sleep
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t MET_PageNumber(uint8_t Field);
+
+// metrics.json, e.g. {"up":      5123,"rtt":{"n":[    0,    0,...],"max":        41},...}
+static const WIFI_PageItem_TypeDef MetPageItems[] =
+{
+  WIFI_PAGE_TEXT("{\"up\":"), MET_U32(MET_FIELD_UP),
+  MET_HISTOGRAM(",\"rtt\":", 0),
+  WIFI_PAGE_TEXT(",\"at_err\":"), MET_U16(MET_FIELD_AT_ERR),
+  WIFI_PAGE_TEXT(",\"at_tmo\":"), MET_U16(MET_FIELD_AT_TMO),
+  MET_HISTOGRAM(",\"upload\":", 1),
+  MET_HISTOGRAM(",\"connect\":", 2),
+  MET_HISTOGRAM(",\"loop_us\":", 3),
+  WIFI_PAGE_TEXT(",\"idle\":"), WIFI_PAGE_NUMBER(MET_FIELD_IDLE, 3),
+  MET_HISTOGRAM(",\"sleep_us\":", 4),
+  WIFI_PAGE_TEXT(",\"configs\":"), MET_U16(MET_FIELD_CONFIGS),
+  WIFI_PAGE_TEXT(",\"resets\":"), MET_U16(MET_FIELD_RESETS),
+  WIFI_PAGE_TEXT(",\"wind\":["),
+  MET_U16(MET_FIELD_WIND + 0), WIFI_PAGE_TEXT(","), MET_U16(MET_FIELD_WIND + 1), WIFI_PAGE_TEXT(","),
+  MET_U16(MET_FIELD_WIND + 2), WIFI_PAGE_TEXT(","), MET_U16(MET_FIELD_WIND + 3),
+  WIFI_PAGE_TEXT("],\"recover\":["),
+  MET_U16(MET_FIELD_RECOVER + 0), WIFI_PAGE_TEXT(","), MET_U16(MET_FIELD_RECOVER + 1), WIFI_PAGE_TEXT(","),
+  MET_U16(MET_FIELD_RECOVER + 2),
+  WIFI_PAGE_TEXT("],\"rx_lost\":"), MET_U16(MET_FIELD_RX_LOST),
+  WIFI_PAGE_TEXT(",\"evt_lost\":"), MET_U16(MET_FIELD_EVT_LOST),
+  WIFI_PAGE_TEXT(",\"frame_err\":"), MET_U16(MET_FIELD_FRAME_ERR),
+  WIFI_PAGE_TEXT("}\r\n")
+};
+
+const WIFI_Page_TypeDef MET_Page = { "/metrics.json", MetPageItems, sizeof(MetPageItems) / sizeof(MetPageItems[0]), 0, MET_PageNumber };
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Adds a value to a histogram.
+  * @param  pHist: the histogram
+  * @param  Value: ms, us, ...
+  * @retval None
+  */
+void MET_Record(MET_Histogram_TypeDef *pHist, uint32_t Value)
+{
+  MET_Sample(pHist, Value);
+  Metrics.Version++;
+}
+
+/**
+  * @brief  Adds a value to a histogram without changing Version.
+  * @param  pHist: the histogram
+  * @param  Value: ms, us, ...
+  * @retval None
+  */
+void MET_Sample(MET_Histogram_TypeDef *pHist, uint32_t Value)
+{
+  uint32_t Rest = Value;
+  uint8_t  Bucket = 0;
+
+  while (Rest && (Bucket < MET_BUCKETS - 1))
+  {
+    Rest >>= 1;
+    Bucket++;
+  }
+  if (pHist->Count[Bucket] != 0xFFFF)
+    pHist->Count[Bucket]++;
+  if (Value > pHist->Max)
+    pHist->Max = Value;
+}
+
+/**
+  * @brief  Increments a counter of Metrics.
+  * @param  pCounter: the counter, it stops at 0xFFFF
+  * @retval None
+  */
+void MET_Count(uint16_t *pCounter)
+{
+  if (*pCounter != 0xFFFF)
+    (*pCounter)++;
+  Metrics.Version++;
+}
+
+/**
+  * @brief  Records the round trip of an AT command, to be set with
+  *         WIFI_AtSetMonitor().
+  * @param  Status: WIFI_AT_xxx
+  * @param  Elapsed: ms since the command was sent
+  * @retval None
+  */
+void MET_AtMonitor(uint8_t Status, uint32_t Elapsed)
+{
+  if (Status == WIFI_AT_ERROR)
+    MET_Count(&Metrics.AtErrors);
+  else if (Status == WIFI_AT_TIMEOUT)
+    MET_Count(&Metrics.AtTimeouts);
+  else
+    MET_Record(&Metrics.AtRtt, Elapsed);
+}
+
+/**
+  * @brief  Free running count of the core clock cycles, from LocalTime and
+  *         the SysTick counter. It wraps around: only differences are valid.
+  * @param  None
+  * @retval Cycles
+  */
+uint32_t MET_Cycles(void)
+{
+  uint32_t Ms, Val;
+
+  // Read again if the SysTick interrupt came in between
+  do
+  {
+    Ms = LocalTime;
+    Val = SysTick->VAL;
+  } while (Ms != LocalTime);
+
+  return Ms * (SysTick->LOAD + 1) + (SysTick->LOAD - Val);
+}
+
+/**
+  * @brief  Value of a number field of MET_Page.
+  * @param  Field: MET_FIELD_xxx, or the first field of a histogram plus the
+  *         bucket (MET_BUCKETS for the Max)
+  * @retval The value
+  */
+static uint32_t MET_PageNumber(uint8_t Field)
+{
+  const MET_Histogram_TypeDef *pHist;
+  uint8_t Bucket;
+
+  if (Field < MET_FIELD_HIST_END)
+  {
+    pHist = MetHistograms[Field / MET_HIST_FIELDS];
+    Bucket = Field % MET_HIST_FIELDS;
+    return (Bucket < MET_BUCKETS) ? pHist->Count[Bucket] : pHist->Max;
+  }
+  if ((Field >= MET_FIELD_WIND) && (Field < MET_FIELD_WIND + MET_WIND_COUNT))
+    return Metrics.Wind[Field - MET_FIELD_WIND];
+  if ((Field >= MET_FIELD_RECOVER) && (Field < MET_FIELD_RECOVER + MET_RECOVER_COUNT))
+    return Metrics.Recover[Field - MET_FIELD_RECOVER];
+
+  switch (Field)
+  {
+    case MET_FIELD_UP:        return LocalTime / 1000;
+    case MET_FIELD_AT_ERR:    return Metrics.AtErrors;
+    case MET_FIELD_AT_TMO:    return Metrics.AtTimeouts;
+    case MET_FIELD_IDLE:      return IDLE_GetPolicy();
+    case MET_FIELD_CONFIGS:   return Metrics.Configs;
+    case MET_FIELD_RESETS:    return Metrics.Resets;
+    case MET_FIELD_RX_LOST:   return WIFI_RxOverruns();
+    case MET_FIELD_EVT_LOST:  return EVT_Overruns();
+    case MET_FIELD_FRAME_ERR: return WIFI_FrameErrors();
+    default:                  return 0;
+  }
+}
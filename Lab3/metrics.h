@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    metrics.h
+  * @brief   Header for metrics.c: counters and latency histograms kept in RAM
+  *          and sent as a JSON file to the STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+#include "wifi_page.h"
+
+/* Exported types ------------------------------------------------------------*/
+#define MET_BUCKETS				12		// Buckets of a histogram
+
+// Bucket i counts the values of i significant bits: 0, 1, 2-3, 4-7, ... the last one the rest
+typedef struct
+{
+  uint16_t Count[MET_BUCKETS];
+  uint32_t Max;
+} MET_Histogram_TypeDef;
+
+typedef struct
+{
+  uint32_t              Version;		// Changed by every MET_Record and MET_Count
+  MET_Histogram_TypeDef AtRtt;			// ms from sending an AT command to its answer
+  uint16_t              AtErrors;		// AT commands answered with an error
+  uint16_t              AtTimeouts;	// AT commands not answered in time
+  MET_Histogram_TypeDef Upload;			// ms to upload led.html or the status string
+  MET_Histogram_TypeDef Connect;		// ms from ConfigureWiFi to :WiFi Up:
+  MET_Histogram_TypeDef Loop;				// us to handle one event in the main loop
+  MET_Histogram_TypeDef Sleep;			// us in Sleep mode, from the empty queue to the wake-up
+  uint16_t              Configs;		// ConfigureWiFi
+  uint16_t              Resets;			// ResetSTMWiFIModule and ResetSTMWiFIModule_retainsLEDs
+  uint16_t              Recover[3];	// Recoveries started, by tier (RCV_RECONNECT, ...), see recover.c
+  uint16_t              Wind[4];		// +WIND:42, 43, 44 and 34 received
+} MET_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+extern MET_TypeDef Metrics;
+extern const WIFI_Page_TypeDef MET_Page;		// metrics.json
+
+/* Exported functions ------------------------------------------------------- */
+void     MET_Record(MET_Histogram_TypeDef *pHist, uint32_t Value);
+void     MET_Sample(MET_Histogram_TypeDef *pHist, uint32_t Value);
+void     MET_Count(uint16_t *pCounter);
+void     MET_AtMonitor(uint8_t Status, uint32_t Elapsed);
+uint32_t MET_Cycles(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __METRICS_H */
@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file    persist.c
+  * @brief   Provisioning and LED state kept in the flash EEPROM emulation
+  *          (eeprom.c, two flash pages, virtual addresses in VirtAddVarTab).
+  *
+  *          The values are read once by PST_Init and kept in RAM: PST_Get
+  *          never touches the flash. PST_Set writes only a value that
+  *          changed, since every write uses flash and a full page costs an
+  *          erase (some ms, with the core stalled on the flash). The copy in
+  *          RAM changes only once the value is in the flash: PST_Get never
+  *          tells what the next boot will not read, and a failed write is
+  *          tried again by the next PST_Set of the same value.
+  *
+  *          A variable never written reads 0, so a blank flash means "not
+  *          provisioned, LEDs off".
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "eeprom.h"
+#include "persist.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+extern uint16_t VirtAddVarTab[NB_OF_VAR];
+
+static uint16_t PstValue[PST_COUNT];		// Copy of the variables
+static uint8_t  PstReady = 0;						// 1 == EE_Init succeeded
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Unlocks the flash, formats or repairs the emulation pages if
+  *         needed and reads the variables.
+  * @param  None
+  * @retval PASS, or FAIL if the emulation cannot be used (all read as 0)
+  */
+uint8_t PST_Init(void)
+{
+  uint16_t Value;
+  uint8_t  Var;
+
+  for (Var = 0; Var < PST_COUNT; Var++)
+    PstValue[Var] = 0;
+
+  FLASH_Unlock();
+  PstReady = (EE_Init() == FLASH_COMPLETE);
+  if (PstReady == 0)
+    return FAIL;
+
+  for (Var = 0; Var < PST_COUNT; Var++)
+  {
+    if (EE_ReadVariable(VirtAddVarTab[Var], &Value) == 0)
+      PstValue[Var] = Value;
+  }
+  return PASS;
+}
+
+/**
+  * @brief  Value of a variable.
+  * @param  Var: PST_xxx
+  * @retval The value, 0 if it was never written
+  */
+uint16_t PST_Get(uint8_t Var)
+{
+  return PstValue[Var];
+}
+
+/**
+  * @brief  Writes a variable, if its value changed. To be called from the
+  *         main loop: it may erase a flash page.
+  * @param  Var: PST_xxx
+  * @param  Value: the new value
+  * @retval PASS, or FAIL if the flash could not be written (PST_Get still
+  *         returns the old value)
+  */
+uint8_t PST_Set(uint8_t Var, uint16_t Value)
+{
+  if (PstValue[Var] == Value)
+    return PASS;
+  if ((PstReady == 0) || (EE_WriteVariable(VirtAddVarTab[Var], Value) != FLASH_COMPLETE))
+    return FAIL;
+  PstValue[Var] = Value;
+  return PASS;
+}
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    persist.h
+  * @brief   Header for persist.c: provisioning and LED state kept in the
+  *          flash EEPROM emulation.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PERSIST_H
+#define __PERSIST_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+// Variables, the index in VirtAddVarTab (main.c): at most NB_OF_VAR
+#define PST_CONFIG_HASH		0			// Hash of the configuration saved on the module with at&w
+#define PST_PROVISIONED		1			// PST_SAVED or PST_NONE
+#define PST_LEDS					2			// Bit 0 Green LED, bit 1 Blue LED
+#define PST_COUNT					3
+
+// PST_PROVISIONED
+#define PST_NONE					0			// Never saved, or factory settings restored
+#define PST_SAVED					0xA5	// The module holds the configuration of PST_CONFIG_HASH
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+uint8_t  PST_Init(void);
+uint16_t PST_Get(uint8_t Var);
+uint8_t  PST_Set(uint8_t Var, uint16_t Value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PERSIST_H */
@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    recover.c
+  * @brief   Recovery policy after a failure of the STM WiFi module (+WIND:42,
+  *          43, 44 or 34, or a recovery that failed).
+  *
+  *          The recoveries are tried from the cheapest one:
+  *          - RCV_RECONNECT: one AT command, some ms;
+  *          - RCV_SOFT_RESET: the module restarts with its saved settings,
+  *            the pages are uploaded again;
+  *          - RCV_REPROVISION: the whole ConfigureWiFi.
+  *          Every failure within RCV_STABLE_MS of the previous recovery moves
+  *          to the next tier and doubles the wait before it (exponential
+  *          backoff, from RCV_BACKOFF_MS to RCV_BACKOFF_MAX_MS). The first
+  *          attempt starts at once.
+  *
+  *          At most RCV_RESETS Soft Resets or reprovisionings start in any
+  *          RCV_WINDOW_MS: a further one waits for the oldest to leave the
+  *          window, whatever the backoff says.
+  *
+  *          Only the policy is here: the caller runs the tier returned by
+  *          RCV_Fail after the delay, and calls RCV_Done when it succeeded.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "recover.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define RCV_MAX_ATTEMPTS	16		// Attempts counted, enough to reach RCV_BACKOFF_MAX_MS
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  RcvAttempts = 0;					// Recoveries since the link was last stable
+static uint8_t  RcvRecovered = 0;					// 1 == the last recovery succeeded, at RcvRecoveredAt
+static uint32_t RcvRecoveredAt = 0;
+static uint32_t RcvResetAt[RCV_RESETS];		// Start of the last resets, oldest at RcvResetNext
+static uint8_t  RcvResetNext = 0;
+static uint8_t  RcvResetCount = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Forgets the previous failures: the next one gets RCV_RECONNECT.
+  * @param  None
+  * @retval None
+  */
+void RCV_Init(void)
+{
+  RcvAttempts = 0;
+  RcvRecovered = 0;
+  RcvResetNext = 0;
+  RcvResetCount = 0;
+}
+
+/**
+  * @brief  A failure: chooses the recovery and the wait before it.
+  * @param  Now: current time in ms
+  * @param  pDelay: returns the ms to wait before running the recovery
+  * @retval The tier to run, RCV_xxx
+  */
+uint8_t RCV_Fail(uint32_t Now, uint32_t *pDelay)
+{
+  uint32_t Delay = 0;
+  uint32_t Oldest;
+  uint8_t  Tier;
+
+  // The link held since the last recovery: this is a new failure, not the same one
+  if (RcvRecovered && ((Now - RcvRecoveredAt) >= RCV_STABLE_MS))
+    RcvAttempts = 0;
+  RcvRecovered = 0;
+
+  Tier = (RcvAttempts < RCV_TIERS) ? RcvAttempts : (RCV_TIERS - 1);
+  if (RcvAttempts != 0)
+  {
+    Delay = (uint32_t)RCV_BACKOFF_MS << (RcvAttempts - 1);
+    if (Delay > RCV_BACKOFF_MAX_MS)
+      Delay = RCV_BACKOFF_MAX_MS;
+  }
+  if (RcvAttempts < RCV_MAX_ATTEMPTS)
+    RcvAttempts++;
+
+  if (Tier != RCV_RECONNECT)
+  {
+    // Window full: wait until its oldest reset is RCV_WINDOW_MS old
+    if (RcvResetCount == RCV_RESETS)
+    {
+      Oldest = RcvResetAt[RcvResetNext];
+      if ((int32_t)(Now + Delay - Oldest) < RCV_WINDOW_MS)
+        Delay = Oldest + RCV_WINDOW_MS - Now;
+    }
+    else
+      RcvResetCount++;
+    RcvResetAt[RcvResetNext] = Now + Delay;
+    if (++RcvResetNext == RCV_RESETS)
+      RcvResetNext = 0;
+  }
+
+  *pDelay = Delay;
+  return Tier;
+}
+
+/**
+  * @brief  The recovery returned by RCV_Fail succeeded: a failure in the
+  *         next RCV_STABLE_MS goes on to the next tier.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+void RCV_Done(uint32_t Now)
+{
+  RcvRecovered = 1;
+  RcvRecoveredAt = Now;
+}
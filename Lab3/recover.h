@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file    recover.h
+  * @brief   Header for recover.c: which recovery to run after a failure of
+  *          the STM WiFi module, and when.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RECOVER_H
+#define __RECOVER_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+// Tiers, from the cheapest: the value returned by RCV_Fail
+#define RCV_RECONNECT			0			// Join the network again (and reopen the socket)
+#define RCV_SOFT_RESET		1			// Soft Reset, the settings saved on the module are kept
+#define RCV_REPROVISION		2			// All the settings sent again, then the Soft Reset
+#define RCV_TIERS					3
+#define RCV_NONE					0xFF	// No recovery running
+
+#define RCV_STABLE_MS			60000	// ms without failures after a recovery: back to RCV_RECONNECT
+#define RCV_BACKOFF_MS		250		// ms before the second attempt, doubled at every attempt
+#define RCV_BACKOFF_MAX_MS	30000	// Longest wait between two attempts
+#define RCV_RESETS				3			// Soft Resets and reprovisionings started in RCV_WINDOW_MS, at most
+#define RCV_WINDOW_MS			60000
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void    RCV_Init(void);
+uint8_t RCV_Fail(uint32_t Now, uint32_t *pDelay);
+void    RCV_Done(uint32_t Now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RECOVER_H */
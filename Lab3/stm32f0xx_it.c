@@ -0,0 +1,177 @@
+/**
+  ******************************************************************************
+  * @file    USART/HyperTerminal_Interrupt/stm32f0xx_it.c 
+  * @author  MCD Application Team
+  * @version V1.0.0
+  * @date    18-May-2012
+  * @brief   Main Interrupt Service Routines.
+  *          This file provides template for all exceptions handler and 
+  *          peripherals interrupt service routine.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2012 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software 
+  * distributed under the License is distributed on an "AS IS" BASIS, 
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx_it.h"
+#include "wifi_uart.h"
+#include "event.h"
+#include "button.h"
+
+/** @addtogroup STM32F0xx_StdPeriph_Examples
+  * @{
+  */
+
+/** @addtogroup HyperTerminal_Interrupt
+  * @{
+  */
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+
+/* Private function prototypes -----------------------------------------------*/
+extern void LocalTime_Increment(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/******************************************************************************/
+/*            Cortex-M0 Processor Exceptions Handlers                         */
+/******************************************************************************/
+
+/**
+  * @brief  This function handles NMI exception.
+  * @param  None
+  * @retval None
+  */
+void NMI_Handler(void)
+{
+}
+
+/**
+  * @brief  This function handles Hard Fault exception.
+  * @param  None
+  * @retval None
+  */
+void HardFault_Handler(void)
+{
+  /* Go to infinite loop when Hard Fault exception occurs */
+  while (1)
+  {
+  }
+}
+
+/**
+  * @brief  This function handles SVCall exception.
+  * @param  None
+  * @retval None
+  */
+void SVC_Handler(void)
+{
+}
+
+/**
+  * @brief  This function handles PendSVC exception.
+  * @param  None
+  * @retval None
+  */
+void PendSV_Handler(void)
+{
+}
+
+/**
+  * @brief  This function handles SysTick Handler (every 1 ms).
+  *         Counts the ms in LocalTime and posts the tick to the main loop
+  *         (the LEDs flash on TIM3, see led.c, the button is on EXTI0).
+  * @param  None
+  * @retval None
+  */
+void SysTick_Handler(void)
+{
+  LocalTime_Increment();
+  EVT_PostOnce(EVT_TICK);
+}
+
+/******************************************************************************/
+/*                 STM32F0xx Peripherals Interrupt Handlers                   */
+/*  Add here the Interrupt Handler for the used peripheral(s) (PPP), for the  */
+/*  available peripheral interrupt handler's name please refer to the startup */
+/*  file (startup_stm32f0xx.s).                                               */
+/******************************************************************************/
+
+/**
+  * @brief  This function handles USART1 (COM1, HyperTerminal) interrupt request.
+  * @param  None
+  * @retval None
+  */
+void USART1_IRQHandler(void)
+{
+  if (USART_GetITStatus(EVAL_COM1, USART_IT_RXNE) != RESET)
+  {
+    EVT_Post(EVT_COM1_RX, USART_ReceiveData(EVAL_COM1));
+  }
+}
+
+/**
+  * @brief  This function handles USART2 (STM WiFi module) interrupt request.
+  *         The received characters are moved by DMA1 Channel5, here only the
+  *         idle line (end of a message) and the overrun error are handled.
+  * @param  None
+  * @retval None
+  */
+void USART2_IRQHandler(void)
+{
+  WIFI_Rx_IRQHandler();
+  EVT_PostOnce(EVT_RX);
+}
+
+/**
+  * @brief  This function handles EXTI0 (PA0, user button) interrupt request.
+  * @param  None
+  * @retval None
+  */
+void EXTI0_1_IRQHandler(void)
+{
+  BTN_EXTI_IRQHandler();
+}
+
+/**
+  * @brief  This function handles DMA1 Channel 4 and Channel 5 interrupt request.
+  * @param  None
+  * @retval None
+  */
+void DMA1_Channel4_5_IRQHandler(void)
+{
+  /* Channel 4: USART2 TX */
+  WIFI_TxDMA_IRQHandler();
+  /* Channel 5: USART2 RX */
+  WIFI_RxDMA_IRQHandler();
+  EVT_PostOnce(EVT_RX);
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
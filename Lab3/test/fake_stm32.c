@@ -0,0 +1,421 @@
+/**
+  ******************************************************************************
+  * @file    fake_stm32.c
+  * @brief   Fake USART2, DMA1 Channels 4/5, CRC unit and interrupt mask for
+  *          the host tests of wifi_uart.c and the modules above it.
+  *
+  *          The "interrupts" are the DMA and USART2 handlers of wifi_uart.c,
+  *          called by this file as the hardware would raise them:
+  *          - Channel 4 (TX): FAKE_TxComplete moves the bytes of the
+  *            transfer in flight to FakeTxLog and raises TC. With
+  *            FakeTxAuto every transfer completes as soon as it is started.
+  *          - Channel 5 (RX): FAKE_RxFeed writes the bytes where the
+  *            circular DMA would, raising HT and TC, FAKE_RxIdle raises the
+  *            idle line and FAKE_RxOverrun the ORE flag.
+  *          A handler raised while the interrupts are masked, or from
+  *          another handler, is left pending and runs as soon as they are
+  *          unmasked, as on the Cortex-M0.
+  *
+  *          FAKE_Irq raises the handlers of the tests, FakeIrq[]: line 0 has
+  *          the priority of the DMA and USART2 handlers, line 1 preempts them
+  *          all. It can be called from a signal handler, so an interrupt
+  *          lands anywhere in the code under test; the pending bits are
+  *          changed with atomic operations.
+  *
+  *          The CRC unit is a bitwise CRC-32 with the input and the output
+  *          reversed, what WIFI_FrameInit sets up. GPIOC only records the
+  *          last BSRR write.
+  *
+  *          The tests are built without PIE, so the addresses of the static
+  *          buffers fit in the 32-bit DMA registers.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "fake_stm32.h"
+#include "wifi_uart.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define FAKE_PENDING_TX		0x01		// WIFI_TxDMA_IRQHandler
+#define FAKE_PENDING_RX		0x02		// WIFI_RxDMA_IRQHandler
+#define FAKE_PENDING_USART	0x04		// WIFI_Rx_IRQHandler
+#define FAKE_PENDING_IRQ0		0x08		// FakeIrq[0]
+#define FAKE_PENDING_IRQ1		0x10		// FakeIrq[1], preempts the others
+#define FAKE_PENDING_LOW		(FAKE_PENDING_TX | FAKE_PENDING_RX | FAKE_PENDING_USART | FAKE_PENDING_IRQ0)
+
+// Priority of the code running
+#define FAKE_LEVEL_THREAD		0
+#define FAKE_LEVEL_LOW			1
+#define FAKE_LEVEL_HIGH			2
+
+#define FAKE_CCR_EN				0x0001
+
+/* Private macro -------------------------------------------------------------*/
+#define FAKE_PTR(a)				((uint8_t *)(uintptr_t)(a))
+
+/* Private variables ---------------------------------------------------------*/
+DMA_Channel_TypeDef FakeDMA1_Channel4, FakeDMA1_Channel5;
+USART_TypeDef       FakeUSART2;
+CRC_TypeDef         FakeCRC;
+SysTick_Type        FakeSysTick;
+GPIO_TypeDef        FakeGPIOC;
+
+uint8_t  FakeTxAuto = 0;
+uint8_t  FakeTxLog[FAKE_TX_LOG_SIZE];
+uint32_t FakeTxCount = 0;
+uint32_t FakeTxTransfers = 0;
+void     (*FakeIrq[2])(void) = { 0, 0 };
+
+static volatile uint32_t FakePrimask = 0;
+static volatile uint8_t  FakeLevel = FAKE_LEVEL_THREAD;
+static volatile uint8_t  FakePending = 0;
+static uint32_t FakeDmaFlags = 0;
+static uint8_t  FakeIdle = 0;
+static uint8_t  FakeOre = 0;
+static uint32_t FakeRxSize = 0;		// DMA_BufferSize of Channel 5
+
+/* Private function prototypes -----------------------------------------------*/
+static void FAKE_Raise(uint8_t Irq);
+static void FAKE_RunPending(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Back to reset: no transfer, nothing pending, empty TX log.
+  * @param  None
+  * @retval None
+  */
+void FAKE_Reset(void)
+{
+  memset(&FakeDMA1_Channel4, 0, sizeof(FakeDMA1_Channel4));
+  memset(&FakeDMA1_Channel5, 0, sizeof(FakeDMA1_Channel5));
+  memset(&FakeUSART2, 0, sizeof(FakeUSART2));
+  memset(&FakeGPIOC, 0, sizeof(FakeGPIOC));
+  FakeTxAuto = 0;
+  FakeTxCount = 0;
+  FakeTxTransfers = 0;
+  FakePrimask = 0;
+  FakeLevel = FAKE_LEVEL_THREAD;
+  FakePending = 0;
+  FakeDmaFlags = 0;
+  FakeIdle = 0;
+  FakeOre = 0;
+}
+
+/**
+  * @brief  Completes the TX transfer in flight: its bytes go to FakeTxLog
+  *         and TC is raised.
+  * @param  None
+  * @retval Bytes moved, 0 if no transfer was in flight
+  */
+uint16_t FAKE_TxComplete(void)
+{
+  uint16_t Length = (uint16_t)FakeDMA1_Channel4.CNDTR;
+  const uint8_t *pData = FAKE_PTR(FakeDMA1_Channel4.CMAR);
+  uint16_t Index;
+
+  if (((FakeDMA1_Channel4.CCR & FAKE_CCR_EN) == 0) || (Length == 0))
+    return 0;
+
+  for (Index = 0; Index < Length; Index++)
+    FakeTxLog[(FakeTxCount++) & (FAKE_TX_LOG_SIZE - 1)] = pData[Index];
+  FakeDMA1_Channel4.CNDTR = 0;
+  FakeTxTransfers++;
+  FakeDmaFlags |= DMA1_IT_TC4;
+  FAKE_Raise(FAKE_PENDING_TX);
+
+  return Length;
+}
+
+/**
+  * @brief  Completes every TX transfer, the queued ones included.
+  * @param  None
+  * @retval None
+  */
+void FAKE_TxDrain(void)
+{
+  while (FAKE_TxComplete() != 0)
+    ;
+}
+
+/**
+  * @brief  Tests if a TX transfer is in flight.
+  * @param  None
+  * @retval 1 if Channel 4 is enabled with bytes to move
+  */
+uint8_t FAKE_TxActive(void)
+{
+  return ((FakeDMA1_Channel4.CCR & FAKE_CCR_EN) != 0) && (FakeDMA1_Channel4.CNDTR != 0);
+}
+
+/**
+  * @brief  Bytes received on USART2: written by the circular DMA of
+  *         Channel 5, HT and TC raised at half and end of the buffer.
+  * @param  pData: the bytes
+  * @param  Length: how many
+  * @retval None
+  */
+void FAKE_RxFeed(const void *pData, uint16_t Length)
+{
+  const uint8_t *pByte = pData;
+  uint8_t *pMem = FAKE_PTR(FakeDMA1_Channel5.CMAR);
+
+  while (Length--)
+  {
+    pMem[FakeRxSize - FakeDMA1_Channel5.CNDTR] = *pByte++;
+    if (--FakeDMA1_Channel5.CNDTR == 0)
+    {
+      FakeDMA1_Channel5.CNDTR = FakeRxSize;
+      FakeDmaFlags |= DMA1_IT_TC5;
+      FAKE_Raise(FAKE_PENDING_RX);
+    }
+    else if (FakeDMA1_Channel5.CNDTR == FakeRxSize / 2)
+    {
+      FakeDmaFlags |= DMA1_IT_HT5;
+      FAKE_Raise(FAKE_PENDING_RX);
+    }
+  }
+}
+
+/**
+  * @brief  Idle line on USART2: the end of a message.
+  * @param  None
+  * @retval None
+  */
+void FAKE_RxIdle(void)
+{
+  FakeIdle = 1;
+  FAKE_Raise(FAKE_PENDING_USART);
+}
+
+/**
+  * @brief  Overrun error on USART2: a byte was lost.
+  * @param  None
+  * @retval None
+  */
+void FAKE_RxOverrun(void)
+{
+  FakeOre = 1;
+  FAKE_Raise(FAKE_PENDING_USART);
+}
+
+/**
+  * @brief  Raises an interrupt: it runs now, or when the interrupts are
+  *         unmasked and the handler running returns.
+  * @param  Irq: FAKE_PENDING_xxx
+  * @retval None
+  */
+static void FAKE_Raise(uint8_t Irq)
+{
+  __atomic_fetch_or(&FakePending, Irq, __ATOMIC_SEQ_CST);
+  FAKE_RunPending();
+}
+
+/**
+  * @brief  Raises an interrupt of the tests, FakeIrq[Line]. Can be called
+  *         from a signal handler.
+  * @param  Line: 0, or 1 that preempts the other handlers
+  * @retval None
+  */
+void FAKE_Irq(uint8_t Line)
+{
+  FAKE_Raise(Line ? FAKE_PENDING_IRQ1 : FAKE_PENDING_IRQ0);
+}
+
+/**
+  * @brief  Runs the pending handlers of a higher priority than the code
+  *         running, if the interrupts are unmasked.
+  * @param  None
+  * @retval None
+  */
+static void FAKE_RunPending(void)
+{
+  uint8_t Level = FakeLevel;
+  uint8_t Allowed = (Level == FAKE_LEVEL_THREAD) ? 0xFF : (Level == FAKE_LEVEL_LOW) ? FAKE_PENDING_IRQ1 : 0;
+  uint8_t Irq;
+
+  while ((FakePrimask == 0) && (FakePending & Allowed))
+  {
+    Irq = __atomic_fetch_and(&FakePending, (uint8_t)~Allowed, __ATOMIC_SEQ_CST) & Allowed;
+    if ((Irq & FAKE_PENDING_IRQ1) && (FakeIrq[1] != 0))
+    {
+      FakeLevel = FAKE_LEVEL_HIGH;
+      FakeIrq[1]();
+    }
+    FakeLevel = FAKE_LEVEL_LOW;
+    if (Irq & FAKE_PENDING_TX)
+      WIFI_TxDMA_IRQHandler();
+    if (Irq & FAKE_PENDING_RX)
+      WIFI_RxDMA_IRQHandler();
+    if (Irq & FAKE_PENDING_USART)
+      WIFI_Rx_IRQHandler();
+    if ((Irq & FAKE_PENDING_IRQ0) && (FakeIrq[0] != 0))
+      FakeIrq[0]();
+    FakeLevel = Level;
+  }
+}
+
+/* Interrupt mask ----------------------------------------------------------- */
+void __disable_irq(void)
+{
+  FakePrimask = 1;
+}
+
+void __enable_irq(void)
+{
+  FakePrimask = 0;
+  FAKE_RunPending();
+}
+
+uint32_t __get_PRIMASK(void)
+{
+  return FakePrimask;
+}
+
+void __set_PRIMASK(uint32_t Mask)
+{
+  FakePrimask = Mask;
+  FAKE_RunPending();
+}
+
+/* RCC, NVIC ---------------------------------------------------------------- */
+void RCC_AHBPeriphClockCmd(uint32_t Periph, FunctionalState NewState)
+{
+}
+
+void NVIC_Init(NVIC_InitTypeDef *pInit)
+{
+}
+
+/* DMA ---------------------------------------------------------------------- */
+void DMA_DeInit(DMA_Channel_TypeDef *DMAy_Channelx)
+{
+  memset(DMAy_Channelx, 0, sizeof(*DMAy_Channelx));
+}
+
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *pInit)
+{
+  DMAy_Channelx->CPAR = pInit->DMA_PeripheralBaseAddr;
+  DMAy_Channelx->CMAR = pInit->DMA_MemoryBaseAddr;
+  DMAy_Channelx->CNDTR = pInit->DMA_BufferSize;
+  DMAy_Channelx->CCR = pInit->DMA_Mode | pInit->DMA_DIR;
+  if (DMAy_Channelx == DMA1_Channel5)
+    FakeRxSize = pInit->DMA_BufferSize;
+}
+
+void DMA_Cmd(DMA_Channel_TypeDef *DMAy_Channelx, FunctionalState NewState)
+{
+  if (NewState == DISABLE)
+  {
+    DMAy_Channelx->CCR &= ~FAKE_CCR_EN;
+    return;
+  }
+  DMAy_Channelx->CCR |= FAKE_CCR_EN;
+  if ((DMAy_Channelx == DMA1_Channel4) && FakeTxAuto)
+    FAKE_TxComplete();
+}
+
+void DMA_ITConfig(DMA_Channel_TypeDef *DMAy_Channelx, uint32_t IT, FunctionalState NewState)
+{
+}
+
+void DMA_SetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx, uint16_t Counter)
+{
+  DMAy_Channelx->CNDTR = Counter;
+}
+
+uint16_t DMA_GetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx)
+{
+  return (uint16_t)DMAy_Channelx->CNDTR;
+}
+
+ITStatus DMA_GetITStatus(uint32_t IT)
+{
+  return (FakeDmaFlags & IT) ? SET : RESET;
+}
+
+void DMA_ClearITPendingBit(uint32_t IT)
+{
+  if (IT == DMA1_IT_GL4)
+    FakeDmaFlags &= ~DMA1_IT_TC4;
+  else if (IT == DMA1_IT_GL5)
+    FakeDmaFlags &= ~(DMA1_IT_TC5 | DMA1_IT_HT5);
+  else
+    FakeDmaFlags &= ~IT;
+}
+
+/* USART -------------------------------------------------------------------- */
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *pInit)
+{
+  USARTx->CR3 = pInit->USART_HardwareFlowControl;
+}
+
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState)
+{
+}
+
+void USART_DMACmd(USART_TypeDef *USARTx, uint32_t Req, FunctionalState NewState)
+{
+}
+
+void USART_ITConfig(USART_TypeDef *USARTx, uint32_t IT, FunctionalState NewState)
+{
+}
+
+ITStatus USART_GetITStatus(USART_TypeDef *USARTx, uint32_t IT)
+{
+  return ((IT == USART_IT_IDLE) && FakeIdle) ? SET : RESET;
+}
+
+void USART_ClearITPendingBit(USART_TypeDef *USARTx, uint32_t IT)
+{
+  if (IT == USART_IT_IDLE)
+    FakeIdle = 0;
+}
+
+FlagStatus USART_GetFlagStatus(USART_TypeDef *USARTx, uint32_t Flag)
+{
+  if (Flag == USART_FLAG_TC)
+    return FAKE_TxActive() ? RESET : SET;
+  if (Flag == USART_FLAG_ORE)
+    return FakeOre ? SET : RESET;
+  return RESET;
+}
+
+void USART_ClearFlag(USART_TypeDef *USARTx, uint32_t Flag)
+{
+  if (Flag == USART_FLAG_ORE)
+    FakeOre = 0;
+}
+
+/* CRC ---------------------------------------------------------------------- */
+void CRC_ReverseInputDataSelect(uint32_t Reverse)
+{
+}
+
+void CRC_ReverseOutputDataCmd(FunctionalState NewState)
+{
+}
+
+void CRC_ResetDR(void)
+{
+  FakeCRC.DR = 0xFFFFFFFF;
+}
+
+uint32_t CRC_CalcCRC8bits(uint8_t Data)
+{
+  uint32_t Crc = FakeCRC.DR ^ Data;
+  uint8_t  Bit;
+
+  for (Bit = 0; Bit < 8; Bit++)
+    Crc = (Crc >> 1) ^ ((Crc & 1) ? 0xEDB88320 : 0);
+  FakeCRC.DR = Crc;
+  return Crc;
+}
+
+uint32_t CRC_GetCRC(void)
+{
+  return FakeCRC.DR;
+}
@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    fake_stm32.h
+  * @brief   Header for fake_stm32.c: what the host tests can do to the fake
+  *          USART2, DMA1 Channels 4/5 and interrupts.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FAKE_STM32_H
+#define __FAKE_STM32_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define FAKE_TX_LOG_SIZE		4096		// Bytes "sent" on USART2 kept, must be a power of 2
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t  FakeTxAuto;						// 1 == a TX transfer completes as soon as it starts
+extern uint8_t  FakeTxLog[FAKE_TX_LOG_SIZE];	// Ring of the bytes sent, index & (FAKE_TX_LOG_SIZE - 1)
+extern uint32_t FakeTxCount;					// Bytes sent since FAKE_Reset
+extern uint32_t FakeTxTransfers;			// DMA transfers completed since FAKE_Reset
+extern void     (*FakeIrq[2])(void);	// Interrupts of the tests, see FAKE_Irq
+
+/* Exported functions ------------------------------------------------------- */
+void     FAKE_Reset(void);
+uint16_t FAKE_TxComplete(void);
+void     FAKE_TxDrain(void);
+uint8_t  FAKE_TxActive(void);
+void     FAKE_RxFeed(const void *pData, uint16_t Length);
+void     FAKE_RxIdle(void);
+void     FAKE_RxOverrun(void);
+void     FAKE_Irq(uint8_t Line);
+
+#endif /* __FAKE_STM32_H */
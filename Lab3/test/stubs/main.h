@@ -0,0 +1,23 @@
+/**
+  ******************************************************************************
+  * @file    main.h
+  * @brief   Host stand-in for the main.h of the Keil project: the constants
+  *          the modules under test take from it.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MAIN_H
+#define __MAIN_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define FAIL									0
+#define PASS									1
+
+#define RXBUFFERSIZE					256		// RxBuffer of wifi_uart.c
+#define DlyBeforeClrRxBuffer	50		// ms
+
+#endif /* __MAIN_H */
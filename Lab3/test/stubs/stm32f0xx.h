@@ -0,0 +1,196 @@
+/**
+  ******************************************************************************
+  * @file    stm32f0xx.h
+  * @brief   Host stand-in for the CMSIS device header and the StdPeriph
+  *          library: only what the modules under test use. The peripherals
+  *          are plain structs and the library calls are implemented by
+  *          fake_stm32.c, which lets the tests play the DMA and USART2.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32F0XX_H
+#define __STM32F0XX_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/* Exported types ------------------------------------------------------------*/
+#define __IO	volatile
+
+typedef enum {RESET = 0, SET = !RESET} FlagStatus, ITStatus;
+typedef enum {DISABLE = 0, ENABLE = !DISABLE} FunctionalState;
+
+typedef struct
+{
+  __IO uint32_t CCR;
+  __IO uint32_t CNDTR;
+  __IO uint32_t CPAR;
+  __IO uint32_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t CR1;
+  __IO uint32_t CR3;
+  __IO uint32_t ISR;
+  __IO uint16_t RDR;
+  __IO uint16_t TDR;
+} USART_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t DR;
+} CRC_TypeDef;
+
+typedef struct
+{
+  uint32_t DMA_PeripheralBaseAddr;
+  uint32_t DMA_MemoryBaseAddr;
+  uint32_t DMA_DIR;
+  uint32_t DMA_BufferSize;
+  uint32_t DMA_PeripheralInc;
+  uint32_t DMA_MemoryInc;
+  uint32_t DMA_PeripheralDataSize;
+  uint32_t DMA_MemoryDataSize;
+  uint32_t DMA_Mode;
+  uint32_t DMA_Priority;
+  uint32_t DMA_M2M;
+} DMA_InitTypeDef;
+
+typedef struct
+{
+  uint32_t USART_BaudRate;
+  uint32_t USART_WordLength;
+  uint32_t USART_StopBits;
+  uint32_t USART_Parity;
+  uint32_t USART_Mode;
+  uint32_t USART_HardwareFlowControl;
+} USART_InitTypeDef;
+
+typedef struct
+{
+  __IO uint32_t ODR;
+  __IO uint32_t BSRR;		// Last value written: the fake does not apply it to ODR
+  __IO uint32_t BRR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t CTRL;
+  __IO uint32_t LOAD;
+  __IO uint32_t VAL;
+  __IO uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+  uint8_t         NVIC_IRQChannel;
+  uint8_t         NVIC_IRQChannelPriority;
+  FunctionalState NVIC_IRQChannelCmd;
+} NVIC_InitTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+extern DMA_Channel_TypeDef FakeDMA1_Channel4, FakeDMA1_Channel5;
+extern USART_TypeDef       FakeUSART2;
+extern CRC_TypeDef         FakeCRC;
+extern SysTick_Type        FakeSysTick;
+extern GPIO_TypeDef        FakeGPIOC;
+
+#define DMA1_Channel4							(&FakeDMA1_Channel4)
+#define DMA1_Channel5							(&FakeDMA1_Channel5)
+#define USART2										(&FakeUSART2)
+#define CRC												(&FakeCRC)
+#define SysTick										(&FakeSysTick)
+#define GPIOC											(&FakeGPIOC)
+
+#define GPIO_Pin_6								0x0040
+#define GPIO_Pin_8								0x0100
+#define GPIO_Pin_9								0x0200
+
+#define RCC_AHBPeriph_DMA1				0x00000001
+#define RCC_AHBPeriph_CRC					0x00000040
+
+#define DMA_DIR_PeripheralDST			0x00000010
+#define DMA_DIR_PeripheralSRC			0x00000000
+#define DMA_PeripheralInc_Disable	0x00000000
+#define DMA_MemoryInc_Enable			0x00000080
+#define DMA_PeripheralDataSize_Byte	0x00000000
+#define DMA_MemoryDataSize_Byte		0x00000000
+#define DMA_Mode_Normal						0x00000000
+#define DMA_Mode_Circular					0x00000020
+#define DMA_Priority_Medium				0x00001000
+#define DMA_Priority_High					0x00002000
+#define DMA_M2M_Disable						0x00000000
+#define DMA_IT_TC									0x00000002
+#define DMA_IT_HT									0x00000004
+#define DMA1_IT_GL4								0x00001000
+#define DMA1_IT_TC4								0x00002000
+#define DMA1_IT_GL5								0x00010000
+#define DMA1_IT_TC5								0x00020000
+#define DMA1_IT_HT5								0x00040000
+
+#define USART_DMAReq_Tx						0x0080
+#define USART_DMAReq_Rx						0x0040
+#define USART_IT_IDLE							0x0410
+#define USART_IT_ERR							0x0001
+#define USART_FLAG_TC							0x0040
+#define USART_FLAG_ORE						0x0008
+#define USART_FLAG_BUSY						0x10000
+#define USART_WordLength_8b				0x0000
+#define USART_StopBits_1					0x0000
+#define USART_Parity_No						0x0000
+#define USART_Mode_Rx							0x0004
+#define USART_Mode_Tx							0x0008
+#define USART_CR3_RTSE						0x0100
+#define USART_CR3_CTSE						0x0200
+#define USART_HardwareFlowControl_None	0x0000
+
+#define CRC_ReverseInputData_8bits	0x00000020
+
+#define DMA1_Channel4_5_IRQn			11
+#define USART2_IRQn								28
+
+/* Exported functions ------------------------------------------------------- */
+void     __disable_irq(void);
+void     __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t Mask);
+
+void     RCC_AHBPeriphClockCmd(uint32_t Periph, FunctionalState NewState);
+void     NVIC_Init(NVIC_InitTypeDef *pInit);
+
+void     DMA_DeInit(DMA_Channel_TypeDef *DMAy_Channelx);
+void     DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *pInit);
+void     DMA_Cmd(DMA_Channel_TypeDef *DMAy_Channelx, FunctionalState NewState);
+void     DMA_ITConfig(DMA_Channel_TypeDef *DMAy_Channelx, uint32_t IT, FunctionalState NewState);
+void     DMA_SetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx, uint16_t Counter);
+uint16_t DMA_GetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx);
+ITStatus DMA_GetITStatus(uint32_t IT);
+void     DMA_ClearITPendingBit(uint32_t IT);
+
+void     USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *pInit);
+void     USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState);
+void     USART_DMACmd(USART_TypeDef *USARTx, uint32_t Req, FunctionalState NewState);
+void     USART_ITConfig(USART_TypeDef *USARTx, uint32_t IT, FunctionalState NewState);
+ITStatus USART_GetITStatus(USART_TypeDef *USARTx, uint32_t IT);
+void     USART_ClearITPendingBit(USART_TypeDef *USARTx, uint32_t IT);
+FlagStatus USART_GetFlagStatus(USART_TypeDef *USARTx, uint32_t Flag);
+void     USART_ClearFlag(USART_TypeDef *USARTx, uint32_t Flag);
+
+void     CRC_ReverseInputDataSelect(uint32_t Reverse);
+void     CRC_ReverseOutputDataCmd(FunctionalState NewState);
+void     CRC_ResetDR(void);
+uint32_t CRC_CalcCRC8bits(uint8_t Data);
+uint32_t CRC_GetCRC(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F0XX_H */
@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file    test.h
+  * @brief   Checks for the host tests: a failed CHECK prints where and the
+  *          test goes on, TEST_END gives the exit code for make.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TEST_H
+#define __TEST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+static unsigned TestChecks = 0;
+static unsigned TestFailures = 0;
+
+/* Exported macro ------------------------------------------------------------*/
+#define CHECK(c)																												\
+  do {																																	\
+    TestChecks++;																												\
+    if (!(c)) {																													\
+      TestFailures++;																										\
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c);		\
+    }																																		\
+  } while (0)
+
+#define CHECK_EQ(a, b)																									\
+  do {																																	\
+    long long _a = (long long)(a), _b = (long long)(b);								\
+    TestChecks++;																												\
+    if (_a != _b) {																											\
+      TestFailures++;																										\
+      printf("%s:%d: %s == %lld, expected %s == %lld\n",								\
+             __FILE__, __LINE__, #a, _a, #b, _b);												\
+    }																																		\
+  } while (0)
+
+// Exit code of main()
+#define TEST_END()																											\
+  (printf("%s: %u checks, %u failed\n", __FILE__, TestChecks, TestFailures),	\
+   TestFailures != 0)
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+  * @brief  Monotonic time, for the benchmarks.
+  * @param  None
+  * @retval Seconds
+  */
+static inline double TEST_Now(void)
+{
+  struct timespec Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return Now.tv_sec + Now.tv_nsec * 1e-9;
+}
+
+/**
+  * @brief  Cycle counter of the host, for the benchmarks: the time stamp
+  *         counter on x86, nanoseconds elsewhere.
+  * @param  None
+  * @retval Cycles
+  */
+static inline uint64_t TEST_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return (uint64_t)(TEST_Now() * 1e9);
+#endif
+}
+
+#endif /* __TEST_H */
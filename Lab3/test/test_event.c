@@ -0,0 +1,439 @@
+/**
+  ******************************************************************************
+  * @file    test_event.c
+  * @brief   event.c under fire: two interrupts, raised by host timers
+  *          (SIGALRM on line 0, SIGUSR1 on line 1 that preempts line 0), post
+  *          numbered events while the main loop takes them, so the posts
+  *          land anywhere in EVT_Get and in each other. Every event posted
+  *          is taken once, in the order of its producer, the lost ones are
+  *          counted, EVT_PostOnce never leaves a type stuck.
+  *
+  *          The timers seldom land in the few instructions that matter, so
+  *          on x86-64 EVT_Get and EVT_Post are also run step by step (trap
+  *          flag): the interrupt is raised after their first instruction,
+  *          then after the second, and so on to the last.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <string.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <time.h>
+#include <sys/time.h>
+#include "main.h"
+#include "event.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// One producer: an interrupt line
+typedef struct
+{
+  uint8_t  Type;			// EVT_Post type, Data = Sequence
+  uint8_t  OnceType;	// EVT_PostOnce type
+  volatile uint32_t Sequence;	// Events posted
+  volatile uint32_t Lost;			// Posts refused, queue full
+  volatile uint32_t OnceLost;
+  uint32_t Taken;			// Taken by the main loop
+  uint32_t Expected;	// Next Data expected, wraps with the 16 bits of Data
+  uint32_t Skipped;		// Data missing between two taken: lost
+  uint32_t Disorder;	// Data older than the one before
+} Producer_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define STRESS_SECONDS		1.0
+#define IRQ0_PERIOD_US		20
+#define IRQ1_PERIOD_US		30
+
+/* Private variables ---------------------------------------------------------*/
+static Producer_TypeDef Producer[2] =
+{
+  { EVT_COM1_RX, EVT_TICK, 0, 0, 0, 0, 0, 0, 0 },
+  { EVT_BUTTON,  EVT_RX,   0, 0, 0, 0, 0, 0, 0 },
+};
+static volatile uint8_t  InIrq0 = 0;
+static volatile uint32_t Nested = 0;		// Line 1 inside line 0
+static volatile uint8_t  Running = 0;
+static timer_t Timer1;
+
+static volatile uint8_t  Tracing = 0;		// 1 == count the instructions
+static volatile uint8_t  TraceFired = 0;
+static volatile uint8_t  TraceLine = 0;	// Line raised
+static volatile uint32_t TraceCount = 0;
+static volatile uint32_t TracePoint = 0;	// Raised after this many instructions
+static volatile uint16_t SweepData[2];	// Data posted by the lines in TestEveryInstruction
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Post(Producer_TypeDef *pProducer)
+{
+  if (EVT_Post(pProducer->Type, (uint16_t)pProducer->Sequence) == FAIL)
+    pProducer->Lost++;
+  pProducer->Sequence++;
+  if (EVT_PostOnce(pProducer->OnceType) == FAIL)
+    pProducer->OnceLost++;
+}
+
+// Line 0 works for a while after its post, as a real handler, so line 1 can land in it
+static void Irq0(void)
+{
+  volatile uint8_t Work;
+
+  InIrq0 = 1;
+  Post(&Producer[0]);
+  for (Work = 0; Work < 100; Work++)
+    ;
+  InIrq0 = 0;
+}
+
+static void Irq1(void)
+{
+  if (InIrq0)
+    Nested++;
+  Post(&Producer[1]);
+}
+
+static void Signal(int Number)
+{
+  if (Running)
+    FAKE_Irq(Number == SIGUSR1);
+}
+
+// Periods in us, 0 stops the timer
+static void Timers(long Period0, long Period1)
+{
+  struct itimerval Timer;
+  struct itimerspec Spec;
+
+  memset(&Timer, 0, sizeof(Timer));
+  Timer.it_interval.tv_usec = Timer.it_value.tv_usec = Period0;
+  setitimer(ITIMER_REAL, &Timer, 0);
+  memset(&Spec, 0, sizeof(Spec));
+  Spec.it_interval.tv_nsec = Spec.it_value.tv_nsec = Period1 * 1000;
+  timer_settime(Timer1, 0, &Spec, 0);
+}
+
+/**
+  * @brief  The main loop takes an event: the Data of a producer must follow
+  *         the previous one, a gap is what was lost.
+  */
+static void Take(const EVT_TypeDef *pEvent)
+{
+  Producer_TypeDef *pProducer;
+  uint16_t Gap;
+  uint8_t  Index;
+
+  for (Index = 0; Index < 2; Index++)
+  {
+    pProducer = &Producer[Index];
+    if (pEvent->Type != pProducer->Type)
+      continue;
+    Gap = (uint16_t)(pEvent->Data - (uint16_t)pProducer->Expected);
+    if (Gap >= 0x8000)
+      pProducer->Disorder++;
+    else
+    {
+      pProducer->Skipped += Gap;
+      pProducer->Expected += Gap + 1;
+    }
+    pProducer->Taken++;
+  }
+}
+
+/**
+  * @brief  The main loop against the two interrupts, sometimes too busy to
+  *         keep up so that the queue fills.
+  */
+static void TestStress(void)
+{
+  struct sigaction Action;
+  struct sigevent  Notify;
+  EVT_TypeDef Event;
+  uint32_t Loops = 0, Once = 0, Lost = 0;
+  volatile uint32_t Busy;
+  double   End;
+  uint8_t  Index;
+
+  FAKE_Reset();
+  EVT_Init();
+  FakeIrq[0] = Irq0;
+  FakeIrq[1] = Irq1;
+  memset(&Action, 0, sizeof(Action));
+  Action.sa_handler = Signal;
+  sigemptyset(&Action.sa_mask);
+  Action.sa_flags = SA_RESTART;
+  sigaction(SIGALRM, &Action, 0);
+  sigaction(SIGUSR1, &Action, 0);
+  memset(&Notify, 0, sizeof(Notify));
+  Notify.sigev_notify = SIGEV_SIGNAL;
+  Notify.sigev_signo = SIGUSR1;
+  CHECK_EQ(timer_create(CLOCK_MONOTONIC, &Notify, &Timer1), 0);
+
+  Running = 1;
+  Timers(IRQ0_PERIOD_US, IRQ1_PERIOD_US);
+  End = TEST_Now() + STRESS_SECONDS;
+  while (TEST_Now() < End)
+  {
+    while (EVT_Get(&Event) != EVT_NONE)
+    {
+      if ((Event.Type == EVT_TICK) || (Event.Type == EVT_RX))
+        Once++;
+      else
+        Take(&Event);
+    }
+    if ((++Loops & 0xFF) == 0)
+    {
+      for (Busy = 0; Busy < 20000; Busy++)
+        ;
+    }
+  }
+  Running = 0;
+  Timers(0, 0);
+  timer_delete(Timer1);
+
+  while (EVT_Get(&Event) != EVT_NONE)
+  {
+    if ((Event.Type == EVT_TICK) || (Event.Type == EVT_RX))
+      Once++;
+    else
+      Take(&Event);
+  }
+
+  for (Index = 0; Index < 2; Index++)
+  {
+    CHECK(Producer[Index].Sequence > 1000);
+    CHECK_EQ(Producer[Index].Disorder, 0);
+    CHECK_EQ(Producer[Index].Taken + Producer[Index].Lost, Producer[Index].Sequence);
+    // Lost between two events taken, or after the last one
+    CHECK_EQ(Producer[Index].Skipped + Producer[Index].Sequence - Producer[Index].Expected,
+             Producer[Index].Lost);
+    Lost += Producer[Index].Lost + Producer[Index].OnceLost;
+  }
+  CHECK_EQ(EVT_Overruns(), (uint16_t)Lost);
+  CHECK(Lost > 0);			// the queue has been full
+  CHECK(Nested > 0);		// and the producers have preempted each other
+  CHECK(Once > 0);
+
+  // No type is left marked as waiting without its event in the queue
+  CHECK_EQ(EVT_PostOnce(EVT_TICK), PASS);
+  CHECK_EQ(EVT_PostOnce(EVT_TICK), PASS);
+  CHECK_EQ(EVT_PostOnce(EVT_RX), PASS);
+  CHECK_EQ(EVT_Get(&Event), EVT_TICK);
+  CHECK_EQ(EVT_Get(&Event), EVT_RX);
+  CHECK_EQ(EVT_Get(&Event), EVT_NONE);
+  CHECK_EQ(EVT_Pending(), 0);
+
+  printf("event stress  %u + %u posted, %u lost, %u taken once, line 1 inside line 0 %u times\n",
+         (unsigned)Producer[0].Sequence, (unsigned)Producer[1].Sequence, (unsigned)Lost,
+         (unsigned)Once, (unsigned)Nested);
+}
+
+/**
+  * @brief  The queue without interrupts: full at EVT_QUEUE_SIZE - 1, one
+  *         EVT_PostOnce of a type at a time.
+  */
+static void TestQueue(void)
+{
+  EVT_TypeDef Event;
+  uint16_t Index;
+
+  FAKE_Reset();
+  EVT_Init();
+  CHECK_EQ(EVT_Get(&Event), EVT_NONE);
+  for (Index = 0; Index < EVT_QUEUE_SIZE - 1; Index++)
+    CHECK_EQ(EVT_Post(EVT_COM1_RX, Index), PASS);
+  CHECK_EQ(EVT_Post(EVT_COM1_RX, Index), FAIL);
+  CHECK_EQ(EVT_PostOnce(EVT_TICK), FAIL);
+  CHECK_EQ(EVT_Overruns(), 2);
+  for (Index = 0; Index < EVT_QUEUE_SIZE - 1; Index++)
+  {
+    CHECK_EQ(EVT_Get(&Event), EVT_COM1_RX);
+    CHECK_EQ(Event.Data, Index);
+  }
+  CHECK_EQ(EVT_PostOnce(EVT_TICK), PASS);
+  CHECK_EQ(EVT_PostOnce(EVT_TICK), PASS);
+  CHECK_EQ(EVT_Post(EVT_BUTTON, 7), PASS);
+  CHECK_EQ(EVT_Get(&Event), EVT_TICK);
+  CHECK_EQ(EVT_PostOnce(EVT_TICK), PASS);
+  CHECK_EQ(EVT_Get(&Event), EVT_BUTTON);
+  CHECK_EQ(Event.Data, 7);
+  CHECK_EQ(EVT_Get(&Event), EVT_TICK);
+  CHECK_EQ(EVT_Pending(), 0);
+}
+
+#if defined(__x86_64__) && defined(__linux__)
+/**
+  * @brief  One instruction executed with the trap flag: the interrupt is
+  *         raised at TracePoint, then the trap flag is cleared.
+  */
+static void Trap(int Number, siginfo_t *pInfo, void *pContext)
+{
+  ucontext_t *pContextX = pContext;
+
+  if (Tracing && !TraceFired && (TraceCount++ == TracePoint))
+  {
+    TraceFired = 1;
+    FAKE_Irq(TraceLine);
+  }
+  if (!Tracing || TraceFired)
+    pContextX->uc_mcontext.gregs[REG_EFL] &= ~0x100;
+}
+
+static void TraceOn(uint32_t Point, uint8_t Line)
+{
+  TraceCount = 0;
+  TracePoint = Point;
+  TraceLine = Line;
+  TraceFired = 0;
+  Tracing = 1;
+  __asm__ volatile ("pushfq\n\torq $0x100, (%%rsp)\n\tpopfq" ::: "memory", "cc");
+}
+
+static void TraceOff(void)
+{
+  Tracing = 0;
+}
+
+static void SweepPost0(void)
+{
+  EVT_Post(EVT_COM1_RX, SweepData[0]);
+}
+
+static void SweepPost1(void)
+{
+  EVT_Post(EVT_BUTTON, SweepData[1]);
+}
+
+static void SweepOnce(void)
+{
+  EVT_PostOnce(EVT_TICK);
+}
+
+/**
+  * @brief  An interrupt after every instruction of: EVT_Get on a full queue,
+  *         EVT_Get of an EVT_PostOnce type, EVT_Post preempted by another
+  *         post.
+  */
+static void TestEveryInstruction(void)
+{
+  struct sigaction Action;
+  EVT_TypeDef Event;
+  uint32_t Point;
+  uint16_t Index;
+  unsigned Fails[3] = { 0, 0, 0 };
+  unsigned Points[3] = { 0, 0, 0 };
+  uint8_t  Seen[2];
+
+  memset(&Action, 0, sizeof(Action));
+  Action.sa_sigaction = Trap;
+  Action.sa_flags = SA_SIGINFO;
+  sigemptyset(&Action.sa_mask);
+  sigaction(SIGTRAP, &Action, 0);
+
+  // 1. Full queue: the post lands in the slot being read, or is refused
+  FakeIrq[0] = SweepPost0;
+  SweepData[0] = 0xBEEF;
+  for (Point = 0; ; Point++)
+  {
+    FAKE_Reset();
+    EVT_Init();
+    for (Index = 0; Index < EVT_QUEUE_SIZE - 1; Index++)
+      EVT_Post(EVT_COM1_RX, Index);
+    TraceOn(Point, 0);
+    EVT_Get(&Event);
+    TraceOff();
+    if (Event.Data != 0)
+      Fails[0]++;
+    for (Index = 1; EVT_Get(&Event) != EVT_NONE; Index++)
+    {
+      if (Event.Data != ((Index < EVT_QUEUE_SIZE - 1) ? Index : 0xBEEF))
+        Fails[0]++;
+    }
+    if (TraceFired && (Index != EVT_QUEUE_SIZE - 1 + (EVT_Overruns() == 0)))
+      Fails[0]++;
+    if (!TraceFired)
+      break;
+    Points[0]++;
+  }
+
+  // 2. EVT_PostOnce during the EVT_Get of its type: never stuck
+  FakeIrq[0] = SweepOnce;
+  for (Point = 0; ; Point++)
+  {
+    FAKE_Reset();
+    EVT_Init();
+    EVT_PostOnce(EVT_TICK);
+    TraceOn(Point, 0);
+    EVT_Get(&Event);
+    TraceOff();
+    if (Event.Type != EVT_TICK)
+      Fails[1]++;
+    while (EVT_Get(&Event) != EVT_NONE)
+      ;
+    EVT_PostOnce(EVT_TICK);
+    if ((EVT_Get(&Event) != EVT_TICK) || (EVT_Overruns() != 0))
+      Fails[1]++;
+    if (!TraceFired)
+      break;
+    Points[1]++;
+  }
+
+  // 3. Line 1 preempts the EVT_Post of line 0: room for both, both taken once
+  FakeIrq[0] = SweepPost0;
+  FakeIrq[1] = SweepPost1;
+  SweepData[0] = 100;
+  SweepData[1] = 200;
+  for (Point = 0; ; Point++)
+  {
+    FAKE_Reset();
+    EVT_Init();
+    for (Index = 0; Index < EVT_QUEUE_SIZE - 3; Index++)
+      EVT_Post(EVT_COM1_RX, Index);
+    TraceOn(Point, 1);
+    FAKE_Irq(0);
+    TraceOff();
+    if (!TraceFired)
+      FAKE_Irq(1);				// Past the end of line 0: after it
+    Seen[0] = Seen[1] = 0;
+    for (Index = 0; EVT_Get(&Event) != EVT_NONE; Index++)
+    {
+      if (Index < EVT_QUEUE_SIZE - 3)
+        Fails[2] += (Event.Type != EVT_COM1_RX) || (Event.Data != Index);
+      else if ((Event.Type == EVT_COM1_RX) && (Event.Data == 100))
+        Seen[0]++;
+      else if ((Event.Type == EVT_BUTTON) && (Event.Data == 200))
+        Seen[1]++;
+      else
+        Fails[2]++;
+    }
+    if ((Seen[0] != 1) || (Seen[1] != 1) || (EVT_Overruns() != 0))
+      Fails[2]++;
+    if (!TraceFired)
+      break;
+    Points[2]++;
+  }
+  FakeIrq[0] = FakeIrq[1] = 0;
+
+  for (Index = 0; Index < 3; Index++)
+  {
+    CHECK(Points[Index] > 10);
+    CHECK_EQ(Fails[Index], 0);
+  }
+  printf("event step    interrupt after each of %u + %u + %u instructions\n", Points[0], Points[1], Points[2]);
+}
+#else
+static void TestEveryInstruction(void)
+{
+  printf("event step    skipped: x86-64 Linux only\n");
+}
+#endif
+
+int main(void)
+{
+  TestQueue();
+  TestEveryInstruction();
+  TestStress();
+  return TEST_END();
+}
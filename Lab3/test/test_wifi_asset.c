@@ -0,0 +1,404 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_asset.c
+  * @brief   wifi_asset.c against a module with a file system: the module
+  *          reads the at+s.fsc and at+s.fsa commands from the fake USART2,
+  *          takes the bytes every at+s.fsa announces and answers OK, or
+  *          ERROR: on the append its script says. Files of several chunks,
+  *          of an exact number of chunks and empty, the gzip files with
+  *          their own HTTP header, an ERROR on a middle chunk and
+  *          WIFI_AtAbort at any time of an upload.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <stdlib.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+#include "wifi_strings.h"
+#include "wifi_at.h"
+#include "wifi_asset.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// File on the module
+typedef struct
+{
+  char     Name[48];			// As long as ModuleLine
+  uint16_t Size;				// Length given by at+s.fsc
+  uint16_t Length;			// Bytes appended
+  uint8_t  Data[1024];
+  uint16_t Append[8];		// Length of every at+s.fsa
+  uint8_t  Appends;
+} File_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define TEST_ID(Id, String)		Id,
+
+enum
+{
+  WIFI_RX_STRINGS(TEST_ID)
+  RX_COUNT
+};
+
+#define TIMEOUT		100		// ms of the test answers
+#define PAD				"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+
+/* Private variables ---------------------------------------------------------*/
+static const WIFI_AtReply_TypeDef ReplyPage =		// at+s.fsc and the chunks, not sent again
+  { WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), TIMEOUT, 5, 0, 0 };
+
+static uint8_t Multi[600];									// 256 + 256 + 88
+static uint8_t Exact[2 * WIFI_ASSET_CHUNK];
+static uint8_t Packed[400];									// "gzip" data, with 0s
+static const char ShortHeader[] =						// ends in the first chunk
+  "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\nContent-Encoding: gzip\r\n\r\n";
+static const char LongHeader[] =						// ends in the second chunk
+  "HTTP/1.0 200 OK\r\nContent-Encoding: gzip\r\nX-Pad: " PAD PAD PAD PAD "\r\n\r\n";
+
+static const WIFI_Asset_TypeDef Files[] =
+{
+  WIFI_ASSET_DATA("/multi.bin", Multi),
+  WIFI_ASSET_DATA("/exact.bin", Exact),
+  WIFI_ASSET_TEXT("/empty.txt", ""),
+  WIFI_ASSET_TEXT("/last.txt", "last")
+};
+static const WIFI_Asset_TypeDef Gzip[] =
+{
+  WIFI_ASSET_GZIP("/short.html", ShortHeader, Packed),
+  WIFI_ASSET_GZIP("/long.html", LongHeader, Packed)
+};
+
+static File_TypeDef ModuleFiles[8];
+static uint8_t  ModuleFileCount = 0;
+static File_TypeDef *pModuleFile = 0;	// File of the at+s.fsa being read
+static uint32_t ModuleRead = 0;				// FakeTxLog bytes the module has read
+static char     ModuleLine[48];
+static uint8_t  ModuleLength = 0;
+static uint16_t ModuleData = 0;				// Bytes of the at+s.fsa still to read
+static uint8_t  ModuleAppends = 0;		// at+s.fsa received since Setup
+static uint8_t  FailAppend = 0;				// This at+s.fsa (from 1) is answered ERROR:, 0 == none
+static uint32_t ModuleOther = 0;			// Lines that are not at+s.fsc or at+s.fsa
+static uint32_t ModuleErrors = 0;			// at+s.fsa on no file or past its length
+
+static uint8_t  DoneCount = 0;				// Calls of the callback of the upload
+static uint8_t  DoneStatus = 0xFF;
+static uint32_t Now = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Done(uint8_t Status)
+{
+  DoneCount++;
+  DoneStatus = Status;
+}
+
+static File_TypeDef *Find(const char *pName)
+{
+  uint8_t Index;
+
+  for (Index = 0; Index < ModuleFileCount; Index++)
+  {
+    if (strcmp(ModuleFiles[Index].Name, pName) == 0)
+      return &ModuleFiles[Index];
+  }
+  return 0;
+}
+
+/**
+  * @brief  A command line of the module, "at+s.fsx=<name>,<length>".
+  */
+static void ModuleCommand(char *pLine)
+{
+  char *pComma = strchr(pLine, ',');
+  File_TypeDef *pFile;
+  uint16_t Length;
+
+  if ((pComma == 0) || ((strncmp(pLine, "at+s.fsc=", 9) != 0) && (strncmp(pLine, "at+s.fsa=", 9) != 0)))
+  {
+    ModuleOther++;
+    FAKE_RxFeed("\r\n OK\r\n", 7);
+    return;
+  }
+  *pComma = 0;
+  Length = (uint16_t)atoi(pComma + 1);
+  pFile = Find(&pLine[9]);
+
+  if (pLine[7] == 'c')
+  {
+    if (pFile == 0)
+      pFile = &ModuleFiles[ModuleFileCount++ & 7];
+    memset(pFile, 0, sizeof(*pFile));
+    strcpy(pFile->Name, &pLine[9]);
+    pFile->Size = Length;
+    FAKE_RxFeed("\r\n OK\r\n", 7);
+    return;
+  }
+
+  ModuleAppends++;
+  if ((pFile == 0) || (Length == 0) || (pFile->Length + Length > pFile->Size) || (pFile->Appends == 8))
+  {
+    ModuleErrors++;
+    return;
+  }
+  pFile->Append[pFile->Appends++] = Length;
+  pModuleFile = pFile;
+  ModuleData = Length;
+}
+
+/**
+  * @brief  The module: reads the commands, every at+s.fsa takes the bytes it
+  *         announces, the file is answered OK or ERROR: after them.
+  */
+static void Module(void)
+{
+  uint8_t Byte;
+
+  while (ModuleRead != FakeTxCount)
+  {
+    Byte = FakeTxLog[ModuleRead++ & (FAKE_TX_LOG_SIZE - 1)];
+    if (ModuleData != 0)
+    {
+      pModuleFile->Data[pModuleFile->Length++] = Byte;
+      if (--ModuleData == 0)
+      {
+        if (ModuleAppends == FailAppend)
+          FAKE_RxFeed("\r\n ERROR: Failed to write\r\n", 27);
+        else
+          FAKE_RxFeed("\r\n OK\r\n", 7);
+      }
+      continue;
+    }
+    if ((Byte == '\r') && (ModuleLength != 0) && (ModuleLine[ModuleLength - 1] == '\n'))
+    {
+      ModuleLine[ModuleLength - 1] = 0;
+      ModuleLength = 0;
+      ModuleCommand(ModuleLine);
+      continue;
+    }
+    if (ModuleLength < sizeof(ModuleLine) - 1)
+      ModuleLine[ModuleLength++] = (char)Byte;
+  }
+}
+
+/**
+  * @brief  Main loop for Ms ms: the engine, then the module answers.
+  */
+static void Run(uint32_t Ms)
+{
+  uint32_t End = Now + Ms;
+
+  while (Now != End)
+  {
+    WIFI_AtProcess(Now);
+    Module();
+    Now++;
+  }
+  WIFI_AtProcess(Now);
+}
+
+static void Setup(void)
+{
+  FAKE_Reset();
+  FakeTxAuto = 1;
+  WIFI_TxInit();
+  WIFI_RxInit();
+  WIFI_MatchReset();
+  WIFI_MatchSetHandler(WIFI_AtMatchHandler);
+  WIFI_AtInit();
+  WIFI_AssetInit(&ReplyPage);
+  ModuleFileCount = 0;
+  ModuleRead = 0;
+  ModuleLength = 0;
+  ModuleData = 0;
+  ModuleAppends = 0;
+  FailAppend = 0;
+  ModuleOther = 0;
+  ModuleErrors = 0;
+  DoneCount = 0;
+  DoneStatus = 0xFF;
+}
+
+/**
+  * @brief  The file on the module is the header and the data of the asset,
+  *         created with their length and appended in full chunks but the
+  *         last one.
+  */
+static void CheckFile(const WIFI_Asset_TypeDef *pAsset)
+{
+  File_TypeDef *pFile = Find(pAsset->pName);
+  uint16_t Size = pAsset->HeaderLength + pAsset->Length;
+  uint16_t Sum = 0;
+  uint8_t  Index;
+
+  CHECK(pFile != 0);
+  if (pFile == 0)
+    return;
+  CHECK_EQ(pFile->Size, Size);
+  CHECK_EQ(pFile->Length, Size);
+  CHECK_EQ(pFile->Appends, (Size + WIFI_ASSET_CHUNK - 1) / WIFI_ASSET_CHUNK);
+  for (Index = 0; Index < pFile->Appends; Index++)
+  {
+    CHECK_EQ(pFile->Append[Index], (Index + 1 < pFile->Appends) ? WIFI_ASSET_CHUNK : Size - Sum);
+    Sum += pFile->Append[Index];
+  }
+  CHECK(memcmp(pFile->Data, pAsset->pHeader, pAsset->HeaderLength) == 0);
+  CHECK(memcmp(&pFile->Data[pAsset->HeaderLength], pAsset->pData, pAsset->Length) == 0);
+}
+
+/**
+  * @brief  Several chunks, an exact number of chunks, an empty file: the
+  *         module gets every byte once, in chunks of WIFI_ASSET_CHUNK, and
+  *         the callback is called once at the end.
+  */
+static void TestChunks(void)
+{
+  uint8_t Index;
+
+  Setup();
+  CHECK_EQ(WIFI_AssetUpload(Files, 4, Done), PASS);
+  Run(200);
+  CHECK_EQ(DoneCount, 1);
+  CHECK_EQ(DoneStatus, WIFI_AT_OK);
+  CHECK_EQ(WIFI_AtBusy(), 0);
+  CHECK_EQ(ModuleFileCount, 4);
+  CHECK_EQ(ModuleErrors, 0);
+  CHECK_EQ(ModuleOther, 0);
+  for (Index = 0; Index < 4; Index++)
+    CheckFile(&Files[Index]);
+
+  CHECK_EQ(Find("/multi.bin")->Appends, 3);
+  CHECK_EQ(Find("/multi.bin")->Append[2], 88);
+  CHECK_EQ(Find("/exact.bin")->Appends, 2);			// no empty at+s.fsa after the last chunk
+  CHECK_EQ(Find("/empty.txt")->Size, 0);				// created, never appended
+  CHECK_EQ(Find("/empty.txt")->Appends, 0);
+  CHECK_EQ(ModuleAppends, 6);
+}
+
+/**
+  * @brief  gzip files: the header is written first, the chunks are cut
+  *         across the header and the data as in one file, at+s.fsc gives
+  *         the length of both.
+  */
+static void TestGzip(void)
+{
+  File_TypeDef *pFile;
+
+  Setup();
+  CHECK(sizeof(ShortHeader) - 1 < WIFI_ASSET_CHUNK);
+  CHECK(sizeof(LongHeader) - 1 > WIFI_ASSET_CHUNK);
+  CHECK(sizeof(LongHeader) - 1 < 2 * WIFI_ASSET_CHUNK);
+  CHECK_EQ(WIFI_AssetUpload(Gzip, 2, Done), PASS);
+  Run(200);
+  CHECK_EQ(DoneCount, 1);
+  CHECK_EQ(DoneStatus, WIFI_AT_OK);
+  CHECK_EQ(ModuleErrors, 0);
+  CheckFile(&Gzip[0]);
+  CheckFile(&Gzip[1]);
+
+  // The header ends partway through the first chunk, the data fills it
+  pFile = Find("/short.html");
+  CHECK_EQ(pFile->Size, sizeof(ShortHeader) - 1 + sizeof(Packed));
+  CHECK_EQ(pFile->Appends, 2);
+  CHECK_EQ(pFile->Append[0], WIFI_ASSET_CHUNK);
+  CHECK_EQ(pFile->Append[1], sizeof(ShortHeader) - 1 + sizeof(Packed) - WIFI_ASSET_CHUNK);
+  CHECK_EQ(pFile->Data[sizeof(ShortHeader) - 2], '\n');
+  CHECK_EQ(pFile->Data[sizeof(ShortHeader) - 1], Packed[0]);
+  CHECK_EQ(pFile->Data[WIFI_ASSET_CHUNK], Packed[WIFI_ASSET_CHUNK - (sizeof(ShortHeader) - 1)]);
+
+  // The header ends partway through the second chunk
+  pFile = Find("/long.html");
+  CHECK_EQ(pFile->Size, sizeof(LongHeader) - 1 + sizeof(Packed));
+  CHECK_EQ(pFile->Appends, 3);
+  CHECK_EQ(pFile->Append[2], sizeof(LongHeader) - 1 + sizeof(Packed) - 2 * WIFI_ASSET_CHUNK);
+  CHECK_EQ(pFile->Data[WIFI_ASSET_CHUNK], LongHeader[WIFI_ASSET_CHUNK]);
+  CHECK_EQ(pFile->Data[sizeof(LongHeader) - 1], Packed[0]);
+}
+
+/**
+  * @brief  An ERROR: on a middle chunk stops the upload: the callback gets
+  *         it once, nothing else is sent and the AT queue is empty. The
+  *         next upload creates the files again from the start.
+  */
+static void TestError(void)
+{
+  Setup();
+  FailAppend = 2;			// /multi.bin, second of its three chunks
+  CHECK_EQ(WIFI_AssetUpload(Files, 4, Done), PASS);
+  Run(200);
+  CHECK_EQ(DoneCount, 1);
+  CHECK_EQ(DoneStatus, WIFI_AT_ERROR);
+  CHECK_EQ(WIFI_AtBusy(), 0);
+  CHECK_EQ(ModuleAppends, 2);
+  CHECK_EQ(ModuleFileCount, 1);
+  CHECK_EQ(Find("/multi.bin")->Length, 2 * WIFI_ASSET_CHUNK);
+  CHECK(Find("/exact.bin") == 0);
+
+  FailAppend = 0;
+  CHECK_EQ(WIFI_AssetUpload(Files, 4, Done), PASS);
+  Run(200);
+  CHECK_EQ(DoneCount, 2);
+  CHECK_EQ(DoneStatus, WIFI_AT_OK);
+  CheckFile(&Files[0]);
+  CheckFile(&Files[3]);
+  CHECK_EQ(ModuleErrors, 0);
+}
+
+/**
+  * @brief  WIFI_AtAbort at any time of an upload drops it without calling
+  *         its callback and leaves the module ready for the next commands:
+  *         never an at+s.fsa without its chunk. The next upload writes
+  *         every file whole.
+  */
+static void TestAbort(void)
+{
+  uint32_t Stop;
+  uint32_t Bad = 0;
+  uint8_t  Index;
+
+  for (Stop = 0; Stop < 60; Stop++)
+  {
+    Setup();
+    CHECK_EQ(WIFI_AssetUpload(Files, 4, Done), PASS);
+    Run(Stop);
+    WIFI_AtAbort();
+    Run(50);
+    if ((DoneCount != 0) || WIFI_AtBusy() || (ModuleData != 0))
+      Bad++;
+
+    CHECK_EQ(WIFI_AssetUpload(Files, 4, Done), PASS);
+    Run(200);
+    if ((DoneCount != 1) || (DoneStatus != WIFI_AT_OK) || (ModuleErrors != 0) || (ModuleOther != 0))
+      Bad++;
+    for (Index = 0; Index < 4; Index++)
+    {
+      if ((Find(Files[Index].pName) == 0) || (Find(Files[Index].pName)->Length != Files[Index].Length)
+          || (memcmp(Find(Files[Index].pName)->Data, Files[Index].pData, Files[Index].Length) != 0))
+        Bad++;
+    }
+  }
+  CHECK_EQ(Bad, 0);
+  CheckFile(&Files[0]);
+  CheckFile(&Files[1]);
+}
+
+int main(void)
+{
+  uint16_t Index;
+
+  for (Index = 0; Index < sizeof(Multi); Index++)
+    Multi[Index] = (uint8_t)(Index * 7 + 1);
+  for (Index = 0; Index < sizeof(Exact); Index++)
+    Exact[Index] = (uint8_t)(Index * 13 + 5);
+  for (Index = 0; Index < sizeof(Packed); Index++)
+    Packed[Index] = (Index % 5 == 0) ? 0 : (uint8_t)(0x1F + Index);		// 0s and \n\r as in gzip
+
+  TestChunks();
+  TestGzip();
+  TestError();
+  TestAbort();
+  return TEST_END();
+}
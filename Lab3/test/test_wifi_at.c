@@ -0,0 +1,433 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_at.c
+  * @brief   wifi_at.c against a scripted module: the commands the engine
+  *          sends are read back from the fake USART2, every one gets the
+  *          answer its rule gives (OK, ERROR: or nothing), in order, on the
+  *          fake RX DMA. The windows, the retries, the timeouts, the full
+  *          queues and the sequences queued all or none.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+#include "wifi_strings.h"
+#include "wifi_at.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// How the module answers a command
+typedef struct
+{
+  const char *pCmd;
+  uint8_t     After;		// The first After times it answers OK,
+  uint8_t     Errors;		// then the next Errors times ERROR:
+  uint8_t     Silent;		// then the next Silent times nothing
+  uint8_t     Received;	// Times the command has been received
+} Rule_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define TEST_ID(Id, String)		Id,
+
+enum
+{
+  WIFI_RX_STRINGS(TEST_ID)
+  RX_COUNT
+};
+
+#define TIMEOUT		100		// ms of the test answers
+#define RETRIES		2
+
+/* Private variables ---------------------------------------------------------*/
+static const WIFI_AtReply_TypeDef ReplyOK =
+  { WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), TIMEOUT, 0, RETRIES, 0 };
+static const WIFI_AtReply_TypeDef ReplyPipe =
+  { WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), TIMEOUT, 0, RETRIES, WIFI_AT_PIPELINE };
+static const WIFI_AtReply_TypeDef ReplyDelay =
+  { WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), TIMEOUT, 50, RETRIES, 0 };
+
+static Rule_TypeDef Rules[8];
+static uint8_t  RuleCount = 0;
+static uint32_t ModuleRead = 0;		// FakeTxLog bytes the module has read
+static char     ModuleCmd[64];
+static uint8_t  ModuleLength = 0;
+static char     Sent[256];				// Commands received by the module, "a b c "
+
+static char     Log[64];					// Callbacks called, "A0B2": name and status
+static uint8_t  LogLength = 0;
+static uint32_t Now = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Record(char Name, uint8_t Status)
+{
+  if (LogLength < sizeof(Log) - 2)
+  {
+    Log[LogLength++] = Name;
+    Log[LogLength++] = (char)('0' + Status);
+    Log[LogLength] = 0;
+  }
+}
+
+static void CbA(uint8_t Status) { Record('A', Status); }
+static void CbB(uint8_t Status) { Record('B', Status); }
+static void CbC(uint8_t Status) { Record('C', Status); }
+static void CbD(uint8_t Status) { Record('D', Status); }
+
+static void Rule(const char *pCmd, uint8_t After, uint8_t Errors, uint8_t Silent)
+{
+  Rules[RuleCount].pCmd = pCmd;
+  Rules[RuleCount].After = After;
+  Rules[RuleCount].Errors = Errors;
+  Rules[RuleCount].Silent = Silent;
+  Rules[RuleCount].Received = 0;
+  RuleCount++;
+}
+
+static uint8_t Received(const char *pCmd)
+{
+  uint8_t Index;
+
+  for (Index = 0; Index < RuleCount; Index++)
+  {
+    if (strcmp(Rules[Index].pCmd, pCmd) == 0)
+      return Rules[Index].Received;
+  }
+  return 0;
+}
+
+/**
+  * @brief  The module: reads what the engine has sent up to now, answers
+  *         every command (ended by its 0) as its rule says. A command
+  *         without a rule is answered OK.
+  */
+static void Module(void)
+{
+  const char *pAnswer;
+  uint8_t Byte, Index;
+  int     Received;
+
+  while (ModuleRead != FakeTxCount)
+  {
+    Byte = FakeTxLog[ModuleRead++ & (FAKE_TX_LOG_SIZE - 1)];
+    if (Byte != 0)
+    {
+      if (ModuleLength < sizeof(ModuleCmd) - 1)
+        ModuleCmd[ModuleLength++] = (char)Byte;
+      continue;
+    }
+    ModuleCmd[ModuleLength] = 0;
+    ModuleLength = 0;
+    strcat(Sent, ModuleCmd);
+    strcat(Sent, " ");
+
+    pAnswer = "\r\n OK\r\n";
+    for (Index = 0; Index < RuleCount; Index++)
+    {
+      if (strcmp(Rules[Index].pCmd, ModuleCmd) != 0)
+        continue;
+      Received = ++Rules[Index].Received - Rules[Index].After;
+      if ((Received > 0) && (Received <= Rules[Index].Errors))
+        pAnswer = "\r\n ERROR: Invalid input\r\n";
+      else if ((Received > 0) && (Received <= Rules[Index].Errors + Rules[Index].Silent))
+        pAnswer = 0;
+      break;
+    }
+    if (pAnswer != 0)
+      FAKE_RxFeed(pAnswer, (uint16_t)strlen(pAnswer));
+  }
+}
+
+/**
+  * @brief  Main loop for Ms ms: the engine, then the module answers.
+  */
+static void Run(uint32_t Ms)
+{
+  uint32_t End = Now + Ms;
+
+  while (Now != End)
+  {
+    WIFI_AtProcess(Now);
+    Module();
+    Now++;
+  }
+  WIFI_AtProcess(Now);
+}
+
+static void Setup(void)
+{
+  FAKE_Reset();
+  FakeTxAuto = 1;
+  WIFI_TxInit();
+  WIFI_RxInit();
+  WIFI_MatchReset();
+  WIFI_MatchSetHandler(WIFI_AtMatchHandler);
+  WIFI_AtInit();
+  RuleCount = 0;
+  ModuleRead = 0;
+  ModuleLength = 0;
+  Sent[0] = 0;
+  Log[0] = 0;
+  LogLength = 0;
+}
+
+// Queues the command string s (with its final 0)
+#define SUBMIT(s, reply, cb)		WIFI_AtSubmit((const uint8_t *)(s), sizeof(s), (reply), (cb))
+
+/**
+  * @brief  One command after the other, every one waits for its OK.
+  */
+static void TestSequence(void)
+{
+  Setup();
+  CHECK_EQ(SUBMIT("at+a", &ReplyOK, CbA), PASS);
+  CHECK_EQ(SUBMIT("at+b", &ReplyOK, CbB), PASS);
+  CHECK_EQ(WIFI_AtBusy(), 1);
+  WIFI_AtProcess(Now);
+  CHECK_EQ(FakeTxCount, 5);			// at+b waits for the OK of at+a
+  Run(10);
+  CHECK(strcmp(Sent, "at+a at+b ") == 0);
+  CHECK(strcmp(Log, "A0B0") == 0);
+  CHECK_EQ(WIFI_AtBusy(), 0);
+}
+
+/**
+  * @brief  Pipelined commands go out back to back, the OKs are matched in
+  *         order; the window ends at the first command not pipelined.
+  */
+static void TestPipeline(void)
+{
+  Setup();
+  SUBMIT("at+a", &ReplyPipe, CbA);
+  SUBMIT("at+b", &ReplyPipe, CbB);
+  SUBMIT("at+c", &ReplyPipe, CbC);
+  SUBMIT("at+d", &ReplyOK, CbD);
+  WIFI_AtProcess(Now);
+  CHECK_EQ(FakeTxCount, 15);		// a, b and c before any answer
+  Run(10);
+  CHECK(strcmp(Sent, "at+a at+b at+c at+d ") == 0);
+  CHECK(strcmp(Log, "A0B0C0D0") == 0);
+}
+
+/**
+  * @brief  An ERROR: sends the window again from the command that failed,
+  *         the ones before it are done.
+  */
+static void TestRetry(void)
+{
+  Setup();
+  Rule("at+b", 0, 1, 0);
+  SUBMIT("at+a", &ReplyPipe, CbA);
+  SUBMIT("at+b", &ReplyPipe, CbB);
+  SUBMIT("at+c", &ReplyPipe, CbC);
+  Run(10);
+  CHECK(strcmp(Sent, "at+a at+b at+c at+b at+c ") == 0);
+  CHECK(strcmp(Log, "A0B0C0") == 0);
+  CHECK_EQ(Received("at+b"), 2);
+}
+
+/**
+  * @brief  The commands sent again with the one that failed are not charged
+  *         with its failures: at+b fails once, after at+a used its retries.
+  */
+static void TestCharge(void)
+{
+  Setup();
+  Rule("at+a", 0, RETRIES, 0);
+  Rule("at+b", RETRIES, 1, 0);
+  SUBMIT("at+a", &ReplyPipe, CbA);
+  SUBMIT("at+b", &ReplyPipe, CbB);
+  Run(10);
+  CHECK(strcmp(Log, "A0B0") == 0);
+  CHECK_EQ(Received("at+a"), RETRIES + 1);
+  CHECK_EQ(Received("at+b"), RETRIES + 2);
+}
+
+/**
+  * @brief  Every command of a window waits for its answer with its own
+  *         Timeout, from the answer before it.
+  */
+static void TestOwnTimeout(void)
+{
+  static const WIFI_AtReply_TypeDef ReplyLong =
+    { WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), 3 * TIMEOUT, 0, RETRIES, WIFI_AT_PIPELINE };
+  static const WIFI_AtReply_TypeDef ReplyShort =
+    { WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), TIMEOUT / 2, 0, RETRIES, WIFI_AT_PIPELINE };
+
+  // at+b times out after its TIMEOUT / 2, not after the 3 * TIMEOUT of at+a
+  Setup();
+  Rule("at+b", 0, 0, 1);
+  SUBMIT("at+a", &ReplyLong, CbA);
+  SUBMIT("at+b", &ReplyShort, CbB);
+  Run(TIMEOUT / 2 + 5);
+  CHECK_EQ(Received("at+b"), 2);
+  CHECK(strcmp(Log, "A0B0") == 0);
+
+  // at+b waits its 3 * TIMEOUT, not the TIMEOUT / 2 of at+a
+  Setup();
+  Rule("at+b", 0, 0, 1);
+  SUBMIT("at+a", &ReplyShort, CbA);
+  SUBMIT("at+b", &ReplyLong, CbB);
+  Run(TIMEOUT);
+  CHECK_EQ(Received("at+b"), 1);
+  CHECK_EQ(LogLength, 0);
+  Run(3 * TIMEOUT);
+  CHECK_EQ(Received("at+b"), 2);
+  CHECK(strcmp(Log, "A0B0") == 0);
+}
+
+/**
+  * @brief  No answer: sent again after the timeout, then the failure goes to
+  *         its callback and the rest of the queue is dropped.
+  */
+static void TestTimeout(void)
+{
+  Setup();
+  Rule("at+a", 0, 0, 1);
+  SUBMIT("at+a", &ReplyOK, CbA);
+  Run(TIMEOUT - 1);
+  CHECK_EQ(Received("at+a"), 1);
+  Run(10);
+  CHECK_EQ(Received("at+a"), 2);
+  CHECK(strcmp(Log, "A0") == 0);
+
+  Setup();
+  Rule("at+a", 0, 0, 10);
+  SUBMIT("at+a", &ReplyOK, CbA);
+  SUBMIT("at+b", &ReplyOK, CbB);
+  Run((RETRIES + 1) * TIMEOUT + 10);
+  CHECK_EQ(Received("at+a"), RETRIES + 1);
+  CHECK(strcmp(Log, "A2") == 0);
+  CHECK(strcmp(Sent, "at+a at+a at+a ") == 0);
+  CHECK_EQ(WIFI_AtBusy(), 0);
+
+  // ERROR: every time
+  Setup();
+  Rule("at+a", 0, 10, 0);
+  SUBMIT("at+a", &ReplyOK, CbA);
+  Run(10);
+  CHECK(strcmp(Log, "A1") == 0);
+  CHECK_EQ(Received("at+a"), RETRIES + 1);
+}
+
+/**
+  * @brief  An OK received before the command was sent does not complete it.
+  */
+static void TestOldAnswer(void)
+{
+  Setup();
+  Rule("at+a", 0, 0, 1);
+  FAKE_RxFeed("\r\n OK\r\n", 7);
+  SUBMIT("at+a", &ReplyOK, CbA);
+  Run(TIMEOUT / 2);
+  CHECK_EQ(LogLength, 0);
+  Run(TIMEOUT);
+  CHECK(strcmp(Log, "A0") == 0);
+  CHECK_EQ(Received("at+a"), 2);
+}
+
+/**
+  * @brief  The Delay after the answer is waited before the next command.
+  */
+static void TestDelay(void)
+{
+  Setup();
+  SUBMIT("at+a", &ReplyDelay, CbA);
+  SUBMIT("at+b", &ReplyOK, CbB);
+  Run(40);
+  CHECK(strcmp(Sent, "at+a ") == 0);
+  CHECK_EQ(LogLength, 0);
+  Run(20);
+  CHECK(strcmp(Sent, "at+a at+b ") == 0);
+  CHECK(strcmp(Log, "A0B0") == 0);
+}
+
+/**
+  * @brief  The TX queue full: the command is sent by a later WIFI_AtProcess.
+  */
+static void TestTxFull(void)
+{
+  static const uint8_t Byte = 'x';
+  uint8_t Index;
+
+  Setup();
+  FakeTxAuto = 0;
+  for (Index = 0; WIFI_TxFree() != 0; Index++)
+    WIFI_TxSubmit(&Byte, 1, 0);
+  SUBMIT("at+a", &ReplyOK, CbA);
+  WIFI_AtProcess(Now);
+  CHECK_EQ(WIFI_AtBusy(), 1);
+  FAKE_TxDrain();
+  FakeTxAuto = 1;
+  ModuleRead = FakeTxCount;
+  Run(10);
+  CHECK(strcmp(Sent, "at+a ") == 0);
+  CHECK(strcmp(Log, "A0") == 0);
+}
+
+/**
+  * @brief  WIFI_AT_QUEUE_SIZE - 1 commands fit; a sequence that does not
+  *         fit is removed whole and none of its callbacks is called.
+  */
+static void TestQueueFull(void)
+{
+  uint8_t Index;
+
+  Setup();
+  for (Index = 0; Index < WIFI_AT_QUEUE_SIZE - 1; Index++)
+    CHECK_EQ(SUBMIT("at", &ReplyPipe, 0), PASS);
+  CHECK_EQ(SUBMIT("at", &ReplyPipe, 0), FAIL);
+
+  Setup();
+  for (Index = 0; Index < WIFI_AT_QUEUE_SIZE - 3; Index++)
+    SUBMIT("at", &ReplyOK, 0);
+  WIFI_AtBegin();
+  CHECK_EQ(SUBMIT("at+a", &ReplyOK, CbA), PASS);
+  CHECK_EQ(SUBMIT("at+b", &ReplyOK, CbB), PASS);
+  CHECK_EQ(SUBMIT("at+c", &ReplyOK, CbC), FAIL);
+  CHECK_EQ(WIFI_AtEnd(), FAIL);
+  CHECK_EQ(SUBMIT("at+d", &ReplyOK, CbD), PASS);	// the room of a and b is back
+  Run(100);
+  CHECK_EQ(Received("at+a"), 0);
+  CHECK(strcmp(Log, "D0") == 0);
+
+  // A sequence that fits
+  Setup();
+  WIFI_AtBegin();
+  SUBMIT("at+a", &ReplyOK, CbA);
+  SUBMIT("at+b", &ReplyOK, CbB);
+  CHECK_EQ(WIFI_AtEnd(), PASS);
+  Run(10);
+  CHECK(strcmp(Log, "A0B0") == 0);
+
+  // Aborted inside: nothing to remove
+  Setup();
+  SUBMIT("at", &ReplyOK, 0);
+  WIFI_AtBegin();
+  SUBMIT("at+a", &ReplyOK, CbA);
+  WIFI_AtAbort();
+  CHECK_EQ(WIFI_AtEnd(), PASS);
+  CHECK_EQ(WIFI_AtBusy(), 0);
+  CHECK_EQ(SUBMIT("at+b", &ReplyOK, CbB), PASS);
+  Run(10);
+  CHECK(strcmp(Log, "B0") == 0);
+}
+
+int main(void)
+{
+  TestSequence();
+  TestPipeline();
+  TestRetry();
+  TestCharge();
+  TestOwnTimeout();
+  TestTimeout();
+  TestOldAnswer();
+  TestDelay();
+  TestTxFull();
+  TestQueueFull();
+  return TEST_END();
+}
@@ -0,0 +1,215 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_cmd.c
+  * @brief   wifi_cmd.c with a registry of every string of wifi_strings.h:
+  *          the Id found is the entry called, OnScan at once, Execute one
+  *          per dispatch in the order of the Ids, the commands posted from
+  *          frames and the lookup of a whole payload.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+#include "wifi_strings.h"
+#include "wifi_cmd.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define TEST_ID(Id, String)			Id,
+
+enum
+{
+  WIFI_RX_STRINGS(TEST_ID)
+  RX_COUNT
+};
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  Executed[64];			// Ids executed, in order
+static uint8_t  ExecCount = 0;
+static uint8_t  Scanned[64];			// Ids scanned, in order
+static uint32_t ScannedPos[64];
+static uint8_t  ScanCount = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+// Every entry has its own handlers, they record their Id. Execute drops its own string
+// only, so the next dispatch finds the others
+static void Execute(uint8_t Id)
+{
+  Executed[ExecCount++ & 63] = Id;
+  WIFI_MatchDiscard(WIFI_MATCH_BIT(Id));
+}
+
+static void Scan(uint8_t Id, uint32_t Pos)
+{
+  Scanned[ScanCount & 63] = Id;
+  ScannedPos[ScanCount++ & 63] = Pos;
+}
+
+#define TEST_HANDLERS(Id, String)																		\
+  static void Exec_##Id(void) { Execute(Id); }												\
+  static void Scan_##Id(uint32_t Pos) { Scan(Id, Pos); }
+WIFI_RX_STRINGS(TEST_HANDLERS)
+
+#define TEST_ENTRY(Id, String)		WIFI_CMD_WEB(String, Scan_##Id, Exec_##Id),
+
+static const WIFI_Cmd_TypeDef Commands[RX_COUNT] = { WIFI_RX_STRINGS(TEST_ENTRY) };
+
+// The same strings, some without handlers
+#define TEST_SPARSE(Id, String)																			\
+  WIFI_CMD(String, ((Id) & 1) ? Scan_##Id : 0, ((Id) & 1) ? 0 : Exec_##Id),
+
+static const WIFI_Cmd_TypeDef Sparse[RX_COUNT] = { WIFI_RX_STRINGS(TEST_SPARSE) };
+
+static void Handler(uint8_t Id, uint32_t Pos)
+{
+  WIFI_CmdScan(Id, Pos);
+}
+
+static void Setup(const WIFI_Cmd_TypeDef *pCmds)
+{
+  FAKE_Reset();
+  WIFI_RxInit();
+  WIFI_MatchReset();
+  WIFI_MatchSetHandler(Handler);
+  CHECK_EQ(WIFI_CmdInit(pCmds, RX_COUNT), PASS);
+  ExecCount = 0;
+  ScanCount = 0;
+}
+
+static void Feed(const char *pText)
+{
+  FAKE_RxFeed(pText, (uint16_t)strlen(pText));
+}
+
+/**
+  * @brief  The registry must be the table of the strings of the automaton.
+  */
+static void TestInit(void)
+{
+  CHECK_EQ(WIFI_CmdInit(Commands, RX_COUNT), PASS);
+  CHECK_EQ(WIFI_CmdInit(Commands, RX_COUNT - 1), FAIL);
+}
+
+/**
+  * @brief  One Execute per dispatch, lowest Id first, whatever the order of
+  *         arrival; then nothing is left and the RxBuffer is consumed.
+  */
+static void TestDispatch(void)
+{
+  Setup(Commands);
+  Feed("post_ip scan reset\r\n");
+  CHECK_EQ(WIFI_CmdDispatch(), RX_RESET);
+  CHECK_EQ(WIFI_CmdDispatch(), RX_SCAN);
+  CHECK_EQ(WIFI_CmdDispatch(), RX_POST_IP);
+  CHECK_EQ(ExecCount, 3);
+  CHECK_EQ(Executed[0], RX_RESET);
+  CHECK_EQ(WIFI_CmdDispatch(), WIFI_CMD_NONE);
+  CHECK_EQ(WIFI_RxAvailable(), 0);
+  CHECK_EQ(ExecCount, 3);
+
+  // Every string goes to its own entry
+  Setup(Commands);
+  Feed(TxBuffer_FAIL3 " " GET_IP " " RxLBOFF " " WiFi_IP "\r\n");
+  WIFI_MatchPoll();
+  CHECK_EQ(ScanCount, 5);
+  CHECK_EQ(Scanned[0], RX_CLRBUF);		// the X of RX_UNK
+  CHECK_EQ(Scanned[1], RX_FAIL3);
+  CHECK_EQ(Scanned[2], RX_GET_IP);
+  CHECK_EQ(Scanned[3], RX_LBOFF);
+  CHECK_EQ(Scanned[4], RX_WIFI_UP);
+}
+
+/**
+  * @brief  An entry without Execute is never dispatched, one without OnScan
+  *         is not scanned.
+  */
+static void TestSparse(void)
+{
+  Setup(Sparse);
+  Feed("lgon lgoff scan\r\n");
+  WIFI_MatchPoll();
+  CHECK_EQ(ScanCount, (RX_LGON & 1) + (RX_LGOFF & 1) + (RX_SCAN & 1));
+  CHECK_EQ(WIFI_CmdScan(WIFI_MATCH_EOL, 0), 0);
+  while (WIFI_CmdDispatch() != WIFI_CMD_NONE)
+    ;
+  CHECK_EQ(ExecCount, !(RX_LGON & 1) + !(RX_LGOFF & 1) + !(RX_SCAN & 1));
+}
+
+/**
+  * @brief  OnScan gets the stream position of the last byte of the string.
+  */
+static void TestScan(void)
+{
+  Setup(Commands);
+  Feed("xx");
+  WIFI_MatchPoll();
+  WIFI_MatchConsume();
+  Feed("lgon\r\n");
+  WIFI_MatchPoll();
+  CHECK_EQ(ScanCount, 1);
+  CHECK_EQ(Scanned[0], RX_LGON);
+  CHECK_EQ(ScannedPos[0], 5);
+  CHECK_EQ(WIFI_CmdScan(RX_COUNT, 0), 0);
+}
+
+/**
+  * @brief  A payload is a command only if it is the whole string.
+  */
+static void TestLookup(void)
+{
+  Setup(Commands);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"get_ip", 6), RX_GET_IP);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"get_i", 5), WIFI_CMD_NONE);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"xget_ip", 7), WIFI_CMD_NONE);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"lgoff", 5), RX_LGOFF);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"OK", 2), RX_OK);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"", 0), WIFI_CMD_NONE);
+}
+
+/**
+  * @brief  A posted command is scanned at once and executed by the next
+  *         dispatch, before the ones of higher Id found in the RxBuffer.
+  *         Only the entries flagged WIFI_CMD_REMOTE can be posted.
+  */
+static void TestPost(void)
+{
+  Setup(Commands);
+  CHECK_EQ(WIFI_CmdPost(RX_SCAN), PASS);
+  CHECK_EQ(ScanCount, 1);
+  CHECK_EQ(Scanned[0], RX_SCAN);
+  CHECK_EQ(ScannedPos[0], 0);
+  CHECK_EQ(WIFI_CmdPending(), 1);
+  Feed("post_ip\r\n");
+  CHECK_EQ(WIFI_CmdDispatch(), RX_SCAN);
+  CHECK_EQ(WIFI_CmdPending(), 0);
+  CHECK_EQ(WIFI_CmdDispatch(), RX_POST_IP);
+  CHECK_EQ(WIFI_CmdDispatch(), WIFI_CMD_NONE);
+
+  CHECK_EQ(WIFI_CmdPost(RX_COUNT), FAIL);
+  CHECK_EQ(WIFI_CmdPending(), 0);
+
+  // Entries without WIFI_CMD_REMOTE, e.g. the messages of the module, cannot be posted
+  Setup(Sparse);
+  CHECK_EQ(WIFI_CmdPost(RX_FAIL1), FAIL);
+  CHECK_EQ(WIFI_CmdPost(RX_WIFI_UP), FAIL);
+  CHECK_EQ(WIFI_CmdPost(RX_SCAN), FAIL);
+  CHECK_EQ(ScanCount, 0);
+  CHECK_EQ(WIFI_CmdPending(), 0);
+  CHECK_EQ(WIFI_CmdDispatch(), WIFI_CMD_NONE);
+}
+
+int main(void)
+{
+  TestInit();
+  TestDispatch();
+  TestSparse();
+  TestScan();
+  TestLookup();
+  TestPost();
+  return TEST_END();
+}
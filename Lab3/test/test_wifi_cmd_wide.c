@@ -0,0 +1,163 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_cmd_wide.c
+  * @brief   wifi_cmd.c with a registry of 40 strings (wide_strings.h), more
+  *          than a uint32_t mask holds: the Ids past 31 are found, executed
+  *          in the order of the Ids across the two words, posted and looked
+  *          up like the others.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+#include "wide_strings.h"
+#include "wifi_cmd.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define TEST_ID(Id, String)			Id,
+
+enum
+{
+  WIFI_RX_STRINGS(TEST_ID)
+  W_COUNT
+};
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  Executed[64];			// Ids executed, in order
+static uint8_t  ExecCount = 0;
+static uint8_t  Scanned[64];			// Ids scanned, in order
+static uint8_t  ScanCount = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Execute(uint8_t Id)
+{
+  Executed[ExecCount++ & 63] = Id;
+  WIFI_MatchDiscard(WIFI_MATCH_BIT(Id));
+}
+
+static void Scan(uint8_t Id)
+{
+  Scanned[ScanCount++ & 63] = Id;
+}
+
+#define TEST_HANDLERS(Id, String)																		\
+  static void Exec_##Id(void) { Execute(Id); }												\
+  static void Scan_##Id(uint32_t Pos) { Scan(Id); }
+WIFI_RX_STRINGS(TEST_HANDLERS)
+
+#define TEST_ENTRY(Id, String)		WIFI_CMD_WEB(String, Scan_##Id, Exec_##Id),
+
+static const WIFI_Cmd_TypeDef Commands[W_COUNT] = { WIFI_RX_STRINGS(TEST_ENTRY) };
+
+static void Handler(uint8_t Id, uint32_t Pos)
+{
+  WIFI_CmdScan(Id, Pos);
+}
+
+static void Setup(void)
+{
+  FAKE_Reset();
+  WIFI_RxInit();
+  WIFI_MatchReset();
+  WIFI_MatchSetHandler(Handler);
+  CHECK_EQ(WIFI_CmdInit(Commands, W_COUNT), PASS);
+  ExecCount = 0;
+  ScanCount = 0;
+}
+
+static void Feed(const char *pText)
+{
+  FAKE_RxFeed(pText, (uint16_t)strlen(pText));
+}
+
+/**
+  * @brief  More than 32 strings are accepted, up to WIFI_MATCH_MAX_STRINGS.
+  */
+static void TestInit(void)
+{
+  CHECK(W_COUNT > 32);
+  CHECK(W_COUNT <= WIFI_MATCH_MAX_STRINGS);
+  CHECK_EQ(WIFI_CmdInit(Commands, W_COUNT), PASS);
+  CHECK_EQ(WIFI_CmdInit(Commands, W_COUNT - 1), FAIL);
+}
+
+/**
+  * @brief  Every string is scanned, the last ones too; one Execute per
+  *         dispatch, lowest Id first across the two words.
+  */
+static void TestDispatch(void)
+{
+  uint8_t Id;
+
+  Setup();
+  Feed("w39 w33 w02 w32 w31\r\n");
+  WIFI_MatchPoll();
+  CHECK_EQ(ScanCount, 5);
+  CHECK_EQ(Scanned[0], W_39);
+  CHECK_EQ(Scanned[1], W_33);
+  CHECK_EQ(WIFI_CmdDispatch(), W_02);
+  CHECK_EQ(WIFI_CmdDispatch(), W_31);
+  CHECK_EQ(WIFI_CmdDispatch(), W_32);
+  CHECK_EQ(WIFI_CmdDispatch(), W_33);
+  CHECK_EQ(WIFI_CmdDispatch(), W_39);
+  CHECK_EQ(WIFI_CmdDispatch(), WIFI_CMD_NONE);
+  CHECK_EQ(WIFI_RxAvailable(), 0);
+
+  // All of them, in reverse order of arrival
+  Setup();
+  for (Id = W_COUNT; Id-- > 0;)
+  {
+    Feed((const char *)Commands[Id].Token.pStr);
+    Feed(" ");
+  }
+  for (Id = 0; Id < W_COUNT; Id++)
+    CHECK_EQ(WIFI_CmdDispatch(), Id);
+  CHECK_EQ(WIFI_CmdDispatch(), WIFI_CMD_NONE);
+  CHECK_EQ(ExecCount, W_COUNT);
+}
+
+/**
+  * @brief  Posted commands past 31 are kept until dispatched, and the lowest
+  *         one goes first.
+  */
+static void TestPost(void)
+{
+  Setup();
+  CHECK_EQ(WIFI_CmdPost(W_39), PASS);
+  CHECK_EQ(WIFI_CmdPost(W_35), PASS);
+  CHECK_EQ(ScanCount, 2);
+  CHECK_EQ(WIFI_CmdPending(), 1);
+  Feed("w36\r\n");
+  CHECK_EQ(WIFI_CmdDispatch(), W_35);
+  CHECK_EQ(WIFI_CmdDispatch(), W_36);
+  CHECK_EQ(WIFI_CmdPending(), 1);
+  CHECK_EQ(WIFI_CmdDispatch(), W_39);
+  CHECK_EQ(WIFI_CmdPending(), 0);
+  CHECK_EQ(WIFI_CmdDispatch(), WIFI_CMD_NONE);
+}
+
+/**
+  * @brief  The lookup of a payload finds the strings past 31.
+  */
+static void TestLookup(void)
+{
+  Setup();
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"w37", 3), W_37);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"w00", 3), W_00);
+  CHECK_EQ(WIFI_CmdLookup((const uint8_t *)"w40", 3), WIFI_CMD_NONE);
+}
+
+int main(void)
+{
+  TestInit();
+  TestDispatch();
+  TestPost();
+  TestLookup();
+  return TEST_END();
+}
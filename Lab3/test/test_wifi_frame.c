@@ -0,0 +1,639 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_frame.c
+  * @brief   wifi_frame.c against a peer on the other end of the socket: the
+  *          peer reads the socket writes from the fake USART2, decodes the
+  *          frames with its own COBS and CRC-32 and answers OK, its frames
+  *          arrive on the fake RX DMA, whole or byte by byte. The CRC unit
+  *          and the encoder against references, the frames delivered once
+  *          and in order, a corrupt frame, the window and its timeout, and
+  *          the cost of a frame in both directions.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <stdlib.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+#include "wifi_strings.h"
+#include "wifi_at.h"
+#include "wifi_frame.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private typedef -----------------------------------------------------------*/
+// Frame decoded by the peer
+typedef struct
+{
+  uint8_t  Type;
+  uint8_t  Seq;
+  uint8_t  Ack;
+  uint16_t Length;
+  uint8_t  Payload[WIFI_FRAME_MAX_PAYLOAD];
+} Peer_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define TEST_ID(Id, String)		Id,
+
+enum
+{
+  WIFI_RX_STRINGS(TEST_ID)
+  RX_COUNT
+};
+
+#define PEER_LOG_SIZE		64		// Frames the peer remembers
+#define BENCH_FRAMES		20000
+
+/* Private variables ---------------------------------------------------------*/
+static const WIFI_AtReply_TypeDef ReplySocket =
+  { WIFI_MATCH_BIT(RX_OK), WIFI_MATCH_BIT(RX_FAIL5), 100, 0, 0, 0 };
+
+static Peer_TypeDef PeerLog[PEER_LOG_SIZE];		// Frames received by the peer
+static uint32_t PeerCount = 0;
+static uint32_t PeerErrors = 0;		// Socket writes that are not a valid frame
+static uint8_t  PeerAutoAck = 0;		// 1 == the peer acks every data frame at once
+static uint32_t ModuleRead = 0;			// FakeTxLog bytes the module has read
+static char     ModuleLine[32];
+static uint8_t  ModuleLength = 0;
+static uint16_t ModuleData = 0;			// Bytes of the socket write still to read
+static uint8_t  ModuleFrame[WIFI_FRAME_ENCODED_MAX];
+static uint16_t ModuleFrameLength = 0;
+
+static uint8_t  Delivered[PEER_LOG_SIZE][WIFI_FRAME_MAX_PAYLOAD];	// Payloads given to the handler
+static uint16_t DeliveredLength[PEER_LOG_SIZE];
+static uint32_t DeliveredCount = 0;
+static uint32_t Text[RX_COUNT];			// Strings read as text
+static uint32_t Hidden = 0;					// Strings inside frames
+static uint32_t Now = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  CRC-32 of zlib, bit by bit.
+  */
+static uint32_t RefCrc(const uint8_t *pData, uint16_t Length)
+{
+  uint32_t Crc = 0xFFFFFFFF;
+  uint8_t  Bit;
+
+  while (Length--)
+  {
+    Crc ^= *pData++;
+    for (Bit = 0; Bit < 8; Bit++)
+      Crc = (Crc >> 1) ^ (0xEDB88320 & (0 - (Crc & 1)));
+  }
+  return Crc ^ 0xFFFFFFFF;
+}
+
+/**
+  * @brief  COBS as in the paper: blocks of at most 254 bytes, no delimiters.
+  */
+static uint16_t RefEncode(uint8_t *pDst, const uint8_t *pRaw, uint16_t Length)
+{
+  uint16_t Size = 1, Code = 0;
+  uint16_t Index;
+
+  for (Index = 0; Index < Length; Index++)
+  {
+    if (pRaw[Index] == 0)
+    {
+      pDst[Code] = (uint8_t)(Size - Code);
+      Code = Size++;
+      continue;
+    }
+    pDst[Size++] = pRaw[Index];
+    if (Size - Code == 0xFF)
+    {
+      pDst[Code] = 0xFF;
+      Code = Size++;
+    }
+  }
+  pDst[Code] = (uint8_t)(Size - Code);
+  return Size;
+}
+
+/**
+  * @brief  Decodes a COBS block without delimiters.
+  * @retval Length, -1 if the block is not valid
+  */
+static int RefDecode(uint8_t *pDst, const uint8_t *pSrc, uint16_t Length)
+{
+  uint16_t Index = 0, Size = 0;
+  uint8_t  Code, Count;
+
+  while (Index < Length)
+  {
+    Code = pSrc[Index++];
+    if ((Code == 0) || (Index + Code - 1 > Length))
+      return -1;
+    for (Count = 1; Count < Code; Count++)
+    {
+      if (pSrc[Index] == 0)
+        return -1;
+      pDst[Size++] = pSrc[Index++];
+    }
+    if ((Code != 0xFF) && (Index < Length))
+      pDst[Size++] = 0;
+  }
+  return Size;
+}
+
+/**
+  * @brief  A frame of the peer, between its two 0x00.
+  */
+static uint16_t PeerBuild(uint8_t *pDst, uint8_t Type, uint8_t Seq, uint8_t Ack,
+                          const uint8_t *pPayload, uint16_t Length)
+{
+  uint8_t  Raw[WIFI_FRAME_RAW_MAX];
+  uint16_t Size = 0;
+  uint32_t Crc;
+
+  Raw[Size++] = Type;
+  Raw[Size++] = Seq;
+  Raw[Size++] = Ack;
+  memcpy(&Raw[Size], pPayload, Length);
+  Size += Length;
+  Crc = RefCrc(Raw, Size);
+  Raw[Size++] = (uint8_t)Crc;
+  Raw[Size++] = (uint8_t)(Crc >> 8);
+  Raw[Size++] = (uint8_t)(Crc >> 16);
+  Raw[Size++] = (uint8_t)(Crc >> 24);
+
+  pDst[0] = 0;
+  Size = 1 + RefEncode(&pDst[1], Raw, Size);
+  pDst[Size++] = 0;
+  return Size;
+}
+
+/**
+  * @brief  The peer sends a frame, whole or one byte at a time with a main
+  *         loop in between.
+  */
+static void Step(void);
+
+static void PeerSend(uint8_t Type, uint8_t Seq, uint8_t Ack, const char *pPayload, uint8_t Split)
+{
+  uint8_t  Frame[WIFI_FRAME_ENCODED_MAX + 8];
+  uint16_t Size = PeerBuild(Frame, Type, Seq, Ack, (const uint8_t *)pPayload, (uint16_t)strlen(pPayload));
+  uint16_t Index;
+
+  if (Split == 0)
+  {
+    FAKE_RxFeed(Frame, Size);
+    return;
+  }
+  for (Index = 0; Index < Size; Index++)
+  {
+    FAKE_RxFeed(&Frame[Index], 1);
+    Step();
+  }
+}
+
+/**
+  * @brief  The peer gets a frame written on the socket.
+  */
+static void PeerReceive(const uint8_t *pData, uint16_t Length)
+{
+  uint8_t Raw[WIFI_FRAME_ENCODED_MAX];
+  Peer_TypeDef *pFrame = &PeerLog[PeerCount % PEER_LOG_SIZE];
+  uint8_t Ack[WIFI_FRAME_ENCODED_MAX];
+  int     Size;
+
+  Size = ((Length >= 2) && (pData[0] == 0) && (pData[Length - 1] == 0)) ? RefDecode(Raw, &pData[1], Length - 2) : -1;
+  if ((Size < WIFI_FRAME_HEADER + 4) || (RefCrc(Raw, (uint16_t)(Size - 4)) != ((uint32_t)Raw[Size - 4]
+      | ((uint32_t)Raw[Size - 3] << 8) | ((uint32_t)Raw[Size - 2] << 16) | ((uint32_t)Raw[Size - 1] << 24))))
+  {
+    PeerErrors++;
+    return;
+  }
+  Size -= 4;
+
+  pFrame->Type = Raw[0];
+  pFrame->Seq = Raw[1];
+  pFrame->Ack = Raw[2];
+  pFrame->Length = (uint16_t)(Size - WIFI_FRAME_HEADER);
+  memcpy(pFrame->Payload, &Raw[WIFI_FRAME_HEADER], pFrame->Length);
+  PeerCount++;
+
+  if (PeerAutoAck && (pFrame->Type == WIFI_FRAME_DATA))
+    FAKE_RxFeed(Ack, PeerBuild(Ack, WIFI_FRAME_ACK, 0, (uint8_t)(pFrame->Seq + 1), 0, 0));
+}
+
+// Last frame received by the peer
+static const Peer_TypeDef *PeerLast(void)
+{
+  static const Peer_TypeDef None;
+
+  return (PeerCount == 0) ? &None : &PeerLog[(PeerCount - 1) % PEER_LOG_SIZE];
+}
+
+/**
+  * @brief  The module: reads the commands, every socket write takes the
+  *         bytes it announces and is answered OK.
+  */
+static void Module(void)
+{
+  uint8_t Byte;
+
+  while (ModuleRead != FakeTxCount)
+  {
+    Byte = FakeTxLog[ModuleRead++ & (FAKE_TX_LOG_SIZE - 1)];
+    if (ModuleData != 0)
+    {
+      ModuleFrame[ModuleFrameLength++] = Byte;
+      if (--ModuleData == 0)
+      {
+        PeerReceive(ModuleFrame, ModuleFrameLength);
+        FAKE_RxFeed("\r\n OK\r\n", 7);
+      }
+      continue;
+    }
+    if ((Byte == '\r') && (ModuleLength != 0) && (ModuleLine[ModuleLength - 1] == '\n'))
+    {
+      ModuleLine[ModuleLength] = 0;
+      ModuleLength = 0;
+      ModuleData = (uint16_t)atoi(&ModuleLine[14]);
+      ModuleFrameLength = 0;
+      if ((strncmp(ModuleLine, "at+s.sockw=00,", 14) != 0) || (ModuleData > WIFI_FRAME_ENCODED_MAX))
+      {
+        PeerErrors++;
+        ModuleData = 0;
+      }
+      continue;
+    }
+    if (ModuleLength < sizeof(ModuleLine) - 1)
+      ModuleLine[ModuleLength++] = (char)Byte;
+  }
+}
+
+static uint16_t Prefix(uint8_t *pDst, uint16_t Length)
+{
+  return (uint16_t)sprintf((char *)pDst, "at+s.sockw=00,%u\n\r", Length);
+}
+
+static void Handler(const uint8_t *pData, uint16_t Length)
+{
+  uint32_t Index = DeliveredCount++ % PEER_LOG_SIZE;
+
+  memcpy(Delivered[Index], pData, Length);
+  DeliveredLength[Index] = Length;
+}
+
+// As RxStringHandler of main.c: the strings inside a frame are data
+static void MatchHandler(uint8_t Id, uint32_t Pos)
+{
+  if (Id == RX_FRAME)
+  {
+    WIFI_FrameDelimiter(Pos);
+    return;
+  }
+  if (WIFI_FrameOpen(Pos))
+  {
+    if (Id < RX_COUNT)
+      WIFI_MatchDiscard(WIFI_MATCH_BIT(Id));
+    Hidden++;
+    return;
+  }
+  WIFI_AtMatchHandler(Id, Pos);
+  if (Id < RX_COUNT)
+    Text[Id]++;
+}
+
+/**
+  * @brief  One pass of the main loop, 1 ms: it consumes what it has scanned,
+  *         as WIFI_CmdDispatch does when there is no command.
+  */
+static void Step(void)
+{
+  WIFI_FrameProcess(Now);
+  WIFI_AtProcess(Now);
+  WIFI_MatchPoll();
+  WIFI_MatchConsume();
+  Module();
+  Now++;
+}
+
+static void Run(uint32_t Ms)
+{
+  while (Ms--)
+    Step();
+}
+
+static void Setup(void)
+{
+  FAKE_Reset();
+  FakeTxAuto = 1;
+  WIFI_TxInit();
+  WIFI_RxInit();
+  WIFI_MatchReset();
+  WIFI_MatchSetHandler(MatchHandler);
+  WIFI_AtInit();
+  WIFI_FrameInit(Prefix, &ReplySocket, Handler);
+  PeerCount = 0;
+  PeerErrors = 0;
+  PeerAutoAck = 0;
+  ModuleRead = 0;
+  ModuleLength = 0;
+  ModuleData = 0;
+  DeliveredCount = 0;
+  memset(Text, 0, sizeof(Text));
+  Hidden = 0;
+}
+
+/**
+  * @brief  The CRC unit set up by WIFI_FrameInit is the CRC-32 of zlib.
+  */
+static void TestCrc(void)
+{
+  uint8_t  Block[300];
+  uint16_t Length;
+  unsigned Fails = 0;
+
+  Setup();
+  CHECK_EQ(WIFI_FrameCrc((const uint8_t *)"123456789", 9), 0xCBF43926);
+  CHECK_EQ(WIFI_FrameCrc(0, 0), 0);
+  srand(1);
+  for (Length = 0; Length < sizeof(Block); Length++)
+  {
+    Block[Length] = (uint8_t)rand();
+    if (WIFI_FrameCrc(Block, Length + 1) != RefCrc(Block, Length + 1))
+      Fails++;
+  }
+  CHECK_EQ(Fails, 0);
+}
+
+/**
+  * @brief  The encoder against the reference: no 0x00 between the two
+  *         delimiters, at most Length / 254 + 3 bytes more, the same bytes.
+  */
+static void TestEncode(void)
+{
+  uint8_t  Raw[600], Encoded[620], Ref[620], Decoded[620];
+  uint16_t Length, Size, Index;
+  unsigned Fails = 0;
+  int      Pattern;
+
+  for (Pattern = 0; Pattern < 4; Pattern++)
+  {
+    for (Length = 0; Length <= sizeof(Raw); Length++)
+    {
+      for (Index = 0; Index < Length; Index++)
+      {
+        if (Pattern == 0)
+          Raw[Index] = 0;
+        else if (Pattern == 1)
+          Raw[Index] = (uint8_t)(Index % 255 + 1);		// no 0: blocks of 254
+        else if (Pattern == 2)
+          Raw[Index] = (uint8_t)((rand() % 4 == 0) ? 0 : rand());
+        else
+          Raw[Index] = (uint8_t)((Index % 300 == 299) ? 0 : 0x55);
+      }
+      Size = WIFI_FrameEncode(Encoded, Raw, Length);
+      if ((Size > Length + Length / 254 + 3) || (Encoded[0] != 0) || (Encoded[Size - 1] != 0)
+          || (memchr(&Encoded[1], 0, Size - 2) != 0)
+          || (RefEncode(Ref, Raw, Length) != Size - 2) || (memcmp(Ref, &Encoded[1], Size - 2) != 0)
+          || (RefDecode(Decoded, &Encoded[1], Size - 2) != Length) || (memcmp(Decoded, Raw, Length) != 0))
+        Fails++;
+    }
+  }
+  CHECK_EQ(Fails, 0);
+}
+
+/**
+  * @brief  Data frames are delivered once, in order, even split over many
+  *         polls; every one is acked with the next sequence expected.
+  */
+static void TestReceive(void)
+{
+  Setup();
+  PeerSend(WIFI_FRAME_DATA, 0, 0, "lgon", 0);
+  Run(10);
+  CHECK_EQ(DeliveredCount, 1);
+  CHECK((DeliveredLength[0] == 4) && (memcmp(Delivered[0], "lgon", 4) == 0));
+  CHECK_EQ(Text[RX_LGON], 0);		// data, not a command
+  CHECK(Hidden >= 1);
+  CHECK_EQ(PeerCount, 1);
+  CHECK_EQ(PeerLog[0].Type, WIFI_FRAME_ACK);
+  CHECK_EQ(PeerLog[0].Ack, 1);
+
+  // Split over the polls of the main loop: kept in the RxBuffer until closed
+  PeerSend(WIFI_FRAME_DATA, 1, 0, "second", 1);
+  Run(10);
+  CHECK_EQ(DeliveredCount, 2);
+  CHECK((DeliveredLength[1] == 6) && (memcmp(Delivered[1], "second", 6) == 0));
+  CHECK_EQ(PeerLast()->Ack, 2);
+
+  // Repeated and out of order: not delivered, acked again
+  PeerSend(WIFI_FRAME_DATA, 1, 0, "second", 0);
+  PeerSend(WIFI_FRAME_DATA, 3, 0, "fourth", 0);
+  Run(10);
+  CHECK_EQ(DeliveredCount, 2);
+  CHECK_EQ(PeerLast()->Ack, 2);
+  CHECK_EQ(WIFI_FrameErrors(), 0);
+  CHECK_EQ(WIFI_FrameBusy(), 0);
+  CHECK_EQ(PeerErrors, 0);
+}
+
+/**
+  * @brief  A corrupt frame is dropped and does not hide the text after it;
+  *         the next frame is received.
+  */
+static void TestCorrupt(void)
+{
+  uint8_t  Frame[WIFI_FRAME_ENCODED_MAX];
+  uint16_t Size;
+
+  Setup();
+  Size = PeerBuild(Frame, WIFI_FRAME_DATA, 0, 0, (const uint8_t *)"abcdef", 6);
+  Frame[5] ^= 0x40;
+  FAKE_RxFeed(Frame, Size);
+  FAKE_RxFeed("\r\nlgon\r\n", 8);
+  Run(5);
+  CHECK_EQ(WIFI_FrameErrors(), 1);
+  CHECK_EQ(DeliveredCount, 0);
+  CHECK_EQ(Text[RX_LGON], 1);
+
+  // Cut short: the two 0x00 around it are still a frame and a lost byte
+  Size = PeerBuild(Frame, WIFI_FRAME_DATA, 0, 0, (const uint8_t *)"abcdef", 6);
+  FAKE_RxFeed(Frame, 4);
+  FAKE_RxFeed(&Frame[5], Size - 5);
+  Run(5);
+  CHECK_EQ(WIFI_FrameErrors(), 2);
+  FAKE_RxFeed("lgoff\r\n", 7);
+  PeerSend(WIFI_FRAME_DATA, 0, 0, "abcdef", 0);
+  Run(10);
+  CHECK_EQ(Text[RX_LGOFF], 1);
+  CHECK_EQ(DeliveredCount, 1);
+  CHECK_EQ(WIFI_FrameErrors(), 2);
+}
+
+/**
+  * @brief  At most WIFI_FRAME_WINDOW frames not acked, sent again after
+  *         WIFI_FRAME_TIMEOUT, the window moved by the acks.
+  */
+static void TestWindow(void)
+{
+  static const char Payload[WIFI_FRAME_MAX_PAYLOAD + 1] = "0123456789abcdef0123456789abcdef";
+  uint8_t Seq;
+
+  Setup();
+  for (Seq = 0; Seq < WIFI_FRAME_WINDOW; Seq++)
+    CHECK_EQ(WIFI_FrameSend((const uint8_t *)&Payload[Seq], 1), PASS);
+  CHECK_EQ(WIFI_FrameSend((const uint8_t *)Payload, 1), FAIL);
+  CHECK_EQ(WIFI_FrameSend((const uint8_t *)Payload, WIFI_FRAME_MAX_PAYLOAD + 1), FAIL);
+  Run(20);
+  CHECK_EQ(PeerCount, WIFI_FRAME_WINDOW);
+  for (Seq = 0; Seq < WIFI_FRAME_WINDOW; Seq++)
+  {
+    CHECK_EQ(PeerLog[Seq].Type, WIFI_FRAME_DATA);
+    CHECK_EQ(PeerLog[Seq].Seq, Seq);
+    CHECK((PeerLog[Seq].Length == 1) && (PeerLog[Seq].Payload[0] == (uint8_t)Payload[Seq]));
+  }
+
+  // Nothing acked: all sent again, once
+  Run(WIFI_FRAME_TIMEOUT);
+  CHECK_EQ(PeerCount, 2 * WIFI_FRAME_WINDOW);
+  CHECK_EQ(PeerLog[WIFI_FRAME_WINDOW].Seq, 0);
+
+  // Two acked: two more can go
+  PeerSend(WIFI_FRAME_ACK, 0, 2, "", 0);
+  Run(5);
+  CHECK_EQ(WIFI_FrameSend((const uint8_t *)Payload, WIFI_FRAME_MAX_PAYLOAD), PASS);
+  CHECK_EQ(WIFI_FrameSend((const uint8_t *)Payload, WIFI_FRAME_MAX_PAYLOAD), PASS);
+  CHECK_EQ(WIFI_FrameSend((const uint8_t *)Payload, 1), FAIL);
+  Run(20);
+  CHECK_EQ(PeerLast()->Seq, WIFI_FRAME_WINDOW + 1);
+  CHECK_EQ(PeerLast()->Length, WIFI_FRAME_MAX_PAYLOAD);
+
+  // An ack out of the window is ignored, the right one empties it
+  PeerSend(WIFI_FRAME_ACK, 0, 100, "", 0);
+  Run(5);
+  CHECK_EQ(WIFI_FrameBusy(), 1);
+  PeerSend(WIFI_FRAME_ACK, 0, WIFI_FRAME_WINDOW + 2, "", 0);
+  Run(5);
+  CHECK_EQ(WIFI_FrameBusy(), 0);
+  CHECK_EQ(PeerErrors, 0);
+}
+
+/**
+  * @brief  Free entries of the AT engine queue: a sequence filled until the
+  *         queue refuses, then dropped by WIFI_AtEnd.
+  */
+static uint8_t AtFree(void)
+{
+  static const uint8_t Cmd[] = "at\n\r";
+  uint8_t Free = 0;
+
+  WIFI_AtBegin();
+  while (WIFI_AtSubmit(Cmd, sizeof(Cmd) - 1, &ReplySocket, 0) == PASS)
+    Free++;
+  CHECK_EQ(WIFI_AtEnd(), FAIL);
+  return Free;
+}
+
+/**
+  * @brief  A silent peer while the AT engine is busy: every frame is queued
+  *         again at most once, whatever the number of timeouts, and the
+  *         other users of the engine keep their room.
+  */
+static void TestSilentPeer(void)
+{
+  static const char Payload[] = "0123";
+  static const uint8_t Slow[] = "at+s.slow\n\r";
+  static const WIFI_AtReply_TypeDef ReplySlow =
+    { WIFI_MATCH_BIT(RX_WIFI_UP), 0, 10 * WIFI_FRAME_TIMEOUT, 0, 0, 0 };
+  uint8_t Seq, Free;
+
+  Setup();
+  for (Seq = 0; Seq < WIFI_FRAME_WINDOW; Seq++)
+    CHECK_EQ(WIFI_FrameSend((const uint8_t *)&Payload[Seq], 1), PASS);
+  Run(20);
+  CHECK_EQ(PeerCount, WIFI_FRAME_WINDOW);
+
+  // A command that holds the engine for 10 timeouts, never answered
+  Free = AtFree();
+  CHECK_EQ(WIFI_AtSubmit(Slow, sizeof(Slow) - 1, &ReplySlow, 0), PASS);
+  Run(8 * WIFI_FRAME_TIMEOUT);
+  CHECK_EQ(PeerCount, WIFI_FRAME_WINDOW);
+  CHECK_EQ(AtFree(), Free - 1 - WIFI_FRAME_WINDOW);
+
+  // Its timeout drops the queue behind it, the frames with it: at the next timeout one copy
+  //		of every frame goes out
+  Run(3 * WIFI_FRAME_TIMEOUT);
+  CHECK_EQ(PeerCount, 2 * WIFI_FRAME_WINDOW);
+  for (Seq = 0; Seq < WIFI_FRAME_WINDOW; Seq++)
+    CHECK_EQ(PeerLog[WIFI_FRAME_WINDOW + Seq].Seq, Seq);
+  CHECK_EQ(PeerErrors, 1);		// the slow command is not a socket write
+}
+
+/**
+  * @brief  Cost of a frame on the host, both ways, through the AT engine,
+  *         the matcher and the fake DMA; and the bytes on the line for a
+  *         byte of payload. The time of the line itself is not simulated.
+  */
+static void TestBench(void)
+{
+  static const char Payload[WIFI_FRAME_MAX_PAYLOAD + 1] = "0123456789abcdef0123456789abcdef";
+  static uint8_t Frames[256][WIFI_FRAME_ENCODED_MAX];	// One per sequence number
+  static uint16_t Sizes[256];
+  uint32_t Sent = 0, Index;
+  uint32_t TxStart;
+  uint64_t Cycles;
+  double   Start, Elapsed;
+
+  // MCU -> peer, acked at once
+  Setup();
+  PeerAutoAck = 1;
+  TxStart = FakeTxCount;
+  Start = TEST_Now();
+  Cycles = TEST_Cycles();
+  while (Sent < BENCH_FRAMES)
+  {
+    if (WIFI_FrameSend((const uint8_t *)Payload, WIFI_FRAME_MAX_PAYLOAD) == PASS)
+      Sent++;
+    Step();
+  }
+  Run(20);
+  Cycles = TEST_Cycles() - Cycles;
+  Elapsed = TEST_Now() - Start;
+  CHECK_EQ(PeerCount, BENCH_FRAMES);
+  CHECK_EQ(WIFI_FrameBusy(), 0);
+  CHECK_EQ(PeerErrors, 0);
+  printf("frame send    %6.0f ns/frame %7.0f cycles/frame %5.2f line bytes/payload byte\n",
+         Elapsed * 1e9 / BENCH_FRAMES, (double)Cycles / BENCH_FRAMES,
+         (double)(FakeTxCount - TxStart) / (BENCH_FRAMES * WIFI_FRAME_MAX_PAYLOAD));
+
+  // Peer -> MCU, the MCU acks. The frames of the peer are built before
+  Setup();
+  for (Index = 0; Index < 256; Index++)
+    Sizes[Index] = PeerBuild(Frames[Index], WIFI_FRAME_DATA, (uint8_t)Index, 0,
+                             (const uint8_t *)Payload, WIFI_FRAME_MAX_PAYLOAD);
+  Start = TEST_Now();
+  Cycles = TEST_Cycles();
+  for (Index = 0; Index < BENCH_FRAMES; Index++)
+  {
+    FAKE_RxFeed(Frames[Index & 0xFF], Sizes[Index & 0xFF]);
+    Step();
+  }
+  Run(20);
+  Cycles = TEST_Cycles() - Cycles;
+  Elapsed = TEST_Now() - Start;
+  CHECK_EQ(DeliveredCount, BENCH_FRAMES);
+  CHECK_EQ(WIFI_FrameErrors(), 0);
+  printf("frame receive %6.0f ns/frame %7.0f cycles/frame\n",
+         Elapsed * 1e9 / BENCH_FRAMES, (double)Cycles / BENCH_FRAMES);
+}
+
+int main(void)
+{
+  TestCrc();
+  TestEncode();
+  TestReceive();
+  TestCorrupt();
+  TestWindow();
+  TestSilentPeer();
+  TestBench();
+  return TEST_END();
+}
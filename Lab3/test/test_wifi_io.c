@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_io.c
+  * @brief   wifi_io.c on the host: the operations of an io: command read
+  *          from the RxBuffer, one BSRR write per port, the PWM operations
+  *          (% and *) given to the Pattern function of their port, the last
+  *          operation on a pin winning, and nothing written on an error.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_io.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define UNTOUCHED		0xDEADBEEF		// BSRR before the command
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t PatternPin[8];			// Calls of Pattern, in order
+static uint16_t PatternValue[8];
+static uint8_t  PatternCount = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Pattern(uint16_t Pin, uint16_t Value)
+{
+  PatternPin[PatternCount & 7] = Pin;
+  PatternValue[PatternCount++ & 7] = Value;
+}
+
+// c: the LEDs, PWM pins; a: two plain pins, no PWM (GPIOC stands for its registers)
+static const WIFI_IoPort_TypeDef Ports[] =
+{
+  { 'c', GPIOC, GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9, GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9, Pattern },
+  { 'a', GPIOC, 0x0003, 0, 0 }
+};
+
+// Runs a command, without "io:", as Cmd_IoEnd does at the end of its line
+static uint8_t Io(const char *pOps)
+{
+  uint16_t Length = (uint16_t)strlen(pOps);
+
+  FAKE_Reset();
+  WIFI_RxInit();
+  FAKE_RxFeed(pOps, Length);
+  FAKE_RxFeed("\r\n", 2);
+  FakeGPIOC.BSRR = UNTOUCHED;
+  PatternCount = 0;
+  return WIFI_IoExecute(0, Length);
+}
+
+/**
+  * @brief  Pins and masks: one BSRR write with the set and reset halves.
+  */
+static void TestPins(void)
+{
+  CHECK_EQ(WIFI_IoInit(Ports, 2), PASS);
+  CHECK_EQ(Io("c8=1,c9=0"), WIFI_IO_OK);
+  CHECK_EQ(FakeGPIOC.BSRR, GPIO_Pin_8 | ((uint32_t)GPIO_Pin_9 << 16));
+  CHECK_EQ(PatternCount, 0);
+
+  CHECK_EQ(Io("c+340"), WIFI_IO_OK);
+  CHECK_EQ(FakeGPIOC.BSRR, GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9);
+  CHECK_EQ(Io("c=100"), WIFI_IO_OK);
+  CHECK_EQ(FakeGPIOC.BSRR, GPIO_Pin_8 | ((uint32_t)(GPIO_Pin_6 | GPIO_Pin_9) << 16));
+
+  CHECK_EQ(Io("c7=1"), WIFI_IO_PIN);
+  CHECK_EQ(FakeGPIOC.BSRR, UNTOUCHED);
+  CHECK_EQ(Io("b1=1"), WIFI_IO_PIN);
+  CHECK_EQ(Io("c8=2"), WIFI_IO_SYNTAX);
+  CHECK_EQ(Io("c8=1,"), WIFI_IO_SYNTAX);
+  CHECK_EQ(FakeGPIOC.BSRR, UNTOUCHED);
+}
+
+/**
+  * @brief  Duty cycle in %, rounded to the 16 steps of a pattern, and raw
+  *         patterns; only on the PWM pins of a port with a Pattern function.
+  */
+static void TestPwm(void)
+{
+  CHECK_EQ(Io("c9%25"), WIFI_IO_OK);
+  CHECK_EQ(PatternCount, 1);
+  CHECK_EQ(PatternPin[0], GPIO_Pin_9);
+  CHECK_EQ(PatternValue[0], 0x000F);
+  CHECK_EQ(FakeGPIOC.BSRR, UNTOUCHED);
+
+  CHECK_EQ(Io("c9%0,c8%100,c6%50"), WIFI_IO_OK);
+  CHECK_EQ(PatternCount, 3);
+  CHECK_EQ(PatternValue[0], 0x0000);
+  CHECK_EQ(PatternValue[1], 0xFFFF);
+  CHECK_EQ(PatternPin[2], GPIO_Pin_6);
+  CHECK_EQ(PatternValue[2], 0x00FF);
+
+  CHECK_EQ(Io("c8*3333"), WIFI_IO_OK);
+  CHECK_EQ(PatternCount, 1);
+  CHECK_EQ(PatternPin[0], GPIO_Pin_8);
+  CHECK_EQ(PatternValue[0], 0x3333);
+
+  // Wrong ones: nothing is written, no Pattern call
+  CHECK_EQ(Io("c9%101"), WIFI_IO_SYNTAX);
+  CHECK_EQ(Io("c9%"), WIFI_IO_SYNTAX);
+  CHECK_EQ(Io("c9*"), WIFI_IO_SYNTAX);
+  CHECK_EQ(Io("c9#5"), WIFI_IO_SYNTAX);
+  CHECK_EQ(Io("c7%50"), WIFI_IO_PIN);
+  CHECK_EQ(Io("a0%50"), WIFI_IO_PIN);
+  CHECK_EQ(Io("c8=1,c9%50,c6=7"), WIFI_IO_SYNTAX);
+  CHECK_EQ(PatternCount, 0);
+  CHECK_EQ(FakeGPIOC.BSRR, UNTOUCHED);
+}
+
+/**
+  * @brief  The last operation on a pin wins, BSRR or PWM; the BSRR of the
+  *         port is written before the patterns.
+  */
+static void TestLastWins(void)
+{
+  CHECK_EQ(Io("c8*00FF,c8=1"), WIFI_IO_OK);
+  CHECK_EQ(PatternCount, 0);
+  CHECK_EQ(FakeGPIOC.BSRR, GPIO_Pin_8);
+
+  CHECK_EQ(Io("c8=1,c8%50"), WIFI_IO_OK);
+  CHECK_EQ(PatternCount, 1);
+  CHECK_EQ(PatternValue[0], 0x00FF);
+  CHECK_EQ(FakeGPIOC.BSRR, UNTOUCHED);
+
+  CHECK_EQ(Io("c9%50,c9%25,c8%50,c=0"), WIFI_IO_OK);
+  CHECK_EQ(PatternCount, 0);
+  CHECK_EQ(FakeGPIOC.BSRR, (uint32_t)(GPIO_Pin_6 | GPIO_Pin_8 | GPIO_Pin_9) << 16);
+
+  CHECK_EQ(Io("c9%50,c9*0001,c9*0002,c9*0003,c9*0004,c6=1"), WIFI_IO_OK);
+  CHECK_EQ(PatternCount, 1);
+  CHECK_EQ(PatternValue[0], 0x0004);
+  CHECK_EQ(FakeGPIOC.BSRR, GPIO_Pin_6);
+}
+
+int main(void)
+{
+  TestPins();
+  TestPwm();
+  TestLastWins();
+  return TEST_END();
+}
@@ -0,0 +1,488 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_match.c
+  * @brief   wifi_match.c with the automaton of wifi_match_table.c: every
+  *          string found where a brute force search finds it, the scan of
+  *          WIFI_MatchPoll and its handler, and the cost per byte against
+  *          the Search_B2inB1 loop that TestRxCommand used to run.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+#include "wifi_strings.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private define ------------------------------------------------------------*/
+#define TEST_ID(Id, String)			Id,
+#define TEST_STRING(Id, String)	WIFI_MATCH_STRING(String),
+
+enum
+{
+  WIFI_RX_STRINGS(TEST_ID)
+  RX_COUNT
+};
+
+#define TEXT_SIZE		200000
+#define BENCH_SIZE	65536
+
+/* Private variables ---------------------------------------------------------*/
+// What the module sends in normal operation
+static const char Traffic[] =
+  "+WIND:1:Poweron (150410-c2e37a3-SPWF01S)\r\n"
+  "+WIND:13:ST SPWF01S IWM: Copyright (c) 2012-2014 STMicroelectronics, Inc. All rights Reserved.\r\n"
+  "+WIND:24:WiFi Up:192.168.1.23\r\n"
+  "\r\n OK\r\n"
+  "GET /led.shtml?cmd=lgon HTTP/1.1\r\nHost: 192.168.1.23\r\nAccept: text/html\r\n\r\n"
+  "+WIND:55:Pending Data:0:24\r\n"
+  "\r\n  ip_ipaddr = 192.168.1.23\r\n  ip_netmask = 255.255.255.0\r\n OK\r\n";
+
+static const WIFI_MatchString_TypeDef Strings[RX_COUNT] = { WIFI_RX_STRINGS(TEST_STRING) };
+static uint8_t Text[TEXT_SIZE];
+
+// Strings reported to Handler
+static uint8_t  SeenId[4096];
+static uint32_t SeenPos[4096];
+static unsigned Seen = 0;
+static uint8_t  ConsumeOn = 0xFE;		// Id on which Handler consumes the RxBuffer
+static uint8_t  ConsumeAll = 0;			// 1 == all of it, 0 == up to the string
+static WIFI_MatchMask NestedMask = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  The search of TestRxCommand before the matcher, as it was: the
+  *         restart after a partial match skips the overlapping prefixes.
+  */
+static uint8_t Search_B2inB1(const uint8_t *pBuffer1, const uint8_t *pBuffer2, uint16_t Buffer1Length, uint16_t Buffer2Length)
+{
+  uint16_t ValComp = 0;
+  const uint8_t *Mem_pBuffer2 = pBuffer2;
+
+  while (Buffer1Length--)
+  {
+    if (*pBuffer1 == *pBuffer2)
+    {
+      ValComp++;
+      pBuffer1++;
+      pBuffer2++;
+      if (ValComp == Buffer2Length)
+        return PASS;
+    }
+    else
+    {
+      ValComp = 0;
+      pBuffer2 = Mem_pBuffer2;
+      pBuffer1++;
+    }
+  }
+  return FAIL;
+}
+
+/**
+  * @brief  Strings that end at Text[End], by brute force.
+  */
+static WIFI_MatchMask BruteForce(const uint8_t *pText, uint32_t End)
+{
+  WIFI_MatchMask Mask = 0;
+  uint8_t  Id;
+
+  for (Id = 0; Id < RX_COUNT; Id++)
+  {
+    if ((Strings[Id].Length <= End + 1) &&
+        (memcmp(&pText[End + 1 - Strings[Id].Length], Strings[Id].pStr, Strings[Id].Length) == 0))
+      Mask |= WIFI_MATCH_BIT(Id);
+  }
+  return Mask;
+}
+
+/**
+  * @brief  Text made of whole strings, their prefixes and the bytes they use,
+  *         so that partial and overlapping matches are frequent.
+  */
+static void MakeText(uint8_t *pText, uint32_t Size, unsigned Seed)
+{
+  const WIFI_MatchString_TypeDef *pString;
+  uint32_t Pos = 0;
+  uint16_t Length;
+
+  srand(Seed);
+  while (Pos < Size)
+  {
+    pString = &Strings[rand() % RX_COUNT];
+    switch (rand() % 4)
+    {
+      case 0:			// whole
+      case 1:			// prefix
+        Length = (rand() % 4 == 0) ? pString->Length : (uint16_t)(1 + rand() % pString->Length);
+        if (Length > Size - Pos)
+          Length = (uint16_t)(Size - Pos);
+        memcpy(&pText[Pos], pString->pStr, Length);
+        Pos += Length;
+        break;
+      case 2:			// one of its bytes
+        pText[Pos++] = pString->pStr[rand() % pString->Length];
+        break;
+      default:		// line end or text
+        pText[Pos++] = "\r\n :aeiouOK"[rand() % 11];
+        break;
+    }
+  }
+}
+
+static void Handler(uint8_t Id, uint32_t Pos)
+{
+  if (Seen < sizeof(SeenId))
+  {
+    SeenId[Seen] = Id;
+    SeenPos[Seen] = Pos;
+    Seen++;
+  }
+  if (Id == ConsumeOn)
+  {
+    NestedMask = WIFI_MatchPoll();		// must not scan again
+    if (ConsumeAll)
+      WIFI_RxConsume(WIFI_RxAvailable());
+    else
+      WIFI_RxConsume((uint16_t)(Pos + 1 - WIFI_RxReadCount()));
+  }
+}
+
+static void Setup(void)
+{
+  FAKE_Reset();
+  WIFI_RxInit();
+  WIFI_MatchSetHandler(0);
+  WIFI_MatchReset();
+  Seen = 0;
+  ConsumeOn = 0xFE;
+}
+
+/**
+  * @brief  The table is the one of the strings, in their order.
+  */
+static void TestInit(void)
+{
+  WIFI_MatchString_TypeDef Swapped[RX_COUNT];
+
+  CHECK_EQ(WIFI_MatchStringCount, RX_COUNT);
+  CHECK_EQ(WIFI_MatchInit(Strings, sizeof(Strings[0]), RX_COUNT), PASS);
+
+  // Another order, a string missing or changed: the table is stale
+  memcpy(Swapped, Strings, sizeof(Swapped));
+  Swapped[RX_LGON] = Strings[RX_LGOFF];
+  Swapped[RX_LGOFF] = Strings[RX_LGON];
+  CHECK_EQ(WIFI_MatchInit(Swapped, sizeof(Swapped[0]), RX_COUNT), FAIL);
+  CHECK_EQ(WIFI_MatchInit(Strings, sizeof(Strings[0]), RX_COUNT - 1), FAIL);
+  memcpy(Swapped, Strings, sizeof(Swapped));
+  Swapped[RX_SCAN].Length--;
+  CHECK_EQ(WIFI_MatchInit(Swapped, sizeof(Swapped[0]), RX_COUNT), FAIL);
+}
+
+/**
+  * @brief  The automaton reports at every byte exactly the strings that end
+  *         there, overlapping ones included.
+  */
+static void TestBruteForce(void)
+{
+  uint32_t Pos, Errors = 0, Found = 0;
+  WIFI_MatchMask Mask;
+  uint8_t  State = 0;
+
+  MakeText(Text, TEXT_SIZE, 1);
+  for (Pos = 0; Pos < TEXT_SIZE; Pos++)
+  {
+    State = WIFI_MatchStep(State, Text[Pos]);
+    Mask = WIFI_MatchOut(State);
+    Found += (Mask != 0);
+    if (Mask != BruteForce(Text, Pos))
+    {
+      if (Errors++ < 5)
+        printf("byte %u: mask %016llX, expected %016llX\n", (unsigned)Pos, (unsigned long long)Mask,
+               (unsigned long long)BruteForce(Text, Pos));
+    }
+  }
+  CHECK_EQ(Errors, 0);
+  CHECK(Found > 1000);
+}
+
+/**
+  * @brief  The overlapping prefix that Search_B2inB1 skipped.
+  */
+static void TestOverlap(void)
+{
+  static const uint8_t OOK[] = "OOK";
+  static const uint8_t Sock[] = "+WIND:+WIND:55:Pending Data:";
+  uint8_t State = 0;
+  uint8_t Index;
+
+  CHECK_EQ(Search_B2inB1(OOK, (const uint8_t *)WiFi_OK, 3, 2), FAIL);
+  for (Index = 0; Index < 3; Index++)
+    State = WIFI_MatchStep(State, OOK[Index]);
+  CHECK_EQ(WIFI_MatchOut(State), WIFI_MATCH_BIT(RX_OK));
+
+  CHECK_EQ(Search_B2inB1(Sock, (const uint8_t *)RxSockData, sizeof(Sock) - 1, sizeof(RxSockData) - 1), FAIL);
+  State = 0;
+  for (Index = 0; Index < sizeof(Sock) - 1; Index++)
+    State = WIFI_MatchStep(State, Sock[Index]);
+  CHECK_EQ(WIFI_MatchOut(State), WIFI_MATCH_BIT(RX_SOCK_DATA));
+}
+
+/**
+  * @brief  Lowest bit of every mask, in both words.
+  */
+static void TestFirst(void)
+{
+  WIFI_MatchMask Mask;
+  uint8_t  Bit, Errors = 0;
+
+  for (Bit = 0; Bit < WIFI_MATCH_MAX_STRINGS; Bit++)
+  {
+    Mask = WIFI_MATCH_BIT(Bit);
+    Errors += WIFI_MatchFirst(Mask) != Bit;
+    Errors += WIFI_MatchFirst(Mask | WIFI_MATCH_BIT(63) | (Mask << 1)) != Bit;
+  }
+  CHECK_EQ(Errors, 0);
+}
+
+/**
+  * @brief  WIFI_MatchPoll: only the new bytes, the handler in the order of
+  *         the bytes with their stream position, the mask until consumed,
+  *         the bytes kept by WIFI_MatchKeep.
+  */
+static void TestPoll(void)
+{
+  static const char Msg1[] = "+WIND:55:Pend";
+  static const char Msg2[] = "ing Data:0:12\r\nOK\r\n";
+
+  Setup();
+  WIFI_MatchSetHandler(Handler);
+  FAKE_RxFeed(Msg1, sizeof(Msg1) - 1);
+  CHECK_EQ(WIFI_MatchPoll(), 0);
+  CHECK_EQ(Seen, 0);
+  FAKE_RxFeed(Msg2, sizeof(Msg2) - 1);
+  CHECK_EQ(WIFI_MatchPoll(), WIFI_MATCH_BIT(RX_SOCK_DATA) | WIFI_MATCH_BIT(RX_OK));
+  CHECK_EQ(Seen, 4);
+  CHECK_EQ(SeenId[0], RX_SOCK_DATA);
+  CHECK_EQ(SeenPos[0], sizeof(RxSockData) - 2);
+  CHECK_EQ(SeenId[1], WIFI_MATCH_EOL);
+  CHECK_EQ(SeenId[2], RX_OK);
+  CHECK_EQ(SeenPos[2], sizeof(Msg1) - 1 + sizeof(Msg2) - 1 - 3);
+  CHECK_EQ(SeenId[3], WIFI_MATCH_EOL);
+
+  // Nothing new: nothing scanned again
+  CHECK_EQ(WIFI_MatchPoll(), WIFI_MATCH_BIT(RX_SOCK_DATA) | WIFI_MATCH_BIT(RX_OK));
+  CHECK_EQ(Seen, 4);
+  WIFI_MatchDiscard(WIFI_MATCH_BIT(RX_OK));
+  CHECK_EQ(WIFI_MatchPoll(), WIFI_MATCH_BIT(RX_SOCK_DATA));
+  WIFI_MatchConsume();
+  CHECK_EQ(WIFI_RxAvailable(), 0);
+  CHECK_EQ(WIFI_MatchPoll(), 0);
+
+  // A string split by WIFI_MatchConsume is still found
+  FAKE_RxFeed("lg", 2);
+  WIFI_MatchPoll();
+  WIFI_MatchConsume();
+  FAKE_RxFeed("on", 2);
+  CHECK_EQ(WIFI_MatchPoll(), WIFI_MATCH_BIT(RX_LGON));
+  WIFI_MatchConsume();
+
+  // Kept bytes stay until the scan has gone past them, or they are released
+  WIFI_MatchKeep(WIFI_RxReadCount() + 2, 4);
+  FAKE_RxFeed("abcde", 5);
+  WIFI_MatchPoll();
+  WIFI_MatchConsume();
+  CHECK_EQ(WIFI_RxAvailable(), 3);
+  FAKE_RxFeed("f", 1);
+  WIFI_MatchPoll();
+  WIFI_MatchConsume();
+  CHECK_EQ(WIFI_RxAvailable(), 0);
+  WIFI_MatchKeep(WIFI_RxReadCount(), 4);
+  FAKE_RxFeed("gh", 2);
+  WIFI_MatchPoll();
+  WIFI_MatchConsume();
+  CHECK_EQ(WIFI_RxAvailable(), 2);
+  WIFI_MatchKeep(0, 0);
+  WIFI_MatchConsume();
+  CHECK_EQ(WIFI_RxAvailable(), 0);
+}
+
+/**
+  * @brief  A handler that consumes the RxBuffer: the scan goes on from the
+  *         oldest unread byte, nothing is reported twice.
+  */
+static void TestHandlerConsumes(void)
+{
+  static const char Msg[] = "OK\r\nlgon lboff\r\n";
+
+  // Everything: the scan stops
+  Setup();
+  WIFI_MatchSetHandler(Handler);
+  ConsumeOn = RX_OK;
+  ConsumeAll = 1;
+  FAKE_RxFeed(Msg, sizeof(Msg) - 1);
+  CHECK_EQ(WIFI_MatchPoll(), WIFI_MATCH_BIT(RX_OK));
+  CHECK_EQ(NestedMask, WIFI_MATCH_BIT(RX_OK));
+  CHECK_EQ(Seen, 1);
+  CHECK_EQ(WIFI_RxAvailable(), 0);
+
+  // Up to the OK: the rest is scanned once
+  Setup();
+  WIFI_MatchSetHandler(Handler);
+  ConsumeOn = RX_OK;
+  ConsumeAll = 0;
+  FAKE_RxFeed(Msg, sizeof(Msg) - 1);
+  CHECK_EQ(WIFI_MatchPoll(), WIFI_MATCH_BIT(RX_OK) | WIFI_MATCH_BIT(RX_LGON) | WIFI_MATCH_BIT(RX_LBOFF));
+  CHECK_EQ(Seen, 5);
+  CHECK_EQ(SeenId[0], RX_OK);
+  CHECK_EQ(SeenId[1], WIFI_MATCH_EOL);
+  CHECK_EQ(SeenId[2], RX_LGON);
+  CHECK_EQ(SeenId[3], RX_LBOFF);
+  CHECK_EQ(SeenPos[3], sizeof(Msg) - 1 - 3);
+  CHECK_EQ(WIFI_RxAvailable(), sizeof(Msg) - 1 - 2);
+}
+
+/**
+  * @brief  Module traffic fed in chunks of every size from 1 to 64 bytes and
+  *         around RXBUFFERSIZE, polled and consumed after every chunk as the
+  *         main loop does: the handler sees the same strings at the same
+  *         positions as a brute force search of the whole stream.
+  */
+static void TestChunks(void)
+{
+  static uint8_t  Stream[(sizeof(Traffic) - 1) * 8];
+  static uint8_t  ExpectId[sizeof(SeenId)];
+  static uint32_t ExpectPos[sizeof(SeenId)];
+  static const uint16_t Big[] = { RXBUFFERSIZE / 2 - 1, RXBUFFERSIZE / 2, RXBUFFERSIZE - 1, RXBUFFERSIZE };
+  unsigned Expected = 0, Index, Errors = 0;
+  uint32_t Pos;
+  WIFI_MatchMask Mask;
+  uint16_t Chunk, Length;
+  uint8_t  Size;
+
+  for (Pos = 0; Pos < sizeof(Stream); Pos++)
+    Stream[Pos] = (uint8_t)Traffic[Pos % (sizeof(Traffic) - 1)];
+  for (Pos = 0; Pos < sizeof(Stream); Pos++)
+  {
+    for (Mask = BruteForce(Stream, Pos); Mask != 0; Mask &= Mask - 1)
+    {
+      ExpectId[Expected] = WIFI_MatchFirst(Mask);
+      ExpectPos[Expected++] = Pos;
+    }
+    if (Stream[Pos] == '\n')
+    {
+      ExpectId[Expected] = WIFI_MATCH_EOL;
+      ExpectPos[Expected++] = Pos;
+    }
+  }
+
+  for (Size = 1; Size <= 64 + sizeof(Big) / sizeof(Big[0]); Size++)
+  {
+    Chunk = (Size <= 64) ? Size : Big[Size - 65];
+    Setup();
+    WIFI_MatchSetHandler(Handler);
+    for (Pos = 0; Pos < sizeof(Stream); Pos += Length)
+    {
+      Length = (uint16_t)((sizeof(Stream) - Pos < Chunk) ? sizeof(Stream) - Pos : Chunk);
+      FAKE_RxFeed(&Stream[Pos], Length);
+      if (Size & 1)
+        FAKE_RxIdle();
+      WIFI_MatchPoll();
+      WIFI_MatchConsume();
+    }
+    if (Seen != Expected)
+    {
+      Errors++;
+      printf("chunk %u: %u strings, expected %u\n", Chunk, Seen, Expected);
+      continue;
+    }
+    for (Index = 0; Index < Seen; Index++)
+    {
+      if ((SeenId[Index] != ExpectId[Index]) || (SeenPos[Index] != ExpectPos[Index]))
+      {
+        Errors++;
+        printf("chunk %u: string %u is %u at %u, expected %u at %u\n", Chunk, Index,
+               SeenId[Index], (unsigned)SeenPos[Index], ExpectId[Index], (unsigned)ExpectPos[Index]);
+        break;
+      }
+    }
+  }
+  CHECK_EQ(Errors, 0);
+  CHECK(Expected > 100);
+  CHECK_EQ(WIFI_RxOverruns(), 0);
+}
+
+/**
+  * @brief  Cost per byte of a text: the old TestRxCommand searched every
+  *         string in the whole RxBuffer at every pass, the automaton steps
+  *         once per byte. The old loop is timed at one pass per RXBUFFERSIZE
+  *         bytes received, the best case it ever had (it ran at every pass of
+  *         the main loop). Host figures, not Cortex-M0 cycles.
+  */
+static void BenchMatch(const char *pName, const uint8_t *pText)
+{
+  uint32_t Pos, OldHits = 0;
+  WIFI_MatchMask Mask = 0;
+  uint8_t  State = 0, Id;
+  double   Start, Old, New;
+  uint64_t Cycles0, Cycles1, Cycles2;
+  unsigned Round;
+
+  Start = TEST_Now();
+  Cycles0 = TEST_Cycles();
+  for (Round = 0; Round < 10; Round++)
+  {
+    for (Pos = 0; Pos < BENCH_SIZE; Pos += RXBUFFERSIZE)
+    {
+      for (Id = 0; Id < RX_COUNT; Id++)
+        OldHits += Search_B2inB1(&pText[Pos], Strings[Id].pStr, RXBUFFERSIZE, Strings[Id].Length);
+    }
+  }
+  Cycles1 = TEST_Cycles();
+  Old = TEST_Now() - Start;
+
+  Start = TEST_Now();
+  for (Round = 0; Round < 10; Round++)
+  {
+    for (Pos = 0; Pos < BENCH_SIZE; Pos++)
+    {
+      State = WIFI_MatchStep(State, pText[Pos]);
+      if (WIFI_MatchNode[State].Out | WIFI_MatchNode[State].Dict)
+        Mask |= WIFI_MatchOut(State);
+    }
+  }
+  Cycles2 = TEST_Cycles();
+  New = TEST_Now() - Start;
+
+  printf("match %-9s Search_B2inB1 x %d strings %6.2f ns/byte %6.1f cycles/byte\n", pName, RX_COUNT,
+         Old * 1e8 / BENCH_SIZE, (double)(Cycles1 - Cycles0) / (10.0 * BENCH_SIZE));
+  printf("match %-9s automaton                %6.2f ns/byte %6.1f cycles/byte (%.1fx)\n", pName,
+         New * 1e8 / BENCH_SIZE, (double)(Cycles2 - Cycles1) / (10.0 * BENCH_SIZE), Old / New);
+  CHECK(Mask != 0);
+  CHECK(OldHits != 0);
+  CHECK(New < Old);
+}
+
+int main(void)
+{
+  uint32_t Pos;
+
+  TestInit();
+  TestBruteForce();
+  TestOverlap();
+  TestFirst();
+  TestPoll();
+  TestHandlerConsumes();
+  TestChunks();
+  MakeText(Text, BENCH_SIZE, 2);
+  BenchMatch("fragments", Text);
+  for (Pos = 0; Pos < BENCH_SIZE; Pos++)
+    Text[Pos] = (uint8_t)Traffic[Pos % (sizeof(Traffic) - 1)];
+  BenchMatch("traffic", Text);
+  return TEST_END();
+}
@@ -0,0 +1,165 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_page.c
+  * @brief   wifi_page.c on the fake USART2/DMA: number fields of fixed
+  *          width, buffers reused only when sent, and metrics.json (MET_Page)
+  *          as it goes out, at the smallest and largest values.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "wifi_page.h"
+#include "metrics.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private variables ---------------------------------------------------------*/
+__IO uint32_t LocalTime = 0;
+static uint32_t Values[32];
+static uint8_t  Policy = 0;
+static uint16_t FrameErrors = 0;
+static char     Out[2048];
+
+/* Private functions ---------------------------------------------------------*/
+uint8_t IDLE_GetPolicy(void)
+{
+  return Policy;
+}
+
+uint16_t WIFI_FrameErrors(void)
+{
+  return FrameErrors;
+}
+
+static uint32_t Number(uint8_t Field)
+{
+  return Values[Field];
+}
+
+static const WIFI_PageItem_TypeDef NumberItems[] =
+{
+  WIFI_PAGE_TEXT("{\"a\":"), WIFI_PAGE_NUMBER(0, 5),
+  WIFI_PAGE_TEXT(",\"b\":"), WIFI_PAGE_NUMBER(1, 10),
+  WIFI_PAGE_TEXT(",\"c\":["),
+  WIFI_PAGE_NUMBER(2, 3), WIFI_PAGE_NUMBER(3, 3), WIFI_PAGE_NUMBER(4, 3), WIFI_PAGE_NUMBER(5, 3),
+  WIFI_PAGE_NUMBER(6, 3), WIFI_PAGE_NUMBER(7, 3), WIFI_PAGE_NUMBER(8, 3), WIFI_PAGE_NUMBER(9, 3),
+  WIFI_PAGE_TEXT("]}")
+};
+static const WIFI_Page_TypeDef NumberPage = { "/n.json", NumberItems, sizeof(NumberItems) / sizeof(NumberItems[0]), 0, Number };
+
+/**
+  * @brief  Sends the body of a page, the DMA completing one transfer each
+  *         time the TX queue or the number buffers are full.
+  * @retval Length of the body, copied to Out with a final 0
+  */
+static uint16_t SendBody(const WIFI_Page_TypeDef *pPage)
+{
+  uint32_t Start;
+  uint16_t Length;
+  unsigned Turns = 0;
+
+  WIFI_PageSendAppend(pPage);
+  FAKE_TxDrain();
+  Start = FakeTxCount;
+  while ((WIFI_PageSendBody(pPage) == WIFI_TX_FAIL) && (Turns++ < 10000))
+    FAKE_TxComplete();
+  FAKE_TxDrain();
+  Length = (uint16_t)(FakeTxCount - Start);
+  for (Turns = 0; (Turns < Length) && (Turns < sizeof(Out) - 1); Turns++)
+    Out[Turns] = (char)FakeTxLog[(Start + Turns) & (FAKE_TX_LOG_SIZE - 1)];
+  Out[Turns] = 0;
+  return Length;
+}
+
+static void Setup(void)
+{
+  FAKE_Reset();
+  WIFI_TxInit();
+  WIFI_RxInit();
+}
+
+/**
+  * @brief  Numbers right aligned in their width, whatever the value: the
+  *         length is the same, only the lowest digits of a number too wide.
+  */
+static void TestNumbers(void)
+{
+  uint16_t Length;
+  uint8_t  Index;
+
+  Setup();
+  memset(Values, 0, sizeof(Values));
+  Length = WIFI_PageLength(&NumberPage);
+  CHECK_EQ(Length, 5 + 5 + 5 + 10 + 6 + 8 * 3 + 2);
+
+  Values[0] = 42;
+  Values[1] = 0xFFFFFFFF;
+  for (Index = 2; Index < 10; Index++)
+    Values[Index] = Index * 100 + Index;		// 4 digits in 3
+  CHECK_EQ(WIFI_PageLength(&NumberPage), Length);
+  CHECK_EQ(SendBody(&NumberPage), Length);
+  CHECK(strcmp(Out, "{\"a\":   42,\"b\":4294967295,\"c\":[202303404505606707808909]}") == 0);
+
+  // All the numbers queued without the DMA: each keeps its own digits
+  Setup();
+  for (Index = 2; Index < 10; Index++)
+    Values[Index] = Index;
+  CHECK_EQ(SendBody(&NumberPage), Length);
+  CHECK(strcmp(Out, "{\"a\":   42,\"b\":4294967295,\"c\":[  2  3  4  5  6  7  8  9]}") == 0);
+}
+
+/**
+  * @brief  metrics.json: same length at 0 and at the largest values, the
+  *         values in place, JSON around them.
+  */
+static void TestMetrics(void)
+{
+  uint16_t Length, Index;
+  uint8_t  Bucket;
+
+  Setup();
+  memset(&Metrics, 0, sizeof(Metrics));
+  Length = WIFI_PageLength(&MET_Page);
+  CHECK_EQ(SendBody(&MET_Page), Length);
+  CHECK(strncmp(Out, "{\"up\":         0,\"rtt\":{\"n\":[    0,", 35) == 0);
+  CHECK(strcmp(&Out[Length - 3], "}\r\n") == 0);
+
+  Setup();
+  LocalTime = 0xFFFFFFFF;
+  Policy = 255;
+  FrameErrors = 0xFFFF;
+  for (Bucket = 0; Bucket < MET_BUCKETS; Bucket++)
+    Metrics.Loop.Count[Bucket] = 0xFFFF;
+  Metrics.Loop.Max = 0xFFFFFFFF;
+  Metrics.Resets = 0xFFFF;
+  Metrics.Recover[2] = 7;
+  CHECK_EQ(WIFI_PageLength(&MET_Page), Length);
+  CHECK_EQ(SendBody(&MET_Page), Length);
+  CHECK(strncmp(Out, "{\"up\":   4294967", 16) == 0);
+  CHECK(strstr(Out, "\"loop_us\":{\"n\":[65535,65535,65535,65535,65535,65535,65535,65535,65535,65535,65535,65535],\"max\":4294967295}") != 0);
+  CHECK(strstr(Out, "\"idle\":255,") != 0);
+  CHECK(strstr(Out, "\"resets\":65535,") != 0);
+  CHECK(strstr(Out, "\"recover\":[    0,    0,    7]") != 0);
+  CHECK(strstr(Out, "\"frame_err\":65535}") != 0);
+
+  // Only JSON: balanced brackets, no byte outside the printable ASCII but the final \r\n
+  for (Index = 0, Bucket = 0; Index < Length - 2; Index++)
+  {
+    Bucket += (Out[Index] == '{') + (Out[Index] == '[') - (Out[Index] == '}') - (Out[Index] == ']');
+    if ((Out[Index] < ' ') || (Out[Index] > '~'))
+      break;
+  }
+  CHECK_EQ(Index, Length - 2);
+  CHECK_EQ(Bucket, 0);
+  printf("metrics.json  %u bytes from the template, none in RAM\n", Length);
+}
+
+int main(void)
+{
+  TestNumbers();
+  TestMetrics();
+  return TEST_END();
+}
@@ -0,0 +1,228 @@
+/**
+  ******************************************************************************
+  * @file    test_wifi_uart.c
+  * @brief   wifi_uart.c on the fake USART2/DMA: TX queue, tickets, full
+  *          queue, zero length buffers, RX ring and idle line.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "main.h"
+#include "wifi_uart.h"
+#include "fake_stm32.h"
+#include "test.h"
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t Hello[] = "hello ";
+static const uint8_t World[] = "world";
+static uint8_t Big[1000];
+static uint8_t Rx[RXBUFFERSIZE * 2];
+
+static unsigned Callbacks = 0;
+static uint32_t CallbackPrimask = 0;	// Masks seen by the callbacks, ORed
+
+/* Private functions ---------------------------------------------------------*/
+static void Done(void)
+{
+  Callbacks++;
+  CallbackPrimask |= __get_PRIMASK();
+}
+
+static void Setup(void)
+{
+  FAKE_Reset();
+  WIFI_TxInit();
+  WIFI_RxInit();
+  Callbacks = 0;
+  CallbackPrimask = 0;
+}
+
+/**
+  * @brief  Buffers go out in order, tickets complete one by one.
+  */
+static void TestTxOrder(void)
+{
+  uint16_t T1, T2;
+
+  Setup();
+  T1 = WIFI_TxSubmit(Hello, 6, Done);
+  T2 = WIFI_TxSubmit(World, 5, Done);
+  CHECK(T1 != WIFI_TX_FAIL);
+  CHECK(T2 != WIFI_TX_FAIL);
+  CHECK(WIFI_TxBusy());
+  CHECK_EQ(WIFI_TxDone(T1), FAIL);
+
+  CHECK_EQ(FAKE_TxComplete(), 6);
+  CHECK_EQ(WIFI_TxDone(T1), PASS);
+  CHECK_EQ(WIFI_TxDone(T2), FAIL);
+  CHECK_EQ(FAKE_TxComplete(), 5);
+  CHECK_EQ(WIFI_TxDone(T2), PASS);
+  CHECK(!WIFI_TxBusy());
+  CHECK_EQ(FakeTxCount, 11);
+  CHECK(memcmp(FakeTxLog, "hello world", 11) == 0);
+  CHECK_EQ(Callbacks, 2);
+}
+
+/**
+  * @brief  A full queue refuses the buffer at once and takes it again when
+  *         the DMA has made room.
+  */
+static void TestTxFull(void)
+{
+  uint16_t Ticket;
+  unsigned Queued = 0;
+
+  Setup();
+  while ((Ticket = WIFI_TxSubmit(Hello, 6, 0)) != WIFI_TX_FAIL)
+    Queued++;
+  CHECK_EQ(Queued, WIFI_TX_QUEUE_SIZE - 1);
+  CHECK_EQ(WIFI_TxFree(), 0);
+  CHECK_EQ(FakeTxCount, 0);		// Nothing waited for the DMA
+
+  FAKE_TxComplete();
+  CHECK_EQ(WIFI_TxFree(), 1);
+  Ticket = WIFI_TxSubmit(World, 5, 0);
+  CHECK(Ticket != WIFI_TX_FAIL);
+  FAKE_TxDrain();
+  CHECK_EQ(WIFI_TxDone(Ticket), PASS);
+  CHECK_EQ(FakeTxCount, Queued * 6 + 5);
+  CHECK_EQ(WIFI_TxFree(), WIFI_TX_QUEUE_SIZE - 1);
+}
+
+/**
+  * @brief  Zero length buffers: done at once when TX is idle, in order
+  *         behind a transfer otherwise. Callbacks never run masked.
+  */
+static void TestTxZeroLength(void)
+{
+  uint16_t T1, T2, T3;
+
+  Setup();
+  T1 = WIFI_TxSubmit(0, 0, Done);
+  CHECK_EQ(WIFI_TxDone(T1), PASS);
+  CHECK_EQ(Callbacks, 1);
+
+  T2 = WIFI_TxSubmit(Hello, 6, Done);
+  T3 = WIFI_TxSubmit(0, 0, Done);
+  CHECK_EQ(WIFI_TxDone(T3), FAIL);
+  CHECK_EQ(Callbacks, 1);
+  FAKE_TxComplete();
+  CHECK_EQ(WIFI_TxDone(T2), PASS);
+  CHECK_EQ(WIFI_TxDone(T3), PASS);
+  CHECK_EQ(Callbacks, 3);
+  CHECK(!WIFI_TxBusy());
+  CHECK_EQ(CallbackPrimask, 0);
+}
+
+/**
+  * @brief  Tickets wrap around and skip WIFI_TX_FAIL.
+  */
+static void TestTxTicketWrap(void)
+{
+  uint16_t Ticket, Old;
+  unsigned Index;
+  unsigned Fails = 0;
+
+  Setup();
+  FakeTxAuto = 1;
+  for (Index = 0; Index < 70000; Index++)
+  {
+    Ticket = WIFI_TxSubmit(Hello, 1, 0);
+    if (Ticket == WIFI_TX_FAIL)
+      Fails++;
+    else if (WIFI_TxDone(Ticket) != PASS)
+      Fails++;
+  }
+  CHECK_EQ(Fails, 0);
+  CHECK_EQ(FakeTxCount, 70000);
+
+  // A ticket kept over more than half the tickets is still done once the queue is idle
+  Old = WIFI_TxSubmit(Hello, 1, 0);
+  for (Index = 0; Index < 40000; Index++)
+    WIFI_TxSubmit(Hello, 1, 0);
+  FakeTxAuto = 0;
+  Ticket = WIFI_TxSubmit(Hello, 1, 0);
+  CHECK_EQ(WIFI_TxDone(Ticket), FAIL);
+  FAKE_TxComplete();
+  CHECK_EQ(WIFI_TxDone(Ticket), PASS);
+  CHECK_EQ(WIFI_TxDone(Old), PASS);
+}
+
+/**
+  * @brief  Streaming a big buffer in pieces through a queue kept full.
+  */
+static void TestTxStream(void)
+{
+  uint16_t Pos = 0, Ticket = WIFI_TX_FAIL, Index;
+
+  Setup();
+  for (Index = 0; Index < sizeof(Big); Index++)
+    Big[Index] = (uint8_t)(Index * 7);
+  while (Pos < sizeof(Big))
+  {
+    Ticket = WIFI_TxSubmit(&Big[Pos], 10, 0);
+    if (Ticket == WIFI_TX_FAIL)
+      FAKE_TxComplete();
+    else
+      Pos += 10;
+  }
+  FAKE_TxDrain();
+  CHECK_EQ(WIFI_TxDone(Ticket), PASS);
+  CHECK_EQ(FakeTxCount, sizeof(Big));
+  CHECK(memcmp(FakeTxLog, Big, sizeof(Big)) == 0);
+}
+
+/**
+  * @brief  RX ring: bytes in order across the wrap, idle line framing,
+  *         overrun when the main loop falls behind.
+  */
+static void TestRx(void)
+{
+  uint16_t Index, Length;
+  uint8_t  Ok = 1;
+
+  Setup();
+  for (Index = 0; Index < sizeof(Rx); Index++)
+    Rx[Index] = (uint8_t)Index;
+
+  // 3/4 of the ring, read, then 3/4 again: the second read wraps
+  FAKE_RxFeed(Rx, RXBUFFERSIZE * 3 / 4);
+  CHECK_EQ(WIFI_RxAvailable(), RXBUFFERSIZE * 3 / 4);
+  CHECK_EQ(WIFI_RxFramed(), 0);
+  FAKE_RxIdle();
+  CHECK_EQ(WIFI_RxNewFrame(), PASS);
+  CHECK_EQ(WIFI_RxNewFrame(), FAIL);
+  CHECK_EQ(WIFI_RxFramed(), RXBUFFERSIZE * 3 / 4);
+  CHECK_EQ(WIFI_RxRead(Big, sizeof(Big)), RXBUFFERSIZE * 3 / 4);
+  CHECK(memcmp(Big, Rx, RXBUFFERSIZE * 3 / 4) == 0);
+
+  FAKE_RxFeed(&Rx[RXBUFFERSIZE * 3 / 4], RXBUFFERSIZE * 3 / 4);
+  Length = WIFI_RxAvailable();
+  CHECK_EQ(Length, RXBUFFERSIZE * 3 / 4);
+  for (Index = 0; Index < Length; Index++)
+    Ok &= WIFI_RxPeek(Index) == Rx[RXBUFFERSIZE * 3 / 4 + Index];
+  CHECK(Ok);
+  CHECK_EQ(WIFI_RxFind(&Rx[RXBUFFERSIZE], 3, 0), RXBUFFERSIZE / 4);
+  WIFI_RxFlush();
+  CHECK_EQ(WIFI_RxAvailable(), 0);
+
+  // More than the ring without reading: the oldest bytes are dropped
+  FAKE_RxFeed(Rx, RXBUFFERSIZE + 10);
+  CHECK_EQ(WIFI_RxAvailable(), RXBUFFERSIZE);
+  CHECK_EQ(WIFI_RxPeek(0), Rx[10]);
+  CHECK(WIFI_RxOverruns() > 0);
+  FAKE_RxOverrun();
+  CHECK_EQ(WIFI_RxOverruns(), 2);
+}
+
+int main(void)
+{
+  TestTxOrder();
+  TestTxFull();
+  TestTxZeroLength();
+  TestTxTicketWrap();
+  TestTxStream();
+  TestRx();
+  return TEST_END();
+}
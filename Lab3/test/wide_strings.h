@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    wide_strings.h
+  * @brief   40 strings for test_wifi_cmd_wide.c: more than the 32 bits of a
+  *          uint32_t, so the masks of wifi_match.c and wifi_cmd.c must hold
+  *          the Ids past 31. The Makefile builds wide_match_table.c from it
+  *          with tools/wifi_match.py, as wifi_match_table.c from
+  *          wifi_strings.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIDE_STRINGS_H
+#define __WIDE_STRINGS_H
+
+/* Exported macro ------------------------------------------------------------*/
+// X(Id, string), one per line: read by tools/wifi_match.py
+#define WIFI_RX_STRINGS(X)	\
+	X(W_00,	"w00") \
+	X(W_01,	"w01") \
+	X(W_02,	"w02") \
+	X(W_03,	"w03") \
+	X(W_04,	"w04") \
+	X(W_05,	"w05") \
+	X(W_06,	"w06") \
+	X(W_07,	"w07") \
+	X(W_08,	"w08") \
+	X(W_09,	"w09") \
+	X(W_10,	"w10") \
+	X(W_11,	"w11") \
+	X(W_12,	"w12") \
+	X(W_13,	"w13") \
+	X(W_14,	"w14") \
+	X(W_15,	"w15") \
+	X(W_16,	"w16") \
+	X(W_17,	"w17") \
+	X(W_18,	"w18") \
+	X(W_19,	"w19") \
+	X(W_20,	"w20") \
+	X(W_21,	"w21") \
+	X(W_22,	"w22") \
+	X(W_23,	"w23") \
+	X(W_24,	"w24") \
+	X(W_25,	"w25") \
+	X(W_26,	"w26") \
+	X(W_27,	"w27") \
+	X(W_28,	"w28") \
+	X(W_29,	"w29") \
+	X(W_30,	"w30") \
+	X(W_31,	"w31") \
+	X(W_32,	"w32") \
+	X(W_33,	"w33") \
+	X(W_34,	"w34") \
+	X(W_35,	"w35") \
+	X(W_36,	"w36") \
+	X(W_37,	"w37") \
+	X(W_38,	"w38") \
+	X(W_39,	"w39")
+
+#endif /* __WIDE_STRINGS_H */
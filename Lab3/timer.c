@@ -0,0 +1,189 @@
+/**
+  ******************************************************************************
+  * @file    timer.c
+  * @brief   Software timers on a timing wheel advanced by the 1 ms SysTick.
+  *
+  *          Instead of waiting with Delay(), the code starts a timer and
+  *          returns: TMR_Process(), called by the main loop, calls its
+  *          callback (or posts its event) when it expires.
+  *
+  *          The wheel has TMR_WHEEL_SIZE slots, one per ms; a timer goes in
+  *          the slot of its expiry tick, in a doubly linked list, so starting
+  *          and stopping it costs the same whatever the number of timers.
+  *          Every tick TMR_Process looks only at the timers of one slot: those
+  *          that expire later, after one or more turns of the wheel, stay
+  *          where they are.
+  *
+  *          The timers are owned by their users (no allocation) and the
+  *          callbacks run in the main loop, not in the interrupt: they can
+  *          queue AT commands, start and stop timers, also their own.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "timer.h"
+#include "event.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define TMR_WHEEL_MASK		(TMR_WHEEL_SIZE - 1)
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static TMR_TypeDef *TmrWheel[TMR_WHEEL_SIZE];
+static TMR_TypeDef *TmrDue = 0;			// Timers of the slot being processed
+static uint32_t     TmrTick = 0;		// Last tick processed
+
+/* Private function prototypes -----------------------------------------------*/
+static void TMR_Insert(TMR_TypeDef *pTimer);
+static void TMR_Unlink(TMR_TypeDef *pTimer);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Empties the wheel.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+void TMR_Init(uint32_t Now)
+{
+  uint8_t Slot;
+
+  for (Slot = 0; Slot < TMR_WHEEL_SIZE; Slot++)
+    TmrWheel[Slot] = 0;
+  TmrDue = 0;
+  TmrTick = Now;
+}
+
+/**
+  * @brief  Starts (or restarts) a timer that calls a function.
+  * @param  pTimer: the timer
+  * @param  Delay: ms to the first expiry, counted from the last TMR_Process
+  * @param  Period: ms between the following expiries, 0 == one shot
+  * @param  Callback: called at every expiry
+  * @retval None
+  */
+void TMR_Start(TMR_TypeDef *pTimer, uint32_t Delay, uint32_t Period, TMR_Callback Callback)
+{
+  TMR_Stop(pTimer);
+  pTimer->Callback = Callback;
+  pTimer->Period = Period;
+  pTimer->Expiry = TmrTick + (Delay ? Delay : 1);
+  TMR_Insert(pTimer);
+}
+
+/**
+  * @brief  Starts (or restarts) a timer that posts an event, without data.
+  * @param  pTimer: the timer
+  * @param  Delay: ms to the first expiry, counted from the last TMR_Process
+  * @param  Period: ms between the following expiries, 0 == one shot
+  * @param  Event: EVT_xxx posted at every expiry
+  * @retval None
+  */
+void TMR_StartEvent(TMR_TypeDef *pTimer, uint32_t Delay, uint32_t Period, uint8_t Event)
+{
+  TMR_Start(pTimer, Delay, Period, 0);
+  pTimer->Event = Event;
+}
+
+/**
+  * @brief  Stops a timer. Nothing happens if it is not running.
+  * @param  pTimer: the timer
+  * @retval None
+  */
+void TMR_Stop(TMR_TypeDef *pTimer)
+{
+  if (pTimer->Slot != TMR_STOPPED)
+    TMR_Unlink(pTimer);
+}
+
+/**
+  * @brief  Tests if a timer is running.
+  * @param  pTimer: the timer
+  * @retval 1 if it will expire, 0 otherwise
+  */
+uint8_t TMR_Active(const TMR_TypeDef *pTimer)
+{
+  return pTimer->Slot != TMR_STOPPED;
+}
+
+/**
+  * @brief  Advances the wheel up to Now and expires the timers. Called by
+  *         the main loop at every tick; the ticks missed are processed too.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+void TMR_Process(uint32_t Now)
+{
+  TMR_TypeDef *pTimer;
+  uint8_t Slot;
+
+  while ((int32_t)(Now - TmrTick) > 0)
+  {
+    TmrTick++;
+    Slot = TmrTick & TMR_WHEEL_MASK;
+
+    // Move the slot to the due list: what the callbacks start goes in the wheel,
+    // what they stop is removed from either list
+    TmrDue = TmrWheel[Slot];
+    TmrWheel[Slot] = 0;
+    for (pTimer = TmrDue; pTimer != 0; pTimer = pTimer->pNext)
+      pTimer->Slot = TMR_DUE;
+
+    while (TmrDue != 0)
+    {
+      pTimer = TmrDue;
+      TMR_Unlink(pTimer);
+      if (pTimer->Expiry != TmrTick)
+      {
+        TMR_Insert(pTimer);		// next turn of the wheel
+        continue;
+      }
+      if (pTimer->Period != 0)
+      {
+        pTimer->Expiry += pTimer->Period;
+        TMR_Insert(pTimer);
+      }
+      if (pTimer->Callback != 0)
+        pTimer->Callback();
+      else
+        EVT_Post(pTimer->Event, 0);
+    }
+  }
+}
+
+/**
+  * @brief  Puts a timer in the slot of its expiry.
+  * @param  pTimer: the timer
+  * @retval None
+  */
+static void TMR_Insert(TMR_TypeDef *pTimer)
+{
+  uint8_t Slot = pTimer->Expiry & TMR_WHEEL_MASK;
+
+  pTimer->Slot = Slot + 1;
+  pTimer->pPrev = 0;
+  pTimer->pNext = TmrWheel[Slot];
+  if (pTimer->pNext != 0)
+    pTimer->pNext->pPrev = pTimer;
+  TmrWheel[Slot] = pTimer;
+}
+
+/**
+  * @brief  Removes a timer from its list.
+  * @param  pTimer: the timer, in the wheel or in the due list
+  * @retval None
+  */
+static void TMR_Unlink(TMR_TypeDef *pTimer)
+{
+  if (pTimer->pPrev != 0)
+    pTimer->pPrev->pNext = pTimer->pNext;
+  else if (pTimer->Slot == TMR_DUE)
+    TmrDue = pTimer->pNext;
+  else
+    TmrWheel[pTimer->Slot - 1] = pTimer->pNext;
+  if (pTimer->pNext != 0)
+    pTimer->pNext->pPrev = pTimer->pPrev;
+  pTimer->Slot = TMR_STOPPED;
+}
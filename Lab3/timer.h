@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file    timer.h
+  * @brief   Header for timer.c: software timers on a timing wheel advanced by
+  *          the 1 ms SysTick.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TIMER_H
+#define __TIMER_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+// Called from TMR_Process when the timer expires
+typedef void (*TMR_Callback)(void);
+
+// A timer, owned by the caller (usually a static variable): not copied by TMR_Start
+typedef struct TMR_Timer
+{
+  struct TMR_Timer *pNext;		// Timers of the same slot
+  struct TMR_Timer *pPrev;
+  uint32_t          Expiry;		// Tick of the next expiry
+  uint32_t          Period;		// ms between two expiries, 0 == one shot
+  TMR_Callback      Callback;	// 0 == post Event
+  uint8_t           Event;		// EVT_xxx posted when Callback is 0
+  uint8_t           Slot;			// Slot of the wheel + 1, TMR_STOPPED or TMR_DUE
+} TMR_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define TMR_WHEEL_SIZE		32		// Slots of the wheel (ms), must be a power of 2
+
+// TMR_TypeDef Slot when the timer is not in the wheel
+#define TMR_STOPPED				0			// A static TMR_TypeDef starts stopped
+#define TMR_DUE						0xFF	// Being expired by TMR_Process
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void    TMR_Init(uint32_t Now);
+void    TMR_Start(TMR_TypeDef *pTimer, uint32_t Delay, uint32_t Period, TMR_Callback Callback);
+void    TMR_StartEvent(TMR_TypeDef *pTimer, uint32_t Delay, uint32_t Period, uint8_t Event);
+void    TMR_Stop(TMR_TypeDef *pTimer);
+uint8_t TMR_Active(const TMR_TypeDef *pTimer);
+void    TMR_Process(uint32_t Now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIMER_H */
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Builds web_assets.c, the files of the web interface of Lab3 (see wifi_asset.c).
+
+Every file of the web directory becomes an entry of WebAssets[], in flash.
+With --gzip a file is compressed when that makes the upload shorter, header
+included: it is then stored with an HTTP header that the module should send
+as it is, with Content-Encoding: gzip, so the browser inflates it. The .shtml
+files are never compressed, the module must find their SSI tags. --gzip is
+off by default: test_wifi_asset checks that the header and the data reach
+the file system of the module byte for byte, but that the module serves a
+stored header instead of its own has not been seen on the hardware yet.
+The files of web/ are too small to gain anything anyway.
+
+    python3 tools/web_assets.py [--gzip]
+
+run from Lab3, writes web_assets.c and prints the size of every file and
+the time its bytes take on the UART at --baud (10 bits a byte). That is a
+lower bound, not a measure: the AT commands, the replies of the module and
+its writes to its own file system are not counted, and the upload time on
+the module has not been measured yet.
+"""
+
+import argparse
+import gzip
+import os
+
+TYPES = {
+    ".html": "text/html",
+    ".shtml": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".jpg": "image/jpeg",
+    ".gif": "image/gif",
+    ".ico": "image/x-icon",
+}
+
+HEADER = "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nContent-Encoding: gzip\r\n\r\n"
+
+PROLOGUE = """/**
+  ******************************************************************************
+  * @file    web_assets.c
+  * @brief   Files of the web interface, uploaded to the STM WiFi module by
+  *          ConfigureWiFi (see wifi_asset.c).
+  *
+  *          Written by tools/web_assets.py from the files in web/: do not
+  *          edit, change web/ and run it again.
+  *
+%s
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "wifi_asset.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+"""
+
+EPILOGUE = """
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+"""
+
+
+def identifier(name):
+    words = name.replace("-", ".").replace("_", ".").split(".")
+    return "Web" + "".join(w[:1].upper() + w[1:] for w in words if w)
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 12):
+        lines.append("  " + ", ".join("0x%02X" % b for b in data[i:i + 12]))
+    return ",\n".join(lines)
+
+
+def c_string(text):
+    return '"%s"' % text.replace("\\", "\\\\").replace('"', '\\"') \
+        .replace("\r", "\\r").replace("\n", "\\n")
+
+
+def build(web_dir, compress):
+    """Returns [(name, raw, stored, content type or None if not compressed)]."""
+    assets = []
+    for name in sorted(os.listdir(web_dir)):
+        path = os.path.join(web_dir, name)
+        if not os.path.isfile(path):
+            continue
+        ext = os.path.splitext(name)[1].lower()
+        if ext not in TYPES:
+            raise SystemExit("%s: unknown type, add it to TYPES" % name)
+        with open(path, "rb") as f:
+            raw = f.read()
+        ctype = None
+        stored = raw
+        if compress and ext != ".shtml":
+            packed = gzip.compress(raw, compresslevel=9, mtime=0)
+            if len(HEADER % TYPES[ext]) + len(packed) < len(raw):
+                ctype = TYPES[ext]
+                stored = packed
+        assets.append((name, raw, stored, ctype))
+    return assets
+
+
+def report(assets, baud):
+    lines = ["%-16s %7s %7s %6s %7s" % ("file", "bytes", "upload", "ratio", "wire ms")]
+    total_raw = total_up = 0
+    for name, raw, stored, ctype in assets:
+        upload = len(stored) + (len(HEADER % ctype) if ctype else 0)
+        total_raw += len(raw)
+        total_up += upload
+        lines.append("%-16s %7d %7d %5.2fx %7.1f%s" % (name, len(raw), upload, len(raw) / upload,
+                                                        wire_ms(upload, baud),
+                                                        "" if ctype else " (not compressed)"))
+    lines.append("%-16s %7d %7d %5.2fx %7.1f" % ("total", total_raw, total_up, total_raw / total_up,
+                                                 wire_ms(total_up, baud)))
+    lines.append("wire ms: bytes alone at %d baud, estimate, not measured" % baud)
+    return lines
+
+
+def wire_ms(size, baud):
+    return size * 10 * 1000.0 / baud
+
+
+def write(assets, out, baud):
+    lines = report(assets, baud)
+    body = []
+    headers = {}
+    for name, raw, stored, ctype in assets:
+        if ctype and ctype not in headers:
+            headers[ctype] = "WebHeader%d" % len(headers)
+            body.append("// Content-Type: %s, Content-Encoding: gzip" % ctype)
+            body.append("static const char %s[] =\n  %s;\n" % (headers[ctype], c_string(HEADER % ctype)))
+    for name, raw, stored, ctype in assets:
+        body.append("static const uint8_t %s[%d] =\n{\n%s\n};\n" % (identifier(name), len(stored), c_bytes(stored)))
+
+    table = []
+    for name, raw, stored, ctype in assets:
+        if ctype:
+            table.append('  WIFI_ASSET_GZIP("/%s", %s, %s)' % (name, headers[ctype], identifier(name)))
+        else:
+            table.append('  WIFI_ASSET_DATA("/%s", %s)' % (name, identifier(name)))
+    body.append("const WIFI_Asset_TypeDef WebAssets[] =\n{\n%s\n};" % ",\n".join(table))
+    body.append("const uint8_t WebAssetCount = sizeof(WebAssets) / sizeof(WebAssets[0]);")
+
+    summary = "\n".join("  *          " + line for line in lines)
+    with open(out, "w", newline="\r\n") as f:
+        f.write(PROLOGUE % summary)
+        f.write("\n".join(body) + "\n")
+        f.write(EPILOGUE)
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--web", default="web", help="directory of the files")
+    parser.add_argument("--out", default="web_assets.c")
+    parser.add_argument("--baud", type=int, default=115200, help="rate of the module UART")
+    parser.add_argument("--gzip", action="store_true", help="compress the files that gain by it")
+    args = parser.parse_args()
+
+    for line in write(build(args.web, args.gzip), args.out, args.baud):
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Host side of the binary frames of Lab3 (see wifi_frame.c).
+
+A frame is Type, Seq, Ack, payload and the CRC-32 (zlib) of all of them,
+little endian, COBS encoded between two 0x00. The payload of a data frame is
+one of the text commands of the board (lgon, lbon, reset, scan, ...).
+
+The board opens the socket (FrameChannel in main.c), so this is the server:
+
+    python3 wifi_frame.py --port 32000 lgon lbon lgoff
+
+sends the commands as data frames, up to WINDOW without waiting, and prints
+the frames received until every command has been acked.
+"""
+
+import argparse
+import socket
+import struct
+import time
+import zlib
+
+DATA = 0x01
+ACK = 0x02
+WINDOW = 4          # WIFI_FRAME_WINDOW
+TIMEOUT = 0.5       # WIFI_FRAME_TIMEOUT, s
+
+
+def cobs_encode(raw):
+    out = bytearray([0])
+    code_pos = len(out)
+    out.append(0)
+    code = 1
+    for byte in raw:
+        if byte != 0:
+            out.append(byte)
+            code += 1
+        if byte == 0 or code == 0xFF:
+            out[code_pos] = code
+            code = 1
+            code_pos = len(out)
+            out.append(0)
+    out[code_pos] = code
+    out.append(0)
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode(ftype, seq, ack, payload=b""):
+    raw = bytes([ftype, seq & 0xFF, ack & 0xFF]) + payload
+    return cobs_encode(raw + struct.pack("<I", zlib.crc32(raw)))
+
+
+def decode(data):
+    """Frame between two 0x00 (without them): (type, seq, ack, payload) or None."""
+    raw = cobs_decode(data)
+    if raw is None or len(raw) < 7:
+        return None
+    body, crc = raw[:-4], struct.unpack("<I", raw[-4:])[0]
+    if zlib.crc32(body) != crc:
+        return None
+    return body[0], body[1], body[2], body[3:]
+
+
+class Link:
+    """Go back N, the same rules as the board."""
+
+    def __init__(self, conn):
+        self.conn = conn
+        self.tx_seq = 0
+        self.tx_base = 0
+        self.rx_seq = 0
+        self.sent = {}
+        self.rx = b""
+        self.errors = 0
+
+    def send(self, payload):
+        frame = encode(DATA, self.tx_seq, self.rx_seq, payload)
+        self.sent[self.tx_seq & 0xFF] = frame
+        self.conn.sendall(frame)
+        self.tx_seq = (self.tx_seq + 1) & 0xFF
+
+    def pending(self):
+        return (self.tx_seq - self.tx_base) & 0xFF
+
+    def resend(self):
+        seq = self.tx_base
+        while seq != self.tx_seq:
+            self.conn.sendall(self.sent[seq])
+            seq = (seq + 1) & 0xFF
+
+    def receive(self, chunk):
+        self.rx += chunk
+        parts = self.rx.split(b"\0")
+        self.rx = parts.pop()
+        for part in parts:
+            if not part:
+                continue
+            frame = decode(part)
+            if frame is None:
+                self.errors += 1
+                continue
+            ftype, seq, ack, payload = frame
+            if ((ack - self.tx_base) & 0xFF) <= self.pending():
+                self.tx_base = ack
+            print("rx type %d seq %d ack %d %r" % (ftype, seq, ack, payload))
+            if ftype == DATA:
+                if seq == self.rx_seq:
+                    self.rx_seq = (self.rx_seq + 1) & 0xFF
+                self.conn.sendall(encode(ACK, self.tx_seq, self.rx_seq))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=32000)
+    parser.add_argument("commands", nargs="+")
+    args = parser.parse_args()
+
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(("", args.port))
+    server.listen(1)
+    print("waiting for the board on port %d" % args.port)
+    conn, addr = server.accept()
+    print("connected from %s:%d" % addr)
+    conn.settimeout(0.05)
+
+    link = Link(conn)
+    commands = [c.encode() for c in args.commands]
+    last = time.monotonic()
+    while commands or link.pending():
+        while commands and link.pending() < WINDOW:
+            link.send(commands.pop(0))
+        try:
+            chunk = conn.recv(256)
+            if not chunk:
+                break
+            base = link.tx_base
+            link.receive(chunk)
+            if link.tx_base != base:
+                last = time.monotonic()
+        except socket.timeout:
+            pass
+        if link.pending() and time.monotonic() - last >= TIMEOUT:
+            link.resend()
+            last = time.monotonic()
+    print("done, %d frames dropped" % link.errors)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Builds wifi_match_table.c, the automaton of wifi_match.c, from wifi_strings.h.
+
+The strings of WIFI_RX_STRINGS become an Aho-Corasick automaton: the trie
+as first-child / next-sibling lists, with the fail and dict links already
+computed. It is const and stays in flash: the MCU builds nothing at boot.
+
+    python3 tools/wifi_match.py
+
+run from Lab3, writes wifi_match_table.c and prints the size of the table.
+With --check nothing is written: the exit code tells if the table is stale.
+"""
+
+import argparse
+import re
+import sys
+
+MAX_STATES = 255    # uint8_t state numbers
+MAX_STRINGS = 64    # one bit of a WIFI_MatchMask (uint64_t) per string
+
+PROLOGUE = """/**
+  ******************************************************************************
+  * @file    wifi_match_table.c
+  * @brief   Automaton of wifi_match.c, for the strings of wifi_strings.h.
+  *
+  *          Written by tools/wifi_match.py: do not edit, change
+  *          wifi_strings.h and run it again.
+  *
+%s
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "wifi_match.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+"""
+
+EPILOGUE = """
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+"""
+
+ESCAPES = {"n": 10, "r": 13, "t": 9, "\\": 92, '"': 34, "'": 39, "a": 7, "b": 8, "f": 12, "v": 11, "?": 63}
+
+
+def c_literal(text):
+    """Bytes of one or more adjacent C string literals."""
+    data = bytearray()
+    for body in re.findall(r'"((?:[^"\\]|\\.)*)"', text):
+        i = 0
+        while i < len(body):
+            c = body[i]
+            if c != "\\":
+                data += c.encode("latin-1")
+                i += 1
+                continue
+            e = body[i + 1]
+            if e in ESCAPES:
+                data.append(ESCAPES[e])
+                i += 2
+            elif e == "x":
+                m = re.match(r"[0-9A-Fa-f]+", body[i + 2:])
+                data.append(int(m.group(0), 16) & 0xFF)
+                i += 2 + len(m.group(0))
+            else:
+                m = re.match(r"[0-7]{1,3}", body[i + 1:])
+                data.append(int(m.group(0), 8) & 0xFF)
+                i += 1 + len(m.group(0))
+    return bytes(data)
+
+
+def parse(path):
+    """Returns [(RX_xxx name, bytes)] in the order of WIFI_RX_STRINGS."""
+    with open(path, encoding="latin-1") as f:
+        source = f.read()
+    macros = {}
+    for name, value in re.findall(r'^\s*#define\s+(\w+)\s+((?:"(?:[^"\\]|\\.)*"\s*)+)', source, re.M):
+        macros[name] = c_literal(value)
+    m = re.search(r"#define\s+WIFI_RX_STRINGS\(X\)((?:[^\n]*\\\n)*[^\n]*)", source)
+    if not m:
+        raise SystemExit("%s: WIFI_RX_STRINGS not found" % path)
+    strings = []
+    for ident, value in re.findall(r"X\(\s*(\w+)\s*,\s*(\w+|\"(?:[^\"\\]|\\.)*\")\s*\)", m.group(1)):
+        if value.startswith('"'):
+            strings.append((ident, c_literal(value)))
+        elif value in macros:
+            strings.append((ident, macros[value]))
+        else:
+            raise SystemExit("%s: %s is not a string #define" % (path, value))
+    return strings
+
+
+def build(strings):
+    """The automaton as the MCU used to build it: [Byte, Child, Sibling, Fail, Dict, Out]."""
+    if len(strings) > MAX_STRINGS:
+        raise SystemExit("%d strings, at most %d" % (len(strings), MAX_STRINGS))
+    BYTE, CHILD, SIBLING, FAIL, DICT, OUT = range(6)
+    node = [[0, 0, 0, 0, 0, 0]]
+    prefix = [b""]
+
+    def child(state, byte):
+        n = node[state][CHILD]
+        while n and node[n][BYTE] != byte:
+            n = node[n][SIBLING]
+        return n
+
+    # 1. Trie, a new child goes in front of its siblings
+    for ident, (name, text) in enumerate(strings):
+        if not text:
+            raise SystemExit("%s: empty string" % name)
+        state = 0
+        for byte in text:
+            n = child(state, byte)
+            if n == 0:
+                n = len(node)
+                node.append([byte, 0, node[state][CHILD], 0, 0, 0])
+                prefix.append(prefix[state] + bytes([byte]))
+                node[state][CHILD] = n
+            state = n
+        if node[state][OUT]:
+            raise SystemExit("%s: same string as %s" % (name, strings[node[state][OUT] - 1][0]))
+        node[state][OUT] = ident + 1
+    if len(node) > MAX_STATES:
+        raise SystemExit("%d states, at most %d" % (len(node), MAX_STATES))
+
+    # 2. Fail and dict links, breadth first
+    queue = []
+    n = node[0][CHILD]
+    while n:
+        queue.append(n)
+        n = node[n][SIBLING]
+    for state in queue:
+        n = node[state][CHILD]
+        while n:
+            fail = node[state][FAIL]
+            while fail and child(fail, node[n][BYTE]) == 0:
+                fail = node[fail][FAIL]
+            node[n][FAIL] = child(fail, node[n][BYTE])
+            fail = node[n][FAIL]
+            node[n][DICT] = fail if node[fail][OUT] else node[fail][DICT]
+            queue.append(n)
+            n = node[n][SIBLING]
+    return node, prefix
+
+
+def c_char(byte):
+    if 32 <= byte < 127 and byte not in (39, 92):
+        return "'%c'" % byte
+    return "0x%02X" % byte
+
+
+def c_comment(text):
+    return '"%s"' % "".join(chr(b) if 32 <= b < 127 and b != 92 else "\\x%02X" % b for b in text)
+
+
+def render(strings, node, prefix):
+    lines = ["%d strings, %d states, %d bytes of flash" % (len(strings), len(node), 6 * len(node) + 256)]
+    body = ["const uint8_t WIFI_MatchStringCount = %d;\n" % len(strings)]
+    rows = []
+    for state, (byte, child, sibling, fail, dict_, out) in enumerate(node):
+        row = "  { %4s, %3d, %3d, %3d, %3d, %2d }" % (c_char(byte), child, sibling, fail, dict_, out)
+        note = c_comment(prefix[state])
+        if out:
+            note += " " + strings[out - 1][0]
+        rows.append((row, "// %3d %s" % (state, note)))
+    table = []
+    for index, (row, note) in enumerate(rows):
+        table.append(row + ("," if index + 1 < len(rows) else " ") + "\t" + note)
+    root = [0] * 256
+    n = node[0][1]
+    while n:
+        root[node[n][0]] = n
+        n = node[n][2]
+    body.append("// State after the root for every byte: most bytes start from the root")
+    body.append("const uint8_t WIFI_MatchRoot[256] =\n{\n%s\n};\n" % ",\n".join(
+        "  " + ", ".join("%3d" % v for v in root[i:i + 16]) for i in range(0, 256, 16)))
+    body.append("// Byte, Child, Sibling, Fail, Dict, Out: see WIFI_MatchNode_TypeDef")
+    body.append("const WIFI_MatchNode_TypeDef WIFI_MatchNode[%d] =\n{\n%s\n};" % (len(node), "\n".join(table)))
+    summary = "\n".join("  *          " + line for line in lines)
+    return PROLOGUE % summary + "\n".join(body) + "\n" + EPILOGUE, lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--strings", default="wifi_strings.h")
+    parser.add_argument("--out", default="wifi_match_table.c")
+    parser.add_argument("--check", action="store_true", help="only test that --out is up to date")
+    args = parser.parse_args()
+
+    strings = parse(args.strings)
+    node, prefix = build(strings)
+    text, lines = render(strings, node, prefix)
+    if args.check:
+        try:
+            with open(args.out, newline="") as f:
+                current = f.read().replace("\r\n", "\n")
+        except OSError:
+            current = None
+        if current != text:
+            sys.exit("%s is stale: run tools/wifi_match.py" % args.out)
+        return
+    with open(args.out, "w", newline="\r\n") as f:
+        f.write(text)
+    for line in lines:
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
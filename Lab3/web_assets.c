@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    web_assets.c
+  * @brief   Files of the web interface, uploaded to the STM WiFi module by
+  *          ConfigureWiFi (see wifi_asset.c).
+  *
+  *          Written by tools/web_assets.py from the files in web/: do not
+  *          edit, change web/ and run it again.
+  *
+  *          file               bytes  upload  ratio wire ms
+  *          led.css               57      57  1.00x     4.9 (not compressed)
+  *          led.shtml            168     168  1.00x    14.6 (not compressed)
+  *          total                225     225  1.00x    19.5
+  *          wire ms: bytes alone at 115200 baud, estimate, not measured
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "wifi_asset.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t WebLedCss[57] =
+{
+  0x62, 0x6F, 0x64, 0x79, 0x7B, 0x66, 0x6F, 0x6E, 0x74, 0x2D, 0x66, 0x61,
+  0x6D, 0x69, 0x6C, 0x79, 0x3A, 0x73, 0x61, 0x6E, 0x73, 0x2D, 0x73, 0x65,
+  0x72, 0x69, 0x66, 0x3B, 0x66, 0x6F, 0x6E, 0x74, 0x2D, 0x73, 0x69, 0x7A,
+  0x65, 0x3A, 0x31, 0x2E, 0x35, 0x65, 0x6D, 0x3B, 0x6D, 0x61, 0x72, 0x67,
+  0x69, 0x6E, 0x3A, 0x32, 0x65, 0x6D, 0x7D, 0x0D, 0x0A
+};
+
+static const uint8_t WebLedShtml[168] =
+{
+  0x3C, 0x68, 0x74, 0x6D, 0x6C, 0x3E, 0x3C, 0x68, 0x65, 0x61, 0x64, 0x3E,
+  0x3C, 0x74, 0x69, 0x74, 0x6C, 0x65, 0x3E, 0x41, 0x6E, 0x64, 0x72, 0x65,
+  0x61, 0x5F, 0x46, 0x6C, 0x6F, 0x72, 0x69, 0x64, 0x69, 0x61, 0x2D, 0x4C,
+  0x65, 0x64, 0x73, 0x2E, 0x68, 0x74, 0x6D, 0x6C, 0x3C, 0x2F, 0x74, 0x69,
+  0x74, 0x6C, 0x65, 0x3E, 0x3C, 0x6C, 0x69, 0x6E, 0x6B, 0x20, 0x72, 0x65,
+  0x6C, 0x3D, 0x22, 0x73, 0x74, 0x79, 0x6C, 0x65, 0x73, 0x68, 0x65, 0x65,
+  0x74, 0x22, 0x20, 0x68, 0x72, 0x65, 0x66, 0x3D, 0x22, 0x2F, 0x6C, 0x65,
+  0x64, 0x2E, 0x63, 0x73, 0x73, 0x22, 0x3E, 0x3C, 0x2F, 0x68, 0x65, 0x61,
+  0x64, 0x3E, 0x3C, 0x62, 0x6F, 0x64, 0x79, 0x3E, 0x20, 0x3C, 0x62, 0x72,
+  0x3E, 0x47, 0x72, 0x65, 0x65, 0x6E, 0x5F, 0x4C, 0x65, 0x64, 0x20, 0x2F,
+  0x20, 0x42, 0x6C, 0x75, 0x65, 0x5F, 0x4C, 0x65, 0x64, 0x3A, 0x20, 0x3C,
+  0x21, 0x2D, 0x2D, 0x23, 0x69, 0x6E, 0x70, 0x75, 0x74, 0x5F, 0x73, 0x73,
+  0x69, 0x2D, 0x2D, 0x3E, 0x3C, 0x62, 0x72, 0x3E, 0x3C, 0x2F, 0x62, 0x6F,
+  0x64, 0x79, 0x3E, 0x3C, 0x2F, 0x68, 0x74, 0x6D, 0x6C, 0x3E, 0x0D, 0x0A
+};
+
+const WIFI_Asset_TypeDef WebAssets[] =
+{
+  WIFI_ASSET_DATA("/led.css", WebLedCss),
+  WIFI_ASSET_DATA("/led.shtml", WebLedShtml)
+};
+const uint8_t WebAssetCount = sizeof(WebAssets) / sizeof(WebAssets[0]);
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
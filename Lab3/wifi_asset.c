@@ -0,0 +1,258 @@
+/**
+  ******************************************************************************
+  * @file    wifi_asset.c
+  * @brief   Constant files (HTML, CSS, JS, images) streamed from flash to the
+  *          file system of the STM WiFi module.
+  *
+  *          An asset table (WIFI_Asset_TypeDef) gives the name, the data and
+  *          the length of every file, computed by the compiler. A file is
+  *          created with at+s.fsc, then appended in chunks of
+  *          WIFI_ASSET_CHUNK bytes: at+s.fsa and the chunk, handed to the
+  *          USART2 TX queue straight from flash (nothing is copied in RAM).
+  *
+  *          Only one chunk is on the AT engine at a time: the next one is
+  *          queued by the callback of the OK of the previous one, so the
+  *          module is never sent more than WIFI_ASSET_CHUNK bytes ahead of
+  *          what it has written, whatever the size of the files, and the AT
+  *          queue holds one command of the upload. at+s.fsa and its chunk
+  *          are that one command, handed to the TX queue together: a
+  *          WIFI_AtAbort() cannot fall between them and leave the module
+  *          waiting for data it would take from the next commands. The OKs
+  *          are the only pacing: there is no RTS/CTS on this board, the CTS
+  *          of USART2 would be PA0, the button (see main.c).
+  *
+  *          A file can start with its own HTTP header (pHeader), that the
+  *          module sends as it is instead of making one: this is how a file
+  *          compressed with gzip is served with Content-Encoding: gzip. The
+  *          headers are shared by the files of the same type, and the chunks
+  *          are cut across the header and the data as if they were one file.
+  *          tools/web_assets.py writes such a table (web_assets.c), with
+  *          gzip files only if asked (--gzip): test_wifi_asset checks the
+  *          bytes written, but the module serving the stored header instead
+  *          of its own has not been seen on the hardware.
+  *
+  *          A failure stops the upload: the callback gets the status of the
+  *          command that failed. WIFI_AtAbort() drops the upload without
+  *          calling it.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_asset.h"
+#include "wifi_page.h"
+#include "wifi_uart.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const WIFI_AtReply_TypeDef *AssetReply;		// Answer to at+s.fsc and to a chunk: OK
+
+static const WIFI_Asset_TypeDef *AssetList;
+static uint8_t         AssetCount = 0;
+static uint8_t         AssetIndex = 0;		// File being uploaded
+static uint8_t         AssetOpen = 0;		// 1 == the file is created, its chunks follow
+static uint16_t        AssetOffset = 0;		// Bytes of the file (header and data) already written
+static uint16_t        AssetChunk = 0;		// Bytes of the chunk being sent
+static WIFI_AtCallback AssetDone = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t  WIFI_AssetNext(void);
+static void     WIFI_AssetEnd(uint8_t Status);
+static void     WIFI_AssetCreated(uint8_t Status);
+static void     WIFI_AssetWritten(uint8_t Status);
+static uint16_t WIFI_AssetSendCreate(const void *pAsset);
+static uint16_t WIFI_AssetSendAppend(const void *pAsset);
+static uint16_t WIFI_AssetSendChunk(const WIFI_Asset_TypeDef *pFile);
+static uint16_t WIFI_AssetLength(const WIFI_Asset_TypeDef *pAsset);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Sets the answer expected by the upload.
+  * @param  pReply: answer to at+s.fsc and to at+s.fsa with its chunk (the
+  *         module answers after the data). Not sent again: the file is
+  *         created again by the next upload
+  * @retval None
+  */
+void WIFI_AssetInit(const WIFI_AtReply_TypeDef *pReply)
+{
+  AssetReply = pReply;
+}
+
+/**
+  * @brief  Queues the upload of the files, replacing the one in progress.
+  * @param  pAssets: the files, in flash
+  * @param  Count: number of files
+  * @param  Callback: called with WIFI_AT_OK when the last file is written,
+  *         or with the status of the command that failed
+  * @retval PASS, or FAIL if the AT queue is full (Callback is not called)
+  */
+uint8_t WIFI_AssetUpload(const WIFI_Asset_TypeDef *pAssets, uint8_t Count, WIFI_AtCallback Callback)
+{
+  AssetList = pAssets;
+  AssetCount = Count;
+  AssetIndex = 0;
+  AssetOffset = 0;
+  AssetOpen = 0;
+  AssetDone = Callback;
+
+  if (WIFI_AssetNext() != PASS)
+  {
+    AssetDone = 0;
+    return FAIL;
+  }
+  return PASS;
+}
+
+/**
+  * @brief  Queues the next step: the creation of the next file, or its next
+  *         chunk, or the end of the upload.
+  * @param  None
+  * @retval PASS, or FAIL if the AT queue is full
+  */
+static uint8_t WIFI_AssetNext(void)
+{
+  const WIFI_Asset_TypeDef *pAsset;
+  uint16_t Left;
+
+  if (AssetIndex == AssetCount)
+  {
+    WIFI_AssetEnd(WIFI_AT_OK);
+    return PASS;
+  }
+  pAsset = &AssetList[AssetIndex];
+
+  if (AssetOpen == 0)
+    return WIFI_AtSubmitFunc(WIFI_AssetSendCreate, pAsset, AssetReply, WIFI_AssetCreated);
+
+  Left = WIFI_AssetLength(pAsset) - AssetOffset;
+  AssetChunk = (Left < WIFI_ASSET_CHUNK) ? Left : WIFI_ASSET_CHUNK;
+  return WIFI_AtSubmitFunc(WIFI_AssetSendAppend, pAsset, AssetReply, WIFI_AssetWritten);
+}
+
+/**
+  * @brief  Ends the upload and calls its callback, once.
+  * @param  Status: WIFI_AT_OK or the failure
+  * @retval None
+  */
+static void WIFI_AssetEnd(uint8_t Status)
+{
+  WIFI_AtCallback Callback = AssetDone;
+
+  AssetDone = 0;
+  if (Callback != 0)
+    Callback(Status);
+}
+
+/**
+  * @brief  Answer to at+s.fsc: the first chunk follows. An empty file is
+  *         done.
+  * @param  Status: WIFI_AT_xxx
+  * @retval None
+  */
+static void WIFI_AssetCreated(uint8_t Status)
+{
+  if (Status != WIFI_AT_OK)
+  {
+    WIFI_AssetEnd(Status);
+    return;
+  }
+  AssetOpen = (WIFI_AssetLength(&AssetList[AssetIndex]) != 0);
+  if (AssetOpen == 0)
+    AssetIndex++;
+  if (WIFI_AssetNext() != PASS)
+    WIFI_AssetEnd(WIFI_AT_ERROR);
+}
+
+/**
+  * @brief  Answer to a chunk: the next one follows.
+  * @param  Status: WIFI_AT_xxx
+  * @retval None
+  */
+static void WIFI_AssetWritten(uint8_t Status)
+{
+  if (Status != WIFI_AT_OK)
+  {
+    WIFI_AssetEnd(Status);
+    return;
+  }
+  AssetOffset += AssetChunk;
+  if (AssetOffset == WIFI_AssetLength(&AssetList[AssetIndex]))
+  {
+    AssetIndex++;
+    AssetOffset = 0;
+    AssetOpen = 0;
+  }
+  if (WIFI_AssetNext() != PASS)
+    WIFI_AssetEnd(WIFI_AT_ERROR);
+}
+
+/**
+  * @brief  Sends at+s.fsc=<name>,<length>: creates the file.
+  * @param  pAsset: the file (WIFI_Asset_TypeDef)
+  * @retval WIFI_TxSubmit ticket
+  */
+static uint16_t WIFI_AssetSendCreate(const void *pAsset)
+{
+  const WIFI_Asset_TypeDef *pFile = pAsset;
+
+  return WIFI_PageSendFileCmd("at+s.fsc=", pFile->pName, WIFI_AssetLength(pFile));
+}
+
+/**
+  * @brief  Sends at+s.fsa=<name>,<length of the chunk> and the chunk.
+  * @param  pAsset: the file (WIFI_Asset_TypeDef)
+  * @retval WIFI_TxSubmit ticket of the last piece, WIFI_TX_FAIL if the TX
+  *         queue is full
+  */
+static uint16_t WIFI_AssetSendAppend(const void *pAsset)
+{
+  const WIFI_Asset_TypeDef *pFile = pAsset;
+
+  // The command and its chunk or nothing: the command alone would take what follows as data
+  if (WIFI_TxFree() < 3)
+    return WIFI_TX_FAIL;
+  if (WIFI_PageSendFileCmd("at+s.fsa=", pFile->pName, AssetChunk) == WIFI_TX_FAIL)
+    return WIFI_TX_FAIL;
+  return WIFI_AssetSendChunk(pFile);
+}
+
+/**
+  * @brief  Sends the chunk, from flash: the end of the header, the data or
+  *         both. The TX queue has room for both pieces.
+  * @param  pFile: the file
+  * @retval WIFI_TxSubmit ticket of the last piece
+  */
+static uint16_t WIFI_AssetSendChunk(const WIFI_Asset_TypeDef *pFile)
+{
+  uint16_t Offset = AssetOffset;
+  uint16_t Left = AssetChunk;
+  uint16_t Length;
+  uint16_t Ticket = WIFI_TX_FAIL;
+
+  if (Offset < pFile->HeaderLength)
+  {
+    Length = pFile->HeaderLength - Offset;
+    if (Length > Left)
+      Length = Left;
+    Ticket = WIFI_TxSubmit((const uint8_t *)pFile->pHeader + Offset, Length, 0);
+    Offset += Length;
+    Left -= Length;
+  }
+  if (Left != 0)
+    Ticket = WIFI_TxSubmit(pFile->pData + (Offset - pFile->HeaderLength), Left, 0);
+
+  return Ticket;
+}
+
+/**
+  * @brief  Length of the file written on the module.
+  * @param  pAsset: the file
+  * @retval Bytes of the header and of the data
+  */
+static uint16_t WIFI_AssetLength(const WIFI_Asset_TypeDef *pAsset)
+{
+  return pAsset->HeaderLength + pAsset->Length;
+}
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    wifi_asset.h
+  * @brief   Header for wifi_asset.c: constant files (HTML, CSS, JS, images)
+  *          streamed from flash to the file system of the STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_ASSET_H
+#define __WIFI_ASSET_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+#include "wifi_at.h"
+
+/* Exported types ------------------------------------------------------------*/
+// One file, all in flash: the length is known at compile time. The file written on the
+// module is pHeader followed by pData
+typedef struct
+{
+  const char    *pName;		// File name on the module, e.g. "/led.css"
+  const uint8_t *pData;
+  uint16_t       Length;		// Bytes of pData, it can contain 0s
+  const char    *pHeader;	// HTTP header sent by the module as it is, 0 == none (the module makes it)
+  uint16_t       HeaderLength;
+} WIFI_Asset_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_ASSET_CHUNK		256		// Bytes appended by one at+s.fsa, each one waits for its OK
+
+/* Exported macro ------------------------------------------------------------*/
+#define WIFI_ASSET_TEXT(name, s)		{ (name), (const uint8_t *)(s), sizeof(s) - 1, 0, 0 }	// s: string literal or char array, without its 0
+#define WIFI_ASSET_DATA(name, a)		{ (name), (a), sizeof(a), 0, 0 }											// a must be an array
+// a compressed with gzip, h the header that announces it (Content-Encoding: gzip), a char array
+#define WIFI_ASSET_GZIP(name, h, a)	{ (name), (a), sizeof(a), (h), sizeof(h) - 1 }
+
+/* Exported variables --------------------------------------------------------*/
+// The files of the web interface, see web_assets.c
+extern const WIFI_Asset_TypeDef WebAssets[];
+extern const uint8_t            WebAssetCount;
+
+/* Exported functions ------------------------------------------------------- */
+void    WIFI_AssetInit(const WIFI_AtReply_TypeDef *pReply);
+uint8_t WIFI_AssetUpload(const WIFI_Asset_TypeDef *pAssets, uint8_t Count, WIFI_AtCallback Callback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_ASSET_H */
@@ -0,0 +1,459 @@
+/**
+  ******************************************************************************
+  * @file    wifi_at.c
+  * @brief   Non blocking AT command engine for the STM WiFi module.
+  *
+  *          The commands are queued with WIFI_AtSubmit() together with the
+  *          answer they expect (WIFI_AtReply_TypeDef) and are sent by
+  *          WIFI_AtProcess(), which must be called from the main loop.
+  *          It never waits: it sends the next command, checks the strings
+  *          found by WIFI_MatchPoll() and the timeout, then returns. A
+  *          command that finds the USART2 TX queue full is sent again at the
+  *          next call.
+  *
+  *          Only the answers received after a command has been sent are
+  *          considered (the stream position is compared), so an old "OK"
+  *          still in the RxBuffer cannot complete a new command.
+  *
+  *          Consecutive commands whose reply has the WIFI_AT_PIPELINE flag
+  *          are sent back to back, up to WIFI_AT_PIPELINE_DEPTH, without
+  *          waiting for the answers in between. The module answers in order,
+  *          so the n-th answer belongs to the n-th command of the window; the
+  *          timeout restarts at every answer. The Delay after the answer is
+  *          waited once, at the end of the window.
+  *
+  *          On error or timeout the window is sent again starting from the
+  *          first command that failed (the settings are idempotent, so the
+  *          ones that succeeded after it can be repeated). Only that command
+  *          is charged with the failure: after Retries failures of its own
+  *          its callback gets the failure and the commands still in the
+  *          queue are dropped, since they usually depend on it.
+  *
+  *          The queue holds WIFI_AT_QUEUE_SIZE - 1 commands. A sequence queued
+  *          between WIFI_AtBegin() and WIFI_AtEnd() goes in whole or not at
+  *          all, so a full queue never drops the command whose callback ends
+  *          the sequence.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_at.h"
+#include "wifi_match.h"
+#include "wifi_uart.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const void                 *pData;		// Buffer, or argument of Send
+  uint16_t                    Length;
+  WIFI_AtSendFunc             Send;			// 0 == send Length bytes of pData
+  const WIFI_AtReply_TypeDef *pReply;
+  WIFI_AtCallback             Callback;
+  uint8_t                     Failures;	// Errors and timeouts of this command
+  uint8_t                     Status;		// WIFI_AT_xxx, WIFI_AT_TIMEOUT until answered
+} WIFI_AtCmd_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define WIFI_AT_QUEUE_MASK		(WIFI_AT_QUEUE_SIZE - 1)
+
+// States of the engine
+#define AT_IDLE								0		// Nothing sent
+#define AT_WAIT								1		// Window sent, waiting for the answers
+#define AT_DELAY							2		// All answered, waiting Delay ms
+#define AT_SEND								3		// Window being sent, the TX queue was full
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static WIFI_AtCmd_TypeDef AtQueue[WIFI_AT_QUEUE_SIZE];
+static uint8_t  AtHead = 0;				// First command of the window
+static uint8_t  AtTail = 0;				// First free slot
+static uint8_t  AtState = AT_IDLE;
+static uint8_t  AtSent = 0;				// Commands in the window
+static uint8_t  AtAnswered = 0;		// Commands of the window answered, in order
+static uint8_t  AtSeen = 0;				// AtAnswered at the last timeout restart
+static uint16_t AtTicket = 0;			// WIFI_TxSubmit ticket of the last command sent
+static uint32_t AtSentPos = 0;		// Stream position from which the answers count
+static uint32_t AtDeadline = 0;		// Time limit of the current state
+static uint32_t AtSentTime = 0;		// When the window was sent
+static uint8_t  AtMark = 0;				// AtTail at WIFI_AtBegin
+static uint8_t  AtLost = 0;				// 1 == a command has been refused since WIFI_AtBegin
+static WIFI_AtMonitor AtMonitor = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static void WIFI_AtSend(uint32_t Now);
+static void WIFI_AtSendMore(uint32_t Now);
+static void WIFI_AtCheck(uint32_t Now);
+static void WIFI_AtComplete(void);
+static void WIFI_AtRestartTimeout(uint32_t Now);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Empties the queue. WIFI_AtMatchHandler() must be called by the
+  *         handler set with WIFI_MatchSetHandler().
+  * @param  None
+  * @retval None
+  */
+void WIFI_AtInit(void)
+{
+  AtHead = 0;
+  AtTail = 0;
+  AtMark = 0;
+  AtLost = 0;
+  AtState = AT_IDLE;
+}
+
+/**
+  * @brief  Starts a sequence of commands that are queued all or none: see
+  *         WIFI_AtEnd().
+  * @param  None
+  * @retval None
+  */
+void WIFI_AtBegin(void)
+{
+  AtMark = AtTail;
+  AtLost = 0;
+}
+
+/**
+  * @brief  Ends the sequence started by WIFI_AtBegin(). If the queue refused
+  *         one of its commands, the ones queued before it are removed too:
+  *         a sequence with a hole would run its commands out of context and
+  *         never call its last callback.
+  * @param  None
+  * @retval PASS if all the commands are queued, FAIL if none is (no callback
+  *         of the sequence will be called)
+  */
+uint8_t WIFI_AtEnd(void)
+{
+  if (AtLost == 0)
+    return PASS;
+
+  AtLost = 0;
+  AtTail = AtMark;
+  return FAIL;
+}
+
+/**
+  * @brief  Queues a command. The buffers are not copied.
+  * @param  pData: command (or data) to send
+  * @param  Length: number of bytes to send
+  * @param  pReply: expected answer
+  * @param  Callback: called with the result, can be 0
+  * @retval PASS, or FAIL if the queue is full
+  */
+uint8_t WIFI_AtSubmit(const uint8_t *pData, uint16_t Length, const WIFI_AtReply_TypeDef *pReply, WIFI_AtCallback Callback)
+{
+  if (((AtTail + 1) & WIFI_AT_QUEUE_MASK) == AtHead)
+  {
+    AtLost = 1;
+    return FAIL;
+  }
+
+  AtQueue[AtTail].pData = pData;
+  AtQueue[AtTail].Length = Length;
+  AtQueue[AtTail].Send = 0;
+  AtQueue[AtTail].pReply = pReply;
+  AtQueue[AtTail].Callback = Callback;
+  AtQueue[AtTail].Failures = 0;
+  AtTail = (AtTail + 1) & WIFI_AT_QUEUE_MASK;
+
+  return PASS;
+}
+
+/**
+  * @brief  Queues a command described by a WIFI_AtCommand_TypeDef.
+  * @param  pCmd: the command and its expected answer
+  * @param  Callback: called with the result, can be 0
+  * @retval PASS, or FAIL if the queue is full
+  */
+uint8_t WIFI_AtSubmitCmd(const WIFI_AtCommand_TypeDef *pCmd, WIFI_AtCallback Callback)
+{
+  return WIFI_AtSubmit(pCmd->pCmd, pCmd->Length, pCmd->pReply, Callback);
+}
+
+/**
+  * @brief  Queues a command whose bytes are produced by a function when it is
+  *         sent (e.g. a page built from a template with the current values).
+  * @param  Send: function that submits the bytes to WIFI_TxSubmit()
+  * @param  pArg: argument of Send
+  * @param  pReply: expected answer
+  * @param  Callback: called with the result, can be 0
+  * @retval PASS, or FAIL if the queue is full
+  */
+uint8_t WIFI_AtSubmitFunc(WIFI_AtSendFunc Send, const void *pArg, const WIFI_AtReply_TypeDef *pReply, WIFI_AtCallback Callback)
+{
+  if (WIFI_AtSubmit(pArg, 0, pReply, Callback) == FAIL)
+    return FAIL;
+
+  AtQueue[(AtTail - 1) & WIFI_AT_QUEUE_MASK].Send = Send;
+  return PASS;
+}
+
+/**
+  * @brief  Advances the engine. Never blocks.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+void WIFI_AtProcess(uint32_t Now)
+{
+  const WIFI_AtReply_TypeDef *pReply;
+  uint8_t Index;
+
+  // Feed the new bytes to the matcher: WIFI_AtMatchHandler collects the answers
+  WIFI_MatchPoll();
+
+  switch (AtState)
+  {
+    case AT_IDLE:
+      if (AtHead != AtTail)
+        WIFI_AtSend(Now);
+      break;
+
+    case AT_SEND:
+      WIFI_AtSendMore(Now);
+      break;
+
+    case AT_WAIT:
+      pReply = AtQueue[AtHead].pReply;
+      if ((pReply->Expect == 0) && WIFI_TxDone(AtTicket))
+      {
+        AtQueue[AtHead].Status = WIFI_AT_OK;
+        AtAnswered = AtSent;
+      }
+      if (AtAnswered != AtSeen)
+      {
+        if (AtMonitor != 0)
+        {
+          for (Index = AtSeen; Index < AtAnswered; Index++)
+            AtMonitor(AtQueue[(AtHead + Index) & WIFI_AT_QUEUE_MASK].Status, Now - AtSentTime);
+        }
+        // Every answer gives the next command of the window its own timeout
+        AtSeen = AtAnswered;
+        WIFI_AtRestartTimeout(Now);
+      }
+      if ((AtAnswered == AtSent) || ((int32_t)(Now - AtDeadline) >= 0))
+        WIFI_AtCheck(Now);
+      break;
+
+    case AT_DELAY:
+      if ((int32_t)(Now - AtDeadline) >= 0)
+        WIFI_AtComplete();
+      break;
+
+    default:
+      AtState = AT_IDLE;
+      break;
+  }
+}
+
+/**
+  * @brief  Drops the commands in progress and the queued ones, without
+  *         calling their callbacks.
+  * @param  None
+  * @retval None
+  */
+void WIFI_AtAbort(void)
+{
+  AtHead = AtTail;
+  AtMark = AtTail;		// a sequence in progress has nothing to remove
+  AtState = AT_IDLE;
+}
+
+/**
+  * @brief  Tests if there are commands queued or in progress.
+  * @param  None
+  * @retval 1 if busy, 0 otherwise
+  */
+uint8_t WIFI_AtBusy(void)
+{
+  return (AtState != AT_IDLE) || (AtHead != AtTail);
+}
+
+/**
+  * @brief  Starts a window: the command at AtHead and, if it is pipelined,
+  *         the following pipelined ones.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+static void WIFI_AtSend(uint32_t Now)
+{
+  // Answers count from the first byte received after this point
+  AtSentPos = WIFI_RxReadCount() + WIFI_RxAvailable();
+  AtSent = 0;
+  AtAnswered = 0;
+  AtSeen = 0;
+  AtSentTime = Now;
+  AtState = AT_SEND;
+
+  WIFI_AtSendMore(Now);
+}
+
+/**
+  * @brief  Sends the commands of the window not sent yet. A command refused
+  *         by the full TX queue is sent again by the next WIFI_AtProcess.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+static void WIFI_AtSendMore(uint32_t Now)
+{
+  WIFI_AtCmd_TypeDef *pCmd;
+  uint16_t Ticket;
+  uint8_t  Index;
+
+  while (AtState == AT_SEND)
+  {
+    pCmd = &AtQueue[(AtHead + AtSent) & WIFI_AT_QUEUE_MASK];
+    if (pCmd->Send != 0)
+      Ticket = pCmd->Send(pCmd->pData);
+    else
+      Ticket = WIFI_TxSubmit(pCmd->pData, pCmd->Length, 0);
+    if (Ticket == WIFI_TX_FAIL)
+      return;
+
+    AtTicket = Ticket;
+    pCmd->Status = WIFI_AT_TIMEOUT;
+    AtSent++;
+
+    Index = (AtHead + AtSent) & WIFI_AT_QUEUE_MASK;
+    if (((pCmd->pReply->Flags & WIFI_AT_PIPELINE) == 0) || (Index == AtTail) ||
+        ((AtQueue[Index].pReply->Flags & WIFI_AT_PIPELINE) == 0) || (AtSent == WIFI_AT_PIPELINE_DEPTH))
+    {
+      WIFI_AtRestartTimeout(Now);
+      AtState = AT_WAIT;
+    }
+  }
+}
+
+/**
+  * @brief  Starts the timeout of the oldest command of the window not
+  *         answered, with its own Timeout: the one it waits for.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+static void WIFI_AtRestartTimeout(uint32_t Now)
+{
+  uint8_t Index = AtAnswered;
+
+  if (Index == AtSent)
+    Index--;		// all answered, WIFI_AtCheck follows at once
+  AtDeadline = Now + AtQueue[(AtHead + Index) & WIFI_AT_QUEUE_MASK].pReply->Timeout;
+}
+
+/**
+  * @brief  The window is answered or timed out: completes the commands that
+  *         succeeded before the first failure, then retries or fails it.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+static void WIFI_AtCheck(uint32_t Now)
+{
+  WIFI_AtCmd_TypeDef *pCmd;
+  WIFI_AtCallback Callback;
+  uint8_t Index;
+
+  for (Index = 0; Index < AtSent; Index++)
+  {
+    if (AtQueue[(AtHead + Index) & WIFI_AT_QUEUE_MASK].Status != WIFI_AT_OK)
+      break;
+  }
+
+  if (Index == AtSent)
+  {
+    // All answered OK: wait the Delay of the last one
+    AtState = AT_DELAY;
+    AtDeadline = Now + AtQueue[(AtHead + AtSent - 1) & WIFI_AT_QUEUE_MASK].pReply->Delay;
+    return;
+  }
+
+  // The first command not answered has timed out (the errors are told with the answer)
+  if ((AtMonitor != 0) && (AtQueue[(AtHead + Index) & WIFI_AT_QUEUE_MASK].Status == WIFI_AT_TIMEOUT))
+    AtMonitor(WIFI_AT_TIMEOUT, Now - AtSentTime);
+
+  // The answers have been used: drop what has been scanned up to now
+  WIFI_MatchConsume();
+
+  // Commands before the first failure are done
+  while (Index--)
+  {
+    Callback = AtQueue[AtHead].Callback;
+    AtHead = (AtHead + 1) & WIFI_AT_QUEUE_MASK;
+    if (Callback != 0)
+      Callback(WIFI_AT_OK);
+  }
+
+  // Only the command that failed is charged: the ones after it are sent again
+  //   because they were in its window, not because they failed
+  AtState = AT_IDLE;
+  pCmd = &AtQueue[AtHead];
+  pCmd->Failures++;
+  if (pCmd->Failures <= pCmd->pReply->Retries)
+    return;		// sent again, from this command, by the next WIFI_AtProcess
+
+  Callback = pCmd->Callback;
+  AtHead = AtTail;
+  if (Callback != 0)
+    Callback(pCmd->Status);
+}
+
+/**
+  * @brief  Ends the window with success and calls the callbacks in order.
+  * @param  None
+  * @retval None
+  */
+static void WIFI_AtComplete(void)
+{
+  WIFI_AtCallback Callback;
+
+  // The answers have been used: drop what has been scanned up to now
+  WIFI_MatchConsume();
+  AtState = AT_IDLE;
+
+  while (AtSent--)
+  {
+    Callback = AtQueue[AtHead].Callback;
+    AtHead = (AtHead + 1) & WIFI_AT_QUEUE_MASK;
+    if (Callback != 0)
+      Callback(WIFI_AT_OK);
+  }
+}
+
+/**
+  * @brief  Called by WIFI_MatchPoll() for every string found in the RxBuffer:
+  *         gives the answer to the oldest command of the window not answered.
+  * @param  Id: index of the string, or WIFI_MATCH_EOL
+  * @param  Pos: stream position of the last byte of the string
+  * @retval None
+  */
+void WIFI_AtMatchHandler(uint8_t Id, uint32_t Pos)
+{
+  WIFI_AtCmd_TypeDef *pCmd;
+
+  if (((AtState != AT_WAIT) && (AtState != AT_SEND)) || (AtAnswered == AtSent) || (Id == WIFI_MATCH_EOL) ||
+      ((int32_t)(Pos - AtSentPos) < 0))
+    return;
+
+  pCmd = &AtQueue[(AtHead + AtAnswered) & WIFI_AT_QUEUE_MASK];
+  if (pCmd->pReply->Expect & WIFI_MATCH_BIT(Id))
+  {
+    pCmd->Status = WIFI_AT_OK;
+    AtAnswered++;
+  }
+  else if (pCmd->pReply->Error & WIFI_MATCH_BIT(Id))
+  {
+    pCmd->Status = WIFI_AT_ERROR;
+    AtAnswered++;
+  }
+}
+
+/**
+  * @brief  Sets the function told of the answers, to measure the round trip
+  *         of the commands.
+  * @param  Monitor: the function, 0 == none
+  * @retval None
+  */
+void WIFI_AtSetMonitor(WIFI_AtMonitor Monitor)
+{
+  AtMonitor = Monitor;
+}
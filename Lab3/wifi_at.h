@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    wifi_at.h
+  * @brief   Header for wifi_at.c: non blocking AT command engine for the
+  *          STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_AT_H
+#define __WIFI_AT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+#include "wifi_match.h"
+
+/* Exported types ------------------------------------------------------------*/
+// What the module must answer to a command
+typedef struct
+{
+  WIFI_MatchMask Expect;	// Strings (WIFI_MATCH_BIT) that complete the command, 0 == done once sent
+  WIFI_MatchMask Error;		// Strings that fail the command
+  uint16_t Timeout;		// ms to wait for the answer
+  uint16_t Delay;			// ms to wait after the answer, before the next command
+  uint8_t  Retries;		// How many times the command is sent again on error or timeout
+  uint8_t  Flags;			// WIFI_AT_PIPELINE or 0
+} WIFI_AtReply_TypeDef;
+
+// Called when a command is completed, Status is one of WIFI_AT_xxx
+typedef void (*WIFI_AtCallback)(uint8_t Status);
+
+// An AT command and the answer it expects, to be kept in flash
+typedef struct
+{
+  const uint8_t              *pCmd;
+  uint16_t                    Length;	// Bytes to send
+  const WIFI_AtReply_TypeDef *pReply;
+} WIFI_AtCommand_TypeDef;
+
+// Sends a command built when it is its turn, returns the WIFI_TxSubmit ticket of its last buffer.
+// WIFI_TX_FAIL == the TX queue is full: it is called again, with the same pArg, by the next
+// WIFI_AtProcess, so it must submit all its buffers or remember how far it went
+typedef uint16_t (*WIFI_AtSendFunc)(const void *pArg);
+
+// Told of every answer (and timeout) with the ms elapsed since its window was sent
+typedef void (*WIFI_AtMonitor)(uint8_t Status, uint32_t Elapsed);
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_AT_QUEUE_SIZE		16		// Power of 2, holds WIFI_AT_QUEUE_SIZE - 1 pending commands
+#define WIFI_AT_PIPELINE_DEPTH	8		// Commands sent without waiting for their answers
+
+// WIFI_AtReply_TypeDef Flags
+#define WIFI_AT_PIPELINE			0x01	// Consecutive commands with this flag are sent back to back
+
+#define WIFI_AT_OK						0
+#define WIFI_AT_ERROR					1
+#define WIFI_AT_TIMEOUT				2
+
+/* Exported macro ------------------------------------------------------------*/
+// Descriptor of the string literal s: WIFI_AT_COMMAND sends the final 0 too (as all the
+// commands always did), WIFI_AT_DATA does not (headers and data whose length is announced)
+#define WIFI_AT_COMMAND(s, reply)		{ (const uint8_t *)(s), sizeof(s), (reply) }
+#define WIFI_AT_DATA(s, reply)			{ (const uint8_t *)(s), sizeof(s) - 1, (reply) }
+// Fails the compilation if a sequence of Count commands cannot fit in the empty queue
+#define WIFI_AT_FITS(Name, Count)		typedef char Name[((Count) <= WIFI_AT_QUEUE_SIZE - 1) ? 1 : -1]
+/* Exported functions ------------------------------------------------------- */
+void    WIFI_AtInit(void);
+void    WIFI_AtBegin(void);
+uint8_t WIFI_AtEnd(void);
+uint8_t WIFI_AtSubmit(const uint8_t *pData, uint16_t Length, const WIFI_AtReply_TypeDef *pReply, WIFI_AtCallback Callback);
+uint8_t WIFI_AtSubmitCmd(const WIFI_AtCommand_TypeDef *pCmd, WIFI_AtCallback Callback);
+uint8_t WIFI_AtSubmitFunc(WIFI_AtSendFunc Send, const void *pArg, const WIFI_AtReply_TypeDef *pReply, WIFI_AtCallback Callback);
+void    WIFI_AtProcess(uint32_t Now);
+void    WIFI_AtAbort(void);
+uint8_t WIFI_AtBusy(void);
+void    WIFI_AtMatchHandler(uint8_t Id, uint32_t Pos);
+void    WIFI_AtSetMonitor(WIFI_AtMonitor Monitor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_AT_H */
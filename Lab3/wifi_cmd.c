@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file    wifi_cmd.c
+  * @brief   Registry of the strings received from the STM WiFi module (web
+  *          commands, module messages, AT answers) and dispatch of their
+  *          handlers.
+  *
+  *          The registry is a const table of WIFI_Cmd_TypeDef in the order
+  *          of the strings of the automaton (wifi_match_table.c): the Id
+  *          that WIFI_MatchPoll() reports for a string is the index of its
+  *          entry, a perfect hash computed when the table is generated. A
+  *          handler is found in one step, whatever the number of commands.
+  *
+  *          Every entry has two handlers:
+  *          - OnScan, called by WIFI_CmdScan() from the match handler, as
+  *            soon as the string is scanned (it must not block);
+  *          - Execute, called by WIFI_CmdDispatch() from the main loop. It
+  *            consumes the RxBuffer, so one runs per call, the lowest Id
+  *            first: the Ids give the priority.
+  *          A command received in a binary frame is posted with
+  *          WIFI_CmdPost() and dispatched as if received as text. Only the
+  *          entries flagged WIFI_CMD_REMOTE (WIFI_CMD_WEB) can be posted:
+  *          a peer on the socket must not fake the messages of the module.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_cmd.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const WIFI_Cmd_TypeDef *CmdTable = 0;
+static uint8_t  CmdCount = 0;
+static WIFI_MatchMask CmdExecuteMask = 0;	// Entries with an Execute function
+static WIFI_MatchMask CmdPending = 0;			// Entries posted by WIFI_CmdPost
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Sets the registry and checks that the automaton is the one of its
+  *         strings.
+  * @param  pCmds: the registry, it must stay valid (const table in flash)
+  * @param  Count: number of entries
+  * @retval PASS, or FAIL if wifi_match_table.c was generated from other
+  *         strings (see WIFI_MatchInit)
+  */
+uint8_t WIFI_CmdInit(const WIFI_Cmd_TypeDef *pCmds, uint8_t Count)
+{
+  uint8_t Id;
+
+  CmdTable = pCmds;
+  CmdCount = Count;
+  CmdExecuteMask = 0;
+  CmdPending = 0;
+  for (Id = 0; Id < Count; Id++)
+  {
+    if (pCmds[Id].Execute != 0)
+      CmdExecuteMask |= WIFI_MATCH_BIT(Id);
+  }
+  return WIFI_MatchInit(&pCmds[0].Token, sizeof(pCmds[0]), Count);
+}
+
+/**
+  * @brief  Calls the OnScan function of a string. To be called by the match
+  *         handler (see WIFI_MatchSetHandler).
+  * @param  Id: index of the string, or WIFI_MATCH_EOL
+  * @param  Pos: stream position of the last byte of the string
+  * @retval 1 if a function has been called, 0 if the string has none
+  */
+uint8_t WIFI_CmdScan(uint8_t Id, uint32_t Pos)
+{
+  if ((Id >= CmdCount) || (CmdTable[Id].OnScan == 0))
+    return 0;
+
+  CmdTable[Id].OnScan(Pos);
+  return 1;
+}
+
+/**
+  * @brief  Executes the command of the lowest Id found in the RxBuffer or
+  *         posted. If there is none, what has been scanned is consumed, so
+  *         the RxBuffer does not fill up.
+  * @param  None
+  * @retval Id of the command executed, WIFI_CMD_NONE if none
+  */
+uint8_t WIFI_CmdDispatch(void)
+{
+  // Only the bytes received since the previous call are scanned, the strings found
+  // before are remembered. What is received meanwhile is tested at the next call
+  WIFI_MatchMask Found = (WIFI_MatchPoll() | CmdPending) & CmdExecuteMask;
+  uint8_t  Id;
+
+  if (Found == 0)
+  {
+    WIFI_MatchConsume();
+    return WIFI_CMD_NONE;
+  }
+
+  Id = WIFI_MatchFirst(Found);
+  CmdPending &= ~WIFI_MATCH_BIT(Id);
+  CmdTable[Id].Execute();
+  return Id;
+}
+
+/**
+  * @brief  Calls OnScan now and leaves Execute to the next WIFI_CmdDispatch,
+  *         as for a string received as text (from a binary frame).
+  * @param  Id: index of the string, its entry must be flagged WIFI_CMD_REMOTE
+  * @retval PASS, or FAIL if the entry cannot be posted: nothing is called
+  */
+uint8_t WIFI_CmdPost(uint8_t Id)
+{
+  if ((Id >= CmdCount) || !(CmdTable[Id].Flags & WIFI_CMD_REMOTE))
+    return FAIL;
+
+  WIFI_CmdScan(Id, 0);
+  if (CmdTable[Id].Execute != 0)
+    CmdPending |= WIFI_MATCH_BIT(Id);
+  return PASS;
+}
+
+/**
+  * @brief  Tests if commands have been posted and not dispatched yet.
+  * @param  None
+  * @retval 1 if some are waiting, 0 otherwise
+  */
+uint8_t WIFI_CmdPending(void)
+{
+  return CmdPending != 0;
+}
+
+/**
+  * @brief  Finds the string equal to a whole buffer, with the automaton.
+  * @param  pData: the bytes
+  * @param  Length: number of bytes
+  * @retval Id of the string, WIFI_CMD_NONE if the bytes are not one of them
+  */
+uint8_t WIFI_CmdLookup(const uint8_t *pData, uint16_t Length)
+{
+  uint8_t  State = 0;
+  uint16_t Index;
+  WIFI_MatchMask Mask;
+  uint8_t  Id;
+
+  for (Index = 0; Index < Length; Index++)
+    State = WIFI_MatchStep(State, pData[Index]);
+
+  // The strings that end here: only one can be as long as the buffer
+  for (Mask = WIFI_MatchOut(State); Mask != 0; Mask &= Mask - 1)
+  {
+    Id = WIFI_MatchFirst(Mask);
+    if ((Id < CmdCount) && (CmdTable[Id].Token.Length == Length))
+      return Id;
+  }
+  return WIFI_CMD_NONE;
+}
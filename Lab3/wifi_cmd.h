@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    wifi_cmd.h
+  * @brief   Header for wifi_cmd.c: registry of the strings received from the
+  *          STM WiFi module and dispatch of their handlers.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_CMD_H
+#define __WIFI_CMD_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+#include "wifi_match.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*WIFI_CmdScanFunc)(uint32_t Pos);	// Pos: stream position of the last byte of the string
+typedef void (*WIFI_CmdFunc)(void);
+
+// Entry of the registry: the index of the entry is the Id of its string
+typedef struct
+{
+  WIFI_MatchString_TypeDef Token;	// must be the first member, see WIFI_MatchInit
+  WIFI_CmdScanFunc OnScan;				// called by WIFI_CmdScan as soon as the string is scanned, 0 == none
+  WIFI_CmdFunc     Execute;				// called by WIFI_CmdDispatch, it must consume the RxBuffer, 0 == none
+  uint8_t          Flags;					// WIFI_CMD_REMOTE or 0
+} WIFI_Cmd_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_CMD_NONE					0xFF		// Returned by WIFI_CmdLookup
+#define WIFI_CMD_REMOTE				0x01		// A peer may send it in a frame, see WIFI_CmdPost
+
+/* Exported macro ------------------------------------------------------------*/
+#define WIFI_CMD(s, OnScan, Execute)			{ WIFI_MATCH_STRING(s), (OnScan), (Execute), 0 }
+// A command of the web interface, accepted from a frame too
+#define WIFI_CMD_WEB(s, OnScan, Execute)	{ WIFI_MATCH_STRING(s), (OnScan), (Execute), WIFI_CMD_REMOTE }
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t WIFI_CmdInit(const WIFI_Cmd_TypeDef *pCmds, uint8_t Count);
+uint8_t WIFI_CmdScan(uint8_t Id, uint32_t Pos);
+uint8_t WIFI_CmdDispatch(void);
+uint8_t WIFI_CmdPost(uint8_t Id);
+uint8_t WIFI_CmdPending(void);
+uint8_t WIFI_CmdLookup(const uint8_t *pData, uint16_t Length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_CMD_H */
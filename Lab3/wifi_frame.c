@@ -0,0 +1,434 @@
+/**
+  ******************************************************************************
+  * @file    wifi_frame.c
+  * @brief   Binary frames carried over a socket of the STM WiFi module, next
+  *          to the AT text.
+  *
+  *          A frame is Type, Seq, Ack, payload and the CRC-32 of all of them,
+  *          COBS encoded so that it contains no 0x00, between two 0x00. The
+  *          module never sends 0x00 in its text, so the matcher finds the
+  *          delimiters in the same pass as the other strings and the frame is
+  *          decoded straight from the RxBuffer: the cost depends only on the
+  *          length of the frame. The bytes of the open frame are kept in the
+  *          RxBuffer (WIFI_MatchKeep) until it is closed, so a frame split
+  *          between two polls of the main loop is not consumed half way.
+  *          The CRC is computed by the CRC unit, set up as the usual CRC-32
+  *          (zlib, Ethernet).
+  *
+  *          A 0x00 opens a frame, the next one closes it. If the bytes
+  *          between them are not a valid frame, the closing 0x00 does not
+  *          open another one: every frame is sent with its own opening 0x00,
+  *          so the text that follows a corrupt frame is still read as text
+  *          and the next frame resynchronizes. A lost byte costs one frame.
+  *
+  *          Data frames are numbered. Up to WIFI_FRAME_WINDOW of them are
+  *          sent without waiting; the Ack field of every frame received
+  *          tells the next sequence number expected by the peer, and the
+  *          frames not acked after WIFI_FRAME_TIMEOUT are sent again (go back
+  *          N). The frames go through the AT engine, one socket write each.
+  *          Every slot keeps its own socket write command and the ticket of
+  *          its last send: a slot is rebuilt only when the TX queue is done
+  *          with it, and nothing waits for the DMA. A slot still waiting in
+  *          the AT engine queue is not queued again, so a silent peer costs
+  *          at most one entry per slot, however long the engine is busy.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_frame.h"
+#include "wifi_uart.h"
+#include "wifi_match.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint16_t Ticket;												// WIFI_TxSubmit ticket of the last send
+  uint8_t  Queued;												// 1 == in the AT engine queue, not sent yet
+  uint16_t PrefixLength;
+  uint8_t  Prefix[WIFI_FRAME_PREFIX_SIZE];	// Socket write command of the frame
+  uint16_t Length;
+  uint8_t  Data[WIFI_FRAME_ENCODED_MAX];
+} WIFI_FrameSlot_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static WIFI_FrameSlot_TypeDef FrameTx[WIFI_FRAME_WINDOW];	// Data frames, slot == Seq % window
+static WIFI_FrameSlot_TypeDef FrameAck;										// Built when it is sent
+static uint8_t  FrameRaw[WIFI_FRAME_RAW_MAX];
+
+static uint8_t  TxSeq = 0;				// Sequence number of the next data frame
+static uint8_t  TxBase = 0;				// Oldest data frame not acked
+static uint32_t TxTime = 0;				// Last time the window moved or was sent again
+static uint8_t  RxSeq = 0;				// Next data frame expected
+static uint8_t  AckDue = 0;				// 1 == an ack must be sent
+static uint8_t  AckQueued = 0;		// 1 == FrameAck is in the AT engine queue
+static uint8_t  RxOpen = 0;				// 1 == a 0x00 opened a frame
+static uint32_t RxStart = 0;			// Stream position of its first byte
+static uint16_t RxErrors = 0;			// Frames with a wrong CRC or length
+static uint32_t FrameNow = 0;
+
+static WIFI_FramePrefix FramePrefix = 0;
+static const WIFI_AtReply_TypeDef *FrameReply = 0;
+static WIFI_FrameHandler FrameHandler = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t WIFI_FrameSendSlot(const void *pSlot);
+static uint16_t WIFI_FrameBuild(WIFI_FrameSlot_TypeDef *pSlot, uint8_t Type, uint8_t Seq,
+                                const uint8_t *pPayload, uint16_t Length);
+static uint16_t WIFI_FrameUnstuff(uint16_t Offset, uint16_t Length);
+static void     WIFI_FrameReceive(uint16_t Length);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Sets up the CRC unit and the transport of the frames.
+  * @param  Prefix: writes the socket write command of a frame
+  * @param  pReply: answer to the socket write
+  * @param  Handler: called with the payload of every data frame received
+  * @retval None
+  */
+void WIFI_FrameInit(WIFI_FramePrefix Prefix, const WIFI_AtReply_TypeDef *pReply, WIFI_FrameHandler Handler)
+{
+  uint8_t Seq;
+
+  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_CRC, ENABLE);
+  CRC_ReverseInputDataSelect(CRC_ReverseInputData_8bits);
+  CRC_ReverseOutputDataCmd(ENABLE);
+
+  FramePrefix = Prefix;
+  FrameReply = pReply;
+  FrameHandler = Handler;
+
+  TxSeq = 0;
+  TxBase = 0;
+  RxSeq = 0;
+  AckDue = 0;
+  AckQueued = 0;
+  for (Seq = 0; Seq < WIFI_FRAME_WINDOW; Seq++)
+    FrameTx[Seq].Queued = 0;
+  RxOpen = 0;
+  RxErrors = 0;
+  WIFI_MatchKeep(0, 0);
+}
+
+/**
+  * @brief  CRC-32 of a block computed by the CRC unit, one byte at a time.
+  * @param  pData: the block
+  * @param  Length: its length
+  * @retval The CRC, the same as zlib crc32()
+  */
+uint32_t WIFI_FrameCrc(const uint8_t *pData, uint16_t Length)
+{
+  CRC_ResetDR();
+  while (Length--)
+    CRC_CalcCRC8bits(*pData++);		// 8 bit access: one byte is processed
+  return CRC_GetCRC() ^ 0xFFFFFFFF;
+}
+
+/**
+  * @brief  COBS encodes a frame between two 0x00.
+  * @param  pDst: at least Length + Length / 254 + 3 bytes
+  * @param  pRaw: the frame
+  * @param  Length: its length
+  * @retval Bytes written in pDst
+  */
+uint16_t WIFI_FrameEncode(uint8_t *pDst, const uint8_t *pRaw, uint16_t Length)
+{
+  uint16_t Size = 0, Code = 1;
+  uint16_t CodePos;
+
+  pDst[Size++] = 0;
+  CodePos = Size++;
+  while (Length--)
+  {
+    if (*pRaw != 0)
+    {
+      pDst[Size++] = *pRaw;
+      Code++;
+    }
+    if ((*pRaw++ == 0) || (Code == 0xFF))
+    {
+      pDst[CodePos] = (uint8_t)Code;
+      Code = 1;
+      CodePos = Size++;
+    }
+  }
+  pDst[CodePos] = (uint8_t)Code;
+  pDst[Size++] = 0;
+
+  return Size;
+}
+
+/**
+  * @brief  Queues a data frame.
+  * @param  pPayload: data to send, copied
+  * @param  Length: at most WIFI_FRAME_MAX_PAYLOAD
+  * @retval PASS, or FAIL if the window or the AT engine queue is full, or
+  *         if the frame that used the slot is still in the TX queue
+  */
+uint8_t WIFI_FrameSend(const uint8_t *pPayload, uint16_t Length)
+{
+  WIFI_FrameSlot_TypeDef *pSlot = &FrameTx[TxSeq % WIFI_FRAME_WINDOW];
+
+  if ((Length > WIFI_FRAME_MAX_PAYLOAD) || ((uint8_t)(TxSeq - TxBase) >= WIFI_FRAME_WINDOW)
+      || (WIFI_TxDone(pSlot->Ticket) == FAIL))
+    return FAIL;
+
+  // A send of the frame acked before in this slot may still be queued: it sends this one
+  if (pSlot->Queued == 0)
+  {
+    if (WIFI_AtSubmitFunc(WIFI_FrameSendSlot, pSlot, FrameReply, 0) == FAIL)
+      return FAIL;
+    pSlot->Queued = 1;
+  }
+  WIFI_FrameBuild(pSlot, WIFI_FRAME_DATA, TxSeq, pPayload, Length);
+
+  if (TxSeq == TxBase)
+    TxTime = FrameNow;
+  TxSeq++;
+  return PASS;
+}
+
+/**
+  * @brief  Sends the acks and the frames not acked in time. To be called
+  *         from the main loop.
+  * @param  Now: current time in ms
+  * @retval None
+  */
+void WIFI_FrameProcess(uint32_t Now)
+{
+  WIFI_FrameSlot_TypeDef *pSlot;
+  uint8_t Seq;
+
+  FrameNow = Now;
+
+  // An aborted engine drops FrameAck and the data frames with the rest of its queue
+  if (WIFI_AtBusy() == 0)
+  {
+    AckQueued = 0;
+    for (Seq = 0; Seq < WIFI_FRAME_WINDOW; Seq++)
+      FrameTx[Seq].Queued = 0;
+  }
+
+  if (AckDue && (AckQueued == 0) && (WIFI_AtSubmitFunc(WIFI_FrameSendSlot, &FrameAck, FrameReply, 0) == PASS))
+  {
+    AckDue = 0;
+    AckQueued = 1;
+  }
+
+  if (TxBase == TxSeq)
+    TxTime = Now;
+  else if ((uint32_t)(Now - TxTime) >= WIFI_FRAME_TIMEOUT)
+  {
+    // The frames whose last send has not left the AT engine queue yet are skipped
+    for (Seq = TxBase; Seq != TxSeq; Seq++)
+    {
+      pSlot = &FrameTx[Seq % WIFI_FRAME_WINDOW];
+      if (pSlot->Queued)
+        continue;
+      if (WIFI_AtSubmitFunc(WIFI_FrameSendSlot, pSlot, FrameReply, 0) == FAIL)
+        break;
+      pSlot->Queued = 1;
+    }
+    TxTime = Now;
+  }
+}
+
+/**
+  * @brief  A 0x00 has been received: it closes the open frame, valid or not,
+  *         otherwise it opens a new frame. Two 0x00 in a row (the end of a
+  *         frame and the start of the next) leave the second one open. To be
+  *         called by the handler of the matcher.
+  * @param  Pos: stream position of the 0x00
+  * @retval None
+  */
+void WIFI_FrameDelimiter(uint32_t Pos)
+{
+  uint32_t ReadCount = WIFI_RxReadCount();
+  uint16_t Length;
+
+  if (RxOpen && (Pos != RxStart) && ((uint32_t)(Pos - RxStart) <= WIFI_FRAME_ENCODED_MAX - 2))
+  {
+    // A corrupt frame is closed too: what follows it is text until the next 0x00
+    RxOpen = 0;
+    WIFI_MatchKeep(0, 0);
+    Length = 0;
+    if ((int32_t)(RxStart - ReadCount) >= 0)
+      Length = WIFI_FrameUnstuff((uint16_t)(RxStart - ReadCount), (uint16_t)(Pos - RxStart));
+    if (Length != 0)
+      WIFI_FrameReceive(Length);
+    else
+      RxErrors++;
+    return;
+  }
+
+  RxOpen = 1;
+  RxStart = Pos + 1;
+  WIFI_MatchKeep(RxStart, WIFI_FRAME_ENCODED_MAX - 1);		// up to the closing 0x00
+}
+
+/**
+  * @brief  Tells if a received byte can be part of a frame: its strings are
+  *         data, not messages of the module.
+  * @param  Pos: stream position of the byte
+  * @retval 1 inside a frame, 0 otherwise
+  */
+uint8_t WIFI_FrameOpen(uint32_t Pos)
+{
+  return RxOpen && ((uint32_t)(Pos - RxStart) < WIFI_FRAME_ENCODED_MAX - 2);
+}
+
+/**
+  * @brief  Frames dropped because of a wrong CRC or length.
+  * @param  None
+  * @retval Number of frames
+  */
+uint16_t WIFI_FrameErrors(void)
+{
+  return RxErrors;
+}
+
+/**
+  * @brief  Tests if frames or acks are still to be sent.
+  * @param  None
+  * @retval 1 if an ack is due or data frames are not acked yet, 0 otherwise
+  */
+uint8_t WIFI_FrameBusy(void)
+{
+  return (AckDue != 0) || (TxBase != TxSeq);
+}
+
+/**
+  * @brief  Sends a frame, WIFI_AtSendFunc: the socket write command, then
+  *         the frame. The ack is built here, so it carries the last Ack.
+  * @param  pSlot: the frame, one of the slots of this file
+  * @retval WIFI_TxSubmit ticket, WIFI_TX_FAIL to be called again later
+  */
+static uint16_t WIFI_FrameSendSlot(const void *pSlot)
+{
+  WIFI_FrameSlot_TypeDef *pFrame = (WIFI_FrameSlot_TypeDef *)pSlot;
+
+  // Both pieces or none: the command must never go alone
+  if (WIFI_TxFree() < 2)
+    return WIFI_TX_FAIL;
+
+  if (pFrame == &FrameAck)
+  {
+    // The previous ack may still be in the TX queue, it is rebuilt once sent
+    if (WIFI_TxDone(FrameAck.Ticket) == FAIL)
+      return WIFI_TX_FAIL;
+    AckQueued = 0;
+    WIFI_FrameBuild(&FrameAck, WIFI_FRAME_ACK, TxSeq, 0, 0);
+  }
+  pFrame->Queued = 0;
+
+  // A data frame sent again is not rebuilt: it can still be in the TX queue
+  WIFI_TxSubmit(pFrame->Prefix, pFrame->PrefixLength, 0);
+  pFrame->Ticket = WIFI_TxSubmit(pFrame->Data, pFrame->Length, 0);
+  return pFrame->Ticket;
+}
+
+/**
+  * @brief  Builds and encodes a frame in a slot, with its socket write
+  *         command. Every frame carries the Ack.
+  * @param  pSlot: where to put the frame
+  * @param  Type: WIFI_FRAME_DATA or WIFI_FRAME_ACK
+  * @param  Seq: sequence number
+  * @param  pPayload: data, 0 if Length is 0
+  * @param  Length: bytes of data
+  * @retval Length of the encoded frame
+  */
+static uint16_t WIFI_FrameBuild(WIFI_FrameSlot_TypeDef *pSlot, uint8_t Type, uint8_t Seq,
+                                const uint8_t *pPayload, uint16_t Length)
+{
+  uint16_t Size = 0;
+  uint32_t Crc;
+
+  FrameRaw[Size++] = Type;
+  FrameRaw[Size++] = Seq;
+  FrameRaw[Size++] = RxSeq;
+  while (Length--)
+    FrameRaw[Size++] = *pPayload++;
+
+  Crc = WIFI_FrameCrc(FrameRaw, Size);
+  FrameRaw[Size++] = (uint8_t)Crc;
+  FrameRaw[Size++] = (uint8_t)(Crc >> 8);
+  FrameRaw[Size++] = (uint8_t)(Crc >> 16);
+  FrameRaw[Size++] = (uint8_t)(Crc >> 24);
+
+  pSlot->Length = WIFI_FrameEncode(pSlot->Data, FrameRaw, Size);
+  pSlot->PrefixLength = FramePrefix(pSlot->Prefix, pSlot->Length);
+  return pSlot->Length;
+}
+
+/**
+  * @brief  COBS decodes a frame from the RxBuffer into FrameRaw and checks
+  *         its CRC.
+  * @param  Offset: first byte after the opening 0x00, from the oldest unread byte
+  * @param  Length: bytes up to the closing 0x00
+  * @retval Length of the frame without the CRC, 0 if it is not valid
+  */
+static uint16_t WIFI_FrameUnstuff(uint16_t Offset, uint16_t Length)
+{
+  uint16_t End = Offset + Length;
+  uint16_t Size = 0;
+  uint8_t  Code, Count;
+  uint32_t Crc;
+
+  if (End > WIFI_RxAvailable())
+    return 0;
+
+  while (Offset < End)
+  {
+    Code = WIFI_RxPeek(Offset++);
+    if ((Code == 0) || (Offset + Code - 1 > End))
+      return 0;
+    for (Count = 1; Count < Code; Count++)
+      FrameRaw[Size++] = WIFI_RxPeek(Offset++);
+    if ((Code != 0xFF) && (Offset < End))
+      FrameRaw[Size++] = 0;
+  }
+
+  if (Size < WIFI_FRAME_HEADER + 4)
+    return 0;
+  Size -= 4;
+  Crc = (uint32_t)FrameRaw[Size] | ((uint32_t)FrameRaw[Size + 1] << 8)
+      | ((uint32_t)FrameRaw[Size + 2] << 16) | ((uint32_t)FrameRaw[Size + 3] << 24);
+  if (WIFI_FrameCrc(FrameRaw, Size) != Crc)
+    return 0;
+
+  return Size;
+}
+
+/**
+  * @brief  Handles a valid frame in FrameRaw: moves the window with its Ack
+  *         and delivers its payload if it is the next data frame.
+  * @param  Length: length of the frame without the CRC
+  * @retval None
+  */
+static void WIFI_FrameReceive(uint16_t Length)
+{
+  uint8_t Ack = FrameRaw[2];
+
+  // Cumulative ack: every frame before Ack has been received
+  if ((uint8_t)(Ack - TxBase) <= (uint8_t)(TxSeq - TxBase))
+  {
+    if (Ack != TxBase)
+      TxTime = FrameNow;
+    TxBase = Ack;
+  }
+
+  if (FrameRaw[0] == WIFI_FRAME_DATA)
+  {
+    if (FrameRaw[1] == RxSeq)
+    {
+      RxSeq++;
+      if (FrameHandler != 0)
+        FrameHandler(&FrameRaw[WIFI_FRAME_HEADER], Length - WIFI_FRAME_HEADER);
+    }
+    // Repeated or out of order: ack again what has been received
+    AckDue = 1;
+  }
+}
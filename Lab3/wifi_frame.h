@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    wifi_frame.h
+  * @brief   Header for wifi_frame.c: binary frames (COBS, CRC-32, sequence
+  *          numbers and acks) carried over a socket of the STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_FRAME_H
+#define __WIFI_FRAME_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+#include "wifi_at.h"
+
+/* Exported types ------------------------------------------------------------*/
+// Writes in pDst the command that sends Length bytes on the socket, returns its length
+typedef uint16_t (*WIFI_FramePrefix)(uint8_t *pDst, uint16_t Length);
+
+// Called with the payload of every new data frame, in sequence order. pData is valid
+// only during the call, WIFI_FrameSend must not be called from the handler
+typedef void (*WIFI_FrameHandler)(const uint8_t *pData, uint16_t Length);
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_FRAME_MAX_PAYLOAD	32		// Bytes of payload in a frame
+#define WIFI_FRAME_WINDOW				4			// Data frames sent and not acked yet
+#define WIFI_FRAME_TIMEOUT			500		// ms without acks before the frames are sent again
+#define WIFI_FRAME_PREFIX_SIZE	24		// Longest command written by WIFI_FramePrefix
+
+// Frame: Type, Seq, Ack, payload, CRC-32 (little endian), COBS encoded between two 0x00
+#define WIFI_FRAME_DATA					0x01	// Payload to deliver, Seq is its sequence number
+#define WIFI_FRAME_ACK					0x02	// Only the Ack field
+#define WIFI_FRAME_HEADER				3
+#define WIFI_FRAME_RAW_MAX			(WIFI_FRAME_HEADER + WIFI_FRAME_MAX_PAYLOAD + 4)
+#define WIFI_FRAME_ENCODED_MAX	(WIFI_FRAME_RAW_MAX + 3)		// + COBS code + 2 delimiters
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void     WIFI_FrameInit(WIFI_FramePrefix Prefix, const WIFI_AtReply_TypeDef *pReply, WIFI_FrameHandler Handler);
+uint32_t WIFI_FrameCrc(const uint8_t *pData, uint16_t Length);
+uint16_t WIFI_FrameEncode(uint8_t *pDst, const uint8_t *pRaw, uint16_t Length);
+uint8_t  WIFI_FrameSend(const uint8_t *pPayload, uint16_t Length);
+void     WIFI_FrameProcess(uint32_t Now);
+void     WIFI_FrameDelimiter(uint32_t Pos);
+uint8_t  WIFI_FrameOpen(uint32_t Pos);
+uint16_t WIFI_FrameErrors(void);
+uint8_t  WIFI_FrameBusy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_FRAME_H */
@@ -0,0 +1,276 @@
+/**
+  ******************************************************************************
+  * @file    wifi_io.c
+  * @brief   Remote I/O commands received through the STM WiFi module.
+  *
+  *          One command sets any writable pin of the configured ports, and
+  *          several operations travel in the same command, so changing many
+  *          outputs costs one round trip and one acknowledgement:
+  *
+  *            io:<op>[,<op>]...
+  *
+  *            <port><pin>=0|1    one pin, pin in decimal           c8=1
+  *            <port>+<hex>       set the pins of the mask          c+300
+  *            <port>-<hex>       reset the pins of the mask        c-40
+  *            <port>=<hex>       write all the writable pins       c=100
+  *            <port><pin>%<duty> PWM pin: on for duty % of the     c9%25
+  *                               time, in steps of 1/16
+  *            <port><pin>*<hex>  PWM pin: pattern of 16 steps,     c8*00FF
+  *                               bit n == on during step n
+  *
+  *          The command ends at the first byte that does not continue it
+  *          (end of line, space, '&' ...). It is checked completely before
+  *          any pin is changed: if an operation is wrong nothing is written.
+  *          Then every port is written once through BSRR, so the pins of a
+  *          port change together and no read-modify-write of ODR can race
+  *          with an interrupt; then the PWM operations go to the Pattern
+  *          function of their port (led.c), at most WIFI_IO_MAX_PATTERNS.
+  *
+  *          A pin in alternate function mode (a timer output, e.g. the
+  *          LEDs on TIM3) does not follow ODR: BSRR only records the
+  *          intent, on or off, and the owner of the pin applies it
+  *          (LED_Update). Only % and * set a duty cycle or a pattern.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_io.h"
+#include "wifi_uart.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static const WIFI_IoPort_TypeDef *IoPorts = 0;
+static uint8_t IoPortCount = 0;
+
+// PWM operations of the command being parsed, Pin == 0: dropped by a later operation
+static uint8_t  PatternPort[WIFI_IO_MAX_PATTERNS];
+static uint16_t PatternPin[WIFI_IO_MAX_PATTERNS];
+static uint16_t PatternValue[WIFI_IO_MAX_PATTERNS];
+static uint8_t  PatternCount = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static int8_t WIFI_IoHex(uint8_t Byte);
+static void   WIFI_IoDropPatterns(uint8_t Port, uint16_t Mask);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Sets the ports that the commands can write.
+  * @param  pPorts: table of the ports, it must stay valid (const table in flash)
+  * @param  Count: number of ports, at most WIFI_IO_MAX_PORTS
+  * @retval PASS, or FAIL if there are too many ports
+  */
+uint8_t WIFI_IoInit(const WIFI_IoPort_TypeDef *pPorts, uint8_t Count)
+{
+  if (Count > WIFI_IO_MAX_PORTS)
+    return FAIL;
+
+  IoPorts = pPorts;
+  IoPortCount = Count;
+  return PASS;
+}
+
+/**
+  * @brief  Checks and executes the operations of a command that is still in
+  *         the RxBuffer.
+  * @param  Pos: stream position of the first operation, after "io:"
+  * @param  Length: bytes from Pos to the end of the line
+  * @retval WIFI_IO_OK, or the error (then no pin has been changed)
+  */
+uint8_t WIFI_IoExecute(uint32_t Pos, uint16_t Length)
+{
+  uint16_t Set[WIFI_IO_MAX_PORTS];
+  uint16_t Reset[WIFI_IO_MAX_PORTS];
+  uint32_t ReadCount = WIFI_RxReadCount();
+  uint16_t Offset, End, Mask, Pattern;
+  uint8_t  Port, Op, Digits, Byte, Index;
+  int8_t   Value;
+
+  if ((int32_t)(Pos - ReadCount) < 0)
+    return WIFI_IO_LOST;
+  Offset = (uint16_t)(Pos - ReadCount);
+  End = Offset + Length;
+  if (End > WIFI_RxAvailable())
+    return WIFI_IO_LOST;
+
+  for (Port = 0; Port < IoPortCount; Port++)
+  {
+    Set[Port] = 0;
+    Reset[Port] = 0;
+  }
+  PatternCount = 0;
+
+  // 1. Parse: the pins to set and reset are collected per port
+  do
+  {
+    if (Offset == End)
+      return WIFI_IO_SYNTAX;
+    Byte = WIFI_RxPeek(Offset++);
+    for (Port = 0; (Port < IoPortCount) && (IoPorts[Port].Name != Byte); Port++)
+      ;
+    if (Port == IoPortCount)
+      return WIFI_IO_PIN;
+
+    if (Offset == End)
+      return WIFI_IO_SYNTAX;
+    Op = WIFI_RxPeek(Offset);
+    Mask = 0;
+    Digits = 0;
+    if ((Op >= '0') && (Op <= '9'))
+    {
+      // <pin>=0|1, <pin>%<duty>, <pin>*<hex>
+      while ((Offset < End) && ((Byte = WIFI_RxPeek(Offset)) >= '0') && (Byte <= '9') && (Digits < 2))
+      {
+        Mask = Mask * 10 + (Byte - '0');
+        Offset++;
+        Digits++;
+      }
+      if ((Mask > 15) || (Offset + 2 > End))
+        return WIFI_IO_SYNTAX;
+      Op = WIFI_RxPeek(Offset++);
+      Mask = (uint16_t)1 << Mask;
+      Pattern = 0;
+      Digits = 0;
+      if (Op == '=')
+      {
+        Byte = WIFI_RxPeek(Offset++);
+        if ((Byte != '0') && (Byte != '1'))
+          return WIFI_IO_SYNTAX;
+        Op = (Byte == '1') ? '+' : '-';
+      }
+      else if (Op == '%')
+      {
+        while ((Offset < End) && ((Byte = WIFI_RxPeek(Offset)) >= '0') && (Byte <= '9') && (Digits < 3))
+        {
+          Pattern = Pattern * 10 + (Byte - '0');
+          Offset++;
+          Digits++;
+        }
+        if ((Digits == 0) || (Pattern > 100))
+          return WIFI_IO_SYNTAX;
+        // Steps of 16 on, rounded: 0 == off, 16 == always on
+        Pattern = (uint16_t)((Pattern * 16 + 50) / 100);
+        Pattern = (Pattern == 16) ? 0xFFFF : (uint16_t)((1U << Pattern) - 1);
+      }
+      else if (Op == '*')
+      {
+        while ((Offset < End) && ((Value = WIFI_IoHex(WIFI_RxPeek(Offset))) >= 0) && (Digits < 4))
+        {
+          Pattern = (Pattern << 4) | Value;
+          Offset++;
+          Digits++;
+        }
+        if (Digits == 0)
+          return WIFI_IO_SYNTAX;
+      }
+      else
+        return WIFI_IO_SYNTAX;
+
+      if ((Op == '%') || (Op == '*'))
+      {
+        if (!(Mask & IoPorts[Port].PwmPins) || (IoPorts[Port].Pattern == 0))
+          return WIFI_IO_PIN;
+        // The last operation on a pin wins
+        Set[Port] &= ~Mask;
+        Reset[Port] &= ~Mask;
+        WIFI_IoDropPatterns(Port, Mask);
+        for (Index = 0; (Index < PatternCount) && (PatternPin[Index] != 0); Index++)
+          ;
+        if (Index == WIFI_IO_MAX_PATTERNS)
+          return WIFI_IO_SYNTAX;
+        if (Index == PatternCount)
+          PatternCount++;
+        PatternPort[Index] = Port;
+        PatternPin[Index] = Mask;
+        PatternValue[Index] = Pattern;
+        continue;
+      }
+    }
+    else if ((Op == '+') || (Op == '-') || (Op == '='))
+    {
+      // <op><hex>
+      Offset++;
+      while ((Offset < End) && ((Value = WIFI_IoHex(WIFI_RxPeek(Offset))) >= 0) && (Digits < 4))
+      {
+        Mask = (Mask << 4) | Value;
+        Offset++;
+        Digits++;
+      }
+      if (Digits == 0)
+        return WIFI_IO_SYNTAX;
+    }
+    else
+      return WIFI_IO_SYNTAX;
+
+    if ((Op != '=') && (Mask & ~IoPorts[Port].Pins))
+      return WIFI_IO_PIN;
+
+    // The last operation on a pin wins
+    WIFI_IoDropPatterns(Port, (Op == '=') ? IoPorts[Port].Pins : Mask);
+    if (Op == '+')
+    {
+      Set[Port] |= Mask;
+      Reset[Port] &= ~Mask;
+    }
+    else if (Op == '-')
+    {
+      Reset[Port] |= Mask;
+      Set[Port] &= ~Mask;
+    }
+    else
+    {
+      Set[Port] = Mask & IoPorts[Port].Pins;
+      Reset[Port] = ~Mask & IoPorts[Port].Pins;
+    }
+  } while ((Offset < End) && (WIFI_RxPeek(Offset++) == ','));
+
+  // 2. Execute: one write per port, then the PWM pins
+  for (Port = 0; Port < IoPortCount; Port++)
+  {
+    if (Set[Port] | Reset[Port])
+      IoPorts[Port].GPIOx->BSRR = Set[Port] | ((uint32_t)Reset[Port] << 16);
+  }
+  for (Index = 0; Index < PatternCount; Index++)
+  {
+    if (PatternPin[Index] != 0)
+      IoPorts[PatternPort[Index]].Pattern(PatternPin[Index], PatternValue[Index]);
+  }
+
+  return WIFI_IO_OK;
+}
+
+/**
+  * @brief  Drops the PWM operations parsed up to now on some pins: a later
+  *         operation on the same pins replaces them.
+  * @param  Port: index of the port in the table
+  * @param  Mask: the pins
+  * @retval None
+  */
+static void WIFI_IoDropPatterns(uint8_t Port, uint16_t Mask)
+{
+  uint8_t Index;
+
+  for (Index = 0; Index < PatternCount; Index++)
+  {
+    if (PatternPort[Index] == Port)
+      PatternPin[Index] &= ~Mask;
+  }
+}
+
+/**
+  * @brief  Value of a hexadecimal digit.
+  * @param  Byte: the digit, upper or lower case
+  * @retval 0 to 15, or -1 if Byte is not a digit
+  */
+static int8_t WIFI_IoHex(uint8_t Byte)
+{
+  if ((Byte >= '0') && (Byte <= '9'))
+    return Byte - '0';
+  Byte |= 0x20;
+  if ((Byte >= 'a') && (Byte <= 'f'))
+    return Byte - 'a' + 10;
+  return -1;
+}
@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file    wifi_io.h
+  * @brief   Header for wifi_io.c: remote I/O commands received through the
+  *          STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_IO_H
+#define __WIFI_IO_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+// Sets the pattern of a pin driven by a timer (PWM): bit n == on during step n of 16
+typedef void (*WIFI_IoPattern)(uint16_t Pin, uint16_t Pattern);
+
+// Port that can be written by the remote commands
+typedef struct
+{
+  uint8_t       Name;				// Letter used in the commands, e.g. 'c'
+  GPIO_TypeDef *GPIOx;
+  uint16_t      Pins;				// Pins that can be written, the others are refused
+  uint16_t      PwmPins;		// Pins driven by a timer, written by Pattern, 0 == none
+  WIFI_IoPattern Pattern;		// 0 == no PWM pin on the port
+} WIFI_IoPort_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_IO_MAX_PORTS			6			// GPIOA to GPIOF
+#define WIFI_IO_MAX_PATTERNS	4			// PWM operations in one command
+
+// Results of WIFI_IoExecute
+#define WIFI_IO_OK						0
+#define WIFI_IO_SYNTAX				1			// Malformed operation
+#define WIFI_IO_PIN						2			// Port not configured or pin not writable
+#define WIFI_IO_LOST					3			// Part of the command left the RxBuffer
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+uint8_t WIFI_IoInit(const WIFI_IoPort_TypeDef *pPorts, uint8_t Count);
+uint8_t WIFI_IoExecute(uint32_t Pos, uint16_t Length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_IO_H */
@@ -0,0 +1,326 @@
+/**
+  ******************************************************************************
+  * @file    wifi_match.c
+  * @brief   Multi-string matcher used to find, in a single pass over the
+  *          received bytes, every command and message of the STM WiFi module.
+  *
+  *          The strings (wifi_strings.h) are searched with an Aho-Corasick
+  *          automaton: a trie whose nodes are the states, plus for every
+  *          state the "fail" state (longest proper suffix that is also in
+  *          the trie) and the "dict" state (nearest suffix state where a
+  *          string ends). WIFI_MatchStep() advances the automaton by one byte
+  *          and WIFI_MatchOut() tells which strings end at that byte, so
+  *          overlapping strings and repeated prefixes are never missed.
+  *
+  *          The automaton is built on the PC by tools/wifi_match.py into
+  *          wifi_match_table.c, as first-child / next-sibling lists of 6
+  *          bytes per state: it is const and stays in flash, nothing of it is
+  *          in the STM32F0 RAM. WIFI_MatchInit() only checks that the table
+  *          was generated from the strings the firmware uses.
+  *
+  *          WIFI_MatchPoll() is the streaming side: it remembers how far the
+  *          RxBuffer has been scanned and the automaton state, so each call
+  *          only feeds the bytes received since the previous one and the work
+  *          does not depend on how much is waiting in the RxBuffer. Matches
+  *          and line ends can also be reported one by one to a handler.
+  *
+  *          The automaton gives, for every byte, the index of the strings that
+  *          end there: the index is a perfect hash of the strings, computed
+  *          by the generator. WIFI_MatchFirst() turns a mask of indexes back into
+  *          one index in constant time, so a caller can use it to address a
+  *          table of handlers without comparing strings.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_match.h"
+#include "wifi_uart.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+// Bit index of (x & -x) * 0x077CB531 >> 27, the de Bruijn sequence B(2, 5)
+static const uint8_t MatchDeBruijn[32] =
+{
+  0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+  31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+static uint8_t  ScanState = 0;				// Automaton state after the last scanned byte
+static uint32_t ScanPos = 0;					// Stream position of the next byte to scan
+static WIFI_MatchMask ScanFound = 0;	// Strings found since WIFI_MatchReset
+static WIFI_MatchHandler ScanHandler = 0;	// Called for every match and line end
+static uint8_t  ScanBusy = 0;					// 1 == WIFI_MatchPoll is scanning
+static uint32_t KeepPos = 0;					// Stream position of the bytes kept by WIFI_MatchConsume
+static uint16_t KeepLength = 0;				// How many, 0 == none
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t WIFI_MatchChild(uint8_t State, uint8_t Byte);
+static uint32_t WIFI_MatchResync(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Checks that the automaton of wifi_match_table.c finds the strings
+  *         of the table, each one with its index. Uses no RAM.
+  * @param  pStrings: first string to search, string i sets bit i of the mask
+  * @param  Size: bytes from one string to the next one, sizeof the table entry
+  * @param  Count: number of strings, at most WIFI_MATCH_MAX_STRINGS
+  * @retval PASS, or FAIL if wifi_match_table.c is stale: run tools/wifi_match.py
+  */
+uint8_t WIFI_MatchInit(const WIFI_MatchString_TypeDef *pStrings, uint16_t Size, uint8_t Count)
+{
+  const WIFI_MatchString_TypeDef *pString;
+  uint8_t Id, Index, State;
+
+  if ((Count > WIFI_MATCH_MAX_STRINGS) || (Count != WIFI_MatchStringCount))
+    return FAIL;
+
+  for (Id = 0; Id < Count; Id++)
+  {
+    pString = (const WIFI_MatchString_TypeDef *)((const uint8_t *)pStrings + (uint32_t)Id * Size);
+    State = 0;
+    for (Index = 0; Index < pString->Length; Index++)
+    {
+      State = WIFI_MatchChild(State, pString->pStr[Index]);
+      if (State == 0)
+        return FAIL;
+    }
+    if ((State == 0) || (WIFI_MatchNode[State].Out != Id + 1))
+      return FAIL;
+  }
+
+  return PASS;
+}
+
+/**
+  * @brief  Advances the automaton by one received byte.
+  * @param  State: current state, 0 at the beginning
+  * @param  Byte: received byte
+  * @retval New state
+  */
+uint8_t WIFI_MatchStep(uint8_t State, uint8_t Byte)
+{
+  uint8_t Next;
+
+  for (;;)
+  {
+    if (State == 0)
+      return WIFI_MatchRoot[Byte];
+    Next = WIFI_MatchChild(State, Byte);
+    if (Next != 0)
+      return Next;
+    State = WIFI_MatchNode[State].Fail;
+  }
+}
+
+/**
+  * @brief  Strings that end in a state.
+  * @param  State: value returned by WIFI_MatchStep()
+  * @retval Mask of the strings, bit i == string i of WIFI_MatchInit()
+  */
+WIFI_MatchMask WIFI_MatchOut(uint8_t State)
+{
+  WIFI_MatchMask Mask = 0;
+
+  if (WIFI_MatchNode[State].Out == 0)
+    State = WIFI_MatchNode[State].Dict;
+  while (State != 0)
+  {
+    Mask |= WIFI_MATCH_BIT(WIFI_MatchNode[State].Out - 1);
+    State = WIFI_MatchNode[State].Dict;
+  }
+  return Mask;
+}
+
+/**
+  * @brief  Lowest string of a mask, in constant time (the Cortex-M0 has no
+  *         count leading zeros instruction): one lookup in the low or the
+  *         high word.
+  * @param  Mask: mask of strings, not 0
+  * @retval Index of the lowest bit set
+  */
+uint8_t WIFI_MatchFirst(WIFI_MatchMask Mask)
+{
+  uint32_t Word = (uint32_t)Mask;
+  uint8_t  Base = 0;
+
+  if (Word == 0)
+  {
+    Word = (uint32_t)(Mask >> 32);
+    Base = 32;
+  }
+  return Base + MatchDeBruijn[(uint32_t)((Word & (0 - Word)) * 0x077CB531U) >> 27];
+}
+
+/**
+  * @brief  Scans the bytes received since the previous call.
+  *         Bytes consumed from the RxBuffer before being scanned are skipped
+  *         (the automaton restarts, a string cannot span them).
+  *         The handler is called from inside the scan, byte by byte: see
+  *         WIFI_MatchSetHandler for what it may do.
+  * @param  None
+  * @retval Mask of the strings found since WIFI_MatchReset(),
+  *         bit i == string i of WIFI_MatchInit()
+  */
+WIFI_MatchMask WIFI_MatchPoll(void)
+{
+  uint32_t ReadCount, End, Pos;
+  WIFI_MatchMask Mask;
+  uint8_t  Byte;
+
+  // Called again by the handler: the outer call scans the rest
+  if (ScanBusy)
+    return ScanFound;
+  ScanBusy = 1;
+
+  ReadCount = WIFI_RxReadCount();
+  End = ReadCount + WIFI_RxAvailable();
+  if ((int32_t)(ScanPos - ReadCount) < 0)
+  {
+    ScanPos = ReadCount;
+    ScanState = 0;
+  }
+
+  while ((int32_t)(End - ScanPos) > 0)
+  {
+    Pos = ScanPos++;
+    Byte = WIFI_RxPeek((uint16_t)(Pos - ReadCount));
+    ScanState = WIFI_MatchStep(ScanState, Byte);
+    if (WIFI_MatchNode[ScanState].Out | WIFI_MatchNode[ScanState].Dict)
+    {
+      Mask = WIFI_MatchOut(ScanState);
+      ScanFound |= Mask;
+      if (ScanHandler != 0)
+      {
+        for (; Mask != 0; Mask &= Mask - 1)
+          ScanHandler(WIFI_MatchFirst(Mask), Pos);
+        ReadCount = WIFI_MatchResync();
+      }
+    }
+    if ((Byte == '\n') && (ScanHandler != 0))
+    {
+      ScanHandler(WIFI_MATCH_EOL, Pos);
+      ReadCount = WIFI_MatchResync();
+    }
+  }
+
+  ScanBusy = 0;
+  return ScanFound;
+}
+
+/**
+  * @brief  Forgets the strings found up to now and restarts the scan from
+  *         the oldest unread byte. To be called after consuming the RxBuffer.
+  * @param  None
+  * @retval None
+  */
+void WIFI_MatchReset(void)
+{
+  ScanPos = WIFI_RxReadCount();
+  ScanState = 0;
+  ScanFound = 0;
+  KeepLength = 0;
+}
+
+/**
+  * @brief  Consumes from the RxBuffer exactly the bytes scanned by the last
+  *         WIFI_MatchPoll() and forgets the strings found. Unlike
+  *         WIFI_RxFlush(), the bytes received in the meantime are kept, and
+  *         the automaton state is kept too: a string whose first bytes have
+  *         been consumed is still found when the rest arrives. The bytes
+  *         kept by WIFI_MatchKeep() stay in the RxBuffer.
+  * @param  None
+  * @retval None
+  */
+void WIFI_MatchConsume(void)
+{
+  uint32_t ReadCount = WIFI_RxReadCount();
+  uint32_t End = ScanPos;
+
+  if ((KeepLength != 0) && ((uint32_t)(ScanPos - KeepPos) < KeepLength))
+    End = KeepPos;
+  if ((int32_t)(End - ReadCount) > 0)
+    WIFI_RxConsume((uint16_t)(End - ReadCount));
+  ScanFound = 0;
+}
+
+/**
+  * @brief  Keeps bytes in the RxBuffer while they are scanned, e.g. a binary
+  *         frame read when its end arrives: WIFI_MatchConsume() does not
+  *         consume them until the scan has gone past them or they are
+  *         released. WIFI_RxFlush() and WIFI_MatchReset() still drop them.
+  * @param  Pos: stream position of the first byte
+  * @param  Length: number of bytes, 0 releases them
+  * @retval None
+  */
+void WIFI_MatchKeep(uint32_t Pos, uint16_t Length)
+{
+  KeepPos = Pos;
+  KeepLength = Length;
+}
+
+/**
+  * @brief  Forgets some of the strings found, e.g. those found inside data.
+  * @param  Mask: the strings, bit i == string i of WIFI_MatchInit()
+  * @retval None
+  */
+void WIFI_MatchDiscard(WIFI_MatchMask Mask)
+{
+  ScanFound &= ~Mask;
+}
+
+/**
+  * @brief  Sets the function called by WIFI_MatchPoll() for every string
+  *         found (Id = string index) and every '\n' (Id = WIFI_MATCH_EOL).
+  *         It is called from inside the scan, in the order of the bytes:
+  *         - it may consume the RxBuffer (WIFI_RxConsume, WIFI_RxFlush,
+  *           WIFI_MatchConsume): the scan goes on from the oldest unread byte;
+  *         - Pos may already be consumed, read it with WIFI_RxView;
+  *         - WIFI_MatchPoll() called from it returns the strings found up to
+  *           now and scans nothing, the running call goes on.
+  * @param  Handler: the function, 0 to disable
+  * @retval None
+  */
+void WIFI_MatchSetHandler(WIFI_MatchHandler Handler)
+{
+  ScanHandler = Handler;
+}
+
+/**
+  * @brief  After the handler: if it consumed bytes not scanned yet, the scan
+  *         goes on from the oldest unread byte, the automaton restarts.
+  * @param  None
+  * @retval WIFI_RxReadCount()
+  */
+static uint32_t WIFI_MatchResync(void)
+{
+  uint32_t ReadCount = WIFI_RxReadCount();
+
+  if ((int32_t)(ScanPos - ReadCount) < 0)
+  {
+    ScanPos = ReadCount;
+    ScanState = 0;
+  }
+  return ReadCount;
+}
+
+/**
+  * @brief  Child of a state along a byte.
+  * @param  State: parent state
+  * @param  Byte: label of the edge
+  * @retval The child, 0 if there is none
+  */
+static uint8_t WIFI_MatchChild(uint8_t State, uint8_t Byte)
+{
+  uint8_t Next;
+
+  for (Next = WIFI_MatchNode[State].Child; Next != 0; Next = WIFI_MatchNode[Next].Sibling)
+  {
+    if (WIFI_MatchNode[Next].Byte == Byte)
+      return Next;
+  }
+  return 0;
+}
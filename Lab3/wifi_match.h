@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    wifi_match.h
+  * @brief   Header for wifi_match.c: multi-string matcher (Aho-Corasick) used
+  *          to find the commands and the messages of the STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_MATCH_H
+#define __WIFI_MATCH_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+// One bit per string, bit i == string i of WIFI_MatchInit
+typedef uint64_t WIFI_MatchMask;
+
+// Called by WIFI_MatchPoll for every string found and every line end,
+// Pos is the position in the received stream of the last byte.
+// Called from inside the scan: see WIFI_MatchSetHandler for what it may do
+typedef void (*WIFI_MatchHandler)(uint8_t Id, uint32_t Pos);
+
+// String to search. It can be the first member of a bigger table entry,
+// WIFI_MatchInit is given the size of the entry
+typedef struct
+{
+  const uint8_t *pStr;
+  uint8_t Length;
+} WIFI_MatchString_TypeDef;
+
+// State of the automaton, written by tools/wifi_match.py in wifi_match_table.c
+typedef struct
+{
+  uint8_t Byte;			// Label of the edge that enters the state
+  uint8_t Child;		// First child, 0 == none (the root is never a child)
+  uint8_t Sibling;	// Next child of the same parent, 0 == none
+  uint8_t Fail;			// State to go to when no child matches
+  uint8_t Dict;			// Nearest suffix state where a string ends, 0 == none
+  uint8_t Out;			// Index + 1 of the string that ends here, 0 == none
+} WIFI_MatchNode_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_MATCH_MAX_STRINGS	64		// One bit of a WIFI_MatchMask per string
+#define WIFI_MATCH_EOL					0xFF	// Id passed to the handler at every '\n'
+
+/* Exported macro ------------------------------------------------------------*/
+#define WIFI_MATCH_BIT(id)			((WIFI_MatchMask)1 << (id))
+// Initializer of a WIFI_MatchString_TypeDef from a string literal or a const array
+#define WIFI_MATCH_STRING(s)		{ (const uint8_t *)(s), sizeof(s) - 1 }
+
+/* Exported variables --------------------------------------------------------*/
+extern const WIFI_MatchNode_TypeDef WIFI_MatchNode[];	// wifi_match_table.c
+extern const uint8_t WIFI_MatchRoot[256];
+extern const uint8_t WIFI_MatchStringCount;
+
+/* Exported functions ------------------------------------------------------- */
+uint8_t  WIFI_MatchInit(const WIFI_MatchString_TypeDef *pStrings, uint16_t Size, uint8_t Count);
+uint8_t  WIFI_MatchStep(uint8_t State, uint8_t Byte);
+WIFI_MatchMask WIFI_MatchOut(uint8_t State);
+uint8_t  WIFI_MatchFirst(WIFI_MatchMask Mask);
+WIFI_MatchMask WIFI_MatchPoll(void);
+void     WIFI_MatchReset(void);
+void     WIFI_MatchConsume(void);
+void     WIFI_MatchKeep(uint32_t Pos, uint16_t Length);
+void     WIFI_MatchDiscard(WIFI_MatchMask Mask);
+void     WIFI_MatchSetHandler(WIFI_MatchHandler Handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_MATCH_H */
@@ -0,0 +1,181 @@
+/**
+  ******************************************************************************
+  * @file    wifi_match_table.c
+  * @brief   Automaton of wifi_match.c, for the strings of wifi_strings.h.
+  *
+  *          Written by tools/wifi_match.py: do not edit, change
+  *          wifi_strings.h and run it again.
+  *
+  *          19 strings, 132 states, 1048 bytes of flash
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "wifi_match.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+const uint8_t WIFI_MatchStringCount = 19;
+
+// State after the root for every byte: most bytes start from the root
+const uint8_t WIFI_MatchRoot[256] =
+{
+   87,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0, 123,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,  61,   0,   0,   0,   0,   0,   0,   0,   0,   0, 121,
+    0,   0,   0,   0,   0,   0,   0,   0,  67,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0, 108,   0,  84,   0,   0,  73,   0,   0,   0,
+  114,   0,  68, 104,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+};
+
+// Byte, Child, Sibling, Fail, Dict, Out: see WIFI_MatchNode_TypeDef
+const WIFI_MatchNode_TypeDef WIFI_MatchNode[132] =
+{
+  { 0x00, 123,   0,   0,   0,  0 },	//   0 ""
+  {  '+',   2,   0,   0,   0,  0 },	//   1 "+"
+  {  'W',   3,   0,   0,   0,  0 },	//   2 "+W"
+  {  'I',   4,   0,   0,   0,  0 },	//   3 "+WI"
+  {  'N',   5,   0,   0,   0,  0 },	//   4 "+WIN"
+  {  'D',   6,   0,   0,   0,  0 },	//   5 "+WIND"
+  {  ':',  88,   0, 123,   0,  0 },	//   6 "+WIND:"
+  {  '4',  28,   0,   0,   0,  0 },	//   7 "+WIND:4"
+  {  '2',   9,   0,   0,   0,  0 },	//   8 "+WIND:42"
+  {  ':',  10,   0, 123,   0,  0 },	//   9 "+WIND:42:"
+  {  'R',  11,   0,   0,   0,  0 },	//  10 "+WIND:42:R"
+  {  'X',  12,   0,  67,  67,  0 },	//  11 "+WIND:42:RX"
+  {  '_',  13,   0,   0,   0,  0 },	//  12 "+WIND:42:RX_"
+  {  'M',  14,   0,   0,   0,  0 },	//  13 "+WIND:42:RX_M"
+  {  'G',  15,   0,   0,   0,  0 },	//  14 "+WIND:42:RX_MG"
+  {  'M',  16,   0,   0,   0,  0 },	//  15 "+WIND:42:RX_MGM"
+  {  'T',  17,   0,   0,   0,  0 },	//  16 "+WIND:42:RX_MGMT"
+  {  ':',   0,   0, 123,   0,  1 },	//  17 "+WIND:42:RX_MGMT:" RX_FAIL1
+  {  '3',  19,   8,   0,   0,  0 },	//  18 "+WIND:43"
+  {  ':',  20,   0, 123,   0,  0 },	//  19 "+WIND:43:"
+  {  'R',  21,   0,   0,   0,  0 },	//  20 "+WIND:43:R"
+  {  'X',  22,   0,  67,  67,  0 },	//  21 "+WIND:43:RX"
+  {  '_',  23,   0,   0,   0,  0 },	//  22 "+WIND:43:RX_"
+  {  'D',  24,   0,   0,   0,  0 },	//  23 "+WIND:43:RX_D"
+  {  'A',  25,   0,   0,   0,  0 },	//  24 "+WIND:43:RX_DA"
+  {  'T',  26,   0,   0,   0,  0 },	//  25 "+WIND:43:RX_DAT"
+  {  'A',  27,   0,   0,   0,  0 },	//  26 "+WIND:43:RX_DATA"
+  {  ':',   0,   0, 123,   0,  2 },	//  27 "+WIND:43:RX_DATA:" RX_FAIL2
+  {  '4',  29,  18,   0,   0,  0 },	//  28 "+WIND:44"
+  {  ':',  30,   0, 123,   0,  0 },	//  29 "+WIND:44:"
+  {  'R',  31,   0,   0,   0,  0 },	//  30 "+WIND:44:R"
+  {  'X',  32,   0,  67,  67,  0 },	//  31 "+WIND:44:RX"
+  {  '_',  33,   0,   0,   0,  0 },	//  32 "+WIND:44:RX_"
+  {  'U',  34,   0,   0,   0,  0 },	//  33 "+WIND:44:RX_U"
+  {  'N',  35,   0,   0,   0,  0 },	//  34 "+WIND:44:RX_UN"
+  {  'K',  36,   0,   0,   0,  0 },	//  35 "+WIND:44:RX_UNK"
+  {  ':',   0,   0, 123,   0,  3 },	//  36 "+WIND:44:RX_UNK:" RX_FAIL3
+  {  '3',  38,   7,   0,   0,  0 },	//  37 "+WIND:3"
+  {  '4',  39,   0,   0,   0,  0 },	//  38 "+WIND:34"
+  {  ':',  40,   0, 123,   0,  0 },	//  39 "+WIND:34:"
+  {  'W',  41,   0, 124,   0,  0 },	//  40 "+WIND:34:W"
+  {  'i',  42,   0, 125,   0,  0 },	//  41 "+WIND:34:Wi"
+  {  'F',  43,   0, 126,   0,  0 },	//  42 "+WIND:34:WiF"
+  {  'i',  44,   0, 127,   0,  0 },	//  43 "+WIND:34:WiFi"
+  {  ' ',  45,   0, 128,   0,  0 },	//  44 "+WIND:34:WiFi "
+  {  'U',  46,   0, 129,   0,  0 },	//  45 "+WIND:34:WiFi U"
+  {  'n',  47,   0,   0,   0,  0 },	//  46 "+WIND:34:WiFi Un"
+  {  'h',  48,   0,   0,   0,  0 },	//  47 "+WIND:34:WiFi Unh"
+  {  'a',  49,   0,   0,   0,  0 },	//  48 "+WIND:34:WiFi Unha"
+  {  'n',  50,   0,   0,   0,  0 },	//  49 "+WIND:34:WiFi Unhan"
+  {  'd',  51,   0,   0,   0,  0 },	//  50 "+WIND:34:WiFi Unhand"
+  {  'l',  52,   0,  73,   0,  0 },	//  51 "+WIND:34:WiFi Unhandl"
+  {  'e',  53,   0,   0,   0,  0 },	//  52 "+WIND:34:WiFi Unhandle"
+  {  'd',  54,   0,   0,   0,  0 },	//  53 "+WIND:34:WiFi Unhandled"
+  {  ' ',  55,   0,   0,   0,  0 },	//  54 "+WIND:34:WiFi Unhandled "
+  {  'E',  56,   0,  61,   0,  0 },	//  55 "+WIND:34:WiFi Unhandled E"
+  {  'v',  57,   0,   0,   0,  0 },	//  56 "+WIND:34:WiFi Unhandled Ev"
+  {  'e',  58,   0,   0,   0,  0 },	//  57 "+WIND:34:WiFi Unhandled Eve"
+  {  'n',  59,   0,   0,   0,  0 },	//  58 "+WIND:34:WiFi Unhandled Even"
+  {  't',  60,   0,   0,   0,  0 },	//  59 "+WIND:34:WiFi Unhandled Event"
+  {  ':',   0,   0, 123,   0,  4 },	//  60 "+WIND:34:WiFi Unhandled Event:" RX_FAIL4
+  {  'E',  62,   1,   0,   0,  0 },	//  61 "E"
+  {  'R',  63,   0,   0,   0,  0 },	//  62 "ER"
+  {  'R',  64,   0,   0,   0,  0 },	//  63 "ERR"
+  {  'O',  65,   0, 121,   0,  0 },	//  64 "ERRO"
+  {  'R',  66,   0,   0,   0,  0 },	//  65 "ERROR"
+  {  ':',   0,   0, 123,   0,  5 },	//  66 "ERROR:" RX_FAIL5
+  {  'X',   0,  61,   0,   0,  6 },	//  67 "X" RX_CLRBUF
+  {  'r',  69,  67,   0,   0,  0 },	//  68 "r"
+  {  'e',  70,   0,   0,   0,  0 },	//  69 "re"
+  {  's',  71,   0, 104,   0,  0 },	//  70 "res"
+  {  'e',  72,   0,   0,   0,  0 },	//  71 "rese"
+  {  't',   0,   0,   0,   0,  7 },	//  72 "reset" RX_RESET
+  {  'l',  79,  68,   0,   0,  0 },	//  73 "l"
+  {  'g',  75,   0, 108,   0,  0 },	//  74 "lg"
+  {  'o',  77,   0,   0,   0,  0 },	//  75 "lgo"
+  {  'n',   0,   0,   0,   0,  8 },	//  76 "lgon" RX_LGON
+  {  'f',  78,  76,   0,   0,  0 },	//  77 "lgof"
+  {  'f',   0,   0,   0,   0,  9 },	//  78 "lgoff" RX_LGOFF
+  {  'b',  80,  74,   0,   0,  0 },	//  79 "lb"
+  {  'o',  82,   0,   0,   0,  0 },	//  80 "lbo"
+  {  'n',   0,   0,   0,   0, 10 },	//  81 "lbon" RX_LBON
+  {  'f',  83,  81,   0,   0,  0 },	//  82 "lbof"
+  {  'f',   0,   0,   0,   0, 11 },	//  83 "lboff" RX_LBOFF
+  {  'i',  85,  73,   0,   0,  0 },	//  84 "i"
+  {  'o',  86,   0,   0,   0,  0 },	//  85 "io"
+  {  ':',   0,   0, 123,   0, 12 },	//  86 "io:" RX_IO
+  { 0x00,   0,  84,   0,   0, 13 },	//  87 "\x00" RX_FRAME
+  {  '5',  89,  37,   0,   0,  0 },	//  88 "+WIND:5"
+  {  '5',  90,   0,   0,   0,  0 },	//  89 "+WIND:55"
+  {  ':',  91,   0, 123,   0,  0 },	//  90 "+WIND:55:"
+  {  'P',  92,   0,   0,   0,  0 },	//  91 "+WIND:55:P"
+  {  'e',  93,   0,   0,   0,  0 },	//  92 "+WIND:55:Pe"
+  {  'n',  94,   0,   0,   0,  0 },	//  93 "+WIND:55:Pen"
+  {  'd',  95,   0,   0,   0,  0 },	//  94 "+WIND:55:Pend"
+  {  'i',  96,   0,  84,   0,  0 },	//  95 "+WIND:55:Pendi"
+  {  'n',  97,   0,   0,   0,  0 },	//  96 "+WIND:55:Pendin"
+  {  'g',  98,   0, 108,   0,  0 },	//  97 "+WIND:55:Pending"
+  {  ' ',  99,   0,   0,   0,  0 },	//  98 "+WIND:55:Pending "
+  {  'D', 100,   0,   0,   0,  0 },	//  99 "+WIND:55:Pending D"
+  {  'a', 101,   0,   0,   0,  0 },	// 100 "+WIND:55:Pending Da"
+  {  't', 102,   0,   0,   0,  0 },	// 101 "+WIND:55:Pending Dat"
+  {  'a', 103,   0,   0,   0,  0 },	// 102 "+WIND:55:Pending Data"
+  {  ':',   0,   0, 123,   0, 14 },	// 103 "+WIND:55:Pending Data:" RX_SOCK_DATA
+  {  's', 105,  87,   0,   0,  0 },	// 104 "s"
+  {  'c', 106,   0,   0,   0,  0 },	// 105 "sc"
+  {  'a', 107,   0,   0,   0,  0 },	// 106 "sca"
+  {  'n',   0,   0,   0,   0, 15 },	// 107 "scan" RX_SCAN
+  {  'g', 109, 104,   0,   0,  0 },	// 108 "g"
+  {  'e', 110,   0,   0,   0,  0 },	// 109 "ge"
+  {  't', 111,   0,   0,   0,  0 },	// 110 "get"
+  {  '_', 112,   0,   0,   0,  0 },	// 111 "get_"
+  {  'i', 113,   0,  84,   0,  0 },	// 112 "get_i"
+  {  'p',   0,   0, 114,   0, 16 },	// 113 "get_ip" RX_GET_IP
+  {  'p', 115, 108,   0,   0,  0 },	// 114 "p"
+  {  'o', 116,   0,   0,   0,  0 },	// 115 "po"
+  {  's', 117,   0, 104,   0,  0 },	// 116 "pos"
+  {  't', 118,   0,   0,   0,  0 },	// 117 "post"
+  {  '_', 119,   0,   0,   0,  0 },	// 118 "post_"
+  {  'i', 120,   0,  84,   0,  0 },	// 119 "post_i"
+  {  'p',   0,   0, 114,   0, 17 },	// 120 "post_ip" RX_POST_IP
+  {  'O', 122, 114,   0,   0,  0 },	// 121 "O"
+  {  'K',   0,   0,   0,   0, 18 },	// 122 "OK" RX_OK
+  {  ':', 124, 121,   0,   0,  0 },	// 123 ":"
+  {  'W', 125,   0,   0,   0,  0 },	// 124 ":W"
+  {  'i', 126,   0,  84,   0,  0 },	// 125 ":Wi"
+  {  'F', 127,   0,   0,   0,  0 },	// 126 ":WiF"
+  {  'i', 128,   0,  84,   0,  0 },	// 127 ":WiFi"
+  {  ' ', 129,   0,   0,   0,  0 },	// 128 ":WiFi "
+  {  'U', 130,   0,   0,   0,  0 },	// 129 ":WiFi U"
+  {  'p', 131,   0, 114,   0,  0 },	// 130 ":WiFi Up"
+  {  ':',   0,   0, 123,   0, 19 } 	// 131 ":WiFi Up:" RX_WIFI_UP
+};
+
+/* Private function prototypes -----------------------------------------------*/
+/* Private functions ---------------------------------------------------------*/
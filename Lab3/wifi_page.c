@@ -0,0 +1,265 @@
+/**
+  ******************************************************************************
+  * @file    wifi_page.c
+  * @brief   HTML pages built from a template and sent to the file system of
+  *          the STM WiFi module.
+  *
+  *          A template (WIFI_Page_TypeDef) is a constant list of text pieces
+  *          and fields, so the HTML shared by all the states of the page is
+  *          stored once in flash and a new LED or status field costs only one
+  *          more item. The page is never built in RAM: WIFI_PageSendBody()
+  *          hands every piece, and the current value of every field, directly
+  *          to the USART2 TX queue (scatter-gather: a field can even point
+  *          into the RxBuffer).
+  *
+  *          The three WIFI_PageSendXxx functions are WIFI_AtSendFunc, to be
+  *          queued on the AT engine with WIFI_AtSubmitFunc():
+  *            create (at+s.fsc, answer OK), append (at+s.fsa, no answer) and
+  *            body (answer OK).
+  *          The lengths are computed when the commands are sent. If a field
+  *          changes length between the append and the body, the body is cut or
+  *          padded with spaces to the announced length.
+  *
+  *          A number field (WIFI_PAGE_NUMBER) has a fixed width, its digits
+  *          right aligned after spaces: the length of the page does not depend
+  *          on the values, e.g. the counters of metrics.json. The digits are
+  *          written when the field is sent, in PAGE_NUMBER_COUNT small buffers
+  *          used in turn like the headers, so no copy of the page is in RAM.
+  *
+  *          The headers are written in PAGE_CMD_COUNT buffers used in turn,
+  *          each with the ticket of its last send: while the next one is
+  *          still in the TX queue the command is refused (WIFI_TX_FAIL) and
+  *          the AT engine sends it again later, nothing waits for the DMA.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_page.h"
+#include "wifi_uart.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+#define PAGE_CMD_SIZE		48		// at+s.fsx=<name>,<length>\n\r
+#define PAGE_CMD_COUNT		2			// Headers in the TX queue at the same time
+#define PAGE_NUMBER_COUNT	4			// Number fields in the TX queue at the same time
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  PageCmd[PAGE_CMD_COUNT][PAGE_CMD_SIZE];	// Headers being sent
+static uint16_t PageCmdTicket[PAGE_CMD_COUNT];				// WIFI_TxSubmit ticket of each
+static uint8_t  PageCmdNext = 0;											// Buffer of the next header
+static uint8_t  PageNumber[PAGE_NUMBER_COUNT][WIFI_PAGE_NUMBER_MAX];	// Number fields being sent
+static uint16_t PageNumberTicket[PAGE_NUMBER_COUNT];							// WIFI_TxSubmit ticket of each
+static uint8_t  PageNumberNext = 0;																// Buffer of the next number
+static uint16_t PageAnnounced = 0;					// Length sent with the last at+s.fsa
+static uint16_t PageLeft = 0;							// Bytes of the body not submitted yet
+static uint8_t  PageIndex = 0;							// Next item of the body
+static const char PageSpaces[] = "                ";
+
+/* Private function prototypes -----------------------------------------------*/
+static const char *WIFI_PageItem(const WIFI_Page_TypeDef *pPage, uint8_t Index, uint16_t *pLength);
+static uint16_t WIFI_PageSendNumber(uint32_t Value, uint16_t Width);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Length of the page with the current values of the fields.
+  * @param  pPage: the template
+  * @retval Number of bytes
+  */
+uint16_t WIFI_PageLength(const WIFI_Page_TypeDef *pPage)
+{
+  uint16_t Length = 0;
+  uint16_t ItemLength;
+  uint8_t  Index;
+
+  for (Index = 0; Index < pPage->Count; Index++)
+  {
+    WIFI_PageItem(pPage, Index, &ItemLength);
+    Length += ItemLength;
+  }
+
+  return Length;
+}
+
+/**
+  * @brief  Sends at+s.fsc=<name>,<length>: creates the file.
+  * @param  pPage: the template (WIFI_Page_TypeDef)
+  * @retval WIFI_TxSubmit ticket
+  */
+uint16_t WIFI_PageSendCreate(const void *pPage)
+{
+  return WIFI_PageSendFileCmd("at+s.fsc=", ((const WIFI_Page_TypeDef *)pPage)->pName, WIFI_PageLength(pPage));
+}
+
+/**
+  * @brief  Sends at+s.fsa=<name>,<length>: the body must follow.
+  * @param  pPage: the template (WIFI_Page_TypeDef)
+  * @retval WIFI_TxSubmit ticket
+  */
+uint16_t WIFI_PageSendAppend(const void *pPage)
+{
+  PageAnnounced = WIFI_PageLength(pPage);
+  PageLeft = PageAnnounced;
+  PageIndex = 0;
+  return WIFI_PageSendFileCmd("at+s.fsa=", ((const WIFI_Page_TypeDef *)pPage)->pName, PageAnnounced);
+}
+
+/**
+  * @brief  Sends the page, piece by piece, exactly as long as announced by
+  *         the last WIFI_PageSendAppend(). The pieces that do not fit in the
+  *         TX queue are sent by the next calls (WIFI_AtSendFunc).
+  * @param  pPage: the template (WIFI_Page_TypeDef)
+  * @retval WIFI_TxSubmit ticket of the last piece, WIFI_TX_FAIL while
+  *         pieces are left
+  */
+uint16_t WIFI_PageSendBody(const void *pPage)
+{
+  const WIFI_Page_TypeDef *pTemplate = pPage;
+  const char *pText;
+  uint16_t Length;
+  uint16_t Ticket = WIFI_TX_FAIL;
+
+  if (PageLeft == 0)
+    return WIFI_TxSubmit(0, 0, 0);		// empty page, nothing to wait for
+
+  for (; (PageIndex < pTemplate->Count) && (PageLeft != 0); PageIndex++)
+  {
+    pText = WIFI_PageItem(pTemplate, PageIndex, &Length);
+    if (Length > PageLeft)
+      Length = PageLeft;
+    if (pText == 0)
+    {
+      Ticket = WIFI_PageSendNumber(pTemplate->Number(pTemplate->pItems[PageIndex].Field), Length);
+      if (Ticket == WIFI_TX_FAIL)
+        return WIFI_TX_FAIL;
+    }
+    else if (Length != 0)
+    {
+      Ticket = WIFI_TxSubmit((const uint8_t *)pText, Length, 0);
+      if (Ticket == WIFI_TX_FAIL)
+        return WIFI_TX_FAIL;
+    }
+    PageLeft -= Length;
+  }
+
+  while (PageLeft != 0)
+  {
+    Length = (PageLeft < sizeof(PageSpaces) - 1) ? PageLeft : sizeof(PageSpaces) - 1;
+    Ticket = WIFI_TxSubmit((const uint8_t *)PageSpaces, Length, 0);
+    if (Ticket == WIFI_TX_FAIL)
+      return WIFI_TX_FAIL;
+    PageLeft -= Length;
+  }
+
+  return Ticket;
+}
+
+/**
+  * @brief  Text of an item: the piece, or the current value of the field.
+  * @param  pPage: the template
+  * @param  Index: item
+  * @param  pLength: returns the length of the text
+  * @retval The text, 0 for a number field (its width in *pLength)
+  */
+static const char *WIFI_PageItem(const WIFI_Page_TypeDef *pPage, uint8_t Index, uint16_t *pLength)
+{
+  const char *pText = pPage->pItems[Index].pText;
+
+  if ((pText != 0) || (pPage->pItems[Index].Length != 0))
+  {
+    *pLength = pPage->pItems[Index].Length;
+    return pText;
+  }
+
+  pText = pPage->Value(pPage->pItems[Index].Field, pLength);
+  if (pText == 0)
+  {
+    pText = "";
+    *pLength = 0;
+  }
+  return pText;
+}
+
+/**
+  * @brief  Builds in the next PageCmd and sends <Cmd><name>,<length>\n\r,
+  *         also used for the files of wifi_asset.c.
+  * @param  pCmd: "at+s.fsc=" or "at+s.fsa="
+  * @param  pName: file name on the module
+  * @param  Length: length of the file, or of the data appended
+  * @retval WIFI_TxSubmit ticket, WIFI_TX_FAIL if the buffer is still in the
+  *         TX queue or the queue is full
+  */
+uint16_t WIFI_PageSendFileCmd(const char *pCmd, const char *pName, uint16_t Length)
+{
+  uint8_t *pDst = PageCmd[PageCmdNext];
+  uint8_t  Digits[5];
+  uint16_t Size = 0;
+  uint8_t  Count = 0;
+  uint16_t Ticket;
+
+  if (WIFI_TxDone(PageCmdTicket[PageCmdNext]) == FAIL)
+    return WIFI_TX_FAIL;
+
+  while ((*pCmd != 0) && (Size < PAGE_CMD_SIZE - 8))
+    pDst[Size++] = *pCmd++;
+  for (pCmd = pName; (*pCmd != 0) && (Size < PAGE_CMD_SIZE - 8); pCmd++)
+    pDst[Size++] = *pCmd;
+  pDst[Size++] = ',';
+
+  do
+  {
+    Digits[Count++] = '0' + (Length % 10);
+    Length /= 10;
+  } while (Length != 0);
+  while (Count != 0)
+    pDst[Size++] = Digits[--Count];
+
+  pDst[Size++] = '\n';
+  pDst[Size++] = '\r';
+
+  Ticket = WIFI_TxSubmit(pDst, Size, 0);
+  if (Ticket != WIFI_TX_FAIL)
+  {
+    PageCmdTicket[PageCmdNext] = Ticket;
+    PageCmdNext = (PageCmdNext + 1) % PAGE_CMD_COUNT;
+  }
+  return Ticket;
+}
+
+/**
+  * @brief  Writes a number in the next PageNumber and sends it, right
+  *         aligned in Width characters.
+  * @param  Value: the number, only its lowest digits if it is too wide
+  * @param  Width: characters, 1 to WIFI_PAGE_NUMBER_MAX (WIFI_PAGE_NUMBER
+  *         rejects the others), all of them are sent
+  * @retval WIFI_TxSubmit ticket, WIFI_TX_FAIL if the buffer is still in the
+  *         TX queue or the queue is full
+  */
+static uint16_t WIFI_PageSendNumber(uint32_t Value, uint16_t Width)
+{
+  uint8_t *pDst = PageNumber[PageNumberNext];
+  uint16_t Index;
+  uint16_t Ticket;
+
+  if (WIFI_TxDone(PageNumberTicket[PageNumberNext]) == FAIL)
+    return WIFI_TX_FAIL;
+
+  Index = Width;
+  do
+  {
+    pDst[--Index] = '0' + (Value % 10);
+    Value /= 10;
+  } while ((Value != 0) && (Index != 0));
+  while (Index != 0)
+    pDst[--Index] = ' ';
+
+  Ticket = WIFI_TxSubmit(pDst, Width, 0);
+  if (Ticket != WIFI_TX_FAIL)
+  {
+    PageNumberTicket[PageNumberNext] = Ticket;
+    PageNumberNext = (PageNumberNext + 1) % PAGE_NUMBER_COUNT;
+  }
+  return Ticket;
+}
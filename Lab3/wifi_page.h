@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    wifi_page.h
+  * @brief   Header for wifi_page.c: HTML pages built from a template and sent
+  *          to the file system of the STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_PAGE_H
+#define __WIFI_PAGE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+// Returns the current value of a field of the template and its length in *pLength,
+// the value does not need a final 0 (it can point into the RxBuffer, see WIFI_RxView)
+typedef const char *(*WIFI_PageField)(uint8_t Field, uint16_t *pLength);
+
+// Returns the current value of a number field of the template
+typedef uint32_t (*WIFI_PageNumber)(uint8_t Field);
+
+// One piece of the template: constant text, or a field if pText == 0
+typedef struct
+{
+  const char *pText;
+  uint16_t    Length;		// Length of pText, it can contain 0s. For a field: 0, or the width of a number
+  uint8_t     Field;
+} WIFI_PageItem_TypeDef;
+
+typedef struct
+{
+  const char                  *pName;		// File name on the module, e.g. "/led.html"
+  const WIFI_PageItem_TypeDef *pItems;
+  uint8_t                      Count;		// Number of items
+  WIFI_PageField               Value;		// Value of the fields
+  WIFI_PageNumber              Number;		// Value of the number fields, 0 if there are none
+} WIFI_Page_TypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_PAGE_NUMBER_MAX		10		// Widest number field, a uint32_t
+
+/* Exported macro ------------------------------------------------------------*/
+#define WIFI_PAGE_TEXT(s)				{ (s), sizeof(s) - 1, 0 }		// s must be a string literal
+#define WIFI_PAGE_FIELD(f)			{ 0, 0, (f) }
+// w characters, spaces before the digits; a width of 0 or over WIFI_PAGE_NUMBER_MAX does
+// not build, WIFI_PageLength would announce bytes the field cannot send
+#define WIFI_PAGE_NUMBER(f, w)	{ 0, (w) + 0 * sizeof(char[(((w) >= 1) && ((w) <= WIFI_PAGE_NUMBER_MAX)) ? 1 : -1]), (f) }
+
+/* Exported functions ------------------------------------------------------- */
+uint16_t WIFI_PageLength(const WIFI_Page_TypeDef *pPage);
+uint16_t WIFI_PageSendCreate(const void *pPage);
+uint16_t WIFI_PageSendAppend(const void *pPage);
+uint16_t WIFI_PageSendBody(const void *pPage);
+uint16_t WIFI_PageSendFileCmd(const char *pCmd, const char *pName, uint16_t Length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_PAGE_H */
@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    wifi_strings.h
+  * @brief   Strings searched in the bytes received from the STM WiFi module:
+  *          the commands, the messages and the answers.
+  *
+  *          WIFI_RX_STRINGS lists them in the order of their RX_xxx value,
+  *          the bit in the masks of wifi_match.c. tools/wifi_match.py builds
+  *          the automaton from this file into wifi_match_table.c: run it
+  *          again after any change here, WIFI_MatchInit() fails at boot if
+  *          the table does not match the strings.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_STRINGS_H
+#define __WIFI_STRINGS_H
+
+/* Exported constants --------------------------------------------------------*/
+// Failures reported by the STM WiFi module
+#define TxBuffer_FAIL1	"+WIND:42:RX_MGMT:"
+#define TxBuffer_FAIL2	"+WIND:43:RX_DATA:"
+#define TxBuffer_FAIL3	"+WIND:44:RX_UNK:"
+#define TxBuffer_FAIL4	"+WIND:34:WiFi Unhandled Event:"
+#define TxBuffer_FAIL5	"ERROR:"
+
+// Commands available ******************************************************************
+#define RxLBOFF  "lboff"	// Led Blue OFF
+#define RxLBON   "lbon"		// Led Blue ON
+#define RxLGOFF  "lgoff"	// Led Green OFF
+#define RxLGON   "lgon"		// Led Green ON
+#define RxClrBuf "X"			// Clear RxBuffer
+#define RxReset  "reset"	// Reset the STM WiFi module, it reload the WiFi configuration
+													//		received from STM32F0-Discovery.
+													//		During the reset the Blue Led is flashing.
+#define SCAN			"scan" // scan command MV
+#define GET_IP		"get_ip"	// obtain ip command MV
+#define POST_IP		"post_ip"		// obtain IP address and print it on HTERM
+#define RxIo			"io:"				// remote I/O: io:c8=1,c9=0 etc., see wifi_io.c
+#define RxFrame		"\0"				// delimiter of the binary frames, see wifi_frame.c
+#define RxSockData	"+WIND:55:Pending Data:"	// data received on the socket: <id>:<length>
+
+// Received strings used for test the status of STM WiFi
+#define WiFi_IP		":WiFi Up:"  	// This means that STM WiFi is connected to WiFi Network
+#define WiFi_OK		"OK"					// This is the answer at the AT command
+
+/* Exported macro ------------------------------------------------------------*/
+// X(RX_xxx value, string), one per line: read by tools/wifi_match.py
+#define WIFI_RX_STRINGS(X)				\
+	X(RX_FAIL1,			TxBuffer_FAIL1)	\
+	X(RX_FAIL2,			TxBuffer_FAIL2)	\
+	X(RX_FAIL3,			TxBuffer_FAIL3)	\
+	X(RX_FAIL4,			TxBuffer_FAIL4)	\
+	X(RX_FAIL5,			TxBuffer_FAIL5)	\
+	X(RX_CLRBUF,		RxClrBuf)				\
+	X(RX_RESET,			RxReset)				\
+	X(RX_LGON,			RxLGON)					\
+	X(RX_LGOFF,			RxLGOFF)				\
+	X(RX_LBON,			RxLBON)					\
+	X(RX_LBOFF,			RxLBOFF)				\
+	X(RX_IO,				RxIo)						\
+	X(RX_FRAME,			RxFrame)				\
+	X(RX_SOCK_DATA,	RxSockData)			\
+	X(RX_SCAN,			SCAN)						\
+	X(RX_GET_IP,		GET_IP)					\
+	X(RX_POST_IP,		POST_IP)				\
+	X(RX_OK,				WiFi_OK)				\
+	X(RX_WIFI_UP,		WiFi_IP)
+
+#endif /* __WIFI_STRINGS_H */
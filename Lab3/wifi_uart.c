@@ -0,0 +1,606 @@
+/**
+  ******************************************************************************
+  * @file    wifi_uart.c
+  * @brief   USART2 link towards the STM WiFi module.
+  *
+  *          Transmission is done by DMA1 Channel4 (USART2_TX) from a small
+  *          queue of buffers: the caller submits a buffer and gets back a
+  *          ticket, the DMA interrupt starts the next buffer as soon as the
+  *          previous one is done. The CPU is therefore free while AT commands
+  *          and HTML pages are streamed out.
+  *
+  *          The submitted buffers are NOT copied: they must stay valid until
+  *          WIFI_TxDone(ticket) returns PASS (or the callback is called).
+  *          Nothing waits for the DMA: a full queue refuses the buffer
+  *          (WIFI_TX_FAIL) and the caller submits it again later.
+  *
+  *          Reception is done by DMA1 Channel5 (USART2_RX) in circular mode
+  *          into RxBuffer, which is used as a ring buffer: the DMA is the
+  *          producer, the main loop consumes with WIFI_RxRead/WIFI_RxConsume.
+  *          The USART2 idle line interrupt marks the end of every message
+  *          sent by the module (WIFI_RxNewFrame/WIFI_RxFramed). If the main
+  *          loop falls behind by more than RXBUFFERSIZE bytes the oldest
+  *          bytes are dropped and counted in WIFI_RxOverruns().
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "wifi_uart.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const uint8_t       *pData;
+  uint16_t             Length;
+  WIFI_TxDoneCallback  Callback;
+} WIFI_TxReq_TypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define WIFI_TX_QUEUE_MASK		(WIFI_TX_QUEUE_SIZE - 1)
+// Ticket after t: WIFI_TX_FAIL is never a ticket
+#define WIFI_TX_NEXT(t)				((uint16_t)((t) + 1) == WIFI_TX_FAIL ? (uint16_t)((t) + 2) : (uint16_t)((t) + 1))
+#define USART2_TDR_ADDRESS		((uint32_t)&USART2->TDR)
+#define USART2_RDR_ADDRESS		((uint32_t)&USART2->RDR)
+
+/* Private macro -------------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static WIFI_TxReq_TypeDef TxQueue[WIFI_TX_QUEUE_SIZE];
+static __IO uint8_t  TxHead = 0;			// Oldest request, the one the DMA is working on
+static __IO uint8_t  TxTail = 0;			// First free slot of the queue
+static __IO uint8_t  TxActive = 0;		// 1 == DMA1 Channel4 is transferring TxQueue[TxHead]
+static __IO uint16_t TxSubmitted = 0;	// Ticket of the last submitted buffer
+static __IO uint16_t TxCompleted = 0;	// Ticket of the last completed buffer
+
+static uint8_t RxBuffer[RXBUFFERSIZE];	// Written by DMA1 Channel5 in circular mode
+static __IO uint32_t RxWritten = 0;		// Bytes written by the DMA since WIFI_RxInit
+static __IO uint32_t RxRead = 0;			// Bytes consumed by the main loop
+static __IO uint32_t RxIdleMark = 0;	// RxWritten at the last idle line
+static __IO uint16_t RxHead = 0;			// DMA write index at the last WIFI_RxUpdate
+static __IO uint16_t RxTail = 0;			// Index of the oldest unread byte
+static __IO uint16_t RxLost = 0;			// Overruns: ring overwritten or USART ORE
+static __IO uint8_t  RxIdle = 0;			// 1 == a new message ended since WIFI_RxNewFrame
+
+/* Private function prototypes -----------------------------------------------*/
+static void WIFI_TxStart(void);
+static void WIFI_RxUpdate(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Configures DMA1 Channel4 for USART2 transmission.
+  *         USART2 must already be initialized (STM_EVAL_COM_2_Init).
+  * @param  None
+  * @retval None
+  */
+void WIFI_TxInit(void)
+{
+  DMA_InitTypeDef  DMA_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  /* DMA1 clock enable */
+  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+  /* DMA1 Channel4 (USART2_TX): memory -> USART2->TDR, byte wide, one shot */
+  DMA_DeInit(DMA1_Channel4);
+  DMA_InitStructure.DMA_PeripheralBaseAddr = USART2_TDR_ADDRESS;
+  DMA_InitStructure.DMA_MemoryBaseAddr = 0;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+  DMA_InitStructure.DMA_BufferSize = 0;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+  DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+  DMA_Init(DMA1_Channel4, &DMA_InitStructure);
+  DMA_ITConfig(DMA1_Channel4, DMA_IT_TC, ENABLE);
+
+  /* Let USART2 request a new byte every time TDR is empty */
+  USART_DMACmd(USART2, USART_DMAReq_Tx, ENABLE);
+
+  /* Enable the DMA1 Channel4 and Channel5 Interrupt */
+  NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel4_5_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  TxHead = 0;
+  TxTail = 0;
+  TxActive = 0;
+}
+
+/**
+  * @brief  Queues a buffer for transmission on USART2. Never waits: if the
+  *         queue is full the buffer is refused and the caller tries again
+  *         later (see WIFI_TxFree). Must be called from the main loop.
+  * @param  pData: buffer to send, it is not copied
+  * @param  Length: number of bytes to send
+  * @param  Callback: called when done, can be 0. From the DMA interrupt, or
+  *         from here if there is nothing to wait for (Length 0, TX idle)
+  * @retval Ticket of the transfer, to be tested with WIFI_TxDone(), or
+  *         WIFI_TX_FAIL if the queue is full
+  */
+uint16_t WIFI_TxSubmit(const uint8_t *pData, uint16_t Length, WIFI_TxDoneCallback Callback)
+{
+  uint16_t Ticket;
+
+  // The DMA interrupt only moves TxHead forward: a free slot stays free
+  if (((TxTail + 1) & WIFI_TX_QUEUE_MASK) == TxHead)
+    return WIFI_TX_FAIL;
+
+  __disable_irq();
+  Ticket = WIFI_TX_NEXT(TxSubmitted);
+  TxSubmitted = Ticket;
+  if ((Length == 0) && (TxActive == 0))
+  {
+    // Nothing queued before it: done at once, the callback runs with the interrupts enabled
+    TxCompleted = Ticket;
+    __enable_irq();
+    if (Callback != 0)
+      Callback();
+    return Ticket;
+  }
+  TxQueue[TxTail].pData = pData;
+  TxQueue[TxTail].Length = Length;
+  TxQueue[TxTail].Callback = Callback;
+  TxTail = (TxTail + 1) & WIFI_TX_QUEUE_MASK;
+  if (TxActive == 0)
+    WIFI_TxStart();
+  __enable_irq();
+
+  return Ticket;
+}
+
+/**
+  * @brief  Tests if a submitted buffer has been completely handed to USART2.
+  * @param  Ticket: value returned by WIFI_TxSubmit()
+  * @retval PASS if the buffer is sent and can be reused, FAIL otherwise
+  */
+uint8_t WIFI_TxDone(uint16_t Ticket)
+{
+  // Tickets wrap around, so compare the distance and not the values. An idle queue
+  // has sent everything: a ticket kept for long is not taken for a future one
+  if (((int16_t)(TxCompleted - Ticket) >= 0) || (WIFI_TxBusy() == 0))
+    return PASS;
+  return FAIL;
+}
+
+/**
+  * @brief  Tests if there is something queued or in flight.
+  * @param  None
+  * @retval 1 if the TX path is busy, 0 otherwise
+  */
+uint8_t WIFI_TxBusy(void)
+{
+  return (TxActive != 0) || (TxHead != TxTail);
+}
+
+/**
+  * @brief  Number of buffers that WIFI_TxSubmit() can queue now.
+  * @param  None
+  * @retval Free slots of the queue
+  */
+uint8_t WIFI_TxFree(void)
+{
+  return (TxHead - TxTail - 1) & WIFI_TX_QUEUE_MASK;
+}
+
+/**
+  * @brief  Waits until every queued buffer is sent and the last bit
+  *         has left the USART2 shift register.
+  * @param  None
+  * @retval None
+  */
+void WIFI_TxFlush(void)
+{
+  while (WIFI_TxBusy())
+    {}
+  while (USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET)
+    {}
+}
+
+/**
+  * @brief  DMA1 Channel4 transfer complete: retire the request at TxHead
+  *         and start the next one. Called from DMA1_Channel4_5_IRQHandler.
+  * @param  None
+  * @retval None
+  */
+void WIFI_TxDMA_IRQHandler(void)
+{
+  WIFI_TxDoneCallback Callback;
+
+  if (DMA_GetITStatus(DMA1_IT_TC4) != RESET)
+  {
+    DMA_ClearITPendingBit(DMA1_IT_GL4);
+
+    Callback = TxQueue[TxHead].Callback;
+    TxHead = (TxHead + 1) & WIFI_TX_QUEUE_MASK;
+    TxCompleted = WIFI_TX_NEXT(TxCompleted);
+    TxActive = 0;
+
+    if (TxHead != TxTail)
+      WIFI_TxStart();
+
+    if (Callback != 0)
+      Callback();
+  }
+}
+
+/**
+  * @brief  Programs DMA1 Channel4 with the request at TxHead.
+  *         Must be called with interrupts disabled or from the DMA ISR.
+  *         From WIFI_TxSubmit the request at TxHead is the one just queued,
+  *         never of length 0: only the DMA ISR completes those, and calls
+  *         their callbacks.
+  * @param  None
+  * @retval None
+  */
+static void WIFI_TxStart(void)
+{
+  // Zero length requests queued behind a transfer are completed here, the DMA would never raise TC
+  while ((TxHead != TxTail) && (TxQueue[TxHead].Length == 0))
+  {
+    if (TxQueue[TxHead].Callback != 0)
+      TxQueue[TxHead].Callback();
+    TxHead = (TxHead + 1) & WIFI_TX_QUEUE_MASK;
+    TxCompleted = WIFI_TX_NEXT(TxCompleted);
+  }
+  if (TxHead == TxTail)
+    return;
+
+  DMA_Cmd(DMA1_Channel4, DISABLE);
+  DMA1_Channel4->CMAR = (uint32_t)TxQueue[TxHead].pData;
+  DMA_SetCurrDataCounter(DMA1_Channel4, TxQueue[TxHead].Length);
+  TxActive = 1;
+  DMA_Cmd(DMA1_Channel4, ENABLE);
+}
+
+/**
+  * @brief  Configures DMA1 Channel5 to receive from USART2 in circular mode
+  *         into RxBuffer and enables the USART2 idle line interrupt.
+  *         USART2 must already be initialized (STM_EVAL_COM_2_Init).
+  * @param  None
+  * @retval None
+  */
+void WIFI_RxInit(void)
+{
+  DMA_InitTypeDef  DMA_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+
+  /* DMA1 clock enable */
+  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+  /* DMA1 Channel5 (USART2_RX): USART2->RDR -> RxBuffer, byte wide, circular */
+  DMA_DeInit(DMA1_Channel5);
+  DMA_InitStructure.DMA_PeripheralBaseAddr = USART2_RDR_ADDRESS;
+  DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)RxBuffer;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+  DMA_InitStructure.DMA_BufferSize = RXBUFFERSIZE;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+  DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+  DMA_Init(DMA1_Channel5, &DMA_InitStructure);
+
+  // Half and full transfer interrupts: the ring position is sampled at least
+  // twice per lap, so a lap of the DMA is never missed
+  DMA_ITConfig(DMA1_Channel5, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+  RxWritten = 0;
+  RxRead = 0;
+  RxIdleMark = 0;
+  RxHead = 0;
+  RxTail = 0;
+  RxLost = 0;
+  RxIdle = 0;
+
+  DMA_Cmd(DMA1_Channel5, ENABLE);
+  USART_DMACmd(USART2, USART_DMAReq_Rx, ENABLE);
+
+  /* Idle line marks the end of a message, ERR reports the USART overruns */
+  USART_ClearITPendingBit(USART2, USART_IT_IDLE);
+  USART_ITConfig(USART2, USART_IT_IDLE, ENABLE);
+  USART_ITConfig(USART2, USART_IT_ERR, ENABLE);
+
+  /* Enable the USART2 Interrupt */
+  NVIC_InitStructure.NVIC_IRQChannel = USART2_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  /* Enable the DMA1 Channel4 and Channel5 Interrupt */
+  NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel4_5_IRQn;
+  NVIC_Init(&NVIC_InitStructure);
+}
+
+/**
+  * @brief  Number of received bytes not consumed yet.
+  * @param  None
+  * @retval Number of bytes
+  */
+uint16_t WIFI_RxAvailable(void)
+{
+  uint16_t Length;
+
+  __disable_irq();
+  WIFI_RxUpdate();
+  Length = (uint16_t)(RxWritten - RxRead);
+  __enable_irq();
+
+  return Length;
+}
+
+/**
+  * @brief  Number of bytes consumed since WIFI_RxInit, i.e. the position in
+  *         the received stream of the oldest unread byte (WIFI_RxPeek(0)).
+  * @param  None
+  * @retval Number of bytes
+  */
+uint32_t WIFI_RxReadCount(void)
+{
+  return RxRead;
+}
+
+/**
+  * @brief  Number of unread bytes that belong to complete messages, i.e.
+  *         bytes that are followed by an idle line on USART2.
+  * @param  None
+  * @retval Number of bytes
+  */
+uint16_t WIFI_RxFramed(void)
+{
+  uint16_t Length = 0;
+
+  __disable_irq();
+  if ((int32_t)(RxIdleMark - RxRead) > 0)
+    Length = (uint16_t)(RxIdleMark - RxRead);
+  __enable_irq();
+
+  return Length;
+}
+
+/**
+  * @brief  Tests (and clears) the "a new message has been received" flag.
+  * @param  None
+  * @retval PASS once after every idle line, FAIL otherwise
+  */
+uint8_t WIFI_RxNewFrame(void)
+{
+  if (RxIdle == 0)
+    return FAIL;
+  RxIdle = 0;
+  return PASS;
+}
+
+/**
+  * @brief  Reads an unread byte without consuming it.
+  * @param  Offset: position from the oldest unread byte, < WIFI_RxAvailable()
+  * @retval The byte
+  */
+uint8_t WIFI_RxPeek(uint16_t Offset)
+{
+  uint16_t Index = RxTail + Offset;
+
+  if (Index >= RXBUFFERSIZE)
+    Index -= RXBUFFERSIZE;
+  return RxBuffer[Index];
+}
+
+/**
+  * @brief  Direct view of received bytes, without copying them. A consumed
+  *         byte stays valid until the DMA writes over it, i.e. until
+  *         RXBUFFERSIZE more bytes have been received.
+  * @param  Pos: position of the first byte in the received stream
+  *         (see WIFI_RxReadCount)
+  * @param  pLength: in: bytes wanted; out: bytes readable from the returned
+  *         pointer, less than wanted if the view wraps around the RxBuffer
+  * @retval Pointer to the byte at Pos, 0 if it has not been received yet or
+  *         has been written over
+  */
+const uint8_t *WIFI_RxView(uint32_t Pos, uint16_t *pLength)
+{
+  uint32_t Written, Read;
+  uint16_t Tail;
+  int32_t  Index;
+
+  __disable_irq();
+  WIFI_RxUpdate();
+  Written = RxWritten;
+  Read = RxRead;
+  Tail = RxTail;
+  __enable_irq();
+
+  if (((int32_t)(Written - Pos) <= 0) || ((Written - Pos) >= RXBUFFERSIZE))
+  {
+    *pLength = 0;
+    return 0;
+  }
+  if (*pLength > (Written - Pos))
+    *pLength = (uint16_t)(Written - Pos);
+
+  // RxTail is the index of the stream position RxRead
+  Index = (int32_t)Tail + (int32_t)(Pos - Read);
+  if (Index < 0)
+    Index += RXBUFFERSIZE;
+  else if (Index >= RXBUFFERSIZE)
+    Index -= RXBUFFERSIZE;
+  if (*pLength > (RXBUFFERSIZE - Index))
+    *pLength = (uint16_t)(RXBUFFERSIZE - Index);
+
+  return &RxBuffer[Index];
+}
+
+/**
+  * @brief  Searches a string in the unread bytes, without consuming them.
+  * @param  pStr: string to search
+  * @param  Length: length of pStr
+  * @param  From: offset from the oldest unread byte where the search starts
+  * @retval Offset of the first match, WIFI_RX_NOT_FOUND if there is none
+  */
+uint16_t WIFI_RxFind(const uint8_t *pStr, uint16_t Length, uint16_t From)
+{
+  uint16_t Available = WIFI_RxAvailable();
+  uint16_t Start, Index;
+
+  if ((Length == 0) || (Length > Available))
+    return WIFI_RX_NOT_FOUND;
+
+  for (Start = From; Start <= (Available - Length); Start++)
+  {
+    // Every start position is tested, so overlapping prefixes are never skipped
+    for (Index = 0; Index < Length; Index++)
+    {
+      if (WIFI_RxPeek(Start + Index) != pStr[Index])
+        break;
+    }
+    if (Index == Length)
+      return Start;
+  }
+  return WIFI_RX_NOT_FOUND;
+}
+
+/**
+  * @brief  Tests if a string is present in the unread bytes.
+  * @param  pStr: string to search
+  * @param  Length: length of pStr
+  * @retval PASS if found, FAIL otherwise
+  */
+uint8_t WIFI_RxSearch(const uint8_t *pStr, uint16_t Length)
+{
+  if (WIFI_RxFind(pStr, Length, 0) == WIFI_RX_NOT_FOUND)
+    return FAIL;
+  return PASS;
+}
+
+/**
+  * @brief  Copies and consumes the oldest unread bytes.
+  * @param  pDst: destination buffer
+  * @param  MaxLength: size of pDst
+  * @retval Number of bytes copied
+  */
+uint16_t WIFI_RxRead(uint8_t *pDst, uint16_t MaxLength)
+{
+  uint16_t Length = WIFI_RxAvailable();
+  uint16_t Index;
+
+  if (Length > MaxLength)
+    Length = MaxLength;
+  for (Index = 0; Index < Length; Index++)
+    pDst[Index] = WIFI_RxPeek(Index);
+  WIFI_RxConsume(Length);
+
+  return Length;
+}
+
+/**
+  * @brief  Consumes the oldest unread bytes.
+  * @param  Length: number of bytes to drop, clipped to WIFI_RxAvailable()
+  * @retval None
+  */
+void WIFI_RxConsume(uint16_t Length)
+{
+  __disable_irq();
+  WIFI_RxUpdate();
+  if (Length > (uint16_t)(RxWritten - RxRead))
+    Length = (uint16_t)(RxWritten - RxRead);
+  RxRead += Length;
+  RxTail += Length;
+  if (RxTail >= RXBUFFERSIZE)
+    RxTail -= RXBUFFERSIZE;
+  __enable_irq();
+}
+
+/**
+  * @brief  Consumes every received byte (the old "clear the RxBuffer").
+  * @param  None
+  * @retval None
+  */
+void WIFI_RxFlush(void)
+{
+  __disable_irq();
+  WIFI_RxUpdate();
+  RxRead = RxWritten;
+  RxTail = RxHead;
+  RxIdle = 0;
+  __enable_irq();
+}
+
+/**
+  * @brief  Number of overruns since WIFI_RxInit.
+  * @param  None
+  * @retval Number of overruns
+  */
+uint16_t WIFI_RxOverruns(void)
+{
+  return RxLost;
+}
+
+/**
+  * @brief  DMA1 Channel5 half/full transfer: sample the ring position.
+  *         Called from DMA1_Channel4_5_IRQHandler.
+  * @param  None
+  * @retval None
+  */
+void WIFI_RxDMA_IRQHandler(void)
+{
+  if ((DMA_GetITStatus(DMA1_IT_HT5) != RESET) || (DMA_GetITStatus(DMA1_IT_TC5) != RESET))
+  {
+    DMA_ClearITPendingBit(DMA1_IT_GL5);
+    WIFI_RxUpdate();
+  }
+}
+
+/**
+  * @brief  USART2 idle line and overrun error. Called from USART2_IRQHandler.
+  * @param  None
+  * @retval None
+  */
+void WIFI_Rx_IRQHandler(void)
+{
+  if (USART_GetITStatus(USART2, USART_IT_IDLE) != RESET)
+  {
+    USART_ClearITPendingBit(USART2, USART_IT_IDLE);
+    WIFI_RxUpdate();
+    RxIdleMark = RxWritten;
+    RxIdle = 1;
+  }
+  if (USART_GetFlagStatus(USART2, USART_FLAG_ORE) != RESET)
+  {
+    // The DMA was too late and a byte has been lost
+    USART_ClearFlag(USART2, USART_FLAG_ORE);
+    RxLost++;
+  }
+}
+
+/**
+  * @brief  Brings RxWritten up to date with the DMA position and drops the
+  *         oldest bytes if the DMA has overwritten them.
+  *         Must be called with interrupts disabled or from an ISR.
+  * @param  None
+  * @retval None
+  */
+static void WIFI_RxUpdate(void)
+{
+  uint16_t Pos = RXBUFFERSIZE - DMA_GetCurrDataCounter(DMA1_Channel5);
+
+  if (Pos >= RXBUFFERSIZE)
+    Pos = 0;
+  if (Pos >= RxHead)
+    RxWritten += Pos - RxHead;
+  else
+    RxWritten += Pos + RXBUFFERSIZE - RxHead;
+  RxHead = Pos;
+
+  if ((RxWritten - RxRead) > RXBUFFERSIZE)
+  {
+    // Keep the newest RXBUFFERSIZE bytes
+    RxRead = RxWritten - RXBUFFERSIZE;
+    RxTail = RxHead;
+    RxLost++;
+  }
+}
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    wifi_uart.h
+  * @brief   Header for wifi_uart.c: USART2 link towards the STM WiFi module.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WIFI_UART_H
+#define __WIFI_UART_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx.h"
+
+/* Exported types ------------------------------------------------------------*/
+// Called from the DMA interrupt when a submitted buffer has been handed to USART2
+typedef void (*WIFI_TxDoneCallback)(void);
+
+/* Exported constants --------------------------------------------------------*/
+#define WIFI_TX_QUEUE_SIZE		8		// Pending TX buffers, must be a power of 2
+#define WIFI_TX_FAIL					0			// Ticket returned by WIFI_TxSubmit() when the queue is full
+#define WIFI_RX_NOT_FOUND			0xFFFF	// Returned by WIFI_RxFind()
+
+/* Exported macro ------------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+void     WIFI_TxInit(void);
+uint16_t WIFI_TxSubmit(const uint8_t *pData, uint16_t Length, WIFI_TxDoneCallback Callback);
+uint8_t  WIFI_TxDone(uint16_t Ticket);
+uint8_t  WIFI_TxBusy(void);
+uint8_t  WIFI_TxFree(void);
+void     WIFI_TxFlush(void);
+void     WIFI_TxDMA_IRQHandler(void);
+
+void     WIFI_RxInit(void);
+uint16_t WIFI_RxAvailable(void);
+uint32_t WIFI_RxReadCount(void);
+uint16_t WIFI_RxFramed(void);
+uint8_t  WIFI_RxNewFrame(void);
+uint8_t  WIFI_RxPeek(uint16_t Offset);
+const uint8_t *WIFI_RxView(uint32_t Pos, uint16_t *pLength);
+uint16_t WIFI_RxFind(const uint8_t *pStr, uint16_t Length, uint16_t From);
+uint8_t  WIFI_RxSearch(const uint8_t *pStr, uint16_t Length);
+uint16_t WIFI_RxRead(uint8_t *pDst, uint16_t MaxLength);
+void     WIFI_RxConsume(uint16_t Length);
+void     WIFI_RxFlush(void);
+uint16_t WIFI_RxOverruns(void);
+void     WIFI_RxDMA_IRQHandler(void);
+void     WIFI_Rx_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_UART_H */